@@ -0,0 +1,128 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "systems/VesselSystem.h"
+#include "FidelityGovernor.h"
+
+//Weight of the newest frame in the moving averages, about the last 20 frames count
+const double FIDELITY_AVERAGE_WEIGHT = 0.1;
+
+
+FidelityGovernor::FidelityGovernor() {
+	frameCost = 0.0;
+	hold = 0;
+	switches = 0;
+	enabled = false;
+}
+
+void FidelityGovernor::init(const FidelityConfig& config, const std::vector<VesselSystem*>& systems) {
+	this->config = config;
+	this->systems.clear();
+	lowered.clear();
+	bool adjustable = false;
+	for (auto it : systems) {
+		//Consecutive phases, so systems decimated by powers of two only share a frame with every one they can't avoid
+		it->setDecimationPhase((unsigned int)this->systems.size());
+		this->systems.push_back(Governed{ it, 0.0, std::vector<double>(it->countFidelityLevels(), 0.0), 0.0 });
+		adjustable = adjustable || it->countFidelityLevels() > 1;
+	}
+	hold = config.hold;
+	enabled = config.budget > 0.0 && adjustable;
+	if (enabled) {
+		Olog::info("Fidelity governor with a budget of %.3f ms per frame", config.budget);
+	}
+}
+
+bool FidelityGovernor::isEnabled() const {
+	return enabled;
+}
+
+void FidelityGovernor::addCost(unsigned int system, double seconds) {
+	if (system < systems.size()) {
+		systems[system].frameCost += seconds;
+	}
+}
+
+void FidelityGovernor::endFrame(double timeAcceleration) {
+	double total = 0.0;
+	for (auto& it : systems) {
+		it.cost += FIDELITY_AVERAGE_WEIGHT * (it.frameCost - it.cost);
+		it.frameCost = 0.0;
+		total += it.cost;
+	}
+	frameCost = total;
+	if (--hold > 0) {
+		return;
+	}
+
+	//The most detailed level is off limits at high time acceleration
+	if (timeAcceleration > config.warp) {
+		for (unsigned int i = 0; i < systems.size(); ++i) {
+			if (systems[i].system->getFidelity() == 0 && systems[i].system->countFidelityLevels() > 1) {
+				lower(i);
+				return;
+			}
+		}
+	}
+
+	double budget = config.budget * 1.0E-3;
+	if (frameCost > budget) {
+		int expensive = -1;
+		for (unsigned int i = 0; i < systems.size(); ++i) {
+			VesselSystem* system = systems[i].system;
+			if (system->getFidelity() + 1 < system->countFidelityLevels() && (expensive < 0 || systems[i].cost > systems[expensive].cost)) {
+				expensive = (int)i;
+			}
+		}
+		if (expensive >= 0) {
+			lower(expensive);
+		}
+	}
+	else if (!lowered.empty()) {
+		unsigned int last = lowered.back();
+		Governed& governed = systems[last];
+		int level = governed.system->getFidelity() - 1;
+		double expected = frameCost - governed.cost + (level < (int)governed.levelCost.size() ? governed.levelCost[level] : 0.0);
+		if (expected < config.headroom * budget && (level > 0 || timeAcceleration <= config.warp)) {
+			raise(last);
+		}
+	}
+}
+
+double FidelityGovernor::getFrameCost() const {
+	return frameCost;
+}
+
+unsigned int FidelityGovernor::countSwitches() const {
+	return switches;
+}
+
+void FidelityGovernor::lower(unsigned int system) {
+	Governed& governed = systems[system];
+	int level = governed.system->getFidelity();
+	remember(governed, level);
+	governed.system->setFidelity(level + 1);
+	lowered.push_back(system);
+	hold = config.hold;
+	switches++;
+	Olog::info("%s steps at fidelity level %d, %.3f ms per frame", governed.system->getName(), level + 1, frameCost * 1.0E3);
+}
+
+void FidelityGovernor::raise(unsigned int system) {
+	Governed& governed = systems[system];
+	int level = governed.system->getFidelity();
+	remember(governed, level);
+	governed.system->setFidelity(level - 1);
+	lowered.pop_back();
+	hold = config.hold;
+	switches++;
+	Olog::info("%s steps at fidelity level %d, %.3f ms per frame", governed.system->getName(), level - 1, frameCost * 1.0E3);
+}
+
+void FidelityGovernor::remember(Governed& governed, int level) {
+	//Systems may offer more levels than when the governor started, e.g. after detailed neutronics were turned on
+	if (level >= (int)governed.levelCost.size()) {
+		governed.levelCost.resize(level + 1, 0.0);
+	}
+	governed.levelCost[level] = governed.cost;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include "model/FidelityConfig.h"
+
+class VesselSystem;
+
+/**
+ * \brief Picks the fidelity level of every vessel system so their step stays within a frame time budget.
+ *
+ * The vessel reports the time each system took in every frame. The governor keeps a moving average of that cost per
+ * system and, while the frame runs over the budget, steps the most expensive system that still has a cheaper level one
+ * level down. The cost a system had at the level it left is remembered: once the frame is expected to stay below the
+ * headroom fraction of the budget with that cost, the system that was lowered last is raised again. Between two
+ * switches the governor holds for a number of frames, so the average reflects the new level before the next decision.
+ *
+ * Above the configured time acceleration no system steps at its most detailed level, the large steps don't resolve
+ * its transients anyway. The systems carry their state across a switch, see VesselSystem::setFidelity.
+ * Every system gets its own decimation phase, so the decimated levels of different systems step on different frames.
+ */
+class FidelityGovernor {
+public:
+	FidelityGovernor();
+
+	/* The governor stays disabled without a budget or without a system that offers more than one level.
+	 */
+	void init(const FidelityConfig& config, const std::vector<VesselSystem*>& systems);
+	bool isEnabled() const;
+
+	//Time the system at the index passed to init took in this frame, in s
+	void addCost(unsigned int system, double seconds);
+	/* Called after all systems stepped, switches at most one system for the next frame.
+	 */
+	void endFrame(double timeAcceleration);
+
+	//Moving average of the time of all systems per frame in s
+	double getFrameCost() const;
+	unsigned int countSwitches() const;
+
+private:
+	struct Governed {
+		VesselSystem* system;
+		//Moving average of the cost per frame in s, and the cost at every level when it was last left
+		double cost;
+		std::vector<double> levelCost;
+		double frameCost;
+	};
+
+	FidelityConfig config;
+	std::vector<Governed> systems;
+	//Systems lowered for the budget, the last one lowered is raised first
+	std::vector<unsigned int> lowered;
+	double frameCost;
+	int hold;
+	unsigned int switches;
+	bool enabled;
+
+	void lower(unsigned int system);
+	void raise(unsigned int system);
+	void remember(Governed& governed, int level);
+};
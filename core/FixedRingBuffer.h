@@ -0,0 +1,61 @@
+#pragma once
+
+/**
+ * \brief Ring buffer with a capacity fixed at compile time.
+ * 
+ * Elements are stored inline, so the buffer never allocates. When the buffer is full, 
+ * pushing a new element overwrites the oldest one.
+ */
+template <typename T, unsigned int CAPACITY>
+class FixedRingBuffer {
+public:
+	FixedRingBuffer() : head(0), count(0) {}
+
+	void push(const T& element) {
+		entries[head] = element;
+		head = (head + 1) % CAPACITY;
+		if (count < CAPACITY) count++;
+	}
+
+	void clear() {
+		head = 0;
+		count = 0;
+	}
+
+	unsigned int size() const {
+		return count;
+	}
+
+	unsigned int capacity() const {
+		return CAPACITY;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	/**
+	 * \brief Access elements by age.
+	 * \param age 0 is the most recently pushed element, size() - 1 the oldest one.
+	 */
+	const T& newest(unsigned int age) const {
+		return entries[(head + CAPACITY - 1 - age) % CAPACITY];
+	}
+
+	T& newest(unsigned int age) {
+		return entries[(head + CAPACITY - 1 - age) % CAPACITY];
+	}
+
+	/**
+	 * \brief Access elements in insertion order.
+	 * \param pos 0 is the oldest element still in the buffer, size() - 1 the newest one.
+	 */
+	const T& oldest(unsigned int pos) const {
+		return entries[(head + CAPACITY - count + pos) % CAPACITY];
+	}
+
+private:
+	T entries[CAPACITY];
+	unsigned int head;
+	unsigned int count;
+};
@@ -0,0 +1,118 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "JobSystem.h"
+
+
+JobSystem::JobSystem(unsigned int workers) {
+	workerCount = max(workers, 1u);
+	stopping = false;
+}
+
+JobSystem::~JobSystem() {
+	std::deque<std::shared_ptr<State>> pending;
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+		pending.swap(queue);
+	}
+	wake.notify_all();
+	for (auto& it : pending) {
+		it->cancelled.store(true);
+		finish(*it);
+	}
+	for (auto& it : workers) {
+		it.join();
+	}
+}
+
+unsigned int JobSystem::countWorkers() const {
+	return workerCount;
+}
+
+void JobSystem::submit(const std::shared_ptr<State>& state) {
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		if (workers.empty()) {
+			for (unsigned int i = 0; i < workerCount; ++i) {
+				workers.push_back(std::thread(&JobSystem::runWorker, this));
+			}
+		}
+		queue.push_back(state);
+	}
+	wake.notify_one();
+}
+
+void JobSystem::runWorker() {
+	while (true) {
+		std::shared_ptr<State> state;
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+			wake.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (queue.empty()) {
+				return;
+			}
+			state = queue.front();
+			queue.pop_front();
+		}
+		if (!state->cancelled.load(std::memory_order_relaxed)) {
+			state->work(state->cancelled);
+		}
+		finish(*state);
+	}
+}
+
+void JobSystem::finish(State& state) {
+	//The work is released here, so captures don't outlive the job
+	state.work = nullptr;
+	std::lock_guard<std::mutex> lock(state.mutex);
+	state.done.store(true, std::memory_order_release);
+	state.finished.notify_all();
+}
+
+
+Job::Job() {}
+
+bool Job::submit(JobSystem& jobs, const JobSystem::Work& work) {
+	if (isPending()) {
+		return false;
+	}
+	state = std::make_shared<JobSystem::State>();
+	state->work = work;
+	state->cancelled.store(false);
+	state->done.store(false);
+	jobs.submit(state);
+	return true;
+}
+
+bool Job::isPending() const {
+	return state && !state->done.load(std::memory_order_acquire);
+}
+
+bool Job::isDone() const {
+	return state && state->done.load(std::memory_order_acquire);
+}
+
+bool Job::isCancelled() const {
+	return state && state->cancelled.load(std::memory_order_relaxed);
+}
+
+void Job::cancel() {
+	if (state) {
+		state->cancelled.store(true, std::memory_order_relaxed);
+	}
+}
+
+void Job::wait() {
+	if (!state) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [this] { return state->done.load(std::memory_order_acquire); });
+}
+
+void Job::reset() {
+	if (!isPending()) {
+		state.reset();
+	}
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \brief Worker threads for computations that take longer than a frame.
+ *
+ * Systems submit work and poll its Job from preStep, they never block on it. The work gets a cancellation flag it
+ * should check now and then, e.g. once per iteration, and returns early once it is set. Jobs run in the order they
+ * were submitted. The workers are only started with the first job, so vessels that never submit cost nothing.
+ * Every vessel has a job system of its own, so a fleet of vessels has as many workers as vessels.
+ */
+class JobSystem {
+public:
+	typedef std::function<void(const std::atomic<bool>& cancelled)> Work;
+
+	/* One worker by default: a system has at most one job pending, and more workers per vessel would only multiply
+	 * the threads of a fleet. 0 counts as one.
+	 */
+	explicit JobSystem(unsigned int workers = 1);
+	/* Cancels the jobs that did not start yet and waits for the running ones.
+	 */
+	~JobSystem();
+
+	unsigned int countWorkers() const;
+
+private:
+	friend class Job;
+
+	struct State {
+		Work work;
+		std::atomic<bool> cancelled;
+		std::atomic<bool> done;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	unsigned int workerCount;
+	std::vector<std::thread> workers;
+	std::deque<std::shared_ptr<State>> queue;
+	std::mutex queueMutex;
+	std::condition_variable wake;
+	bool stopping;
+
+	void submit(const std::shared_ptr<State>& state);
+	void runWorker();
+	static void finish(State& state);
+};
+
+/**
+ * \brief Handle of one job at a time, owned by the submitting system.
+ */
+class Job {
+public:
+	Job();
+
+	/* Queues work, returns false while the last job is still pending.
+	 */
+	bool submit(JobSystem& jobs, const JobSystem::Work& work);
+	//Submitted and not finished
+	bool isPending() const;
+	//Finished or cancelled, and not reset yet
+	bool isDone() const;
+	bool isCancelled() const;
+	/* Sets the cancellation flag of the work. A queued job doesn't run anymore, a running one when it checks the flag.
+	 */
+	void cancel();
+	/* Blocks until the job finished, for destructors of the owner.
+	 */
+	void wait();
+	//Forgets a finished job, so the next one can be submitted
+	void reset();
+
+private:
+	std::shared_ptr<JobSystem::State> state;
+};
+
+/**
+ * \brief Two buffers of a result computed by a job: the job writes the back one while the system reads the front one.
+ *
+ * collect() exchanges the buffers once a job finished without being cancelled, by flipping an index, so T needs not
+ * be copyable. The back buffer keeps the result before the last one, which makes a good start for iterative work.
+ */
+template <typename T>
+class BackgroundResult {
+public:
+	//Returns false if it did not produce a result, the buffers then stay as they are
+	typedef std::function<bool(T& result, const std::atomic<bool>& cancelled)> Work;
+
+	BackgroundResult() : front(0), produced(false) {}
+	~BackgroundResult() {
+		job.cancel();
+		job.wait();
+	}
+
+	T& get() {
+		return buffers[front];
+	}
+	const T& get() const {
+		return buffers[front];
+	}
+	/* Only valid while no job is pending.
+	 */
+	T& getBack() {
+		return buffers[1 - front];
+	}
+
+	bool submit(JobSystem& jobs, const Work& work) {
+		if (job.isPending()) {
+			return false;
+		}
+		job.reset();
+		produced = false;
+		T* back = &buffers[1 - front];
+		return job.submit(jobs, [this, back, work](const std::atomic<bool>& cancelled) {
+			produced = work(*back, cancelled) && !cancelled.load(std::memory_order_relaxed);
+		});
+	}
+
+	bool isPending() const {
+		return job.isPending();
+	}
+
+	/* Makes the result of a finished job the front buffer. Returns true if there was a new result.
+	 */
+	bool collect() {
+		if (!job.isDone()) {
+			return false;
+		}
+		bool fresh = produced && !job.isCancelled();
+		job.reset();
+		if (fresh) {
+			front = 1 - front;
+		}
+		return fresh;
+	}
+
+	/* Discards the result of the pending job, e.g. when its inputs were invalidated.
+	 */
+	void cancel() {
+		job.cancel();
+	}
+	void wait() {
+		job.wait();
+	}
+
+private:
+	T buffers[2];
+	int front;
+	//Written by the job before it is done, read after
+	bool produced;
+	Job job;
+};
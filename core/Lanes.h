@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cmath>
+
+/**
+ * \brief N doubles processed in lock-step, one per SIMD lane.
+ *
+ * All operations are plain loops over the lanes with no dependencies between them, which the compiler turns into
+ * vector instructions of the target (SSE2, AVX2 or AVX-512 for 2, 4 or 8 doubles per register). Code templated on
+ * the value type runs with double for a single instance and with Lanes<N> for N instances.
+ *
+ * Branches become masks: compute both sides and select() per lane.
+ * min and max are macros in windows.h, use minimum() and maximum() instead.
+ */
+template <unsigned int N>
+struct alignas(sizeof(double) * (N < 8 ? N : 8)) Lanes {
+	double v[N];
+
+	Lanes() = default;
+	Lanes(double value) {
+		for (unsigned int i = 0; i < N; ++i) v[i] = value;
+	}
+
+	double& operator[](unsigned int i) { return v[i]; }
+	const double& operator[](unsigned int i) const { return v[i]; }
+
+	Lanes& operator+=(const Lanes& other) {
+		for (unsigned int i = 0; i < N; ++i) v[i] += other.v[i];
+		return *this;
+	}
+	Lanes& operator-=(const Lanes& other) {
+		for (unsigned int i = 0; i < N; ++i) v[i] -= other.v[i];
+		return *this;
+	}
+	Lanes& operator*=(const Lanes& other) {
+		for (unsigned int i = 0; i < N; ++i) v[i] *= other.v[i];
+		return *this;
+	}
+	Lanes& operator/=(const Lanes& other) {
+		for (unsigned int i = 0; i < N; ++i) v[i] /= other.v[i];
+		return *this;
+	}
+};
+
+/**
+ * \brief Result of a comparison of Lanes, one flag per lane.
+ */
+template <unsigned int N>
+struct LaneMask {
+	bool v[N];
+
+	LaneMask() = default;
+	LaneMask(bool value) {
+		for (unsigned int i = 0; i < N; ++i) v[i] = value;
+	}
+
+	bool& operator[](unsigned int i) { return v[i]; }
+	const bool& operator[](unsigned int i) const { return v[i]; }
+
+	bool any() const {
+		bool result = false;
+		for (unsigned int i = 0; i < N; ++i) result |= v[i];
+		return result;
+	}
+};
+
+/**
+ * \brief Number of lanes and mask type of a value type, so templated code can address single lanes.
+ */
+template <typename Real>
+struct LaneTraits;
+
+template <>
+struct LaneTraits<double> {
+	static const unsigned int COUNT = 1;
+	typedef bool Mask;
+};
+
+template <unsigned int N>
+struct LaneTraits<Lanes<N>> {
+	static const unsigned int COUNT = N;
+	typedef LaneMask<N> Mask;
+};
+
+inline double& lane(double& value, unsigned int) { return value; }
+inline const double& lane(const double& value, unsigned int) { return value; }
+inline bool& lane(bool& value, unsigned int) { return value; }
+inline const bool& lane(const bool& value, unsigned int) { return value; }
+
+template <unsigned int N>
+inline double& lane(Lanes<N>& value, unsigned int i) { return value.v[i]; }
+template <unsigned int N>
+inline const double& lane(const Lanes<N>& value, unsigned int i) { return value.v[i]; }
+template <unsigned int N>
+inline bool& lane(LaneMask<N>& value, unsigned int i) { return value.v[i]; }
+template <unsigned int N>
+inline const bool& lane(const LaneMask<N>& value, unsigned int i) { return value.v[i]; }
+
+//Scalar versions, so templated code compiles for double
+inline double minimum(double a, double b) { return a < b ? a : b; }
+inline double maximum(double a, double b) { return a > b ? a : b; }
+inline double select(bool mask, double a, double b) { return mask ? a : b; }
+
+
+#define LANES_BINARY_OPERATOR(OP) \
+	template <unsigned int N> \
+	inline Lanes<N> operator OP(const Lanes<N>& a, const Lanes<N>& b) { \
+		Lanes<N> r; \
+		for (unsigned int i = 0; i < N; ++i) r.v[i] = a.v[i] OP b.v[i]; \
+		return r; \
+	} \
+	template <unsigned int N> \
+	inline Lanes<N> operator OP(const Lanes<N>& a, double b) { \
+		Lanes<N> r; \
+		for (unsigned int i = 0; i < N; ++i) r.v[i] = a.v[i] OP b; \
+		return r; \
+	} \
+	template <unsigned int N> \
+	inline Lanes<N> operator OP(double a, const Lanes<N>& b) { \
+		Lanes<N> r; \
+		for (unsigned int i = 0; i < N; ++i) r.v[i] = a OP b.v[i]; \
+		return r; \
+	}
+
+#define LANES_COMPARISON(OP) \
+	template <unsigned int N> \
+	inline LaneMask<N> operator OP(const Lanes<N>& a, const Lanes<N>& b) { \
+		LaneMask<N> r; \
+		for (unsigned int i = 0; i < N; ++i) r.v[i] = a.v[i] OP b.v[i]; \
+		return r; \
+	} \
+	template <unsigned int N> \
+	inline LaneMask<N> operator OP(const Lanes<N>& a, double b) { \
+		LaneMask<N> r; \
+		for (unsigned int i = 0; i < N; ++i) r.v[i] = a.v[i] OP b; \
+		return r; \
+	}
+
+#define LANES_FUNCTION2(NAME, EXPRESSION) \
+	template <unsigned int N> \
+	inline Lanes<N> NAME(const Lanes<N>& a, const Lanes<N>& b) { \
+		Lanes<N> r; \
+		for (unsigned int i = 0; i < N; ++i) { double x = a.v[i], y = b.v[i]; r.v[i] = EXPRESSION; } \
+		return r; \
+	} \
+	template <unsigned int N> \
+	inline Lanes<N> NAME(const Lanes<N>& a, double y) { \
+		Lanes<N> r; \
+		for (unsigned int i = 0; i < N; ++i) { double x = a.v[i]; r.v[i] = EXPRESSION; } \
+		return r; \
+	} \
+	template <unsigned int N> \
+	inline Lanes<N> NAME(double x, const Lanes<N>& b) { \
+		Lanes<N> r; \
+		for (unsigned int i = 0; i < N; ++i) { double y = b.v[i]; r.v[i] = EXPRESSION; } \
+		return r; \
+	}
+
+LANES_BINARY_OPERATOR(+)
+LANES_BINARY_OPERATOR(-)
+LANES_BINARY_OPERATOR(*)
+LANES_BINARY_OPERATOR(/)
+LANES_COMPARISON(<)
+LANES_COMPARISON(<=)
+LANES_COMPARISON(>)
+LANES_COMPARISON(>=)
+LANES_FUNCTION2(minimum, x < y ? x : y)
+LANES_FUNCTION2(maximum, x > y ? x : y)
+LANES_FUNCTION2(pow, std::pow(x, y))
+
+#undef LANES_BINARY_OPERATOR
+#undef LANES_COMPARISON
+#undef LANES_FUNCTION2
+
+template <unsigned int N>
+inline Lanes<N> operator-(const Lanes<N>& a) {
+	Lanes<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = -a.v[i];
+	return r;
+}
+
+template <unsigned int N>
+inline Lanes<N> sqrt(const Lanes<N>& a) {
+	Lanes<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = std::sqrt(a.v[i]);
+	return r;
+}
+
+template <unsigned int N>
+inline Lanes<N> exp(const Lanes<N>& a) {
+	Lanes<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = std::exp(a.v[i]);
+	return r;
+}
+
+template <unsigned int N>
+inline LaneMask<N> operator&(const LaneMask<N>& a, const LaneMask<N>& b) {
+	LaneMask<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = a.v[i] && b.v[i];
+	return r;
+}
+
+template <unsigned int N>
+inline LaneMask<N> operator|(const LaneMask<N>& a, const LaneMask<N>& b) {
+	LaneMask<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = a.v[i] || b.v[i];
+	return r;
+}
+
+/**
+ * \brief Per lane a where the mask is set, b otherwise. Both sides are always computed.
+ */
+template <unsigned int N>
+inline Lanes<N> select(const LaneMask<N>& mask, const Lanes<N>& a, const Lanes<N>& b) {
+	Lanes<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = mask.v[i] ? a.v[i] : b.v[i];
+	return r;
+}
+
+template <unsigned int N>
+inline Lanes<N> select(const LaneMask<N>& mask, const Lanes<N>& a, double b) {
+	Lanes<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = mask.v[i] ? a.v[i] : b;
+	return r;
+}
+
+template <unsigned int N>
+inline Lanes<N> select(const LaneMask<N>& mask, double a, const Lanes<N>& b) {
+	Lanes<N> r;
+	for (unsigned int i = 0; i < N; ++i) r.v[i] = mask.v[i] ? a : b.v[i];
+	return r;
+}
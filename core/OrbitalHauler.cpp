@@ -7,15 +7,24 @@
 #include "Oparse.h"
 #include "model/Models.h"
 #include "event/Events.h"
+#include "core/Trace.h"
+#include "core/StepProfiler.h"
 
 #include "systems/VesselSystem.h"
 #include "systems/mainengine/MainEngine.h"
 #include "systems/rcs/ReactionControlSystem.h"
+#include "systems/rcs/Autopilot.h"
 #include "systems/dockport/DockPort.h"
+#include "systems/tanks/PropellantTanks.h"
+#include "systems/telemetry/TelemetryRecorder.h"
+#include "systems/telemetry/TrendRecorder.h"
+#include "systems/faults/FaultInjector.h"
 
 #include "core/OrbitalHauler.h"
 #include "mfds/LANTRMFD.h"
 
+#include <chrono>
+
 
 using namespace Oparse;
 
@@ -44,6 +53,9 @@ DLLCLBK void InitModule(HINSTANCE hModule) {
 // Vessel class
 
 OrbitalHauler::OrbitalHauler(OBJHANDLE hVessel, int flightmodel) : VESSEL4(hVessel, flightmodel) { 
+	displayDecimation = 1;
+	config = NULL;
+	profiler = NULL;
 	registerPowerplantMFD();
 }
 
@@ -53,6 +65,7 @@ OrbitalHauler::~OrbitalHauler() {
 	for (const auto& it : systems) {
 		delete it;
 	}
+	delete config;
 
 }
 
@@ -81,17 +94,47 @@ void OrbitalHauler::clbkSetClassCaps(FILEHANDLE cfg) {
 		throw std::runtime_error("Errors in OrbitalHauler config, see log for details!");
 	}
 
+	createSystems(config);
+	// Keep the anomaly log of this vessel across sessions and crashes
+	mainEngine->openAnomalyLog((string("OrbitalHauler_") + GetName() + ".anomalies").c_str());
+}
+
+void OrbitalHauler::createSystems(const OrbitalHaulerConfig& configuration) {
+	// The systems keep references into their configuration
+	config = new OrbitalHaulerConfig(configuration);
+	const OrbitalHaulerConfig& config = *this->config;
+
+	displayDecimation = config.displayConfig.refreshDecimation;
+
 	phLO2 = CreatePropellantResource(TUG_LO2TANK_MAXIMUM_MASS);
 	phLH2 = CreatePropellantResource(TUG_LH2TANK_MAXIMUM_MASS);
+	phRCS = CreatePropellantResource(TUG_RCS_ACCUMULATOR_MAXIMUM_MASS);
 
 	// Initialise vessel systems
+	// The tanks go first, so the other systems see the propellant load of this step
+	systems.push_back(tanks = new PropellantTanks(this, config.tankConfig, phLH2, phLO2, phRCS));
 	systems.push_back(mainEngine = new MainEngine(this, config.mainEngineConfig,  phLH2, phLO2));
-	systems.push_back(new ReactionControlSystem(config.rcsConfig, this));
-	systems.push_back(new DockPort(this));
+	// The autopilot works with the mass properties of the stack and commands the RCS, so it steps in between
+	systems.push_back(dockPort = new DockPort(this, config.dockConfig));
+	ReactionControlSystem* rcs = new ReactionControlSystem(config.rcsConfig, this, phRCS);
+	systems.push_back(autopilot = new Autopilot(this, config.autopilotConfig, rcs));
+	systems.push_back(rcs);
+	// Faults take effect from the next step of the systems before
+	systems.push_back(faults = new FaultInjector(this, config.faultConfig, mainEngine, tanks, rcs));
+
+	systems.push_back(trends = new TrendRecorder(this));
+	mainEngine->registerTrends(*trends);
+
+	// Telemetry samples after all other systems stepped, so it has to stay last
+	TelemetryRecorder* telemetry = new TelemetryRecorder(this, config.telemetryConfig);
+	mainEngine->registerTelemetry(*telemetry);
+	tanks->registerTelemetry(*telemetry);
+	systems.push_back(telemetry);
 
 	for (const auto& it : systems) {
 		it->init(eventBroker);
 	}
+	governor.init(config.fidelityConfig, systems);
 
 	// Event will be propagated in first clbkPreStep
 	eventBroker.publish(EVENTTOPIC::GENERAL, new SimpleEvent(EVENTTYPE::SIMULATIONSTARTEDEVENT));
@@ -100,19 +143,93 @@ void OrbitalHauler::clbkSetClassCaps(FILEHANDLE cfg) {
 
 
 void OrbitalHauler::clbkPreStep(double  simt, double  simdt, double  mjd) {
+	OH_TRACE_FRAME("clbkPreStep");
 	
 	// Propagate due events.
 	// This should always remain at the beginning of clbkPreStep and never be called anywhere else.
+	if (profiler != NULL) profiler->beginPhase("EventBroker::processEvents");
 	eventBroker.processEvents();
-	for (const auto& it : systems) {
-		it->preStep(simt, simdt, mjd);
+	if (profiler != NULL) profiler->endPhase("EventBroker::processEvents");
+	bool governed = governor.isEnabled();
+	for (unsigned int i = 0; i < systems.size(); ++i) {
+		VesselSystem* system = systems[i];
+		OH_TRACE_SCOPE(system->getName());
+		if (profiler != NULL) profiler->beginPhase(system->getName());
+		auto start = governed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+		system->preStep(simt, simdt, mjd);
+		if (governed) governor.addCost(i, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		if (profiler != NULL) profiler->endPhase(system->getName());
+	}
+	// Pick the fidelity of the next frame from the cost of this one
+	if (governed) {
+		governor.endFrame(oapiGetTimeAcceleration());
 	}
 
 }
 
+int OrbitalHauler::clbkConsumeBufferedKey(DWORD key, bool down, char* kstate) {
+	// The plain keys are left to Orbiter and the MFDs
+	if (!down || !KEYMOD_ALT(kstate)) {
+		return 0;
+	}
+	switch (key) {
+	case OAPI_KEY_K:
+		autopilot->killRotation();
+		return 1;
+	case OAPI_KEY_J:
+		autopilot->holdAttitude();
+		return 1;
+	case OAPI_KEY_D: {
+		const DockingTarget* target = dockPort->getTarget();
+		if (target == NULL) {
+			Olog::warn("No docking target in sensor range for the approach");
+			return 1;
+		}
+		autopilot->approach(target->vessel);
+		return 1;
+	}
+	case OAPI_KEY_O:
+		autopilot->off();
+		return 1;
+	}
+	return 0;
+}
+
 MainEngine* OrbitalHauler::Powerplant() const {
 	return mainEngine;
 }
 
+PropellantTanks* OrbitalHauler::Tanks() const {
+	return tanks;
+}
+
+Autopilot* OrbitalHauler::Guidance() const {
+	return autopilot;
+}
+
+DockPort* OrbitalHauler::Docking() const {
+	return dockPort;
+}
+
+TrendRecorder* OrbitalHauler::Trends() const {
+	return trends;
+}
+
+FaultInjector* OrbitalHauler::Faults() const {
+	return faults;
+}
+
+JobSystem& OrbitalHauler::Jobs() {
+	return jobs;
+}
+
+int OrbitalHauler::DisplayDecimation() const {
+	return displayDecimation;
+}
+
+void OrbitalHauler::setStepProfiler(StepProfiler* profiler) {
+	this->profiler = profiler;
+}
+
 
 
@@ -4,6 +4,8 @@
 #include <VesselAPI.h>
 #include <systems/VesselSystem.h>
 #include <event/Events.h>
+#include "core/FidelityGovernor.h"
+#include "core/JobSystem.h"
 
 using namespace std;
 
@@ -14,8 +16,18 @@ const double TUG_LH2TANK_MAXIMUM_MASS = TUG_NUMBER_LH2_TANKS * 5000.0;
 /* Maximum mass of the LO2 inside the tank, based on the LUNOX shuttle concept, assuming a MR of 3.0 for high-DV maneuvers.
  */
 const double TUG_LO2TANK_MAXIMUM_MASS = 30000.0;
+/* Maximum mass of the LH2 in the RCS accumulator, which is refilled from the sump tank.
+ */
+const double TUG_RCS_ACCUMULATOR_MAXIMUM_MASS = 500.0;
 
 class MainEngine;
+class PropellantTanks;
+class Autopilot;
+class DockPort;
+class TrendRecorder;
+class FaultInjector;
+class StepProfiler;
+struct OrbitalHaulerConfig;
 
 
 class OrbitalHauler : public VESSEL4 {
@@ -24,21 +36,56 @@ public:
 	~OrbitalHauler();
 	void clbkSetClassCaps(FILEHANDLE cfg);
 	void clbkPreStep(double  simt, double  simdt, double  mjd);
+	/* Autopilot keys: Alt+K kills the rotation, Alt+J holds the attitude, Alt+D approaches the docking target and
+	 * Alt+O switches the autopilot off.
+	 */
+	int clbkConsumeBufferedKey(DWORD key, bool down, char* kstate);
+	/* Creates and initialises the vessel systems from a copy of a parsed configuration.
+	 * Called by clbkSetClassCaps, headless tools call it directly with a configuration of their own.
+	 */
+	void createSystems(const OrbitalHaulerConfig& config);
 	MainEngine* Powerplant() const;
+	PropellantTanks* Tanks() const;
+	Autopilot* Guidance() const;
+	DockPort* Docking() const;
+	TrendRecorder* Trends() const;
+	FaultInjector* Faults() const;
+	//Worker threads for computations of the systems that span several frames
+	JobSystem& Jobs();
+	//MFD refreshes per reading of the displayed values
+	int DisplayDecimation() const;
+	/* Reports the phases of every step to a profiler, NULL detaches it. The profiler must outlive the vessel or be detached.
+	 */
+	void setStepProfiler(StepProfiler* profiler);
 private:
 	MainEngine* mainEngine;
+	PropellantTanks* tanks;
+	Autopilot* autopilot;
+	DockPort* dockPort;
+	TrendRecorder* trends;
+	FaultInjector* faults;
+	int displayDecimation;
+	//Configuration the systems were created from
+	OrbitalHaulerConfig* config;
+	StepProfiler* profiler;
 
 	vector<VesselSystem*> systems;
 	/* Six cylindrical LH2 tanks around the propellant tank section. Can be individually enabled or isolated.
 	 * Single point refueling is possible over the sump tank.
 	 * Propellant tanks leaks could be a possible failure mode.
+	 * Holds the liquid of the open tanks, the tanks themselves are modelled by PropellantTanks.
 	 */
 	PROPELLANT_HANDLE phLH2;
 	/* There is only a single central LO2 tank, since it is not flight critical - return to any point of safety should be possible on LH2 only.
 	 */
 	PROPELLANT_HANDLE phLO2;
+	/* Accumulator of the RCS thrusters.
+	 */
+	PROPELLANT_HANDLE phRCS;
 
 	EventBroker eventBroker;
+	FidelityGovernor governor;
+	JobSystem jobs;
 
 	void registerPowerplantMFD();
 };
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "Procedure.h"
+
+#include <exception>
+
+//Coroutine frames are pooled in size classes of PROCEDURE_FRAME_GRANULE bytes, larger ones come from the heap
+const size_t PROCEDURE_FRAME_GRANULE = 64;
+const size_t PROCEDURE_FRAME_CLASSES = 16;
+
+namespace {
+	struct FramePool {
+		std::vector<void*> free[PROCEDURE_FRAME_CLASSES];
+
+		~FramePool();
+	};
+
+	thread_local FramePool framePool;
+	//Frames released while the thread exits go back to the heap
+	thread_local bool framePoolClosed = false;
+
+	FramePool::~FramePool() {
+		framePoolClosed = true;
+		for (auto& it : free) {
+			for (void* frame : it) {
+				::operator delete(frame);
+			}
+		}
+	}
+
+	size_t frameClass(size_t size) {
+		return (size + PROCEDURE_FRAME_GRANULE - 1) / PROCEDURE_FRAME_GRANULE - 1;
+	}
+}
+
+
+Procedure Procedure::promise_type::get_return_object() {
+	return Procedure(Handle::from_promise(*this));
+}
+
+void Procedure::promise_type::unhandled_exception() {
+	std::terminate();
+}
+
+void* Procedure::promise_type::operator new(size_t size) {
+	size_t sizeClass = frameClass(size);
+	if (sizeClass >= PROCEDURE_FRAME_CLASSES) {
+		return ::operator new(size);
+	}
+	std::vector<void*>& free = framePool.free[sizeClass];
+	if (free.empty()) {
+		return ::operator new((sizeClass + 1) * PROCEDURE_FRAME_GRANULE);
+	}
+	void* frame = free.back();
+	free.pop_back();
+	return frame;
+}
+
+void Procedure::promise_type::operator delete(void* frame, size_t size) {
+	size_t sizeClass = frameClass(size);
+	if (sizeClass >= PROCEDURE_FRAME_CLASSES || framePoolClosed) {
+		::operator delete(frame);
+		return;
+	}
+	framePool.free[sizeClass].push_back(frame);
+}
+
+
+Procedure::Procedure() {
+}
+
+Procedure::Procedure(Handle handle) : handle(handle) {
+}
+
+Procedure::Procedure(Procedure&& other) noexcept : handle(other.handle) {
+	other.handle = Handle();
+}
+
+Procedure& Procedure::operator=(Procedure&& other) noexcept {
+	if (this != &other) {
+		cancel();
+		handle = other.handle;
+		other.handle = Handle();
+	}
+	return *this;
+}
+
+Procedure::~Procedure() {
+	cancel();
+}
+
+bool Procedure::isRunning() const {
+	return handle && !handle.done();
+}
+
+void Procedure::cancel() {
+	if (!handle) {
+		return;
+	}
+	if (handle.promise().scheduler != NULL) {
+		handle.promise().scheduler->forget(handle);
+	}
+	handle.destroy();
+	handle = Handle();
+}
+
+
+ProcedureScheduler::Delay::Delay(ProcedureScheduler& scheduler, double due) : scheduler(scheduler), due(due) {
+}
+
+bool ProcedureScheduler::Delay::await_ready() const noexcept {
+	return due <= scheduler.now;
+}
+
+void ProcedureScheduler::Delay::await_suspend(Procedure::Handle handle) {
+	handle.promise().scheduler = &scheduler;
+	scheduler.timers.push_back(Timer{ due, handle });
+	std::push_heap(scheduler.timers.begin(), scheduler.timers.end(), &ProcedureScheduler::later);
+	scheduler.waiting++;
+}
+
+
+ProcedureScheduler::Condition::Condition(ProcedureScheduler& scheduler, const std::function<bool()>& condition, double deadline) :
+	scheduler(scheduler), condition(condition), deadline(deadline) {
+	met = false;
+}
+
+bool ProcedureScheduler::Condition::await_ready() {
+	met = condition();
+	return met;
+}
+
+void ProcedureScheduler::Condition::await_suspend(Procedure::Handle handle) {
+	handle.promise().scheduler = &scheduler;
+	scheduler.waits.push_back(Wait{ this, handle });
+	scheduler.waiting++;
+}
+
+
+ProcedureScheduler::ProcedureScheduler() {
+	now = 0.0;
+	resuming = 0;
+	waiting = 0;
+}
+
+ProcedureScheduler::~ProcedureScheduler() {
+	for (auto& it : timers) {
+		if (it.handle) it.handle.promise().scheduler = NULL;
+	}
+	for (auto& it : waits) {
+		if (it.handle) it.handle.promise().scheduler = NULL;
+	}
+}
+
+void ProcedureScheduler::start(Procedure& procedure) {
+	if (procedure.handle && !procedure.handle.done() && procedure.handle.promise().scheduler == NULL) {
+		resume(procedure.handle);
+	}
+}
+
+void ProcedureScheduler::step(double simt) {
+	now = simt;
+	while (!timers.empty() && timers.front().due <= now) {
+		std::pop_heap(timers.begin(), timers.end(), later);
+		Procedure::Handle handle = timers.back().handle;
+		timers.pop_back();
+		if (handle) {
+			waiting--;
+			resume(handle);
+		}
+	}
+
+	//Procedures resumed here may add waits, which are then evaluated in this step already
+	for (size_t i = 0; i < waits.size();) {
+		Wait wait = waits[i];
+		if (!wait.handle) {
+			waits[i] = waits.back();
+			waits.pop_back();
+			continue;
+		}
+		Condition& condition = *wait.condition;
+		condition.met = condition.condition();
+		if (!condition.met && (condition.deadline <= 0.0 || now < condition.deadline)) {
+			++i;
+			continue;
+		}
+		waits[i] = waits.back();
+		waits.pop_back();
+		waiting--;
+		resume(wait.handle);
+	}
+}
+
+ProcedureScheduler::Delay ProcedureScheduler::seconds(double duration) {
+	return Delay(*this, now + duration);
+}
+
+ProcedureScheduler::Condition ProcedureScheduler::until(const std::function<bool()>& condition, double timeout) {
+	return Condition(*this, condition, timeout > 0.0 ? now + timeout : 0.0);
+}
+
+double ProcedureScheduler::getTime() const {
+	return now;
+}
+
+bool ProcedureScheduler::isResuming() const {
+	return resuming > 0;
+}
+
+unsigned int ProcedureScheduler::countWaiting() const {
+	return waiting;
+}
+
+bool ProcedureScheduler::later(const Timer& a, const Timer& b) {
+	return a.due > b.due;
+}
+
+void ProcedureScheduler::resume(Procedure::Handle handle) {
+	handle.promise().scheduler = NULL;
+	resuming++;
+	handle.resume();
+	resuming--;
+}
+
+void ProcedureScheduler::forget(Procedure::Handle handle) {
+	for (auto& it : timers) {
+		if (it.handle == handle) {
+			it.handle = Procedure::Handle();
+			waiting--;
+		}
+	}
+	for (auto& it : waits) {
+		if (it.handle == handle) {
+			it.handle = Procedure::Handle();
+			waiting--;
+		}
+	}
+}
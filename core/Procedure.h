@@ -0,0 +1,151 @@
+#pragma once
+
+#include <coroutine>
+#include <functional>
+#include <vector>
+
+class ProcedureScheduler;
+
+/**
+ * \brief A sequence of steps written as a C++20 coroutine, that waits for sim time or for conditions with co_await.
+ *
+ * A procedure reads top to bottom like the checklist it implements, e.g.
+ *
+ *     co_await procedures.seconds(5.0);
+ *     if (!co_await procedures.until([this] { return loopPressurized(); }, 60.0)) ...
+ *
+ * instead of a state with flags and timers that is entered again every frame. The owner holds the Procedure, which
+ * destroys the coroutine when it goes out of scope or is cancelled, wherever the procedure is waiting.
+ * The frames come from a per thread pool, so starting a procedure does not allocate once the pool is warm.
+ */
+class Procedure {
+public:
+	struct promise_type {
+		//Scheduler the procedure waits on, NULL while running or after it returned
+		ProcedureScheduler* scheduler = NULL;
+
+		Procedure get_return_object();
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() {}
+		void unhandled_exception();
+
+		static void* operator new(size_t size);
+		static void operator delete(void* frame, size_t size);
+	};
+	typedef std::coroutine_handle<promise_type> Handle;
+
+	Procedure();
+	Procedure(Procedure&& other) noexcept;
+	Procedure& operator=(Procedure&& other) noexcept;
+	Procedure(const Procedure&) = delete;
+	Procedure& operator=(const Procedure&) = delete;
+	~Procedure();
+
+	//Started and neither returned nor cancelled
+	bool isRunning() const;
+	/* Destroys the coroutine. A procedure must not cancel itself, it returns instead.
+	 */
+	void cancel();
+
+private:
+	friend class ProcedureScheduler;
+
+	Handle handle;
+
+	explicit Procedure(Handle handle);
+};
+
+/**
+ * \brief Resumes the procedures of a vessel once what they wait for is due.
+ *
+ * Procedures waiting for sim time sit in a heap ordered by their due time, so a step only looks at the earliest one
+ * and a waiting procedure costs nothing until it is due. Procedures waiting for a condition have it evaluated once per
+ * step until it holds or its timeout expires. Time is the sim time of the last step.
+ */
+class ProcedureScheduler {
+public:
+	/* Awaits the given sim time in seconds.
+	 */
+	class Delay {
+	public:
+		bool await_ready() const noexcept;
+		void await_suspend(Procedure::Handle handle);
+		void await_resume() const noexcept {}
+
+	private:
+		friend class ProcedureScheduler;
+
+		ProcedureScheduler& scheduler;
+		double due;
+
+		Delay(ProcedureScheduler& scheduler, double due);
+	};
+
+	/* Awaits a condition, evaluates to true if it holds and to false if the timeout expired first.
+	 */
+	class Condition {
+	public:
+		bool await_ready();
+		void await_suspend(Procedure::Handle handle);
+		bool await_resume() const noexcept { return met; }
+
+	private:
+		friend class ProcedureScheduler;
+
+		ProcedureScheduler& scheduler;
+		std::function<bool()> condition;
+		//Sim time at which the wait gives up, 0.0 for never
+		double deadline;
+		bool met;
+
+		Condition(ProcedureScheduler& scheduler, const std::function<bool()>& condition, double deadline);
+	};
+
+	ProcedureScheduler();
+	/* Procedures still waiting are left to their owners, they are just not resumed anymore.
+	 */
+	~ProcedureScheduler();
+
+	/* Runs a procedure up to its first wait.
+	 */
+	void start(Procedure& procedure);
+	/* Resumes every procedure whose wait is over, call once per frame.
+	 */
+	void step(double simt);
+
+	Delay seconds(double duration);
+	//timeout in seconds, 0.0 to wait for the condition forever
+	Condition until(const std::function<bool()>& condition, double timeout = 0.0);
+
+	//Sim time of the last step
+	double getTime() const;
+	//True while a procedure runs, e.g. to tell its transitions from those of others
+	bool isResuming() const;
+	//Procedures waiting for time or a condition
+	unsigned int countWaiting() const;
+
+private:
+	friend class Procedure;
+
+	struct Timer {
+		double due;
+		Procedure::Handle handle;
+	};
+
+	struct Wait {
+		Condition* condition;
+		Procedure::Handle handle;
+	};
+
+	//Min-heap by due time, cancelled entries have no handle and are dropped when they come up
+	std::vector<Timer> timers;
+	std::vector<Wait> waits;
+	double now;
+	int resuming;
+	unsigned int waiting;
+
+	static bool later(const Timer& a, const Timer& b);
+	void resume(Procedure::Handle handle);
+	void forget(Procedure::Handle handle);
+};
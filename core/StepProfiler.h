@@ -0,0 +1,16 @@
+#pragma once
+
+/**
+ * \brief Receives the phases of a vessel step: the event broker and the preStep of every system.
+ *
+ * Profilers of the headless harness attach to a vessel with OrbitalHauler::setStepProfiler to measure each phase on
+ * its own, e.g. with hardware counters. Without one, the step only checks for it.
+ * Phase names are string literals, the same pointer for the same phase in every step.
+ */
+class StepProfiler {
+public:
+	virtual ~StepProfiler() {};
+
+	virtual void beginPhase(const char* name) = 0;
+	virtual void endPhase(const char* name) = 0;
+};
@@ -0,0 +1,127 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+#include "Trace.h"
+
+struct TraceBuffer {
+	unsigned int thread;
+	std::atomic<uint64_t> head;
+	TraceEvent events[TRACE_BUFFER_EVENTS];
+};
+
+std::atomic<bool> Trace::enabled(false);
+
+//Buffers of all threads that recorded since the process started, a thread's buffer outlives it
+static std::mutex traceMutex;
+static std::vector<std::unique_ptr<TraceBuffer>> traceBuffers;
+static std::chrono::steady_clock::time_point traceStart;
+static double traceSpikeThreshold = 0.0;
+static std::string traceSpikeFile;
+
+static TraceBuffer* threadBuffer() {
+	thread_local TraceBuffer* buffer = NULL;
+	if (buffer == NULL) {
+		std::lock_guard<std::mutex> lock(traceMutex);
+		traceBuffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer()));
+		buffer = traceBuffers.back().get();
+		buffer->thread = (unsigned int)traceBuffers.size();
+		buffer->head.store(0);
+	}
+	return buffer;
+}
+
+void Trace::start() {
+	std::lock_guard<std::mutex> lock(traceMutex);
+	for (auto& it : traceBuffers) {
+		it->head.store(0, std::memory_order_relaxed);
+	}
+	traceStart = std::chrono::steady_clock::now();
+	enabled.store(true, std::memory_order_release);
+}
+
+void Trace::stop() {
+	enabled.store(false, std::memory_order_release);
+}
+
+bool Trace::isCompiled() {
+#ifdef OH_TRACING
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Trace::begin(const char* name) {
+	record(name, TRACEPHASE::BEGIN, 0.0);
+}
+
+void Trace::end(const char* name) {
+	record(name, TRACEPHASE::END, 0.0);
+}
+
+void Trace::counter(const char* name, double value) {
+	record(name, TRACEPHASE::COUNTER, value);
+}
+
+void Trace::record(const char* name, TRACEPHASE phase, double value) {
+	if (!isEnabled()) {
+		return;
+	}
+	TraceBuffer* buffer = threadBuffer();
+	uint64_t head = buffer->head.load(std::memory_order_relaxed);
+	TraceEvent& event = buffer->events[head % TRACE_BUFFER_EVENTS];
+	event.name = name;
+	event.time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - traceStart).count();
+	event.value = value;
+	event.phase = phase;
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Trace::setSpikeThreshold(double threshold, const char* filename) {
+	std::lock_guard<std::mutex> lock(traceMutex);
+	traceSpikeThreshold = threshold;
+	traceSpikeFile = filename;
+}
+
+void Trace::frameEnd(double duration) {
+	if (!isEnabled() || traceSpikeThreshold <= 0.0 || duration <= traceSpikeThreshold) {
+		return;
+	}
+	//Every spike overwrites the last one, the buffers then start over
+	stop();
+	write(traceSpikeFile.c_str());
+	start();
+}
+
+bool Trace::write(const char* filename) {
+	FILE* file = fopen(filename, "w");
+	if (file == NULL) {
+		return false;
+	}
+	std::lock_guard<std::mutex> lock(traceMutex);
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (const auto& buffer : traceBuffers) {
+		uint64_t head = buffer->head.load(std::memory_order_acquire);
+		uint64_t begin = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+		for (uint64_t i = begin; i < head; ++i) {
+			const TraceEvent& event = buffer->events[i % TRACE_BUFFER_EVENTS];
+			double time = event.time * 1.0E-3;
+			if (event.phase == TRACEPHASE::COUNTER) {
+				fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%.9g}}",
+					first ? "" : ",\n", event.name, time, buffer->thread, event.value);
+			}
+			else {
+				fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+					first ? "" : ",\n", event.name, event.phase == TRACEPHASE::BEGIN ? 'B' : 'E', time, buffer->thread);
+			}
+			first = false;
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+	return fclose(file) == 0;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/**
+ * \file Trace.h
+ * Timeline of the hot paths, written as Chrome trace JSON for chrome://tracing or ui.perfetto.dev.
+ *
+ * Code marks scopes with OH_TRACE_SCOPE and values with OH_TRACE_COUNTER. The macros only record anything when the
+ * build defines OH_TRACING, without it they expand to nothing and cost nothing. With it, they cost a check of a flag
+ * until Trace::start().
+ *
+ * Every thread records into a ring buffer of its own, so recording takes no lock: the event is stored and the head
+ * moved with release semantics. The buffers keep the last TRACE_BUFFER_EVENTS events of every thread, older ones are
+ * overwritten. Write the trace after Trace::stop(), events recorded while it is written may be garbled.
+ *
+ * OH_TRACE_FRAME marks the scope of a whole frame. Frames slower than the spike threshold write the trace right away,
+ * so the timeline around a spike is kept even though the buffers move on.
+ * Names must be string literals, only the pointers are stored.
+ */
+
+//Events kept per thread
+const unsigned int TRACE_BUFFER_EVENTS = 1 << 15;
+
+enum class TRACEPHASE { BEGIN, END, COUNTER };
+
+struct TraceEvent {
+	const char* name;
+	//ns since Trace::start()
+	int64_t time;
+	double value;
+	TRACEPHASE phase;
+};
+
+class Trace {
+public:
+	/* Clears the buffers and starts recording.
+	 */
+	static void start();
+	static void stop();
+	static bool isEnabled() {
+		return enabled.load(std::memory_order_relaxed);
+	}
+	//Whether the macros record anything in this build
+	static bool isCompiled();
+
+	static void begin(const char* name);
+	static void end(const char* name);
+	static void counter(const char* name, double value);
+
+	/* Frames slower than threshold in s write the trace to filename. 0.0 disables.
+	 */
+	static void setSpikeThreshold(double threshold, const char* filename);
+	static void frameEnd(double duration);
+
+	/* Writes the events of all threads as Chrome trace JSON. Returns false if the file can't be written.
+	 */
+	static bool write(const char* filename);
+
+private:
+	static std::atomic<bool> enabled;
+	static void record(const char* name, TRACEPHASE phase, double value);
+};
+
+/* Records the begin and end of a scope.
+ */
+class TraceScope {
+public:
+	TraceScope(const char* name) : name(name) {
+		Trace::begin(name);
+	}
+	~TraceScope() {
+		Trace::end(name);
+	}
+private:
+	const char* name;
+};
+
+/* Scope of a frame, checked against the spike threshold.
+ */
+class TraceFrame {
+public:
+	TraceFrame(const char* name) : name(name), started(std::chrono::steady_clock::now()) {
+		Trace::begin(name);
+	}
+	~TraceFrame() {
+		Trace::end(name);
+		Trace::frameEnd(std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count());
+	}
+private:
+	const char* name;
+	std::chrono::steady_clock::time_point started;
+};
+
+#define OH_TRACE_JOIN2(a, b) a##b
+#define OH_TRACE_JOIN(a, b) OH_TRACE_JOIN2(a, b)
+
+#ifdef OH_TRACING
+#define OH_TRACE_SCOPE(name) TraceScope OH_TRACE_JOIN(traceScope, __LINE__)(name)
+#define OH_TRACE_FRAME(name) TraceFrame OH_TRACE_JOIN(traceFrame, __LINE__)(name)
+#define OH_TRACE_COUNTER(name, value) Trace::counter(name, (double)(value))
+#else
+#define OH_TRACE_SCOPE(name)
+#define OH_TRACE_FRAME(name)
+#define OH_TRACE_COUNTER(name, value)
+#endif
@@ -6,6 +6,7 @@
 #include <deque>
 #include "EventSubscriber.h"
 #include "EventBroker.h"
+#include "core/Trace.h"
 
 using namespace std;
 
@@ -89,6 +90,8 @@ void EventBroker::publish(EVENTTOPIC topic, Event_Base* event) {
  * if an event requires longer delay, it will be re-added to the event queue instead of propagated
  */
 void EventBroker::processEvents() {
+	OH_TRACE_SCOPE("processEvents");
+	UINT sent = 0;
 
 	for (map<EVENTTOPIC, deque<Event_Base*>>::iterator it = eventqueues.begin(); it != eventqueues.end(); it++)
 	{
@@ -104,6 +107,7 @@ void EventBroker::processEvents() {
 				//if the event is due, propagate it, then delete it.
 				propagateEvent(it->first, e);
 				delete e;
+				sent++;
 			}
 			else
 			{
@@ -112,6 +116,7 @@ void EventBroker::processEvents() {
 			}
 		}
 	}
+	OH_TRACE_COUNTER("events sent", sent);
 
 }
 
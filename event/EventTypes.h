@@ -12,6 +12,8 @@
 enum class EVENTTYPE {
 	SIMULATIONSTARTEDEVENT,
 	CHANGEMODEEVENT,
+	//Mass, center of mass or inertia of the docked stack changed, a StackChangedEvent
+	STACKCHANGEDEVENT,
 };
 
 
@@ -0,0 +1,25 @@
+#pragma once
+
+/**
+ * \brief The mass properties of the docked stack changed, carries the new center of mass.
+ * Events with a different center of mass are not duplicates, so the last one in the queue is the current stack.
+ */
+class StackChangedEvent :
+    public Event_Base
+{
+public:
+
+    StackChangedEvent(const VECTOR3& centerOfMass, int delay = 1) : Event_Base(EVENTTYPE::STACKCHANGEDEVENT, delay), centerOfMass(centerOfMass) {};
+    ~StackChangedEvent() {};
+
+    virtual bool operator==(Event_Base* e) {
+        return Event_Base::operator==(e) && length(((StackChangedEvent*)e)->centerOfMass - centerOfMass) == 0.0;
+    };
+    using Event_Base::operator==;
+
+    //Center of mass of the stack in hauler coordinates
+    const VECTOR3& getCenterOfMass() const { return centerOfMass; };
+
+private:
+    VECTOR3 centerOfMass;
+};
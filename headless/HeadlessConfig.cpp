@@ -0,0 +1,177 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+
+#include "HeadlessConfig.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+using namespace Oparse;
+
+
+static std::string trim(const std::string& text) {
+	size_t first = text.find_first_not_of(" \t\r\n");
+	if (first == std::string::npos) {
+		return "";
+	}
+	size_t last = text.find_last_not_of(" \t\r\n");
+	return text.substr(first, last - first + 1);
+}
+
+static std::string lowerCase(std::string text) {
+	std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return text;
+}
+
+bool HeadlessConfig::load(const std::string& filename) {
+	std::ifstream file(filename);
+	if (!file) {
+		fprintf(stderr, "Can't read %s\n", filename.c_str());
+		return false;
+	}
+
+	values.clear();
+	std::vector<std::string> blocks;
+	std::string line;
+	int lineNumber = 0;
+
+	while (std::getline(file, line)) {
+		lineNumber++;
+		line = trim(line.substr(0, line.find(';')));
+		if (line.empty()) {
+			continue;
+		}
+
+		std::string upper = line;
+		std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return (char)std::toupper(c); });
+		if (upper.compare(0, 6, "BEGIN_") == 0) {
+			blocks.push_back(lowerCase(line.substr(6)));
+			continue;
+		}
+		if (upper.compare(0, 4, "END_") == 0) {
+			if (blocks.empty() || blocks.back() != lowerCase(line.substr(4))) {
+				fprintf(stderr, "%s:%d: unexpected %s\n", filename.c_str(), lineNumber, line.c_str());
+				return false;
+			}
+			blocks.pop_back();
+			continue;
+		}
+
+		size_t separator = line.find('=');
+		if (separator == std::string::npos) {
+			fprintf(stderr, "%s:%d: expected key = value\n", filename.c_str(), lineNumber);
+			return false;
+		}
+		std::string path;
+		for (const auto& block : blocks) {
+			path += block + "/";
+		}
+		values[path + lowerCase(trim(line.substr(0, separator)))] = trim(line.substr(separator + 1));
+	}
+
+	if (!blocks.empty()) {
+		fprintf(stderr, "%s: BEGIN_%s is never closed\n", filename.c_str(), blocks.back().c_str());
+		return false;
+	}
+	return true;
+}
+
+bool HeadlessConfig::has(const std::string& path) const {
+	return values.find(path) != values.end();
+}
+
+double HeadlessConfig::getDouble(const std::string& path, double fallback) const {
+	auto it = values.find(path);
+	return it != values.end() ? atof(it->second.c_str()) : fallback;
+}
+
+bool HeadlessConfig::getBool(const std::string& path, bool fallback) const {
+	auto it = values.find(path);
+	if (it == values.end()) {
+		return fallback;
+	}
+	std::string value = lowerCase(it->second);
+	return value == "true" || value == "1";
+}
+
+std::vector<double> HeadlessConfig::getList(const std::string& path) const {
+	std::vector<double> result;
+	auto it = values.find(path);
+	if (it == values.end()) {
+		return result;
+	}
+	std::stringstream stream(it->second);
+	std::string item;
+	while (std::getline(stream, item, ',')) {
+		result.push_back(atof(item.c_str()));
+	}
+	return result;
+}
+
+bool HeadlessConfig::hasBlock(const std::string& path) const {
+	auto it = values.lower_bound(path);
+	return it != values.end() && it->first.compare(0, path.size(), path) == 0;
+}
+
+bool HeadlessConfig::read(const std::string& path, OpModelDef& model) const {
+	bool valid = true;
+	for (const auto& it : model) {
+		std::string key = path + it.first;
+		const OpEntry& entry = it.second;
+		bool required = std::any_of(entry.validators.begin(), entry.validators.end(),
+			[](const OpValidator& validator) { return validator.kind == OpValidator::REQUIRED; });
+
+		if (entry.value.model) {
+			if (!hasBlock(key + "/")) {
+				if (required) {
+					fprintf(stderr, "Missing required block %s\n", key.c_str());
+					valid = false;
+				}
+				continue;
+			}
+			OpModelDef nested = entry.value.model();
+			valid = read(key + "/", nested) && valid;
+			continue;
+		}
+
+		auto value = values.find(key);
+		if (value == values.end()) {
+			if (required) {
+				fprintf(stderr, "Missing required key %s\n", key.c_str());
+				valid = false;
+			}
+			continue;
+		}
+		std::vector<double> numbers;
+		if (!entry.value.read(value->second, numbers)) {
+			fprintf(stderr, "Invalid value %s for %s\n", value->second.c_str(), key.c_str());
+			valid = false;
+			continue;
+		}
+		for (const auto& validator : entry.validators) {
+			for (double number : numbers) {
+				if ((validator.kind == OpValidator::MIN && number < validator.bound) ||
+					(validator.kind == OpValidator::MAX && number > validator.bound)) {
+					fprintf(stderr, "%s = %s is out of range, %s %g\n", key.c_str(), value->second.c_str(),
+						validator.kind == OpValidator::MIN ? "min" : "max", validator.bound);
+					valid = false;
+					break;
+				}
+			}
+		}
+	}
+	return valid;
+}
+
+bool HeadlessConfig::getLANTRConfig(LANTRConfig& config) const {
+	OpModelDef model = config.GetModelDef();
+	return read("lantr/", model);
+}
+
+bool HeadlessConfig::getOrbitalHaulerConfig(OrbitalHaulerConfig& config) const {
+	OpModelDef model = config.GetModelDef();
+	return read("", model);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+struct LANTRConfig;
+struct OrbitalHaulerConfig;
+namespace Oparse {
+	class OpModelDef;
+}
+
+/**
+ * \brief Reads the vessel cfg outside of Orbiter.
+ *
+ * Oparse is not available in headless builds, so this reads the subset of the cfg syntax the vessel configuration uses:
+ * "key = value" lines, nested BEGIN_NAME / END_NAME blocks and ';' comments.
+ * Values are addressed by their lower case path, e.g. "lantr/tcga/compressor/speeds".
+ * The configurations are filled through the model definitions of the vessel, so keys, required keys and bounds are
+ * the ones Oparse checks in Orbiter.
+ */
+class HeadlessConfig {
+public:
+	bool load(const std::string& filename);
+
+	bool has(const std::string& path) const;
+	double getDouble(const std::string& path, double fallback = 0.0) const;
+	bool getBool(const std::string& path, bool fallback = false) const;
+	std::vector<double> getList(const std::string& path) const;
+
+	/* Fills the engine configuration from the LANTR block. Returns false if a required key is missing or a value is
+	 * invalid or out of range.
+	 */
+	bool getLANTRConfig(LANTRConfig& config) const;
+	/* Fills the vessel configuration from all its blocks, for a whole OrbitalHauler. Blocks that are missing keep their
+	 * defaults. Returns false if a required key is missing or a value is invalid or out of range.
+	 */
+	bool getOrbitalHaulerConfig(OrbitalHaulerConfig& config) const;
+
+private:
+	std::map<std::string, std::string> values;
+
+	//True if a key in the block at path is set
+	bool hasBlock(const std::string& path) const;
+	/* Fills a model from the block at path, e.g. "lantr/", reports every missing or invalid key.
+	 */
+	bool read(const std::string& path, Oparse::OpModelDef& model) const;
+};
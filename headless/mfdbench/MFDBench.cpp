@@ -0,0 +1,209 @@
+/**
+ * \file MFDBench.cpp
+ * Renders the pages of the POWERPLANT MFD on a software sketchpad and measures the cost of a refresh.
+ *
+ * A headless OrbitalHauler runs the engine up to the target mode, then the MFD is refreshed on every page while the
+ * vessel keeps stepping in between, as in Orbiter. For every page the time of Update() is reported with the draw calls
+ * it made, so changes to the MFD can be checked for their cost like the physics with montecarlo.
+ *
+ * Usage: mfdbench [options]
+ *   --cfg <file>       vessel cfg (default: the cfg in this repository)
+ *   --refreshes <n>    refreshes per page (500)
+ *   --interval <s>     sim time between refreshes (1.0)
+ *   --dt <s>           simulation step (0.05)
+ *   --warmup <s>       sim time before the first refresh (300)
+ *   --mode <ntr|electric|lantr>   target mode of the engine (ntr)
+ *   --window <n>       trend window, as number of presses of the window button (0)
+ *   --size <px>        width and height of the MFD (256)
+ *   --png <prefix>     write the last refresh of every page to <prefix><page>.png
+ *   --budget <us>      fail if the median refresh of a page takes longer
+ *   --trace <file>     write a Chrome trace of the refreshes, in builds with OH_TRACING
+ */
+
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+#include "event/Events.h"
+#include "systems/mainengine/MainEngine.h"
+#include "systems/telemetry/TrendRecorder.h"
+#include "core/OrbitalHauler.h"
+#include "mfds/LANTRMFD.h"
+#include "core/Trace.h"
+
+#include "HeadlessConfig.h"
+#include "SoftSketchpad.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifndef OH_DEFAULT_CFG
+#define OH_DEFAULT_CFG "orbiter/Config/Vessels/OrbitalHauler/OrbitalHauler.cfg"
+#endif
+
+struct BenchOptions {
+	std::string cfg = OH_DEFAULT_CFG;
+	unsigned int refreshes = 500;
+	double interval = 1.0;
+	double dt = 0.05;
+	double warmup = 300.0;
+	int targetMode = LANTR_MODE_NTR;
+	int window = 0;
+	int size = 256;
+	std::string png;
+	double budget = 0.0;
+	std::string trace;
+};
+
+struct PageResult {
+	std::vector<double> times;
+	SketchpadStats stats;
+};
+
+/* Steps the vessel up to simt.
+ */
+static void advance(OrbitalHauler& vessel, double& simt, double until, double dt) {
+	while (simt < until) {
+		vessel.clbkPreStep(simt, dt, oapiGetSimMJD() + simt / 86400.0);
+		simt += dt;
+	}
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0.0;
+	size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[min(index, sorted.size() - 1)];
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for %s\n", arg.c_str());
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--cfg") options.cfg = value;
+		else if (arg == "--refreshes") options.refreshes = (unsigned int)atoi(value);
+		else if (arg == "--interval") options.interval = atof(value);
+		else if (arg == "--dt") options.dt = atof(value);
+		else if (arg == "--warmup") options.warmup = atof(value);
+		else if (arg == "--window") options.window = atoi(value);
+		else if (arg == "--size") options.size = atoi(value);
+		else if (arg == "--png") options.png = value;
+		else if (arg == "--budget") options.budget = atof(value);
+		else if (arg == "--trace") options.trace = value;
+		else if (arg == "--mode") {
+			std::string mode = value;
+			if (mode == "electric") options.targetMode = LANTR_MODE_ELECTRIC;
+			else if (mode == "ntr") options.targetMode = LANTR_MODE_NTR;
+			else if (mode == "lantr") options.targetMode = LANTR_MODE_LANTR;
+			else {
+				fprintf(stderr, "Unknown mode %s\n", value);
+				return false;
+			}
+		}
+		else {
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		}
+	}
+	if (options.dt <= 0.0 || options.interval <= 0.0 || options.size < 64 || options.refreshes == 0) {
+		fprintf(stderr, "dt and interval must be positive, size at least 64 and refreshes at least 1\n");
+		return false;
+	}
+	if (!options.trace.empty() && !Trace::isCompiled()) {
+		fprintf(stderr, "--trace needs a build with -DOH_TRACING=ON\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	HeadlessConfig cfg;
+	OrbitalHaulerConfig config = OrbitalHaulerConfig();
+	if (!cfg.load(options.cfg) || !cfg.getOrbitalHaulerConfig(config)) {
+		return 1;
+	}
+	//The steps run unpaced, solutions on worker threads would lag far behind the drums
+	config.mainEngineConfig.neutronics.background = false;
+
+	OrbitalHauler vessel((OBJHANDLE)1, 1);
+	vessel.createSystems(config);
+	vessel.Powerplant()->setTargetMode(options.targetMode);
+	double simt = 0.0;
+	advance(vessel, simt, options.warmup, options.dt);
+
+	LANTRMFD mfd(options.size, options.size, &vessel);
+	SoftSketchpad sketchpad(options.size, options.size);
+	for (int i = 0; i < options.window; ++i) {
+		mfd.ConsumeKeyBuffered(OAPI_KEY_W);
+	}
+
+	unsigned int pages = vessel.Trends()->countTrends() + 1;
+	std::vector<PageResult> results(pages);
+	printf("Rendering %u pages of %dx%d, %u refreshes each, every %.2f s sim time, engine %s\n", pages, options.size, options.size,
+		options.refreshes, options.interval, controllerStateLabel(vessel.Powerplant()->getCurrentMode()));
+
+	if (!options.trace.empty()) {
+		Trace::start();
+	}
+
+	for (unsigned int page = 0; page < pages; ++page) {
+		PageResult& result = results[page];
+		sketchpad.resetStats();
+		for (unsigned int refresh = 0; refresh < options.refreshes; ++refresh) {
+			advance(vessel, simt, simt + options.interval, options.dt);
+			sketchpad.clear();
+			auto start = std::chrono::steady_clock::now();
+			mfd.Update(&sketchpad);
+			result.times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+		}
+		result.stats = sketchpad.getStats();
+
+		if (!options.png.empty()) {
+			std::string filename = options.png + std::to_string(page) + ".png";
+			if (!sketchpad.writePNG(filename.c_str())) {
+				fprintf(stderr, "Can't write %s\n", filename.c_str());
+				return 1;
+			}
+		}
+		mfd.ConsumeKeyBuffered(OAPI_KEY_G);
+	}
+
+	if (!options.trace.empty()) {
+		Trace::stop();
+		if (!Trace::write(options.trace.c_str())) {
+			fprintf(stderr, "Can't write %s\n", options.trace.c_str());
+			return 1;
+		}
+	}
+
+	bool overBudget = false;
+	printf("\n  %-8s %10s %10s %10s %10s   per refresh: %6s %6s %6s %8s\n", "page", "mean", "p50", "p95", "max", "texts", "chars", "lines", "pixels");
+	for (unsigned int page = 0; page < pages; ++page) {
+		PageResult& result = results[page];
+		std::sort(result.times.begin(), result.times.end());
+		double mean = 0.0;
+		for (double time : result.times) mean += time;
+		mean /= result.times.size();
+		double n = (double)options.refreshes;
+		double median = percentile(result.times, 0.5);
+		printf("  %-8s %8.2f us %7.2f us %7.2f us %7.2f us   %18.1f %6.1f %6.1f %8.0f\n", page == 0 ? "STATUS" : vessel.Trends()->getName(page - 1),
+			mean, median, percentile(result.times, 0.95), result.times.back(),
+			result.stats.texts / n, result.stats.characters / n, result.stats.lines / n, result.stats.pixels / n);
+		if (options.budget > 0.0 && median > options.budget) {
+			overBudget = true;
+		}
+	}
+	if (overBudget) {
+		printf("\nMedian refresh over the budget of %.2f us\n", options.budget);
+		return 1;
+	}
+	return 0;
+}
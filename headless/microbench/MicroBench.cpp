@@ -0,0 +1,778 @@
+/**
+ * \file MicroBench.cpp
+ * Micro-benchmarks of the hot paths of the vessel: event broker, main engine step, heat transfer, docked stack mass
+ * properties and MFD refresh.
+ *
+ * Every benchmark runs its body for a calibrated number of iterations, repeated several times, and reports the median
+ * time per iteration. Results can be written as JSON in the layout of Google Benchmark, and compared against a stored
+ * baseline: benchmarks slower than the threshold are flagged and fail the run, so a performance change can be checked
+ * before it is committed.
+ *
+ * Before anything is timed, the incremental sums of the docked stack are checked against the stack built from scratch
+ * after a long random sequence of docking, mass changes and undocking, and the propellant tanks are run through random
+ * loads, empty ones among them, steps and draws. The autopilot has to kill a tumble of a vessel and rotate it back into
+ * its attitude, with the attitude dynamics integrated from the torques of its thrusters. The detailed neutronics are
+ * solved on the job system while the engine starts in frames paced by the wall clock, and have to be collected,
+ * cancelled and shut down cleanly. A mismatch fails the run.
+ *
+ *   microbench --json baseline.json              store a baseline
+ *   microbench --baseline baseline.json          compare against it
+ *
+ * Usage: microbench [options]
+ *   --cfg <file>         vessel cfg (default: the cfg in this repository)
+ *   --filter <text>      only run benchmarks whose name contains text
+ *   --min-time <s>       minimum time of one repetition (0.05)
+ *   --repetitions <n>    repetitions per benchmark, the median is reported (5)
+ *   --json <file>        write the results
+ *   --baseline <file>    compare with results written before
+ *   --threshold <f>      relative slowdown against the baseline that counts as regression (0.10)
+ */
+
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+#include "event/Events.h"
+#include "systems/mainengine/MainEngine.h"
+#include "systems/mainengine/EngineKernel.h"
+#include "systems/telemetry/TrendRecorder.h"
+#include "systems/dockport/StackMassProperties.h"
+#include "systems/tanks/PropellantTanks.h"
+#include "systems/rcs/ReactionControlSystem.h"
+#include "systems/rcs/Autopilot.h"
+#include "core/OrbitalHauler.h"
+#include "mfds/LANTRMFD.h"
+
+#include "HeadlessConfig.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+
+#ifndef OH_DEFAULT_CFG
+#define OH_DEFAULT_CFG "orbiter/Config/Vessels/OrbitalHauler/OrbitalHauler.cfg"
+#endif
+
+//Simulation step of the engine benchmarks
+const double BENCH_DT = 0.05;
+//Longest sim time to wait for the engine to reach a mode
+const double BENCH_MODE_TIMEOUT = 900.0;
+//Slots of the docked stack, the hauler and its ports
+const unsigned int BENCH_STACK_SLOTS = 8;
+//Relative difference up to which the incremental stack matches the one built from scratch
+const double BENCH_STACK_TOLERANCE = 1e-9;
+//Relative error up to which the propellant of the tanks is conserved
+const double BENCH_TANK_TOLERANCE = 1e-9;
+//Body rate in rad/s and attitude error in rad the autopilot has to settle within, the RCS fires in pulses of a minimum impulse bit
+const double BENCH_AUTOPILOT_RATE = 1e-3;
+const double BENCH_AUTOPILOT_ANGLE = 0.5 * RAD;
+//Time in s the autopilot has to settle in
+const double BENCH_AUTOPILOT_TIMEOUT = 600.0;
+//Wall clock time in s of a frame of the paced check of the background neutronics, a vessel at ten times time acceleration
+const double BENCH_PACED_FRAME = 0.005;
+//Frames of the engine startup, and new solutions they have to collect at least
+const int BENCH_PACED_FRAMES = 600;
+const int BENCH_PACED_SOLUTIONS = 10;
+//Wall clock time in s a cancelled or abandoned solve may take to stop
+const double BENCH_PACED_STOP_TIME = 0.5;
+
+struct BenchOptions {
+	std::string cfg = OH_DEFAULT_CFG;
+	std::string filter;
+	double minTime = 0.05;
+	unsigned int repetitions = 5;
+	std::string json;
+	std::string baseline;
+	double threshold = 0.10;
+};
+
+/* Runs its body for the given number of iterations.
+ */
+typedef std::function<void(unsigned long long iterations)> BenchBody;
+
+struct Benchmark {
+	std::string name;
+	//Creates the state of the benchmark and returns the body working on it, so setup is not timed
+	std::function<BenchBody()> setup;
+};
+
+struct BenchResult {
+	std::string name;
+	unsigned long long iterations;
+	//Median time per iteration in ns
+	double time;
+};
+
+//Results of the benchmark bodies go here, so the compiler can't drop them
+static volatile double sink;
+
+class CountingSubscriber : public EventSubscriber {
+public:
+	unsigned long long received = 0;
+protected:
+	virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic) {
+		received++;
+	}
+};
+
+/* One frame: depth events published over the topics, duplicates of earlier events in the given share, then processed.
+ */
+static Benchmark eventBenchmark(int topics, int depth, int duplicates) {
+	char name[128];
+	sprintf_s(name, 128, "EventBroker/topics:%d/depth:%d/duplicates:%d", topics, depth, duplicates);
+	return Benchmark{ name, [=]() {
+		struct State {
+			EventBroker broker;
+			std::vector<CountingSubscriber> subscribers;
+			std::vector<int> types;
+		};
+		std::shared_ptr<State> state(new State());
+		state->subscribers.resize(topics);
+		for (int t = 0; t < topics; ++t) {
+			state->broker.subscribe(&state->subscribers[t], (EVENTTOPIC)t);
+		}
+		//Event types only identify events, any number of them works for the broker
+		int unique = max(1, depth * (100 - duplicates) / 100);
+		std::mt19937 random(1);
+		for (int i = 0; i < depth; ++i) {
+			state->types.push_back(i < unique ? i : (int)(random() % unique));
+		}
+		return [state, topics](unsigned long long iterations) {
+			for (unsigned long long n = 0; n < iterations; ++n) {
+				for (size_t i = 0; i < state->types.size(); ++i) {
+					state->broker.publish((EVENTTOPIC)(i % topics), new SimpleEvent((EVENTTYPE)state->types[i]));
+				}
+				state->broker.processEvents();
+			}
+			sink = (double)state->subscribers[0].received;
+		};
+	} };
+}
+
+/* A main engine by itself on a stub vessel, as montecarlo runs it, held in a controller mode.
+ */
+class EngineBench {
+public:
+	EngineBench(const LANTRConfig& config) : config(config), vessel((OBJHANDLE)1, 1),
+		phLO2(vessel.CreatePropellantResource(TUG_LO2TANK_MAXIMUM_MASS)),
+		phLH2(vessel.CreatePropellantResource(TUG_LH2TANK_MAXIMUM_MASS)),
+		engine(&vessel, this->config, phLH2, phLO2), simt(0.0)
+	{
+		engine.init(eventBroker);
+	}
+
+	bool reach(int mode) {
+		engine.setTargetMode(mode);
+		for (double end = simt + BENCH_MODE_TIMEOUT; simt < end && engine.getCurrentMode() != mode; ) {
+			step();
+		}
+		return engine.getCurrentMode() == mode;
+	}
+
+	void step() {
+		engine.preStep(simt, BENCH_DT, oapiGetSimMJD());
+		simt += BENCH_DT;
+	}
+
+	MainEngine& getEngine() {
+		return engine;
+	}
+
+private:
+	LANTRConfig config;
+	OrbitalHauler vessel;
+	PROPELLANT_HANDLE phLO2;
+	PROPELLANT_HANDLE phLH2;
+	MainEngine engine;
+	EventBroker eventBroker;
+	double simt;
+};
+
+static Benchmark engineBenchmark(const LANTRConfig& config, int mode) {
+	return Benchmark{ std::string("MainEngine::preStep/") + controllerStateLabel(mode), [=]() {
+		std::shared_ptr<EngineBench> bench(new EngineBench(config));
+		if (!bench->reach(mode)) {
+			fprintf(stderr, "Engine did not reach %s, measuring %s\n", controllerStateLabel(mode), controllerStateLabel(bench->getEngine().getCurrentMode()));
+		}
+		return [bench](unsigned long long iterations) {
+			for (unsigned long long n = 0; n < iterations; ++n) {
+				bench->step();
+			}
+			sink = bench->getEngine().getChamberTemperature();
+		};
+	} };
+}
+
+static Benchmark heatTransferBenchmark() {
+	return Benchmark{ "doHeatTransfer", []() {
+		return [](unsigned long long iterations) {
+			GasFlow hot = { 14304.0, 1200.0, 2.0E6, 5.0 };
+			GasFlow cold = { 14304.0, 300.0, 2.0E6, 5.0 };
+			for (unsigned long long n = 0; n < iterations; ++n) {
+				doHeatTransfer(0.8, hot, cold);
+				//Keep the flows apart, so every iteration transfers heat
+				hot.T += 0.5;
+				cold.T -= 0.5;
+			}
+			sink = hot.T + cold.T;
+		};
+	} };
+}
+
+/* Mass, center of mass and inertia of a random body, roughly of the size of a docked vessel.
+ */
+static void randomBody(std::mt19937& random, double& mass, VECTOR3& centerOfMass, MATRIX3& inertia) {
+	std::uniform_real_distribution<double> unit(-1.0, 1.0);
+	mass = 1000.0 + 50000.0 * (unit(random) + 1.0);
+	centerOfMass = _V(5.0 * unit(random), 5.0 * unit(random), 30.0 * unit(random));
+	for (int i = 0; i < 3; ++i) {
+		for (int j = i; j < 3; ++j) {
+			inertia.data[3 * i + j] = inertia.data[3 * j + i] = i == j ? mass * (10.0 + 5.0 * unit(random)) : mass * unit(random);
+		}
+	}
+}
+
+static double relativeDifference(double a, double b, double scale) {
+	return fabs(a - b) / max(scale, 1e-300);
+}
+
+/* Docks, changes and undocks random bodies, and compares the incremental sums with a stack built from the present
+ * bodies after every change. Returns false and reports the first mismatch.
+ */
+static bool checkStack() {
+	struct Slot {
+		bool present;
+		double mass;
+		VECTOR3 centerOfMass;
+		MATRIX3 inertia;
+	};
+	std::mt19937 random(1);
+	StackMassProperties stack;
+	Slot slots[BENCH_STACK_SLOTS] = { };
+	for (int n = 0; n < 100000; ++n) {
+		unsigned int slot = random() % BENCH_STACK_SLOTS;
+		Slot& it = slots[slot];
+		if (it.present && random() % 3 == 0) {
+			stack.clearBody(slot);
+			it.present = false;
+		}
+		else {
+			randomBody(random, it.mass, it.centerOfMass, it.inertia);
+			stack.setBody(slot, it.mass, it.centerOfMass, it.inertia);
+			it.present = true;
+		}
+
+		StackMassProperties rebuilt;
+		for (unsigned int s = 0; s < BENCH_STACK_SLOTS; ++s) {
+			if (slots[s].present) {
+				rebuilt.setBody(s, slots[s].mass, slots[s].centerOfMass, slots[s].inertia);
+			}
+		}
+		if (rebuilt.getMass() <= 0.0) {
+			continue;
+		}
+		double error = relativeDifference(stack.getMass(), rebuilt.getMass(), rebuilt.getMass());
+		VECTOR3 centerOfMass = stack.getCenterOfMass();
+		VECTOR3 expectedCenter = rebuilt.getCenterOfMass();
+		for (int i = 0; i < 3; ++i) {
+			error = max(error, relativeDifference(centerOfMass.data[i], expectedCenter.data[i], 30.0));
+		}
+		MATRIX3 inertia = stack.getInertia();
+		MATRIX3 expectedInertia = rebuilt.getInertia();
+		double scale = 0.0;
+		for (int k = 0; k < 9; ++k) {
+			scale = max(scale, fabs(expectedInertia.data[k]));
+		}
+		for (int k = 0; k < 9; ++k) {
+			error = max(error, relativeDifference(inertia.data[k], expectedInertia.data[k], scale));
+		}
+		if (error > BENCH_STACK_TOLERANCE) {
+			fprintf(stderr, "Stack mass properties drifted by %g after %d changes\n", error, n + 1);
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Loads the tanks at random, a full and an empty LH2 and LO2 load among them, and steps them over random times from
+ * 0.1 to 10000 s with random draws. Checks that liquid, vapor, vented, leaked and drawn propellant add up to the load,
+ * that no tank exceeds its relief pressure, and that a dry tank never gains vapor. Returns false and reports the first
+ * violation.
+ */
+static bool checkTanks() {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> uniform(0.0, 1.0);
+	PropellantTankConfig config;
+	for (int trial = 0; trial < 16; ++trial) {
+		OrbitalHauler vessel(NULL, 1);
+		PROPELLANT_HANDLE lo2 = vessel.CreatePropellantResource(TUG_LO2TANK_MAXIMUM_MASS);
+		PROPELLANT_HANDLE lh2 = vessel.CreatePropellantResource(TUG_LH2TANK_MAXIMUM_MASS);
+		PROPELLANT_HANDLE rcs = vessel.CreatePropellantResource(TUG_RCS_ACCUMULATOR_MAXIMUM_MASS);
+		double loads[] = { 0.0, 1.0, uniform(random), 0.001 * uniform(random) };
+		vessel.SetPropellantMass(lh2, loads[trial % 4] * TUG_LH2TANK_MAXIMUM_MASS);
+		vessel.SetPropellantMass(lo2, loads[trial / 4] * TUG_LO2TANK_MAXIMUM_MASS);
+		vessel.SetPropellantMass(rcs, TUG_RCS_ACCUMULATOR_MAXIMUM_MASS);
+		PropellantTanks tanks(&vessel, config, lh2, lo2, rcs);
+		EventBroker broker;
+		tanks.init(broker);
+
+		double load = 0.0;
+		double drawn = 0.0;
+		for (int n = 0; n < 500; ++n) {
+			double dt = pow(10.0, 5.0 * uniform(random) - 1.0);
+			if (n > 0 && uniform(random) < 0.5) {
+				double draw = 0.2 * uniform(random) * vessel.GetPropellantMass(lh2);
+				vessel.SetPropellantMass(lh2, vessel.GetPropellantMass(lh2) - draw);
+				drawn += draw;
+			}
+			double vapor[PROPELLANT_TANKS];
+			for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+				vapor[i] = tanks.getLiquidMass(i) > 0.0 ? -1.0 : tanks.getVaporMass(i);
+			}
+			tanks.preStep(0.0, dt, 0.0);
+
+			double total = drawn;
+			for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+				total += tanks.getLiquidMass(i) + tanks.getVaporMass(i) + tanks.getVentedMass(i) + tanks.getLeakedMass(i);
+				double relief = i == LO2_TANK ? config.lo2.reliefPressure : config.lh2.reliefPressure;
+				if (tanks.getPressure(i) > relief * (1.0 + BENCH_TANK_TOLERANCE)) {
+					fprintf(stderr, "Tank %d at %.0f Pa above its relief pressure in trial %d\n", (int)i, tanks.getPressure(i), trial);
+					return false;
+				}
+				if (n > 0 && vapor[i] >= 0.0 && tanks.getVaporMass(i) > vapor[i] * (1.0 + BENCH_TANK_TOLERANCE)) {
+					fprintf(stderr, "Dry tank %d gained %g kg of vapor in trial %d\n", (int)i, tanks.getVaporMass(i) - vapor[i], trial);
+					return false;
+				}
+			}
+			//The first step takes over the load
+			if (n == 0) {
+				load = total;
+			}
+			else if (fabs(total - load) > BENCH_TANK_TOLERANCE * max(load, 1.0)) {
+				fprintf(stderr, "Tanks lost %g kg of %g kg after %d steps in trial %d\n", load - total, load, n, trial);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/* Rotation matrix of a rotation vector.
+ */
+static MATRIX3 rotation(const VECTOR3& axis) {
+	double angle = length(axis);
+	MATRIX3 R = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+	if (angle <= 0.0) {
+		return R;
+	}
+	VECTOR3 u = axis / angle;
+	double c = cos(angle), s = sin(angle);
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			R.data[3 * i + j] = (1.0 - c) * u.data[i] * u.data[j] + (i == j ? c : 0.0);
+		}
+	}
+	R.m12 -= s * u.z; R.m13 += s * u.y;
+	R.m21 += s * u.z; R.m23 -= s * u.x;
+	R.m31 -= s * u.y; R.m32 += s * u.x;
+	return R;
+}
+
+static MATRIX3 product(const MATRIX3& A, const MATRIX3& B) {
+	MATRIX3 C;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			C.data[3 * i + j] = A.data[3 * i] * B.data[j] + A.data[3 * i + 1] * B.data[3 + j] + A.data[3 * i + 2] * B.data[6 + j];
+		}
+	}
+	return C;
+}
+
+/* Steps a vessel with the torque of its thrusters acting on its principal moments of inertia, as Orbiter would, until
+ * its body rates, and with a target attitude its attitude error, are within the tolerance. Returns the time that took,
+ * or a negative time if they did not settle.
+ */
+static double settleAttitude(OrbitalHauler& vessel, double& simt, const MATRIX3* target) {
+	for (double settled = 0.0; settled < BENCH_AUTOPILOT_TIMEOUT; settled += BENCH_DT, simt += BENCH_DT) {
+		vessel.clbkPreStep(simt, BENCH_DT, oapiGetSimMJD());
+
+		VECTOR3 torque = _V(0, 0, 0);
+		for (DWORD i = 0; i < vessel.GetThrusterCount(); ++i) {
+			THRUSTER_HANDLE th = vessel.GetThrusterHandleByIndex(i);
+			VECTOR3 pos, dir;
+			vessel.GetThrusterRef(th, pos);
+			vessel.GetThrusterDir(th, dir);
+			torque += crossp(pos, dir * (vessel.GetThrusterLevel(th) * vessel.GetThrusterMax0(th)));
+		}
+		VECTOR3 pmi, rate;
+		vessel.GetPMI(pmi);
+		vessel.GetAngularVel(rate);
+		VECTOR3 inertia = pmi * vessel.GetMass();
+		VECTOR3 momentum = _V(inertia.x * rate.x, inertia.y * rate.y, inertia.z * rate.z);
+		VECTOR3 acceleration = torque - crossp(rate, momentum);
+		for (int i = 0; i < 3; ++i) {
+			rate.data[i] += acceleration.data[i] / inertia.data[i] * BENCH_DT;
+		}
+		MATRIX3 R;
+		vessel.GetRotationMatrix(R);
+		R = product(R, rotation(rate * BENCH_DT));
+		vessel.SetAngularVel(rate);
+		vessel.SetRotationMatrix(R);
+
+		double error = 0.0;
+		if (target != NULL) {
+			double trace = 0.0;
+			for (int k = 0; k < 9; ++k) {
+				trace += R.data[k] * target->data[k];
+			}
+			error = acos(max(-1.0, min(1.0, (trace - 1.0) * 0.5)));
+		}
+		if (length(rate) < BENCH_AUTOPILOT_RATE && error < BENCH_AUTOPILOT_ANGLE) {
+			return settled;
+		}
+	}
+	return -1.0;
+}
+
+/* Runs the autopilot in a closed loop with the attitude dynamics of the vessel: kills a tumble, then rotates back into
+ * the attitude it started in. Returns false and reports if the rates or the attitude do not settle.
+ */
+static bool checkAutopilot(const OrbitalHaulerConfig& config) {
+	OrbitalHaulerConfig configuration = config;
+	OrbitalHauler vessel((OBJHANDLE)1, 1);
+	vessel.createSystems(configuration);
+	MATRIX3 start;
+	vessel.GetRotationMatrix(start);
+	vessel.SetAngularVel(_V(0.02, -0.015, 0.03));
+
+	double simt = 0.0;
+	vessel.Guidance()->killRotation();
+	double killed = settleAttitude(vessel, simt, NULL);
+	if (killed < 0.0) {
+		fprintf(stderr, "Autopilot did not kill the rotation within %.0f s\n", BENCH_AUTOPILOT_TIMEOUT);
+		return false;
+	}
+	vessel.Guidance()->holdAttitude(start);
+	double held = settleAttitude(vessel, simt, &start);
+	if (held < 0.0) {
+		fprintf(stderr, "Autopilot did not return to the attitude within %.0f s\n", BENCH_AUTOPILOT_TIMEOUT);
+		return false;
+	}
+	vessel.Guidance()->off();
+	return true;
+}
+
+/* Steps a vessel once per BENCH_PACED_FRAME of wall clock time, so work on the job system progresses between the frames
+ * as it would in Orbiter. Returns how often the front buffer of the neutronics changed, i.e. new solutions were collected.
+ */
+static int pacedSteps(OrbitalHauler& vessel, double& simt, int frames) {
+	const NeutronDiffusion* front = &vessel.Powerplant()->getNeutronics();
+	int collected = 0;
+	auto next = std::chrono::steady_clock::now();
+	for (int n = 0; n < frames; ++n, simt += BENCH_DT) {
+		vessel.clbkPreStep(simt, BENCH_DT, oapiGetSimMJD());
+		if (&vessel.Powerplant()->getNeutronics() != front) {
+			front = &vessel.Powerplant()->getNeutronics();
+			collected++;
+		}
+		next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(BENCH_PACED_FRAME));
+		std::this_thread::sleep_until(next);
+	}
+	return collected;
+}
+
+/* Steps a vessel until a frame submitted a solve, without pacing, so the solve is still running after the step.
+ */
+static bool waitForSolve(OrbitalHauler& vessel, double& simt) {
+	for (int n = 0; n < BENCH_PACED_FRAMES; ++n, simt += BENCH_DT) {
+		vessel.clbkPreStep(simt, BENCH_DT, oapiGetSimMJD());
+		if (vessel.Powerplant()->isNeutronicsPending()) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* Starts the engine with the detailed neutronics solved on the job system, as the cfg ships it, in frames paced by the
+ * wall clock. The solutions have to be collected while the engine starts, a solve cancelled by a drop to the lumped
+ * model must stop quickly and never be collected, the solutions must resume after the return to the detailed model,
+ * and a vessel deleted while a solve runs must shut its job system down quickly. Returns false and reports the first
+ * failure.
+ */
+static bool checkBackgroundNeutronics(const OrbitalHaulerConfig& config) {
+	OrbitalHaulerConfig configuration = config;
+	configuration.mainEngineConfig.neutronics.detailed = true;
+	configuration.mainEngineConfig.neutronics.background = true;
+	std::unique_ptr<OrbitalHauler> vessel(new OrbitalHauler((OBJHANDLE)1, 1));
+	vessel->createSystems(configuration);
+	MainEngine* engine = vessel->Powerplant();
+	engine->setTargetMode(LANTR_MODE_NTR);
+
+	double simt = 0.0;
+	int collected = pacedSteps(*vessel, simt, BENCH_PACED_FRAMES);
+	if (collected < BENCH_PACED_SOLUTIONS) {
+		fprintf(stderr, "Only %d background solutions collected in %d paced frames\n", collected, BENCH_PACED_FRAMES);
+		return false;
+	}
+
+	if (!waitForSolve(*vessel, simt)) {
+		fprintf(stderr, "No background solve started in %d paced frames\n", BENCH_PACED_FRAMES);
+		return false;
+	}
+	const NeutronDiffusion* front = &engine->getNeutronics();
+	engine->setFidelity(ENGINE_FIDELITY_LUMPED_NEUTRONICS);
+	auto start = std::chrono::steady_clock::now();
+	while (engine->isNeutronicsPending() && secondsSince(start) < BENCH_PACED_STOP_TIME) {
+		std::this_thread::yield();
+	}
+	if (engine->isNeutronicsPending()) {
+		fprintf(stderr, "Cancelled background solve still running after %.1f s\n", BENCH_PACED_STOP_TIME);
+		return false;
+	}
+	engine->setFidelity(ENGINE_FIDELITY_FULL);
+	pacedSteps(*vessel, simt, 1);
+	if (&engine->getNeutronics() != front) {
+		fprintf(stderr, "Cancelled background solution was collected\n");
+		return false;
+	}
+	engine->setTargetMode(LANTR_MODE_LANTR);
+	collected = pacedSteps(*vessel, simt, BENCH_PACED_FRAMES);
+	if (collected < BENCH_PACED_SOLUTIONS) {
+		fprintf(stderr, "Only %d background solutions collected after the return to detailed neutronics\n", collected);
+		return false;
+	}
+
+	if (!waitForSolve(*vessel, simt)) {
+		fprintf(stderr, "No background solve started in %d paced frames\n", BENCH_PACED_FRAMES);
+		return false;
+	}
+	start = std::chrono::steady_clock::now();
+	vessel.reset();
+	if (secondsSince(start) > BENCH_PACED_STOP_TIME) {
+		fprintf(stderr, "Vessel took %.2f s to shut down its job system\n", secondsSince(start));
+		return false;
+	}
+	return true;
+}
+
+/* Mass change of one docked body, as the payloads burn propellant.
+ */
+static Benchmark stackBenchmark() {
+	return Benchmark{ "StackMassProperties::setBody", []() {
+		std::shared_ptr<StackMassProperties> stack(new StackMassProperties());
+		std::shared_ptr<std::mt19937> random(new std::mt19937(1));
+		double mass;
+		VECTOR3 centerOfMass;
+		MATRIX3 inertia;
+		for (unsigned int slot = 0; slot < BENCH_STACK_SLOTS; ++slot) {
+			randomBody(*random, mass, centerOfMass, inertia);
+			stack->setBody(slot, mass, centerOfMass, inertia);
+		}
+		return [=](unsigned long long iterations) {
+			for (unsigned long long n = 0; n < iterations; ++n) {
+				stack->setBody((unsigned int)(n % BENCH_STACK_SLOTS), mass + (double)(n % 100), centerOfMass, inertia);
+				sink = stack->getCenterOfMass().z;
+			}
+		};
+	} };
+}
+
+/* Refreshes of one page of the POWERPLANT MFD of a whole vessel, drawn on a sketchpad that does nothing.
+ */
+static Benchmark mfdBenchmark(const OrbitalHaulerConfig& config, unsigned int page, const char* label) {
+	return Benchmark{ std::string("LANTRMFD::Update/") + label, [=]() {
+		struct State {
+			OrbitalHaulerConfig config;
+			std::unique_ptr<OrbitalHauler> vessel;
+			std::unique_ptr<LANTRMFD> mfd;
+			oapi::Sketchpad sketchpad;
+		};
+		std::shared_ptr<State> state(new State());
+		state->config = config;
+		state->vessel.reset(new OrbitalHauler((OBJHANDLE)1, 1));
+		state->vessel->createSystems(state->config);
+		state->vessel->Powerplant()->setTargetMode(LANTR_MODE_NTR);
+		for (double simt = 0.0; simt < 300.0; simt += BENCH_DT) {
+			state->vessel->clbkPreStep(simt, BENCH_DT, oapiGetSimMJD());
+		}
+		state->mfd.reset(new LANTRMFD(256, 256, state->vessel.get()));
+		for (unsigned int i = 0; i < page; ++i) {
+			state->mfd->ConsumeKeyBuffered(OAPI_KEY_G);
+		}
+		return [state](unsigned long long iterations) {
+			for (unsigned long long n = 0; n < iterations; ++n) {
+				state->mfd->Update(&state->sketchpad);
+			}
+		};
+	} };
+}
+
+static double runOnce(const BenchBody& body, unsigned long long iterations) {
+	auto start = std::chrono::steady_clock::now();
+	body(iterations);
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult runBenchmark(const Benchmark& benchmark, const BenchOptions& options) {
+	BenchBody body = benchmark.setup();
+
+	//Grow the iterations until one repetition takes the minimum time
+	unsigned long long iterations = 1;
+	double elapsed = runOnce(body, iterations);
+	while (elapsed < options.minTime && iterations < (1ULL << 40)) {
+		double factor = elapsed > 0.0 ? min(10.0, 1.4 * options.minTime / elapsed) : 10.0;
+		iterations = (unsigned long long)(iterations * max(factor, 2.0));
+		elapsed = runOnce(body, iterations);
+	}
+
+	std::vector<double> times;
+	for (unsigned int r = 0; r < options.repetitions; ++r) {
+		times.push_back(runOnce(body, iterations) * 1.0E9 / iterations);
+	}
+	std::sort(times.begin(), times.end());
+	return BenchResult{ benchmark.name, iterations, times[times.size() / 2] };
+}
+
+static bool writeJson(const std::string& filename, const std::vector<BenchResult>& results) {
+	FILE* out = fopen(filename.c_str(), "w");
+	if (out == NULL) {
+		fprintf(stderr, "Can't write %s\n", filename.c_str());
+		return false;
+	}
+	//One benchmark per line, which is all readBaseline relies on
+	fprintf(out, "{\n  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); ++i) {
+		fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"real_time\": %.3f, \"time_unit\": \"ns\"}%s\n",
+			results[i].name.c_str(), results[i].iterations, results[i].time, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+	fclose(out);
+	return true;
+}
+
+static bool readBaseline(const std::string& filename, std::map<std::string, double>& baseline) {
+	std::ifstream file(filename);
+	if (!file) {
+		fprintf(stderr, "Can't read %s\n", filename.c_str());
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		size_t name = line.find("\"name\": \"");
+		size_t time = line.find("\"real_time\": ");
+		if (name == std::string::npos || time == std::string::npos) {
+			continue;
+		}
+		name += 9;
+		baseline[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + time + 13);
+	}
+	return true;
+}
+
+static bool parseOptions(int argc, char** argv, BenchOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for %s\n", arg.c_str());
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--cfg") options.cfg = value;
+		else if (arg == "--filter") options.filter = value;
+		else if (arg == "--min-time") options.minTime = atof(value);
+		else if (arg == "--repetitions") options.repetitions = (unsigned int)atoi(value);
+		else if (arg == "--json") options.json = value;
+		else if (arg == "--baseline") options.baseline = value;
+		else if (arg == "--threshold") options.threshold = atof(value);
+		else {
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		}
+	}
+	if (options.minTime <= 0.0 || options.repetitions == 0) {
+		fprintf(stderr, "min-time and repetitions must be positive\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	BenchOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	HeadlessConfig cfg;
+	OrbitalHaulerConfig config = OrbitalHaulerConfig();
+	if (!cfg.load(options.cfg) || !cfg.getOrbitalHaulerConfig(config)) {
+		return 1;
+	}
+	//The background solutions are checked in paced frames, the benchmarks run unpaced, so solutions on worker threads
+	//would lag far behind and their cost would not be measured
+	if (!checkBackgroundNeutronics(config)) {
+		return 1;
+	}
+	config.mainEngineConfig.neutronics.background = false;
+	if (!checkStack() || !checkTanks() || !checkAutopilot(config)) {
+		return 1;
+	}
+	std::map<std::string, double> baseline;
+	if (!options.baseline.empty() && !readBaseline(options.baseline, baseline)) {
+		return 1;
+	}
+
+	std::vector<Benchmark> benchmarks;
+	for (int topics : { 1, 4, 16 }) {
+		for (int depth : { 1, 8, 64 }) {
+			for (int duplicates : { 0, 50, 90 }) {
+				benchmarks.push_back(eventBenchmark(topics, depth, duplicates));
+			}
+		}
+	}
+	for (int mode : { LANTR_MODE_OFF, LANTR_MODE_ELECTRIC, LANTR_MODE_NTR, LANTR_MODE_LANTR }) {
+		benchmarks.push_back(engineBenchmark(config.mainEngineConfig, mode));
+	}
+	benchmarks.push_back(heatTransferBenchmark());
+	benchmarks.push_back(stackBenchmark());
+	benchmarks.push_back(mfdBenchmark(config, 0, "STATUS"));
+	benchmarks.push_back(mfdBenchmark(config, 1, "TREND"));
+
+	std::vector<BenchResult> results;
+	int regressions = 0;
+	printf("%-52s %12s %14s %12s\n", "benchmark", "iterations", "time", "baseline");
+	for (const auto& benchmark : benchmarks) {
+		if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+			continue;
+		}
+		BenchResult result = runBenchmark(benchmark, options);
+		results.push_back(result);
+		printf("%-52s %12llu %11.1f ns", result.name.c_str(), result.iterations, result.time);
+
+		auto it = baseline.find(result.name);
+		if (it != baseline.end() && it->second > 0.0) {
+			double change = result.time / it->second - 1.0;
+			bool regressed = change > options.threshold;
+			printf(" %+11.1f %%%s", 100.0 * change, regressed ? "  REGRESSION" : "");
+			if (regressed) regressions++;
+		}
+		printf("\n");
+		fflush(stdout);
+	}
+
+	if (!options.json.empty() && !writeJson(options.json, results)) {
+		return 1;
+	}
+	if (regressions > 0) {
+		printf("\n%d benchmarks slower than the baseline by more than %.0f %%\n", regressions, 100.0 * options.threshold);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,483 @@
+/**
+ * \file MonteCarlo.cpp
+ * Monte Carlo sweep of the main engine startup sequence.
+ *
+ * Runs thousands of headless MainEngine instances with randomized configuration and sensor noise from
+ * LANTR_MODE_OFF to a target mode, spread over all cores, and reports how the controller copes:
+ * outcome of each run, time to mode, scrams and downmodes by cause, peak temperatures and the time spent in
+ * every controller state compared to its watchdog.
+ *
+ * Every run is seeded from the sweep seed and its index, so a sweep is reproducible regardless of the number
+ * of threads, and a single run can be repeated with --first and --runs 1.
+ *
+ * Usage: montecarlo [options]
+ *   --cfg <file>       vessel cfg with the LANTR block (default: the cfg in this repository)
+ *   --runs <n>         number of runs (1000)
+ *   --first <n>        index of the first run (0)
+ *   --threads <n>      worker threads, 0 for all cores (0)
+ *   --seed <n>         sweep seed (1)
+ *   --dt <s>           simulation step (0.05)
+ *   --duration <s>     maximum sim time per run (600)
+ *   --hold <s>         time to keep running after the target mode is reached (30)
+ *   --spread <f>       relative spread of the randomized parameters (0.2)
+ *   --noise <f>        relative standard deviation of the sensor noise (0.01)
+ *   --mode <ntr|electric|lantr>   target mode (ntr)
+ *   --lanes <1|4|8|16> engines stepped together by one MainEngineBatch (1 steps every engine by itself)
+ *   --csv <file>       write one line per run
+ */
+
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+#include "event/Events.h"
+#include "systems/mainengine/MainEngine.h"
+#include "systems/mainengine/MainEngineBatch.h"
+#include "core/OrbitalHauler.h"
+
+#include "HeadlessConfig.h"
+#include "WorkStealingScheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+
+#ifndef OH_DEFAULT_CFG
+#define OH_DEFAULT_CFG "orbiter/Config/Vessels/OrbitalHauler/OrbitalHauler.cfg"
+#endif
+
+const int MAX_CAUSES = 4;
+
+struct SweepOptions {
+	std::string cfg = OH_DEFAULT_CFG;
+	size_t runs = 1000;
+	size_t first = 0;
+	unsigned int threads = 0;
+	unsigned int seed = 1;
+	double dt = 0.05;
+	double duration = 600.0;
+	double hold = 30.0;
+	double spread = 0.2;
+	double noise = 0.01;
+	int targetMode = LANTR_MODE_NTR;
+	unsigned int lanes = 1;
+	std::string csv;
+};
+
+/* Randomized parameters of one run, as factors on the configured values.
+ */
+struct RunParameters {
+	unsigned int seed;
+	double hCladding;
+	double hRadiator;
+	double tcgaInertia;
+	double tcgaPressureRatio;
+	double tcgaEfficiency;
+	double h2tpaInertia;
+	double h2tpaPressureRatio;
+	double noise;
+};
+
+enum class RunOutcome { REACHED, ABORTED, SCRAMMED, TIMEOUT };
+
+struct RunResult {
+	RunParameters parameters;
+	RunOutcome outcome;
+	//Sim time when the target mode was first reached, negative if never
+	double timeToMode;
+	double peakFuelTemperature;
+	//Hottest fuel rod centerline
+	double peakCenterlineTemperature;
+	double peakLoopTemperature;
+	double peakLoopPressure;
+	int scrams;
+	int downmodes;
+	//Longest continuous time spent in each controller state
+	double stateTime[CONTROLLER_STATE_COUNT];
+	int causeCount;
+	char causes[MAX_CAUSES][40];
+};
+
+static const char* outcomeLabel(RunOutcome outcome) {
+	switch (outcome) {
+	case RunOutcome::REACHED: return "REACHED";
+	case RunOutcome::ABORTED: return "ABORTED";
+	case RunOutcome::SCRAMMED: return "SCRAMMED";
+	default: return "TIMEOUT";
+	}
+}
+
+static void scaleList(std::vector<double>& values, double factor, double minimum) {
+	for (auto& value : values) {
+		value = minimum + (value - minimum) * factor;
+	}
+}
+
+static RunParameters sampleParameters(const SweepOptions& options, size_t index) {
+	//Seed sequence over sweep seed and run index, so neighbouring runs are uncorrelated
+	std::seed_seq sequence{ options.seed, (unsigned int)(index & 0xFFFFFFFF), (unsigned int)(index >> 32) };
+	std::mt19937 random(sequence);
+	std::uniform_real_distribution<double> factor(1.0 - options.spread, 1.0 + options.spread);
+	std::uniform_real_distribution<double> efficiency(1.0 - options.spread * 0.25, 1.0 + options.spread * 0.1);
+
+	RunParameters parameters;
+	parameters.seed = random();
+	parameters.hCladding = factor(random);
+	parameters.hRadiator = factor(random);
+	parameters.tcgaInertia = factor(random);
+	parameters.tcgaPressureRatio = factor(random);
+	parameters.tcgaEfficiency = efficiency(random);
+	parameters.h2tpaInertia = factor(random);
+	parameters.h2tpaPressureRatio = factor(random);
+	parameters.noise = options.noise;
+	return parameters;
+}
+
+static LANTRConfig applyParameters(const LANTRConfig& base, const RunParameters& parameters) {
+	LANTRConfig config = base;
+	config.h_cladding *= parameters.hCladding;
+	config.h_radiator *= parameters.hRadiator;
+	config.tcga.inertia *= parameters.tcgaInertia;
+	scaleList(config.tcga.compressor.pressureRatio, parameters.tcgaPressureRatio, 1.0);
+	scaleList(config.tcga.compressor.efficiency, parameters.tcgaEfficiency, 0.0);
+	scaleList(config.tcga.turbine.efficiency, parameters.tcgaEfficiency, 0.0);
+	config.h2tpa.inertia *= parameters.h2tpaInertia;
+	scaleList(config.h2tpa.compressor.pressureRatio, parameters.h2tpaPressureRatio, 1.0);
+	for (auto& value : config.tcga.compressor.efficiency) value = min(value, 0.95);
+	for (auto& value : config.tcga.turbine.efficiency) value = min(value, 0.95);
+	return config;
+}
+
+/* One run of the sweep. The engine is stepped from outside, by itself or in a batch, and evaluated after every step.
+ */
+class StartupRun {
+public:
+	StartupRun(const SweepOptions& options, const LANTRConfig& base, size_t index, RunResult& result) :
+		options(options), result(result), config(base), vessel((OBJHANDLE)(index + 1), 1),
+		phLO2(vessel.CreatePropellantResource(TUG_LO2TANK_MAXIMUM_MASS)),
+		phLH2(vessel.CreatePropellantResource(TUG_LH2TANK_MAXIMUM_MASS)),
+		engine(&vessel, config, phLH2, phLO2)
+	{
+		result = RunResult();
+		result.parameters = sampleParameters(options, index);
+		result.timeToMode = -1.0;
+		config = applyParameters(base, result.parameters);
+
+		engine.init(eventBroker);
+		engine.setSensorNoise(result.parameters.noise, result.parameters.seed);
+		engine.setTargetMode(options.targetMode);
+
+		state = engine.getCurrentMode();
+		stateEntry = 0.0;
+		end = options.duration;
+		simt = 0.0;
+	}
+
+	MainEngine& getEngine() {
+		return engine;
+	}
+
+	/* Records the engine after the step at simt. Returns false once the run is over.
+	 */
+	bool evaluate(double simt) {
+		this->simt = simt;
+		result.peakFuelTemperature = max(result.peakFuelTemperature, engine.getFuelTemperature());
+		result.peakCenterlineTemperature = max(result.peakCenterlineTemperature, engine.getPeakFuelTemperature());
+		result.peakLoopTemperature = max(result.peakLoopTemperature, engine.getPrimaryLoopOutletT());
+		result.peakLoopPressure = max(result.peakLoopPressure, engine.getPrimaryLoopInP());
+
+		int mode = engine.getCurrentMode();
+		if (mode != state) {
+			unsigned int index = controllerStateIndex(state);
+			result.stateTime[index] = max(result.stateTime[index], simt - stateEntry);
+			state = mode;
+			stateEntry = simt;
+		}
+		if (mode == options.targetMode && result.timeToMode < 0.0) {
+			result.timeToMode = simt;
+			end = min(options.duration, simt + options.hold);
+		}
+		return mode != LANTR_MODE_SCRAM && simt < end;
+	}
+
+	void finish() {
+		unsigned int stateIndex = controllerStateIndex(state);
+		result.stateTime[stateIndex] = max(result.stateTime[stateIndex], simt - stateEntry);
+
+		for (int i = engine.countErrors() - 1; i >= 0; --i) {
+			REACTOR_ERROR_TYPE error;
+			if (!engine.getError(i, &error)) continue;
+			if (error.type == ANOMALY_SCRAM) result.scrams++;
+			else result.downmodes++;
+			if (result.causeCount < MAX_CAUSES) {
+				sprintf_s(result.causes[result.causeCount++], sizeof(result.causes[0]), "%s", error.cause);
+			}
+		}
+
+		if (result.scrams > 0) result.outcome = RunOutcome::SCRAMMED;
+		else if (engine.getCurrentMode() == options.targetMode) result.outcome = RunOutcome::REACHED;
+		else if (result.downmodes > 0) result.outcome = RunOutcome::ABORTED;
+		else result.outcome = RunOutcome::TIMEOUT;
+	}
+
+private:
+	const SweepOptions& options;
+	RunResult& result;
+	//Randomized before the engine reads it in init()
+	LANTRConfig config;
+	OrbitalHauler vessel;
+	PROPELLANT_HANDLE phLO2;
+	PROPELLANT_HANDLE phLH2;
+	MainEngine engine;
+	EventBroker eventBroker;
+
+	int state;
+	double stateEntry;
+	double end;
+	double simt;
+};
+
+static void runStartup(const SweepOptions& options, const LANTRConfig& base, size_t index, RunResult& result) {
+	StartupRun run(options, base, index, result);
+	for (long long step = 0; ; ++step) {
+		double simt = step * options.dt;
+		run.getEngine().preStep(simt, options.dt, oapiGetSimMJD());
+		if (!run.evaluate(simt)) break;
+	}
+	run.finish();
+}
+
+/* Runs count consecutive runs in the lanes of one batch. A finished run leaves its lane,
+ * the batch continues until the last run is over.
+ */
+template <unsigned int LANES>
+static void runStartupBatch(const SweepOptions& options, const LANTRConfig& base, size_t first, size_t count, RunResult* results) {
+	MainEngineBatch<LANES> batch;
+	std::unique_ptr<StartupRun> runs[LANES];
+	for (size_t i = 0; i < count && i < LANES; ++i) {
+		runs[i].reset(new StartupRun(options, base, first + i, results[i]));
+		batch.attach(&runs[i]->getEngine());
+	}
+
+	for (long long step = 0; batch.size() > 0; ++step) {
+		double simt = step * options.dt;
+		batch.preStep(simt, options.dt, oapiGetSimMJD());
+		for (auto& run : runs) {
+			if (run && !run->evaluate(simt)) {
+				batch.detach(&run->getEngine());
+				run->finish();
+				run.reset();
+			}
+		}
+	}
+}
+
+static void runStartups(const SweepOptions& options, const LANTRConfig& base, size_t first, size_t count, RunResult* results) {
+	switch (options.lanes) {
+	case 4:
+		runStartupBatch<4>(options, base, first, count, results);
+		break;
+	case 8:
+		runStartupBatch<8>(options, base, first, count, results);
+		break;
+	case 16:
+		runStartupBatch<16>(options, base, first, count, results);
+		break;
+	default:
+		for (size_t i = 0; i < count; ++i) {
+			runStartup(options, base, first + i, results[i]);
+		}
+	}
+}
+
+/* Percentile of an ascending sorted list, p in [0, 1].
+ */
+static double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) return 0.0;
+	size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[min(index, sorted.size() - 1)];
+}
+
+static void printDistribution(const char* label, std::vector<double> values, const char* unit) {
+	if (values.empty()) {
+		printf("  %-24s no samples\n", label);
+		return;
+	}
+	std::sort(values.begin(), values.end());
+	double mean = 0.0;
+	for (double value : values) mean += value;
+	mean /= values.size();
+	printf("  %-24s min %10.2f  mean %10.2f  p50 %10.2f  p95 %10.2f  max %10.2f %s\n", label,
+		values.front(), mean, percentile(values, 0.5), percentile(values, 0.95), values.back(), unit);
+}
+
+static void printSummary(const SweepOptions& options, const std::vector<RunResult>& results) {
+	size_t outcomes[4] = { 0, 0, 0, 0 };
+	std::map<std::string, size_t> causes;
+	std::vector<double> timeToMode, peakFuel, peakCenterline, peakLoop, peakPressure;
+
+	for (const auto& result : results) {
+		outcomes[(int)result.outcome]++;
+		for (int i = 0; i < result.causeCount; ++i) {
+			causes[result.causes[i]]++;
+		}
+		if (result.timeToMode >= 0.0) timeToMode.push_back(result.timeToMode);
+		peakFuel.push_back(result.peakFuelTemperature);
+		peakCenterline.push_back(result.peakCenterlineTemperature);
+		peakLoop.push_back(result.peakLoopTemperature);
+		peakPressure.push_back(result.peakLoopPressure * 1e-3);
+	}
+
+	printf("\nOutcomes of %zu runs to %s\n", results.size(), controllerStateLabel(options.targetMode));
+	for (int i = 0; i < 4; ++i) {
+		printf("  %-24s %8zu  %6.2f %%\n", outcomeLabel((RunOutcome)i), outcomes[i], 100.0 * outcomes[i] / max((size_t)1, results.size()));
+	}
+
+	printf("\nAnomalies by cause\n");
+	if (causes.empty()) printf("  none\n");
+	for (const auto& it : causes) {
+		printf("  %-24s %8zu\n", it.first.c_str(), it.second);
+	}
+
+	printf("\nStartup\n");
+	printDistribution("time to mode", timeToMode, "s");
+	printDistribution("peak fuel temperature", peakFuel, "K");
+	printDistribution("peak fuel centerline", peakCenterline, "K");
+	printDistribution("peak loop temperature", peakLoop, "K");
+	printDistribution("peak loop pressure", peakPressure, "kPa");
+
+	printf("\nTime in controller states vs. watchdog\n");
+	for (unsigned int state = 0; state < CONTROLLER_STATE_COUNT; ++state) {
+		std::vector<double> times;
+		for (const auto& result : results) {
+			if (result.stateTime[state] > 0.0) times.push_back(result.stateTime[state]);
+		}
+		if (times.empty()) continue;
+		double timeout = MainEngine::getStateTimeout(CONTROLLER_STATES[state].id);
+		std::sort(times.begin(), times.end());
+		if (timeout > 0.0) {
+			size_t expired = times.end() - std::lower_bound(times.begin(), times.end(), timeout);
+			printf("  %-24s p95 %8.2f  max %8.2f  watchdog %6.1f s  margin %8.2f s  expired %zu\n", CONTROLLER_STATES[state].label,
+				percentile(times, 0.95), times.back(), timeout, timeout - times.back(), expired);
+		}
+		else {
+			printf("  %-24s p95 %8.2f  max %8.2f\n", CONTROLLER_STATES[state].label, percentile(times, 0.95), times.back());
+		}
+	}
+}
+
+static bool writeCsv(const SweepOptions& options, const std::vector<RunResult>& results) {
+	FILE* out = fopen(options.csv.c_str(), "w");
+	if (out == NULL) {
+		fprintf(stderr, "Can't write %s\n", options.csv.c_str());
+		return false;
+	}
+	fprintf(out, "run,seed,h_cladding,h_radiator,tcga_inertia,tcga_pressureratio,tcga_efficiency,h2tpa_inertia,h2tpa_pressureratio,noise,"
+		"outcome,time_to_mode,peak_fuel_temperature,peak_fuel_centerline,peak_loop_temperature,peak_loop_pressure,scrams,downmodes,causes\n");
+	for (size_t i = 0; i < results.size(); ++i) {
+		const RunResult& result = results[i];
+		const RunParameters& p = result.parameters;
+		fprintf(out, "%zu,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%s,%.2f,%.1f,%.1f,%.1f,%.0f,%d,%d,", options.first + i, p.seed,
+			p.hCladding, p.hRadiator, p.tcgaInertia, p.tcgaPressureRatio, p.tcgaEfficiency, p.h2tpaInertia, p.h2tpaPressureRatio, p.noise,
+			outcomeLabel(result.outcome), result.timeToMode, result.peakFuelTemperature, result.peakCenterlineTemperature, result.peakLoopTemperature, result.peakLoopPressure,
+			result.scrams, result.downmodes);
+		for (int c = 0; c < result.causeCount; ++c) {
+			fprintf(out, "%s%s", c > 0 ? "|" : "", result.causes[c]);
+		}
+		fprintf(out, "\n");
+	}
+	fclose(out);
+	return true;
+}
+
+static bool parseOptions(int argc, char** argv, SweepOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for %s\n", arg.c_str());
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--cfg") options.cfg = value;
+		else if (arg == "--runs") options.runs = strtoull(value, NULL, 10);
+		else if (arg == "--first") options.first = strtoull(value, NULL, 10);
+		else if (arg == "--threads") options.threads = (unsigned int)atoi(value);
+		else if (arg == "--seed") options.seed = (unsigned int)strtoul(value, NULL, 10);
+		else if (arg == "--dt") options.dt = atof(value);
+		else if (arg == "--duration") options.duration = atof(value);
+		else if (arg == "--hold") options.hold = atof(value);
+		else if (arg == "--spread") options.spread = atof(value);
+		else if (arg == "--noise") options.noise = atof(value);
+		else if (arg == "--csv") options.csv = value;
+		else if (arg == "--lanes") options.lanes = (unsigned int)atoi(value);
+		else if (arg == "--mode") {
+			std::string mode = value;
+			if (mode == "electric") options.targetMode = LANTR_MODE_ELECTRIC;
+			else if (mode == "ntr") options.targetMode = LANTR_MODE_NTR;
+			else if (mode == "lantr") options.targetMode = LANTR_MODE_LANTR;
+			else {
+				fprintf(stderr, "Unknown mode %s\n", value);
+				return false;
+			}
+		}
+		else {
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		}
+	}
+	if (options.dt <= 0.0 || options.spread < 0.0 || options.spread >= 1.0) {
+		fprintf(stderr, "dt must be positive and spread in [0, 1)\n");
+		return false;
+	}
+	if (options.lanes != 1 && options.lanes != 4 && options.lanes != 8 && options.lanes != 16) {
+		fprintf(stderr, "lanes must be 1, 4, 8 or 16\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv) {
+	SweepOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	HeadlessConfig cfg;
+	LANTRConfig base;
+	if (!cfg.load(options.cfg) || !cfg.getLANTRConfig(base)) {
+		return 1;
+	}
+	//Solutions on worker threads arrive after a varying number of steps, which would make the runs irreproducible
+	base.neutronics.background = false;
+
+	WorkStealingScheduler scheduler(options.threads);
+	std::vector<RunResult> results(options.runs);
+	std::atomic<size_t> finished(0);
+
+	printf("Sweeping %zu startups on %u threads with %u lanes, seed %u, spread %.2f, noise %.3f\n",
+		options.runs, scheduler.countWorkers(), options.lanes, options.seed, options.spread, options.noise);
+	auto start = std::chrono::steady_clock::now();
+
+	//One task per batch of runs, the scheduler balances batches instead of runs
+	size_t batches = (options.runs + options.lanes - 1) / options.lanes;
+	scheduler.run(batches, [&](size_t batch, unsigned int worker) {
+		size_t index = batch * options.lanes;
+		size_t count = min((size_t)options.lanes, options.runs - index);
+		runStartups(options, base, options.first + index, count, &results[index]);
+		size_t done = (finished += count);
+		if (done % 100 < count || done == options.runs) {
+			fprintf(stderr, "\r%zu / %zu", done, options.runs);
+		}
+	});
+
+	double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	fprintf(stderr, "\n");
+	printf("Finished in %.1f s (%.1f runs/s, %zu steals)\n", elapsed, options.runs / max(elapsed, 1e-9), scheduler.countSteals());
+
+	printSummary(options, results);
+	if (!options.csv.empty() && !writeCsv(options, results)) {
+		return 1;
+	}
+	return 0;
+}
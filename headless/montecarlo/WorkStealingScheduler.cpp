@@ -0,0 +1,110 @@
+#include "WorkStealingScheduler.h"
+
+#include <algorithm>
+#include <thread>
+
+
+WorkStealingScheduler::WorkStealingScheduler(unsigned int workers) : steals(0) {
+	if (workers == 0) {
+		workers = std::max(1u, std::thread::hardware_concurrency());
+	}
+	this->workers = workers;
+	for (unsigned int i = 0; i < workers; ++i) {
+		ranges.push_back(std::unique_ptr<Range>(new Range()));
+	}
+}
+
+unsigned int WorkStealingScheduler::countWorkers() const {
+	return workers;
+}
+
+size_t WorkStealingScheduler::countSteals() const {
+	return steals.load();
+}
+
+void WorkStealingScheduler::run(size_t count, const Task& task) {
+	steals.store(0);
+
+	//Deal out contiguous blocks, the first count % workers workers get one task more
+	size_t begin = 0;
+	for (unsigned int i = 0; i < workers; ++i) {
+		size_t size = count / workers + (i < count % workers ? 1 : 0);
+		ranges[i]->begin = begin;
+		ranges[i]->end = begin + size;
+		begin += size;
+	}
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 1; i < workers; ++i) {
+		threads.emplace_back(&WorkStealingScheduler::work, this, i, std::cref(task));
+	}
+	work(0, task);
+	for (auto& thread : threads) {
+		thread.join();
+	}
+}
+
+bool WorkStealingScheduler::takeOwn(unsigned int worker, size_t& index) {
+	Range& range = *ranges[worker];
+	std::lock_guard<std::mutex> guard(range.lock);
+	if (range.begin >= range.end) {
+		return false;
+	}
+	index = range.begin++;
+	return true;
+}
+
+/*
+* Moves the back half of the largest range of another worker to the thief. Returns false if there is nothing left to steal.
+* Tasks never create new tasks, so once every range is empty, the batch is done.
+*/
+bool WorkStealingScheduler::steal(unsigned int thief) {
+	while (true) {
+		unsigned int victim = thief;
+		size_t largest = 0;
+		for (unsigned int i = 0; i < workers; ++i) {
+			if (i == thief) continue;
+			std::lock_guard<std::mutex> guard(ranges[i]->lock);
+			size_t remaining = ranges[i]->end - std::min(ranges[i]->begin, ranges[i]->end);
+			if (remaining > largest) {
+				largest = remaining;
+				victim = i;
+			}
+		}
+		if (victim == thief) {
+			return false;
+		}
+
+		size_t begin, end;
+		{
+			std::lock_guard<std::mutex> guard(ranges[victim]->lock);
+			Range& range = *ranges[victim];
+			if (range.begin >= range.end) {
+				//Victim finished its range in the meantime, look again
+				continue;
+			}
+			size_t remaining = range.end - range.begin;
+			end = range.end;
+			begin = range.end - (remaining + 1) / 2;
+			range.end = begin;
+		}
+
+		std::lock_guard<std::mutex> guard(ranges[thief]->lock);
+		ranges[thief]->begin = begin;
+		ranges[thief]->end = end;
+		steals.fetch_add(1);
+		return true;
+	}
+}
+
+void WorkStealingScheduler::work(unsigned int worker, const Task& task) {
+	size_t index;
+	while (true) {
+		while (takeOwn(worker, index)) {
+			task(index, worker);
+		}
+		if (!steal(worker)) {
+			return;
+		}
+	}
+}
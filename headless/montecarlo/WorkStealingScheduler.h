@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * \brief Runs a batch of independent tasks on all cores.
+ *
+ * Every worker starts with a contiguous range of task indices and works through it from the front.
+ * A worker that runs out of tasks steals the back half of the largest remaining range of another worker,
+ * so slow tasks (long startup sequences, stiff parameter sets) do not leave the other cores idle at the end of a batch.
+ * Ranges are protected by one lock per worker, which is only contended while stealing.
+ */
+class WorkStealingScheduler {
+public:
+	typedef std::function<void(size_t index, unsigned int worker)> Task;
+
+	/* workers 0 uses one worker per hardware thread.
+	 */
+	explicit WorkStealingScheduler(unsigned int workers = 0);
+
+	/* Runs task for every index in [0, count) and returns once all of them are done.
+	 */
+	void run(size_t count, const Task& task);
+
+	unsigned int countWorkers() const;
+	//Number of successful steals during the last run
+	size_t countSteals() const;
+
+private:
+	struct Range {
+		std::mutex lock;
+		size_t begin = 0;
+		size_t end = 0;
+	};
+
+	unsigned int workers;
+	std::vector<std::unique_ptr<Range>> ranges;
+	std::atomic<size_t> steals;
+
+	bool takeOwn(unsigned int worker, size_t& index);
+	bool steal(unsigned int thief);
+	void work(unsigned int worker, const Task& task);
+};
@@ -0,0 +1,182 @@
+#include "PerfCounters.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+//Empty phases measured for the overhead
+const int PERF_CALIBRATION_PHASES = 1000;
+
+
+PerfCounters::PerfCounters() {
+	opened = 0;
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		fds[i] = -1;
+		slots[i] = -1;
+		overhead[i] = 0.0;
+	}
+	open();
+
+	//The smallest reading of an empty phase is the cost of the reads themselves
+	if (opened > 0) {
+		for (int i = 0; i < PERF_COUNTERS; ++i) {
+			overhead[i] = 1.0E300;
+		}
+		Reading begin, end;
+		for (int n = 0; n < PERF_CALIBRATION_PHASES; ++n) {
+			read(begin);
+			read(end);
+			for (int i = 0; i < PERF_COUNTERS; ++i) {
+				overhead[i] = std::min(overhead[i], (double)(end.counts[i] - begin.counts[i]));
+			}
+		}
+		for (int i = 0; i < PERF_COUNTERS; ++i) {
+			overhead[i] = slots[i] >= 0 ? overhead[i] : 0.0;
+		}
+	}
+}
+
+PerfCounters::~PerfCounters() {
+	close();
+}
+
+#ifdef __linux__
+void PerfCounters::open() {
+	const uint64_t configs[PERF_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+	};
+	int leader = -1;
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.config = configs[i];
+		attr.disabled = leader < 0 ? 1 : 0;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_GROUP;
+		int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+		if (fd < 0) {
+			if (error.empty()) {
+				error = std::string("perf_event_open failed: ") + strerror(errno);
+			}
+			continue;
+		}
+		fds[i] = fd;
+		slots[i] = opened++;
+		if (leader < 0) {
+			leader = fd;
+		}
+	}
+	if (leader < 0) {
+		return;
+	}
+	buffer.assign(1 + opened, 0);
+	ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+	ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+void PerfCounters::close() {
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		if (fds[i] >= 0) {
+			::close(fds[i]);
+			fds[i] = -1;
+		}
+	}
+}
+
+void PerfCounters::read(Reading& reading) {
+	reading.time = std::chrono::steady_clock::now();
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		reading.counts[i] = 0;
+	}
+	if (opened == 0) {
+		return;
+	}
+	//The leader is the first counter that opened, a group read returns the number of counters, then their values
+	int leader = 0;
+	while (fds[leader] < 0) leader++;
+	if (::read(fds[leader], buffer.data(), buffer.size() * sizeof(uint64_t)) <= 0) {
+		return;
+	}
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		if (slots[i] >= 0) {
+			reading.counts[i] = buffer[1 + slots[i]];
+		}
+	}
+}
+#else
+void PerfCounters::open() {
+	error = "perf_event_open is only available on Linux";
+}
+
+void PerfCounters::close() {}
+
+void PerfCounters::read(Reading& reading) {
+	reading.time = std::chrono::steady_clock::now();
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		reading.counts[i] = 0;
+	}
+}
+#endif
+
+bool PerfCounters::isAvailable(PERFCOUNTER counter) const {
+	return slots[(int)counter] >= 0;
+}
+
+bool PerfCounters::isAvailable() const {
+	return opened > 0;
+}
+
+const std::string& PerfCounters::getError() const {
+	return error;
+}
+
+void PerfCounters::beginPhase(const char* name) {
+	stack.push_back(Reading());
+	read(stack.back());
+}
+
+void PerfCounters::endPhase(const char* name) {
+	Reading end;
+	read(end);
+	if (stack.empty()) {
+		return;
+	}
+	const Reading& begin = stack.back();
+	PhaseCounts& counts = phase(name);
+	counts.calls++;
+	counts.seconds += std::chrono::duration<double>(end.time - begin.time).count();
+	for (int i = 0; i < PERF_COUNTERS; ++i) {
+		counts.counts[i] += std::max(0.0, (double)(end.counts[i] - begin.counts[i]) - overhead[i]);
+	}
+	stack.pop_back();
+}
+
+const std::vector<PhaseCounts>& PerfCounters::getPhases() const {
+	return phases;
+}
+
+void PerfCounters::reset() {
+	phases.clear();
+	stack.clear();
+}
+
+PhaseCounts& PerfCounters::phase(const char* name) {
+	//Few phases, and the same pointer every step
+	for (auto& it : phases) {
+		if (it.name == name) {
+			return it;
+		}
+	}
+	phases.push_back(PhaseCounts{ name, 0, 0.0, { 0.0 } });
+	return phases.back();
+}
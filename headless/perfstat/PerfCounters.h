@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "core/StepProfiler.h"
+
+enum class PERFCOUNTER { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES };
+const int PERF_COUNTERS = 4;
+
+/* Totals of one phase over a run.
+ */
+struct PhaseCounts {
+	const char* name;
+	unsigned long long calls;
+	double seconds;
+	double counts[PERF_COUNTERS];
+};
+
+/**
+ * \brief Hardware counters per phase of the vessel step, read with perf_event_open on Linux.
+ *
+ * The counters are opened as one group on the calling thread, so they are always scheduled together and read with one
+ * syscall at the begin and end of every phase. The difference is added to the totals of the phase, less the cost of an
+ * empty phase measured when the counters are opened. Nested phases count in both.
+ * Only the thread that opened the counters is measured: the sweeps the neutron diffusion hands to its worker threads
+ * are missing from the counts, but not from the time.
+ *
+ * Where the counters can't be opened (other platforms, no PMU in a virtual machine, perf_event_paranoid above 2),
+ * only the time of the phases is taken and getError() tells why.
+ */
+class PerfCounters : public StepProfiler {
+public:
+	PerfCounters();
+	~PerfCounters();
+
+	//Whether a counter could be opened, counts of the others stay 0
+	bool isAvailable(PERFCOUNTER counter) const;
+	bool isAvailable() const;
+	const std::string& getError() const;
+
+	virtual void beginPhase(const char* name);
+	virtual void endPhase(const char* name);
+
+	//Phases in the order they were first seen
+	const std::vector<PhaseCounts>& getPhases() const;
+	void reset();
+
+private:
+	struct Reading {
+		std::chrono::steady_clock::time_point time;
+		uint64_t counts[PERF_COUNTERS];
+	};
+
+	int fds[PERF_COUNTERS];
+	//Position of each counter in a group read, -1 if it isn't open
+	int slots[PERF_COUNTERS];
+	int opened;
+	std::string error;
+	//Counts of an empty phase
+	double overhead[PERF_COUNTERS];
+
+	std::vector<PhaseCounts> phases;
+	//Readings of the open phases, innermost last
+	std::vector<Reading> stack;
+	std::vector<uint64_t> buffer;
+
+	void open();
+	void close();
+	void read(Reading& reading);
+	PhaseCounts& phase(const char* name);
+};
@@ -0,0 +1,181 @@
+/**
+ * \file PerfStat.cpp
+ * Hardware counters of every phase of the vessel step: the event broker and the preStep of every system.
+ *
+ * A headless OrbitalHauler runs the engine up to the target mode, then the counters are taken over the following
+ * steps and reported per phase: time, cycles and instructions per call, instructions per cycle, and cache and branch
+ * misses per call and per thousand instructions. Low IPC with many cache misses per thousand instructions marks a
+ * phase that waits on memory, so data layout changes can be checked before and after.
+ *
+ * The counters come from perf_event_open and count user space of the stepping thread only, see PerfCounters.h.
+ * Without access to them (perf_event_paranoid above 2, no PMU in a virtual machine) only the times are reported.
+ *
+ * Usage: perfstat [options]
+ *   --cfg <file>       vessel cfg (default: the cfg in this repository)
+ *   --dt <s>           simulation step (0.05)
+ *   --warmup <s>       sim time before the counters start (300)
+ *   --duration <s>     sim time counted (600)
+ *   --mode <ntr|electric|lantr>   target mode of the engine (ntr)
+ *   --csv <file>       write one line per phase with the totals
+ */
+
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+#include "event/Events.h"
+#include "systems/mainengine/MainEngine.h"
+#include "core/OrbitalHauler.h"
+
+#include "HeadlessConfig.h"
+#include "PerfCounters.h"
+
+#ifndef OH_DEFAULT_CFG
+#define OH_DEFAULT_CFG "orbiter/Config/Vessels/OrbitalHauler/OrbitalHauler.cfg"
+#endif
+
+struct StatOptions {
+	std::string cfg = OH_DEFAULT_CFG;
+	double dt = 0.05;
+	double warmup = 300.0;
+	double duration = 600.0;
+	int targetMode = LANTR_MODE_NTR;
+	std::string csv;
+};
+
+/* Steps the vessel up to simt.
+ */
+static void advance(OrbitalHauler& vessel, double& simt, double until, double dt) {
+	while (simt < until) {
+		vessel.clbkPreStep(simt, dt, oapiGetSimMJD() + simt / 86400.0);
+		simt += dt;
+	}
+}
+
+static bool parseOptions(int argc, char** argv, StatOptions& options) {
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (i + 1 >= argc) {
+			fprintf(stderr, "Missing value for %s\n", arg.c_str());
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--cfg") options.cfg = value;
+		else if (arg == "--dt") options.dt = atof(value);
+		else if (arg == "--warmup") options.warmup = atof(value);
+		else if (arg == "--duration") options.duration = atof(value);
+		else if (arg == "--csv") options.csv = value;
+		else if (arg == "--mode") {
+			std::string mode = value;
+			if (mode == "electric") options.targetMode = LANTR_MODE_ELECTRIC;
+			else if (mode == "ntr") options.targetMode = LANTR_MODE_NTR;
+			else if (mode == "lantr") options.targetMode = LANTR_MODE_LANTR;
+			else {
+				fprintf(stderr, "Unknown mode %s\n", value);
+				return false;
+			}
+		}
+		else {
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		}
+	}
+	if (options.dt <= 0.0 || options.duration <= 0.0) {
+		fprintf(stderr, "dt and duration must be positive\n");
+		return false;
+	}
+	return true;
+}
+
+/* Per call, or - if the counter isn't available.
+ */
+static std::string perCall(const PerfCounters& counters, PERFCOUNTER counter, const PhaseCounts& phase) {
+	char text[32];
+	if (!counters.isAvailable(counter)) return "-";
+	snprintf(text, sizeof(text), "%.0f", phase.counts[(int)counter] / phase.calls);
+	return text;
+}
+
+static std::string formatRatio(bool available, double value) {
+	char text[32];
+	if (!available) return "-";
+	snprintf(text, sizeof(text), "%.2f", value);
+	return text;
+}
+
+int main(int argc, char** argv) {
+	StatOptions options;
+	if (!parseOptions(argc, argv, options)) {
+		return 1;
+	}
+
+	HeadlessConfig cfg;
+	OrbitalHaulerConfig config = OrbitalHaulerConfig();
+	if (!cfg.load(options.cfg) || !cfg.getOrbitalHaulerConfig(config)) {
+		return 1;
+	}
+	//The steps run unpaced, so solutions on worker threads would lag far behind and their cost would not be counted
+	config.mainEngineConfig.neutronics.background = false;
+
+	OrbitalHauler vessel((OBJHANDLE)1, 1);
+	vessel.createSystems(config);
+	vessel.Powerplant()->setTargetMode(options.targetMode);
+	double simt = 0.0;
+	advance(vessel, simt, options.warmup, options.dt);
+
+	PerfCounters counters;
+	if (!counters.isAvailable()) {
+		printf("No hardware counters (%s), reporting times only\n", counters.getError().c_str());
+	}
+	vessel.setStepProfiler(&counters);
+	advance(vessel, simt, options.warmup + options.duration, options.dt);
+	vessel.setStepProfiler(NULL);
+
+	const std::vector<PhaseCounts>& phases = counters.getPhases();
+	bool cycles = counters.isAvailable(PERFCOUNTER::CYCLES);
+	bool instructions = counters.isAvailable(PERFCOUNTER::INSTRUCTIONS);
+	bool cacheMisses = counters.isAvailable(PERFCOUNTER::CACHE_MISSES);
+	bool branchMisses = counters.isAvailable(PERFCOUNTER::BRANCH_MISSES);
+	printf("%.0f s sim time in steps of %.3f s, engine %s\n\n", options.duration, options.dt,
+		controllerStateLabel(vessel.Powerplant()->getCurrentMode()));
+	printf("  %-28s %8s %10s %10s %10s %6s %9s %9s %9s %9s\n", "phase", "calls", "us/call", "cycles", "instr", "IPC",
+		"cachemiss", "cacheMPKI", "brmiss", "brMPKI");
+
+	PhaseCounts total = PhaseCounts{ "total", 0, 0.0, { 0.0 } };
+	for (const auto& phase : phases) {
+		double instr = phase.counts[(int)PERFCOUNTER::INSTRUCTIONS];
+		printf("  %-28s %8llu %10.3f %10s %10s %6s %9s %9s %9s %9s\n", phase.name, phase.calls, phase.seconds * 1.0E6 / phase.calls,
+			perCall(counters, PERFCOUNTER::CYCLES, phase).c_str(), perCall(counters, PERFCOUNTER::INSTRUCTIONS, phase).c_str(),
+			formatRatio(cycles && instructions, instr / max(1.0, phase.counts[(int)PERFCOUNTER::CYCLES])).c_str(),
+			perCall(counters, PERFCOUNTER::CACHE_MISSES, phase).c_str(),
+			formatRatio(cacheMisses && instructions, phase.counts[(int)PERFCOUNTER::CACHE_MISSES] * 1000.0 / max(1.0, instr)).c_str(),
+			perCall(counters, PERFCOUNTER::BRANCH_MISSES, phase).c_str(),
+			formatRatio(branchMisses && instructions, phase.counts[(int)PERFCOUNTER::BRANCH_MISSES] * 1000.0 / max(1.0, instr)).c_str());
+		total.calls = max(total.calls, phase.calls);
+		total.seconds += phase.seconds;
+		for (int i = 0; i < PERF_COUNTERS; ++i) {
+			total.counts[i] += phase.counts[i];
+		}
+	}
+	if (!phases.empty()) {
+		printf("  %-28s %8llu %10.3f %10s %10s %6s\n", "step", total.calls, total.seconds * 1.0E6 / total.calls,
+			perCall(counters, PERFCOUNTER::CYCLES, total).c_str(), perCall(counters, PERFCOUNTER::INSTRUCTIONS, total).c_str(),
+			formatRatio(cycles && instructions, total.counts[(int)PERFCOUNTER::INSTRUCTIONS] / max(1.0, total.counts[(int)PERFCOUNTER::CYCLES])).c_str());
+	}
+
+	if (!options.csv.empty()) {
+		FILE* file = fopen(options.csv.c_str(), "w");
+		if (file == NULL) {
+			fprintf(stderr, "Can't write %s\n", options.csv.c_str());
+			return 1;
+		}
+		fprintf(file, "phase,calls,seconds,cycles,instructions,cache_misses,branch_misses\n");
+		for (const auto& phase : phases) {
+			fprintf(file, "%s,%llu,%.9f,%.0f,%.0f,%.0f,%.0f\n", phase.name, phase.calls, phase.seconds,
+				phase.counts[(int)PERFCOUNTER::CYCLES], phase.counts[(int)PERFCOUNTER::INSTRUCTIONS],
+				phase.counts[(int)PERFCOUNTER::CACHE_MISSES], phase.counts[(int)PERFCOUNTER::BRANCH_MISSES]);
+		}
+		fclose(file);
+	}
+	return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+// Headless stand-in for the Orbiter MFD and Sketchpad API.
+#include "OrbiterAPI.h"
+namespace oapi {
+	class Font { };
+	class Pen {
+	public:
+		Pen(DWORD colour = 0) : colour(colour) {}
+		DWORD colour;
+	};
+	class Brush { };
+	class Sketchpad {
+	public:
+		virtual ~Sketchpad() {}
+		virtual Font* SetFont(Font* font) const { return 0; }
+		virtual Pen* SetPen(Pen* pen) const { return 0; }
+		virtual Brush* SetBrush(Brush* brush) const { return 0; }
+		virtual DWORD SetTextColor(DWORD col) { return 0; }
+		virtual DWORD SetBackgroundColor(DWORD col) { return 0; }
+		virtual bool Text(int x, int y, const char* str, int len) { return false; }
+		virtual void MoveTo(int x, int y) {}
+		virtual void LineTo(int x, int y) {}
+		virtual void Line(int x0, int y0, int x1, int y1) {}
+		virtual void Rectangle(int x0, int y0, int x1, int y1) {}
+		virtual void Polyline(const struct IVECTOR2* pt, int npt) {}
+	};
+}
+struct IVECTOR2 { long x, y; };
+struct MFDBUTTONMENU { const char* line1; const char* line2; char selchar; };
+typedef int (*MFDMSGPROC)(UINT, UINT, WPARAM, LPARAM);
+struct MFDMODESPECEX { char* name; DWORD key; void* context; MFDMSGPROC msgproc; };
+struct MFDMODEOPENSPEC { DWORD w, h; void* spec; };
+class MFD2 {
+public:
+	MFD2(DWORD w, DWORD h, VESSEL* vessel) : W(w), H(h), pV(vessel) {}
+	virtual ~MFD2() {}
+	virtual int ButtonMenu(const MFDBUTTONMENU** menu) const { return 0; }
+	virtual char* ButtonLabel(int bt) { return 0; }
+	virtual bool ConsumeButton(int bt, int event) { return false; }
+	virtual bool ConsumeKeyBuffered(DWORD key) { return false; }
+	virtual bool Update(oapi::Sketchpad* skp) { return false; }
+	void Title(oapi::Sketchpad* skp, const char* title) const;
+	oapi::Pen* GetDefaultPen(DWORD colidx, DWORD intens = 0, DWORD style = 1) const;
+	oapi::Font* GetDefaultFont(DWORD fontidx) const;
+	DWORD GetDefaultColour(DWORD colidx, DWORD intens = 0) const;
+	DWORD GetWidth() const { return W; }
+	DWORD GetHeight() const { return H; }
+	void InvalidateDisplay();
+	void InvalidateButtons();
+protected:
+	DWORD W, H;
+	VESSEL* pV;
+};
@@ -0,0 +1,35 @@
+#pragma once
+// Headless stand-in for Olog. Warnings and errors go to stderr, the other levels are discarded.
+#include <functional>
+#include <cstdarg>
+#include <cstdio>
+enum OLOGLEVEL { OLOG_TRACE, OLOG_DEBUG, OLOG_INFO, OLOG_WARN, OLOG_ERROR };
+typedef void* FILEHANDLE;
+namespace Olog {
+	inline OLOGLEVEL loglevel = OLOG_INFO;
+	inline OLOGLEVEL assertlevel = OLOG_DEBUG;
+	inline const char* projectName = "";
+	inline void trace(const char*, ...) {}
+	inline void debug(const char*, ...) {}
+	inline void info(const char*, ...) {}
+	//One write per message, so messages of vessels stepped on different threads don't interleave
+	inline void print(const char* level, const char* message, va_list args) {
+		char text[1024];
+		vsnprintf(text, sizeof(text), message, args);
+		fprintf(stderr, "%s: %s\n", level, text);
+	}
+	inline void warn(const char* message, ...) {
+		va_list args;
+		va_start(args, message);
+		print("WARNING", message, args);
+		va_end(args);
+	}
+	inline void error(const char* message, ...) {
+		va_list args;
+		va_start(args, message);
+		print("ERROR", message, args);
+		va_end(args);
+	}
+	inline void setLogLevelFromFile(FILEHANDLE) {}
+	inline void assertThat(std::function<bool()>, const char*, ...) {}
+}
@@ -0,0 +1,3 @@
+#pragma once
+// Headless stand-in for Oparse forward declarations.
+namespace Oparse { class OpModelDef; }
@@ -0,0 +1,5 @@
+#pragma once
+// Headless stand-in for Oparse standard library includes.
+#include <string>
+#include <vector>
+#include <map>
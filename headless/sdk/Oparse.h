@@ -0,0 +1,100 @@
+#pragma once
+// Headless stand-in for Oparse. Model definitions bind their variables and validators like they do with Oparse, and
+// HeadlessConfig reads the cfg through them, so headless tools parse the same keys with the same bounds as the vessel.
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <functional>
+#include <type_traits>
+#include <initializer_list>
+#include <cstdlib>
+typedef void* FILEHANDLE;
+namespace Oparse {
+	class OpModelDef;
+
+	struct OpValue {
+		// Reads the text of a key into the bound variable, adds the numbers read for the validators. False if the text is invalid.
+		std::function<bool(const std::string& text, std::vector<double>& numbers)> read;
+		// Definition of the nested block, for models instead of read
+		std::function<OpModelDef()> model;
+	};
+
+	struct OpValidator {
+		enum KIND { REQUIRED, MIN, MAX } kind;
+		double bound;
+	};
+
+	struct OpEntry {
+		OpValue value;
+		std::vector<OpValidator> validators;
+		OpEntry(OpValue value, std::initializer_list<OpValidator> validators = {}) : value(value), validators(validators) {}
+	};
+
+	class OpModelDef : public std::map<std::string, OpEntry> {
+	public:
+		OpModelDef() {}
+		OpModelDef(std::initializer_list<std::pair<const char*, OpEntry>> entries) { *this = entries; }
+		OpModelDef& operator=(std::initializer_list<std::pair<const char*, OpEntry>> entries) {
+			clear();
+			for (const auto& it : entries) emplace(it.first, it.second);
+			return *this;
+		}
+	};
+
+	inline bool readNumber(const std::string& text, double& number) {
+		char* end;
+		number = strtod(text.c_str(), &end);
+		return end != text.c_str();
+	}
+
+	template<typename T> OpValue _Param(T& param) {
+		return OpValue{ [&param](const std::string& text, std::vector<double>& numbers) {
+			if constexpr (std::is_same_v<T, std::string>) {
+				param = text;
+				return true;
+			}
+			else if constexpr (std::is_same_v<T, bool>) {
+				std::string value;
+				for (char c : text) value += (char)tolower((unsigned char)c);
+				param = value == "true" || value == "1";
+				return param || value == "false" || value == "0";
+			}
+			else {
+				double number;
+				if (!readNumber(text, number)) return false;
+				param = (T)number;
+				numbers.push_back(number);
+				return true;
+			}
+		}, nullptr };
+	}
+
+	template<typename T> OpValue _List(std::vector<T>& list, const char* delimiter = ",") {
+		std::string separator = delimiter;
+		return OpValue{ [&list, separator](const std::string& text, std::vector<double>& numbers) {
+			std::vector<T> items;
+			for (size_t start = 0; start <= text.size();) {
+				size_t end = text.find(separator, start);
+				if (end == std::string::npos) end = text.size();
+				double number;
+				if (!readNumber(text.substr(start, end - start), number)) return false;
+				items.push_back((T)number);
+				numbers.push_back(number);
+				start = end + separator.size();
+			}
+			list = items;
+			return true;
+		}, nullptr };
+	}
+
+	template<typename T> OpValue _Model(T& model) {
+		return OpValue{ nullptr, [&model]() { return model.GetModelDef(); } };
+	}
+
+	inline OpValidator _REQUIRED() { return OpValidator{ OpValidator::REQUIRED, 0.0 }; }
+	template<typename T> OpValidator _MIN(T bound) { return OpValidator{ OpValidator::MIN, (double)bound }; }
+	template<typename T> OpValidator _MAX(T bound) { return OpValidator{ OpValidator::MAX, (double)bound }; }
+	struct PARSINGRESULT { bool HasErrors() { return false; } std::string GetFormattedErrorsForFile() { return ""; } };
+	inline PARSINGRESULT ParseFile(FILEHANDLE, OpModelDef&, std::string) { return PARSINGRESULT(); }
+}
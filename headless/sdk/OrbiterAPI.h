@@ -0,0 +1,65 @@
+#pragma once
+// Headless stand-in for the Orbiter API.
+#include <windows.h>
+#include <cmath>
+#include <vector>
+#include <string>
+const double PI = 3.14159265358979323846;
+const double PI05 = PI * 0.5;
+const double PI2 = PI * 2.0;
+const double RAD = PI / 180.0;
+const double DEG = 180.0 / PI;
+typedef void* OBJHANDLE;
+typedef void* VISHANDLE;
+typedef void* MESHHANDLE;
+typedef void* THRUSTER_HANDLE;
+typedef void* THGROUP_HANDLE;
+typedef void* PROPELLANT_HANDLE;
+typedef void* DOCKHANDLE;
+typedef void* FILEHANDLE;
+typedef union { double data[3]; struct { double x, y, z; }; } VECTOR3;
+typedef union { double data[9]; struct { double m11, m12, m13, m21, m22, m23, m31, m32, m33; }; } MATRIX3;
+inline VECTOR3 _V(double x, double y, double z) { VECTOR3 v; v.x = x; v.y = y; v.z = z; return v; }
+inline VECTOR3 operator+(const VECTOR3& a, const VECTOR3& b) { return _V(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline VECTOR3 operator-(const VECTOR3& a, const VECTOR3& b) { return _V(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline VECTOR3 operator-(const VECTOR3& a) { return _V(-a.x, -a.y, -a.z); }
+inline VECTOR3 operator*(const VECTOR3& a, double f) { return _V(a.x * f, a.y * f, a.z * f); }
+inline VECTOR3 operator/(const VECTOR3& a, double f) { return _V(a.x / f, a.y / f, a.z / f); }
+inline VECTOR3& operator+=(VECTOR3& a, const VECTOR3& b) { a.x += b.x; a.y += b.y; a.z += b.z; return a; }
+inline VECTOR3& operator-=(VECTOR3& a, const VECTOR3& b) { a.x -= b.x; a.y -= b.y; a.z -= b.z; return a; }
+inline VECTOR3& operator*=(VECTOR3& a, double f) { a.x *= f; a.y *= f; a.z *= f; return a; }
+inline double dotp(const VECTOR3& a, const VECTOR3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline VECTOR3 crossp(const VECTOR3& a, const VECTOR3& b) { return _V(a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y); }
+inline double length(const VECTOR3& a) { return std::sqrt(dotp(a, a)); }
+inline VECTOR3 unit(const VECTOR3& a) { return a / length(a); }
+inline VECTOR3 mul(const MATRIX3& A, const VECTOR3& b) { return _V(A.m11 * b.x + A.m12 * b.y + A.m13 * b.z, A.m21 * b.x + A.m22 * b.y + A.m23 * b.z, A.m31 * b.x + A.m32 * b.y + A.m33 * b.z); }
+inline VECTOR3 tmul(const MATRIX3& A, const VECTOR3& b) { return _V(A.m11 * b.x + A.m21 * b.y + A.m31 * b.z, A.m12 * b.x + A.m22 * b.y + A.m32 * b.z, A.m13 * b.x + A.m23 * b.y + A.m33 * b.z); }
+enum THGROUP_TYPE {
+	THGROUP_MAIN, THGROUP_RETRO, THGROUP_HOVER,
+	THGROUP_ATT_PITCHUP, THGROUP_ATT_PITCHDOWN, THGROUP_ATT_YAWLEFT, THGROUP_ATT_YAWRIGHT,
+	THGROUP_ATT_BANKLEFT, THGROUP_ATT_BANKRIGHT, THGROUP_ATT_RIGHT, THGROUP_ATT_LEFT,
+	THGROUP_ATT_UP, THGROUP_ATT_DOWN, THGROUP_ATT_FORWARD, THGROUP_ATT_BACK,
+	THGROUP_USER = 0x40
+};
+#define MANCTRL_ATTMODE 0
+#define MANCTRL_ROTMODE 1
+#define MANCTRL_LINMODE 2
+#define MANCTRL_ANYDEVICE 0
+#define NAVMODE_KILLROT 1
+const int OAPI_KEY_A = 0x1E, OAPI_KEY_K = 0x25, OAPI_KEY_N = 0x31, OAPI_KEY_P = 0x19, OAPI_KEY_S = 0x1F, OAPI_KEY_X = 0x2D, OAPI_KEY_G = 0x22, OAPI_KEY_W = 0x11, OAPI_KEY_T = 0x14, OAPI_KEY_R = 0x13, OAPI_KEY_C = 0x2E, OAPI_KEY_D = 0x20, OAPI_KEY_J = 0x24, OAPI_KEY_O = 0x18;
+const int OAPI_KEY_LALT = 0x38, OAPI_KEY_RALT = 0xB8;
+#define KEYDOWN(buf, key) (buf[key] & 0x80)
+#define KEYMOD_ALT(buf) (KEYDOWN(buf, OAPI_KEY_LALT) || KEYDOWN(buf, OAPI_KEY_RALT))
+const int PANEL_MOUSE_LBDOWN = 1;
+const UINT OAPI_MSG_MFD_OPENEDEX = 5;
+double oapiGetSimMJD();
+double oapiGetSimTime();
+double oapiGetSimStep();
+double oapiGetTimeAcceleration();
+double oapiGetSysTime();
+DWORD oapiGetVesselCount();
+OBJHANDLE oapiGetVesselByIndex(int index);
+class VESSEL* oapiGetVesselInterface(OBJHANDLE h);
+bool oapiIsVessel(OBJHANDLE h);
+void oapiGetGlobalPos(OBJHANDLE h, VECTOR3* pos);
+void oapiGetGlobalVel(OBJHANDLE h, VECTOR3* vel);
@@ -0,0 +1,150 @@
+/**
+ * \file OrbiterStub.cpp
+ * Headless implementation of the parts of the Orbiter API used by the vessel systems.
+ *
+ * There is no simulation behind it: propellant resources, thrusters and the attitude only store what is set on them,
+ * so systems can be stepped outside of Orbiter. Tools that need the vessel to move integrate it themselves. Every vessel keeps its own state and there is no global
+ * mutable state, so independent vessels can be stepped from different threads.
+ */
+
+#include <orbitersdk.h>
+#include <memory>
+#include <vector>
+
+const double HEADLESS_SIM_MJD = 51544.5;
+
+struct HeadlessPropellant {
+	double maxMass;
+	double mass;
+};
+
+struct HeadlessThruster {
+	VECTOR3 pos;
+	VECTOR3 dir;
+	double max0;
+	double level;
+	HeadlessPropellant* propellant;
+	double isp;
+};
+
+struct HeadlessDock {
+	VECTOR3 pos;
+	VECTOR3 dir;
+	VECTOR3 rot;
+};
+
+struct HeadlessVesselState {
+	std::string name;
+	std::vector<std::unique_ptr<HeadlessPropellant>> propellants;
+	std::vector<std::unique_ptr<HeadlessThruster>> thrusters;
+	std::vector<HeadlessDock> docks;
+	double emptyMass = 0.0;
+	VECTOR3 pmi = { 1.0, 1.0, 1.0 };
+	MATRIX3 rotation = { 1.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 1.0 };
+	VECTOR3 angularVel = { 0.0, 0.0, 0.0 };
+};
+
+double oapiGetSimMJD() { return HEADLESS_SIM_MJD; }
+double oapiGetSimTime() { return 0.0; }
+double oapiGetSimStep() { return 0.02; }
+double oapiGetTimeAcceleration() { return 1.0; }
+double oapiGetSysTime() { return 0.0; }
+DWORD oapiGetVesselCount() { return 0; }
+OBJHANDLE oapiGetVesselByIndex(int) { return NULL; }
+VESSEL* oapiGetVesselInterface(OBJHANDLE) { return NULL; }
+bool oapiIsVessel(OBJHANDLE) { return false; }
+void oapiGetGlobalPos(OBJHANDLE, VECTOR3* pos) { *pos = _V(0, 0, 0); }
+void oapiGetGlobalVel(OBJHANDLE, VECTOR3* vel) { *vel = _V(0, 0, 0); }
+
+VESSEL::VESSEL(OBJHANDLE hVessel, int) : hVessel(hVessel), state(new HeadlessVesselState()) {
+	state->name = "Hauler";
+}
+
+VESSEL::~VESSEL() {
+	delete state;
+}
+
+OBJHANDLE VESSEL::GetHandle() const { return hVessel; }
+const char* VESSEL::GetName() const { return state->name.c_str(); }
+
+PROPELLANT_HANDLE VESSEL::CreatePropellantResource(double maxmass, double mass, double) const {
+	state->propellants.push_back(std::unique_ptr<HeadlessPropellant>(new HeadlessPropellant{ maxmass, mass < 0.0 ? maxmass : mass }));
+	return state->propellants.back().get();
+}
+
+double VESSEL::GetPropellantMass(PROPELLANT_HANDLE ph) const { return ph ? ((HeadlessPropellant*)ph)->mass : 0.0; }
+double VESSEL::GetPropellantMaxMass(PROPELLANT_HANDLE ph) const { return ph ? ((HeadlessPropellant*)ph)->maxMass : 0.0; }
+void VESSEL::SetPropellantMass(PROPELLANT_HANDLE ph, double mass) const { if (ph) ((HeadlessPropellant*)ph)->mass = mass; }
+
+double VESSEL::GetTotalPropellantMass() const {
+	double total = 0.0;
+	for (const auto& it : state->propellants) {
+		total += it->mass;
+	}
+	return total;
+}
+
+double VESSEL::GetMass() const { return state->emptyMass + GetTotalPropellantMass(); }
+double VESSEL::GetEmptyMass() const { return state->emptyMass; }
+void VESSEL::SetEmptyMass(double m) const { state->emptyMass = m; }
+void VESSEL::GetPMI(VECTOR3& pmi) const { pmi = state->pmi; }
+void VESSEL::SetPMI(const VECTOR3& pmi) const { state->pmi = pmi; }
+void VESSEL::GetRotationMatrix(MATRIX3& R) const { R = state->rotation; }
+void VESSEL::SetRotationMatrix(const MATRIX3& R) const { state->rotation = R; }
+void VESSEL::GetAngularVel(VECTOR3& avel) const { avel = state->angularVel; }
+void VESSEL::SetAngularVel(const VECTOR3& avel) const { state->angularVel = avel; }
+void VESSEL::GetRelativePos(OBJHANDLE, VECTOR3& pos) const { pos = _V(0, 0, 0); }
+void VESSEL::GetRelativeVel(OBJHANDLE, VECTOR3& vel) const { vel = _V(0, 0, 0); }
+double VESSEL::GetSize() const { return 10.0; }
+void VESSEL::GetGlobalPos(VECTOR3& pos) const { pos = _V(0, 0, 0); }
+void VESSEL::GetGlobalVel(VECTOR3& vel) const { vel = _V(0, 0, 0); }
+void VESSEL::Local2Global(const VECTOR3& local, VECTOR3& global) const { global = mul(state->rotation, local); }
+void VESSEL::GlobalRot(const VECTOR3& rloc, VECTOR3& rglob) const { rglob = mul(state->rotation, rloc); }
+
+DWORD VESSEL::GetThrusterCount() const { return (DWORD)state->thrusters.size(); }
+THRUSTER_HANDLE VESSEL::GetThrusterHandleByIndex(DWORD idx) const { return idx < state->thrusters.size() ? state->thrusters[idx].get() : NULL; }
+
+THRUSTER_HANDLE VESSEL::CreateThruster(const VECTOR3& pos, const VECTOR3& dir, double maxth0, PROPELLANT_HANDLE hp, double isp0, double, double) const {
+	state->thrusters.push_back(std::unique_ptr<HeadlessThruster>(new HeadlessThruster{ pos, dir, maxth0, 0.0, (HeadlessPropellant*)hp, isp0 }));
+	return state->thrusters.back().get();
+}
+
+void VESSEL::SetThrusterLevel(THRUSTER_HANDLE th, double level) const { ((HeadlessThruster*)th)->level = level; }
+double VESSEL::GetThrusterLevel(THRUSTER_HANDLE th) const { return ((HeadlessThruster*)th)->level; }
+void VESSEL::SetThrusterMax0(THRUSTER_HANDLE th, double maxth0) const { ((HeadlessThruster*)th)->max0 = maxth0; }
+double VESSEL::GetThrusterMax0(THRUSTER_HANDLE th) const { return ((HeadlessThruster*)th)->max0; }
+void VESSEL::SetThrusterDir(THRUSTER_HANDLE th, const VECTOR3& dir) const { ((HeadlessThruster*)th)->dir = dir; }
+void VESSEL::GetThrusterDir(THRUSTER_HANDLE th, VECTOR3& dir) const { dir = ((HeadlessThruster*)th)->dir; }
+void VESSEL::GetThrusterRef(THRUSTER_HANDLE th, VECTOR3& pos) const { pos = ((HeadlessThruster*)th)->pos; }
+void VESSEL::SetThrusterResource(THRUSTER_HANDLE th, PROPELLANT_HANDLE ph) const { ((HeadlessThruster*)th)->propellant = (HeadlessPropellant*)ph; }
+THGROUP_HANDLE VESSEL::CreateThrusterGroup(THRUSTER_HANDLE*, int, THGROUP_TYPE) const { return (THGROUP_HANDLE)1; }
+double VESSEL::GetThrusterGroupLevel(THGROUP_TYPE) const { return 0.0; }
+double VESSEL::GetManualControlLevel(THGROUP_TYPE, DWORD, DWORD) const { return 0.0; }
+unsigned int VESSEL::AddExhaust(THRUSTER_HANDLE, double, double, const VECTOR3&, const VECTOR3&, void*) const { return 0; }
+
+DOCKHANDLE VESSEL::CreateDock(const VECTOR3& pos, const VECTOR3& dir, const VECTOR3& rot) const {
+	state->docks.push_back(HeadlessDock{ pos, dir, rot });
+	return (DOCKHANDLE)(uintptr_t)state->docks.size();
+}
+
+DWORD VESSEL::DockCount() const { return (DWORD)state->docks.size(); }
+DOCKHANDLE VESSEL::GetDockHandle(UINT n) const { return n < state->docks.size() ? (DOCKHANDLE)(uintptr_t)(n + 1) : NULL; }
+
+void VESSEL::GetDockParams(DOCKHANDLE dock, VECTOR3& pos, VECTOR3& dir, VECTOR3& rot) const {
+	const HeadlessDock& it = state->docks[(uintptr_t)dock - 1];
+	pos = it.pos;
+	dir = it.dir;
+	rot = it.rot;
+}
+OBJHANDLE VESSEL::GetDockStatus(DOCKHANDLE) const { return NULL; }
+bool VESSEL::RegisterMFDMode(const MFDMODESPECEX&) { return true; }
+
+void MFD2::Title(oapi::Sketchpad* skp, const char* title) const { skp->Text(0, 0, title, (int)strlen(title)); }
+oapi::Font* MFD2::GetDefaultFont(DWORD) const { return NULL; }
+oapi::Pen* MFD2::GetDefaultPen(DWORD, DWORD, DWORD) const {
+	static oapi::Pen pen(0x00FF00);
+	return &pen;
+}
+DWORD MFD2::GetDefaultColour(DWORD, DWORD) const { return 0x00FF00; }
+void MFD2::InvalidateDisplay() {}
+void MFD2::InvalidateButtons() {}
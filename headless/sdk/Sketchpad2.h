@@ -0,0 +1,3 @@
+#pragma once
+// Headless stand-in for Sketchpad2.
+#include "MFDAPI.h"
@@ -0,0 +1,267 @@
+#include "SoftSketchpad.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+const int GLYPH_WIDTH = 5;
+const int GLYPH_HEIGHT = 7;
+//Advance per character and line, in unscaled pixels
+const int GLYPH_ADVANCE = 6;
+
+/* 5x7 font for the printable ASCII characters from ' ' to '~'. One byte per column, the lowest bit is the top row.
+ */
+static const unsigned char FONT[95][GLYPH_WIDTH] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 },
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 },
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },
+	{ 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 },
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 },
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 },
+	{ 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 },
+	{ 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },
+	{ 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x09, 0x01 }, { 0x3E, 0x41, 0x49, 0x49, 0x7A },
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 },
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x0C, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 },
+	{ 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F },
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x07, 0x08, 0x70, 0x08, 0x07 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 },
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 },
+	{ 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 }, { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 },
+	{ 0x38, 0x44, 0x44, 0x48, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x0C, 0x52, 0x52, 0x52, 0x3E },
+	{ 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3D, 0x00 }, { 0x7F, 0x10, 0x28, 0x44, 0x00 },
+	{ 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 }, { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 },
+	{ 0x7C, 0x14, 0x14, 0x14, 0x08 }, { 0x08, 0x14, 0x14, 0x18, 0x7C }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+	{ 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C },
+	{ 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C }, { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 },
+	{ 0x00, 0x00, 0x7F, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x08, 0x04, 0x08, 0x10, 0x08 }
+};
+
+
+SoftSketchpad::SoftSketchpad(int width, int height, int fontScale) :
+	width(width), height(height), fontScale(fontScale > 0 ? fontScale : 1), pixels((size_t)width * height, 0),
+	textColour(0xFFFFFF), backgroundColour(0), pen(NULL), penX(0), penY(0) {}
+
+oapi::Pen* SoftSketchpad::SetPen(oapi::Pen* pen) const {
+	oapi::Pen* previous = this->pen;
+	this->pen = pen;
+	return previous;
+}
+
+DWORD SoftSketchpad::SetTextColor(DWORD col) {
+	DWORD previous = textColour;
+	textColour = col;
+	return previous;
+}
+
+DWORD SoftSketchpad::SetBackgroundColor(DWORD col) {
+	DWORD previous = backgroundColour;
+	backgroundColour = col;
+	return previous;
+}
+
+bool SoftSketchpad::Text(int x, int y, const char* str, int len) {
+	stats.texts++;
+	stats.characters += len;
+	for (int i = 0; i < len; ++i) {
+		unsigned char c = (unsigned char)str[i];
+		const unsigned char* glyph = FONT[(c >= ' ' && c <= '~' ? c : '?') - ' '];
+		int left = x + i * GLYPH_ADVANCE * fontScale;
+		for (int column = 0; column < GLYPH_WIDTH; ++column) {
+			for (int row = 0; row < GLYPH_HEIGHT; ++row) {
+				if (!(glyph[column] >> row & 1)) continue;
+				for (int sy = 0; sy < fontScale; ++sy) {
+					for (int sx = 0; sx < fontScale; ++sx) {
+						plot(left + column * fontScale + sx, y + row * fontScale + sy, textColour);
+					}
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void SoftSketchpad::MoveTo(int x, int y) {
+	penX = x;
+	penY = y;
+}
+
+void SoftSketchpad::LineTo(int x, int y) {
+	stats.lines++;
+	drawLine(penX, penY, x, y);
+	MoveTo(x, y);
+}
+
+void SoftSketchpad::Line(int x0, int y0, int x1, int y1) {
+	stats.lines++;
+	drawLine(x0, y0, x1, y1);
+	MoveTo(x1, y1);
+}
+
+void SoftSketchpad::Rectangle(int x0, int y0, int x1, int y1) {
+	stats.rectangles++;
+	//The right and bottom edges are outside, as in GDI
+	drawLine(x0, y0, x1 - 1, y0);
+	drawLine(x1 - 1, y0, x1 - 1, y1 - 1);
+	drawLine(x1 - 1, y1 - 1, x0, y1 - 1);
+	drawLine(x0, y1 - 1, x0, y0);
+}
+
+void SoftSketchpad::Polyline(const IVECTOR2* pt, int npt) {
+	stats.polylines++;
+	for (int i = 1; i < npt; ++i) {
+		drawLine((int)pt[i - 1].x, (int)pt[i - 1].y, (int)pt[i].x, (int)pt[i].y);
+	}
+}
+
+void SoftSketchpad::clear() {
+	for (auto& it : pixels) {
+		it = backgroundColour;
+	}
+}
+
+DWORD SoftSketchpad::getPixel(int x, int y) const {
+	return x >= 0 && y >= 0 && x < width && y < height ? pixels[(size_t)y * width + x] : 0;
+}
+
+int SoftSketchpad::getWidth() const {
+	return width;
+}
+
+int SoftSketchpad::getHeight() const {
+	return height;
+}
+
+const SketchpadStats& SoftSketchpad::getStats() const {
+	return stats;
+}
+
+void SoftSketchpad::resetStats() {
+	stats = SketchpadStats();
+}
+
+void SoftSketchpad::plot(int x, int y, DWORD colour) {
+	if (x >= 0 && y >= 0 && x < width && y < height) {
+		pixels[(size_t)y * width + x] = colour;
+		stats.pixels++;
+	}
+}
+
+/*
+* Bresenham, without the end point. Without a pen nothing is drawn.
+*/
+void SoftSketchpad::drawLine(int x0, int y0, int x1, int y1) {
+	if (pen == NULL) {
+		return;
+	}
+	int dx = abs(x1 - x0);
+	int dy = -abs(y1 - y0);
+	int sx = x0 < x1 ? 1 : -1;
+	int sy = y0 < y1 ? 1 : -1;
+	int error = dx + dy;
+	while (x0 != x1 || y0 != y1) {
+		plot(x0, y0, pen->colour);
+		int e2 = 2 * error;
+		if (e2 >= dy) {
+			error += dy;
+			x0 += sx;
+		}
+		if (e2 <= dx) {
+			error += dx;
+			y0 += sy;
+		}
+	}
+}
+
+static std::vector<uint32_t> crcTable() {
+	std::vector<uint32_t> table(256);
+	for (uint32_t n = 0; n < 256; ++n) {
+		uint32_t c = n;
+		for (int k = 0; k < 8; ++k) {
+			c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+		table[n] = c;
+	}
+	return table;
+}
+
+static uint32_t crc32(const unsigned char* data, size_t length) {
+	static const std::vector<uint32_t> table = crcTable();
+	uint32_t crc = 0xFFFFFFFFu;
+	for (size_t i = 0; i < length; ++i) {
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void putBigEndian(std::vector<unsigned char>& out, uint32_t value) {
+	out.push_back((unsigned char)(value >> 24));
+	out.push_back((unsigned char)(value >> 16));
+	out.push_back((unsigned char)(value >> 8));
+	out.push_back((unsigned char)value);
+}
+
+static void writeChunk(FILE* file, const char* type, const std::vector<unsigned char>& data) {
+	std::vector<unsigned char> chunk;
+	putBigEndian(chunk, (uint32_t)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	putBigEndian(chunk, crc32(&chunk[4], chunk.size() - 4));
+	fwrite(chunk.data(), 1, chunk.size(), file);
+}
+
+bool SoftSketchpad::writePNG(const char* filename) const {
+	FILE* file = fopen(filename, "wb");
+	if (file == NULL) {
+		return false;
+	}
+	static const unsigned char SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file);
+
+	std::vector<unsigned char> header;
+	putBigEndian(header, (uint32_t)width);
+	putBigEndian(header, (uint32_t)height);
+	//8 bit RGB, deflate, no filter, no interlace
+	const unsigned char format[5] = { 8, 2, 0, 0, 0 };
+	header.insert(header.end(), format, format + 5);
+	writeChunk(file, "IHDR", header);
+
+	//Scanlines with filter type 0
+	std::vector<unsigned char> raw;
+	raw.reserve((size_t)height * (width * 3 + 1));
+	for (int y = 0; y < height; ++y) {
+		raw.push_back(0);
+		for (int x = 0; x < width; ++x) {
+			DWORD colour = pixels[(size_t)y * width + x];
+			raw.push_back((unsigned char)(colour & 0xFF));
+			raw.push_back((unsigned char)(colour >> 8 & 0xFF));
+			raw.push_back((unsigned char)(colour >> 16 & 0xFF));
+		}
+	}
+
+	//zlib stream of stored deflate blocks
+	std::vector<unsigned char> data = { 0x78, 0x01 };
+	const size_t BLOCK = 65535;
+	for (size_t offset = 0; offset < raw.size() || offset == 0; offset += BLOCK) {
+		size_t length = raw.size() - offset < BLOCK ? raw.size() - offset : BLOCK;
+		data.push_back(offset + length >= raw.size() ? 1 : 0);
+		data.push_back((unsigned char)(length & 0xFF));
+		data.push_back((unsigned char)(length >> 8));
+		data.push_back((unsigned char)(~length & 0xFF));
+		data.push_back((unsigned char)(~length >> 8 & 0xFF));
+		data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + length);
+		if (raw.empty()) break;
+	}
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (unsigned char c : raw) {
+		a = (a + c) % 65521;
+		b = (b + a) % 65521;
+	}
+	putBigEndian(data, b << 16 | a);
+	writeChunk(file, "IDAT", data);
+	writeChunk(file, "IEND", std::vector<unsigned char>());
+
+	return fclose(file) == 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+// Software rasterizer behind the headless Sketchpad, for rendering MFD pages outside of Orbiter.
+#include "MFDAPI.h"
+#include <vector>
+
+/* Calls a page made on the sketchpad, and what they touched.
+ */
+struct SketchpadStats {
+	unsigned long long texts = 0;
+	unsigned long long characters = 0;
+	unsigned long long lines = 0;
+	unsigned long long rectangles = 0;
+	unsigned long long polylines = 0;
+	unsigned long long pixels = 0;
+};
+
+/**
+ * \brief Sketchpad drawing into a framebuffer in memory.
+ *
+ * Text is drawn with a built-in 5x7 font with 6 pixels per character, which an integer factor can scale up for
+ * larger MFDs. Lines follow GDI and leave out their end point. Rectangles only draw
+ * their outline, there are no brushes. Colours are 0x00BBGGRR as in Orbiter.
+ *
+ * The sketchpad counts its calls, so a benchmark can report draw calls per refresh next to the time, and can write
+ * the framebuffer as PNG for a look at the page.
+ */
+class SoftSketchpad : public oapi::Sketchpad {
+public:
+	SoftSketchpad(int width, int height, int fontScale = 1);
+
+	virtual oapi::Pen* SetPen(oapi::Pen* pen) const;
+	virtual DWORD SetTextColor(DWORD col);
+	virtual DWORD SetBackgroundColor(DWORD col);
+	virtual bool Text(int x, int y, const char* str, int len);
+	virtual void MoveTo(int x, int y);
+	virtual void LineTo(int x, int y);
+	virtual void Line(int x0, int y0, int x1, int y1);
+	virtual void Rectangle(int x0, int y0, int x1, int y1);
+	virtual void Polyline(const IVECTOR2* pt, int npt);
+
+	//Fills the framebuffer with the background colour, as Orbiter does before every MFD refresh
+	void clear();
+	DWORD getPixel(int x, int y) const;
+	int getWidth() const;
+	int getHeight() const;
+
+	const SketchpadStats& getStats() const;
+	void resetStats();
+
+	/* Writes the framebuffer as 8 bit RGB PNG, uncompressed. Returns false if the file can't be written.
+	 */
+	bool writePNG(const char* filename) const;
+
+private:
+	int width;
+	int height;
+	int fontScale;
+	std::vector<DWORD> pixels;
+	DWORD textColour;
+	DWORD backgroundColour;
+	//SetPen is const in the Orbiter API
+	mutable oapi::Pen* pen;
+	int penX;
+	int penY;
+	SketchpadStats stats;
+
+	void plot(int x, int y, DWORD colour);
+	void drawLine(int x0, int y0, int x1, int y1);
+};
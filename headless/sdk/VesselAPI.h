@@ -0,0 +1,69 @@
+#pragma once
+// Headless stand-in for the Orbiter vessel API, see OrbiterStub.cpp.
+#include "OrbiterAPI.h"
+class VESSEL {
+public:
+	VESSEL(OBJHANDLE hVessel, int fmodel = 1);
+	virtual ~VESSEL();
+	OBJHANDLE GetHandle() const;
+	const char* GetName() const;
+	PROPELLANT_HANDLE CreatePropellantResource(double maxmass, double mass = -1.0, double efficiency = 1.0) const;
+	double GetPropellantMass(PROPELLANT_HANDLE ph) const;
+	double GetPropellantMaxMass(PROPELLANT_HANDLE ph) const;
+	void SetPropellantMass(PROPELLANT_HANDLE ph, double mass) const;
+	double GetTotalPropellantMass() const;
+	DWORD GetThrusterCount() const;
+	THRUSTER_HANDLE GetThrusterHandleByIndex(DWORD idx) const;
+	THRUSTER_HANDLE CreateThruster(const VECTOR3& pos, const VECTOR3& dir, double maxth0, PROPELLANT_HANDLE hp = NULL, double isp0 = 0.0, double isp_ref = 0.0, double p_ref = 101.4e3) const;
+	void SetThrusterLevel(THRUSTER_HANDLE th, double level) const;
+	double GetThrusterLevel(THRUSTER_HANDLE th) const;
+	void SetThrusterMax0(THRUSTER_HANDLE th, double maxth0) const;
+	double GetThrusterMax0(THRUSTER_HANDLE th) const;
+	void SetThrusterDir(THRUSTER_HANDLE th, const VECTOR3& dir) const;
+	void GetThrusterDir(THRUSTER_HANDLE th, VECTOR3& dir) const;
+	void GetThrusterRef(THRUSTER_HANDLE th, VECTOR3& pos) const;
+	void SetThrusterResource(THRUSTER_HANDLE th, PROPELLANT_HANDLE ph) const;
+	THGROUP_HANDLE CreateThrusterGroup(THRUSTER_HANDLE* th, int nth, THGROUP_TYPE thgt) const;
+	double GetThrusterGroupLevel(THGROUP_TYPE thgt) const;
+	double GetManualControlLevel(THGROUP_TYPE thgt, DWORD mode = MANCTRL_ATTMODE, DWORD device = MANCTRL_ANYDEVICE) const;
+	unsigned int AddExhaust(THRUSTER_HANDLE th, double lscale, double wscale, const VECTOR3& pos, const VECTOR3& dir, void* tex = 0) const;
+	DOCKHANDLE CreateDock(const VECTOR3& pos, const VECTOR3& dir, const VECTOR3& rot) const;
+	DWORD DockCount() const;
+	DOCKHANDLE GetDockHandle(UINT n) const;
+	void GetDockParams(DOCKHANDLE dock, VECTOR3& pos, VECTOR3& dir, VECTOR3& rot) const;
+	OBJHANDLE GetDockStatus(DOCKHANDLE dock) const;
+	double GetMass() const;
+	double GetEmptyMass() const;
+	void SetEmptyMass(double m) const;
+	void GetPMI(VECTOR3& pmi) const;
+	void SetPMI(const VECTOR3& pmi) const;
+	double GetSize() const;
+	void GetGlobalPos(VECTOR3& pos) const;
+	void GetGlobalVel(VECTOR3& vel) const;
+	void GetRotationMatrix(MATRIX3& R) const;
+	void SetRotationMatrix(const MATRIX3& R) const;
+	void GetAngularVel(VECTOR3& avel) const;
+	void SetAngularVel(const VECTOR3& avel) const;
+	void GetGlobalOrientation(VECTOR3& arot) const;
+	void Global2Local(const VECTOR3& glob, VECTOR3& loc) const;
+	void Local2Global(const VECTOR3& local, VECTOR3& global) const;
+	void GlobalRot(const VECTOR3& rloc, VECTOR3& rglob) const;
+	void GetRelativePos(OBJHANDLE hRef, VECTOR3& pos) const;
+	void GetRelativeVel(OBJHANDLE hRef, VECTOR3& vel) const;
+	bool ActivateNavmode(int mode);
+	bool DeactivateNavmode(int mode);
+	bool GetNavmodeState(int mode);
+	bool RegisterMFDMode(const struct MFDMODESPECEX& spec);
+	virtual void clbkSetClassCaps(FILEHANDLE cfg) {}
+	virtual void clbkPreStep(double simt, double simdt, double mjd) {}
+	virtual void clbkPostStep(double simt, double simdt, double mjd) {}
+	virtual int clbkConsumeBufferedKey(DWORD key, bool down, char* kstate) { return 0; }
+protected:
+	OBJHANDLE hVessel;
+private:
+	//Propellant resources and thrusters of this vessel, owned by the stub
+	struct HeadlessVesselState* state;
+};
+class VESSEL2 : public VESSEL { public: VESSEL2(OBJHANDLE h, int f = 1) : VESSEL(h, f) {} };
+class VESSEL3 : public VESSEL2 { public: VESSEL3(OBJHANDLE h, int f = 1) : VESSEL2(h, f) {} };
+class VESSEL4 : public VESSEL3 { public: VESSEL4(OBJHANDLE h, int f = 1) : VESSEL3(h, f) {} };
@@ -0,0 +1,6 @@
+#pragma once
+// Headless stand-in for the Orbiter SDK umbrella header.
+#include <windows.h>
+#include "OrbiterAPI.h"
+#include "VesselAPI.h"
+#include "MFDAPI.h"
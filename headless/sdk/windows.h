@@ -0,0 +1,17 @@
+#pragma once
+// Headless stand-in for the few Win32 types and functions the OrbitalHauler sources use.
+#include <cstdint>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+typedef unsigned long DWORD;
+typedef unsigned int UINT;
+typedef uintptr_t WPARAM;
+typedef intptr_t LPARAM;
+typedef void* HINSTANCE;
+typedef void* HANDLE;
+typedef int BOOL;
+#define DLLCLBK extern "C"
+template<size_t N, typename... A> inline int sprintf_s(char (&buf)[N], const char* fmt, A... a) { return snprintf(buf, N, fmt, a...); }
+template<typename... A> inline int sprintf_s(char* buf, size_t n, const char* fmt, A... a) { return snprintf(buf, n, fmt, a...); }
@@ -1,6 +1,8 @@
 #include "LANTRMFD.h"
 #include <Sketchpad2.h>
 #include "core/OrbitalHauler.h"
+#include "systems/telemetry/TrendRecorder.h"
+#include "core/Trace.h"
 
 using namespace std;
 
@@ -9,32 +11,68 @@ LANTRMFD::LANTRMFD(DWORD w, DWORD h, VESSEL* vessel)
 	: MFD2(w, h, vessel)
 {
 	engine = ((OrbitalHauler*)vessel)->Powerplant();
-	initStateLabels();
+	decimation = ((OrbitalHauler*)vessel)->DisplayDecimation();
+	refreshes = 0;
+	trends = ((OrbitalHauler*)vessel)->Trends();
+	page = 0;
+	window = 0;
+	trendMinimum.resize(max((int)GetWidth() - 10, 1));
+	trendMaximum.resize(trendMinimum.size());
+	int baseX2 = GetWidth() / 2;
+	MainEngine* engine = this->engine;
+
+	display.addText(5, 20, [engine]() { return (unsigned int)engine->getTargetMode(); },
+		[engine](char* buffer, size_t size) { sprintf_s(buffer, size, "MODE: %s", engine->getModeAsText().c_str()); });
+	display.addText(5, 40, [engine]() { return (unsigned int)engine->getCurrentMode(); },
+		[engine](char* buffer, size_t size) {
+			int mode = engine->getCurrentMode();
+			const char* label = controllerStateLabel(mode);
+			if (label != NULL) {
+				sprintf_s(buffer, size, "STATE: (%04d) %s", mode, label);
+			}
+			else {
+				sprintf_s(buffer, size, "STATE: (%04d)", mode);
+			}
+		});
+
+	// Thresholds of half the last printed digit. FLUX prints two significant digits, so half its last digit is 0.5 to
+	// 5 % of the value, depending on the mantissa. The relative threshold takes the low end, no printed change is missed.
+	display.addValue(5, 80, "THERMAL: %5.1f kW", 0.05, [engine]() { return engine->getThermalPower() / 1000.0; });
+	display.addValue(5, 100, "FLUX: %010.2g", 0.005, [engine]() { return engine->getNeutronFlux(); }, true);
+	display.addValue(5, 120, "TEMP: %06.1f K", 0.05, [engine]() { return engine->getChamberTemperature(); });
+
+	display.addValue(baseX2, 80, "IN P: %06.3f kPa", 0.0005, [engine]() { return engine->getPrimaryLoopInP() / 1000.0; });
+	display.addValue(baseX2, 100, "IN T: %06.3f K", 0.0005, [engine]() { return engine->getPrimaryLoopInletT(); });
+
+	addErrorMessages();
 }
 
 int LANTRMFD::ButtonMenu(const MFDBUTTONMENU** menu) const {
-	static const MFDBUTTONMENU mnu[5] = {
+	static const MFDBUTTONMENU mnu[8] = {
 		{"Stop", 0, 'S'},
 		{"Start", 0, 'A'},
 		{"NTR", 0, 'N'},
 		{"LANTR", 0, 'K'},
-		{"SCRAM", 0, 'X'}
+		{"SCRAM", 0, 'X'},
+		{"Acknowledge", "anomalies", 'C'},
+		{"Next page", 0, 'G'},
+		{"Trend window", 0, 'W'}
 	};
 	if (menu) *menu = mnu;
-	return 5;
+	return 8;
 }
 
 char* LANTRMFD::ButtonLabel(int bt)
 {
-	char* label[5] = { "OFF", "ON", "NTR", "LAN", "SCR"};
-	return (bt < 5 ? label[bt] : 0);
+	char* label[8] = { "OFF", "ON", "NTR", "LAN", "SCR", "ACK", "PG", "WIN"};
+	return (bt < 8 ? label[bt] : 0);
 }
 
 bool LANTRMFD::ConsumeButton(int bt, int event)
 {
 	if (!(event & PANEL_MOUSE_LBDOWN)) return false;
-	static const DWORD btkey[5] = { OAPI_KEY_S, OAPI_KEY_A, OAPI_KEY_N, OAPI_KEY_K, OAPI_KEY_X };
-	if (bt < 5) return ConsumeKeyBuffered(btkey[bt]);
+	static const DWORD btkey[8] = { OAPI_KEY_S, OAPI_KEY_A, OAPI_KEY_N, OAPI_KEY_K, OAPI_KEY_X, OAPI_KEY_C, OAPI_KEY_G, OAPI_KEY_W };
+	if (bt < 8) return ConsumeKeyBuffered(btkey[bt]);
 	else return false;
 }
 
@@ -58,47 +96,39 @@ bool LANTRMFD::ConsumeKeyBuffered(DWORD key)
 	case OAPI_KEY_X:
 		engine->scram("CREW COMMAND");
 		return true;
+	case OAPI_KEY_C:
+		engine->confirmErrors();
+		return true;
+	case OAPI_KEY_G:
+		page = (page + 1) % (trends->countTrends() + 1);
+		//Read the status values right away when returning to the status page
+		refreshes = 0;
+		InvalidateDisplay();
+		return true;
+	case OAPI_KEY_W:
+		window = (window + 1) % LANTRMFD_TREND_WINDOWS;
+		InvalidateDisplay();
+		return true;
 	}
 	return false;
 }
 
-const string LABEL_STATE_OFF = "STANDBY";
-const string LABEL_STATE_ACTIVATE_CONTROLLER = "ACTIVATE_CONTROLLER";
-const string LABEL_STATE_CONTROLLER_BITE = "CONTROLLER_BITE";
-const string LABEL_STATE_NEUTRONDETECTOR_TEST = "NEUTRON_DETECTOR_TEST";
-
 bool LANTRMFD::Update(oapi::Sketchpad* sketchpad) {
-	char buffer[250];
-	int baseX2 = GetWidth() / 2;
-
+	OH_TRACE_SCOPE("LANTRMFD::Update");
 	Title(sketchpad, "POWERPLANT");
 	sketchpad->SetFont(GetDefaultFont(0));
 	sketchpad->SetTextColor(GetDefaultColour(0));
-	sprintf_s(buffer, 250, "MODE: %s", engine->getModeAsText().c_str());
-	sketchpad->Text(5, 20, buffer, strlen(buffer));
-	int mode = engine->getCurrentMode();
-	if (state_labels.find(mode) != state_labels.end()) {
-		sprintf_s(buffer, 250, "STATE: (%04d) %s", mode, state_labels.at(mode).c_str());
-	}
-	else {
-		sprintf_s(buffer, 250, "STATE: (%04d)", mode);
-	}
-	sketchpad->Text(5, 40, buffer, strlen(buffer));
-
-	sprintf_s(buffer, 250, "THERMAL: %5.1f kW", engine->getThermalPower() / 1000.0);
-	sketchpad->Text(5, 80, buffer, strlen(buffer));
-	sprintf_s(buffer, 250, "FLUX: %010.2g", engine->getNeutronFlux());
-	sketchpad->Text(5, 100, buffer, strlen(buffer));
-	sprintf_s(buffer, 250, "TEMP: %06.1f K", engine->getChamberTemperature());
-	sketchpad->Text(5, 120, buffer, strlen(buffer));
-
-	sprintf_s(buffer, 250, "IN P: %06.3f kPa", engine->getPrimaryLoopInP() / 1000.0);
-	sketchpad->Text(baseX2, 80, buffer, strlen(buffer));
-	sprintf_s(buffer, 250, "IN T: %06.3f K", engine->getPrimaryLoopInletT());
-	sketchpad->Text(baseX2, 100, buffer, strlen(buffer));
 
+	if (page > 0) {
+		drawTrend(sketchpad, page - 1);
+		return true;
+	}
 
-	renderErrorMessages(sketchpad);
+	// Orbiter cleared the surface, so every field is drawn, but only changed values are formatted
+	if (refreshes++ % decimation == 0) {
+		display.update();
+	}
+	display.draw(sketchpad);
 
 	return true;
 }
@@ -118,22 +148,86 @@ int MJDToGMT(double mjd) {
 	return hours * 100 + minutes;
 }
 
-void LANTRMFD::renderErrorMessages(oapi::Sketchpad* sketchpad) {
+void LANTRMFD::addErrorMessages() {
 	int baseY = this->GetHeight() - 40;
-	int lines = min(4, engine->countErrors());
-	char buffer[250];
-	
-	for (int i = 0; i < lines; i++) {
-		REACTOR_ERROR_TYPE error;
-		if (engine->getError(i, &error)) {
-			sprintf_s(buffer, 250, "%c %03d %04d %20s %c",
-				error.type,
-				MJDToDayOfYear(error.mjd),
-				MJDToGMT(error.mjd),
-				error.cause,
-				error.confirmed ? 'X' : ' ');
-			sketchpad->Text(4, baseY + 20 * i, buffer, strlen(buffer));
+	MainEngine* engine = this->engine;
+
+	// The lines only change when an anomaly is logged or acknowledged
+	for (int i = 0; i < LANTRMFD_ERROR_LINES; i++) {
+		display.addText(4, baseY + 20 * i, [engine]() { return engine->countErrorChanges(); },
+			[engine, i](char* buffer, size_t size) {
+				REACTOR_ERROR_TYPE error;
+				if (i < engine->countErrors() && engine->getError(i, &error)) {
+					sprintf_s(buffer, size, "%c %03d %04d %20s %c",
+						error.type,
+						MJDToDayOfYear(error.mjd),
+						MJDToGMT(error.mjd),
+						error.cause,
+						error.confirmed ? 'X' : ' ');
+				}
+			});
+	}
+}
+
+void LANTRMFD::drawTrend(oapi::Sketchpad* sketchpad, unsigned int trend) {
+	char buffer[MFD_FIELD_LENGTH];
+	const TrendHistory& history = trends->getHistory(trend);
+	double span = LANTRMFD_TREND_WINDOW[window];
+	int left = 5;
+	int top = 60;
+	int bottom = GetHeight() - 40;
+	unsigned int columns = (unsigned int)trendMinimum.size();
+
+	if (span >= 7200.0) {
+		sprintf_s(buffer, MFD_FIELD_LENGTH, "%s %s / %.0f h", trends->getName(trend), trends->getUnit(trend), span / 3600.0);
+	}
+	else if (span >= 120.0) {
+		sprintf_s(buffer, MFD_FIELD_LENGTH, "%s %s / %.0f min", trends->getName(trend), trends->getUnit(trend), span / 60.0);
+	}
+	else {
+		sprintf_s(buffer, MFD_FIELD_LENGTH, "%s %s / %.0f s", trends->getName(trend), trends->getUnit(trend), span);
+	}
+	sketchpad->Text(5, 20, buffer, strlen(buffer));
+
+	double low = HUGE_VAL;
+	double high = -HUGE_VAL;
+	if (history.plot(span, columns, &trendMinimum[0], &trendMaximum[0])) {
+		for (unsigned int c = 0; c < columns; ++c) {
+			if (trendMinimum[c] <= trendMaximum[c]) {
+				low = min(low, trendMinimum[c]);
+				high = max(high, trendMaximum[c]);
+			}
+		}
+	}
+	if (low > high) {
+		sprintf_s(buffer, MFD_FIELD_LENGTH, "NO DATA");
+		sketchpad->Text(5, top, buffer, strlen(buffer));
+		return;
+	}
+	// Give a flat trend some room around the line
+	if (high - low <= 1.0E-9 * max(fabs(high), 1.0)) {
+		double margin = max(fabs(high) * 0.05, 1.0E-3);
+		low -= margin;
+		high += margin;
+	}
+
+	sprintf_s(buffer, MFD_FIELD_LENGTH, "%.4g", high);
+	sketchpad->Text(5, top - 20, buffer, strlen(buffer));
+	sprintf_s(buffer, MFD_FIELD_LENGTH, "%.4g", low);
+	sketchpad->Text(5, bottom + 5, buffer, strlen(buffer));
+
+	sketchpad->SetPen(GetDefaultPen(0));
+	sketchpad->Line(left, top, left, bottom);
+	sketchpad->Line(left, bottom, left + columns, bottom);
+	// One bar from minimum to maximum per column
+	double scale = (bottom - top) / (high - low);
+	for (unsigned int c = 0; c < columns; ++c) {
+		if (trendMinimum[c] > trendMaximum[c]) {
+			continue;
 		}
+		int yLow = bottom - (int)((trendMinimum[c] - low) * scale);
+		int yHigh = bottom - (int)((trendMaximum[c] - low) * scale);
+		sketchpad->Line(left + c, yHigh, left + c, yLow + 1);
 	}
 }
 
@@ -147,9 +241,3 @@ int LANTRMFD::MsgProc(UINT msg, UINT mfd, WPARAM wparam, LPARAM lparam)
 	}
 	return 0;
 }
-
-void LANTRMFD::initStateLabels() {
-	state_labels.insert(std::make_pair(LANTR_MODE_OFF, LABEL_STATE_OFF));
-	state_labels.insert(std::make_pair(LANTR_MODE_SCRAM, "SCRAM"));
-
-}
\ No newline at end of file
@@ -1,15 +1,36 @@
 #pragma once
 #include <MFDAPI.h>
 #include "systems/mainengine/MainEngine.h"
-#include <map>
+#include "MFDDisplay.h"
 #include <string>
+#include <vector>
+
+class TrendRecorder;
+
+//Anomalies listed at the bottom of the page
+const int LANTRMFD_ERROR_LINES = 4;
+//Windows of the trend pages in s, selected in turn
+const int LANTRMFD_TREND_WINDOWS = 5;
+const double LANTRMFD_TREND_WINDOW[LANTRMFD_TREND_WINDOWS] = { 60.0, 300.0, 1800.0, 10800.0, 43200.0 };
 
 class LANTRMFD : public MFD2
 {
 	MainEngine* engine;
-	map<int, string> state_labels;
-	void initStateLabels();
-	void renderErrorMessages(oapi::Sketchpad* sketchpad);
+	//Fields of the page, formatted only when their values change
+	MFDDisplay display;
+	//Refreshes since the values were last read, and how many pass between readings
+	int refreshes;
+	int decimation;
+	/* Page 0 shows the engine status, every further page plots one trend.
+	 */
+	TrendRecorder* trends;
+	unsigned int page;
+	int window;
+	//Minimum and maximum per plot column
+	std::vector<double> trendMinimum;
+	std::vector<double> trendMaximum;
+	void addErrorMessages();
+	void drawTrend(oapi::Sketchpad* sketchpad, unsigned int trend);
 public:
 	LANTRMFD(DWORD w, DWORD h, VESSEL* vessel);
 
@@ -21,4 +42,3 @@ public:
 
 	static int MsgProc(UINT msg, UINT mfd, WPARAM wparam, LPARAM lparam);
 };
-
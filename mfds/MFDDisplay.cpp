@@ -0,0 +1,81 @@
+#include "core/Common.h"
+#include <cstring>
+
+#include "MFDDisplay.h"
+
+
+MFDDisplay::MFDDisplay() {
+	formats = 0;
+}
+
+void MFDDisplay::addValue(int x, int y, const char* format, double threshold, Value value, bool relative) {
+	Field field = {};
+	field.x = x;
+	field.y = y;
+	field.format = format;
+	field.threshold = threshold;
+	field.relative = relative;
+	field.value = value;
+	fields.push_back(field);
+}
+
+void MFDDisplay::addText(int x, int y, Key key, Formatter formatter) {
+	Field field = {};
+	field.x = x;
+	field.y = y;
+	field.key = key;
+	field.formatter = formatter;
+	fields.push_back(field);
+}
+
+unsigned int MFDDisplay::update() {
+	unsigned int result = 0;
+	for (auto& it : fields) {
+		if (it.value) {
+			double value = it.value();
+			double threshold = it.relative ? it.threshold * fabs(it.formatted) : it.threshold;
+			if (it.valid && fabs(value - it.formatted) <= threshold) {
+				continue;
+			}
+			it.formatted = value;
+			sprintf_s(it.text, MFD_FIELD_LENGTH, it.format, value);
+		}
+		else {
+			unsigned int key = it.key();
+			if (it.valid && key == it.formattedKey) {
+				continue;
+			}
+			it.formattedKey = key;
+			it.text[0] = '\0';
+			it.formatter(it.text, MFD_FIELD_LENGTH);
+		}
+		it.length = (int)strlen(it.text);
+		it.valid = true;
+		it.changed = true;
+		result++;
+	}
+	formats += result;
+	return result;
+}
+
+unsigned int MFDDisplay::draw(oapi::Sketchpad* sketchpad, bool changedOnly) {
+	unsigned int result = 0;
+	for (auto& it : fields) {
+		if ((it.changed || !changedOnly) && it.length > 0) {
+			sketchpad->Text(it.x, it.y, it.text, it.length);
+			result++;
+		}
+		it.changed = false;
+	}
+	return result;
+}
+
+void MFDDisplay::invalidate() {
+	for (auto& it : fields) {
+		it.valid = false;
+	}
+}
+
+unsigned int MFDDisplay::countFormats() const {
+	return formats;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <MFDAPI.h>
+#include <functional>
+#include <vector>
+
+//Longest text of a display field, including the terminator
+const int MFD_FIELD_LENGTH = 64;
+
+/**
+ * \brief Retained text of an MFD page.
+ *
+ * Every field is bound to a value and keeps its formatted text. update() polls the values and formats a field again
+ * only when its value moved by more than the field's threshold, or for text fields when their key changed, so a
+ * steady engine costs no formatting at all. draw() puts the cached texts on the sketchpad.
+ * Orbiter clears the MFD surface before every refresh, so there all fields are drawn each time; surfaces that keep
+ * their content only need the fields that changed since the last draw.
+ */
+class MFDDisplay {
+public:
+	typedef std::function<double()> Value;
+	typedef std::function<unsigned int()> Key;
+	typedef std::function<void(char* buffer, size_t size)> Formatter;
+
+	MFDDisplay();
+
+	/* A number, printed with a printf format taking one double. With relative set, the threshold is a fraction of
+	 * the value, for formats with significant digits.
+	 */
+	void addValue(int x, int y, const char* format, double threshold, Value value, bool relative = false);
+	/* Text that only changes with its key, written into the buffer by the formatter.
+	 */
+	void addText(int x, int y, Key key, Formatter formatter);
+
+	/* Polls the values and formats the fields that changed. Returns the number of fields formatted.
+	 */
+	unsigned int update();
+	/* Draws all fields, or only those changed since the last draw. Returns the number of fields drawn.
+	 */
+	unsigned int draw(oapi::Sketchpad* sketchpad, bool changedOnly = false);
+	//Formats every field on the next update
+	void invalidate();
+
+	//Fields formatted since construction
+	unsigned int countFormats() const;
+
+private:
+	struct Field {
+		int x;
+		int y;
+		const char* format;
+		double threshold;
+		bool relative;
+		Value value;
+		Key key;
+		Formatter formatter;
+		//Value or key the text was formatted from
+		double formatted;
+		unsigned int formattedKey;
+		bool valid;
+		bool changed;
+		char text[MFD_FIELD_LENGTH];
+		int length;
+	};
+
+	std::vector<Field> fields;
+	unsigned int formats;
+};
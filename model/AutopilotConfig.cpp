@@ -0,0 +1,14 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "AutopilotConfig.h"
+
+using namespace Oparse;
+
+OpModelDef AutopilotConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "maxrate", { _Param(maxRate), { _MIN(0.001) } } },
+		{ "response", { _Param(responseTime), { _MIN(0.1) } } },
+		{ "approach", { _Param(approachSpeed), { _MIN(0.0) } } }
+	};
+}
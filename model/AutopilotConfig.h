@@ -0,0 +1,15 @@
+#pragma once
+#include "Oparse.h"
+
+/* Attitude and translation autopilot on top of the RCS.
+ */
+struct AutopilotConfig {
+	//Largest rotation rate the autopilot commands in deg/s
+	double maxRate = 1.0;
+	//Time constant in s in which an attitude or rate error is taken out, before the rate and acceleration limits
+	double responseTime = 5.0;
+	//Closing speed of the docking approach in m/s
+	double approachSpeed = 0.1;
+
+	Oparse::OpModelDef GetModelDef();
+};
@@ -0,0 +1,12 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "DisplayConfig.h"
+
+using namespace Oparse;
+
+OpModelDef DisplayConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "decimation", { _Param(refreshDecimation), { _MIN(1) } } }
+	};
+}
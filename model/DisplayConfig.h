@@ -0,0 +1,11 @@
+#pragma once
+#include "Oparse.h"
+
+/* MFD pages.
+ */
+struct DisplayConfig {
+	//The displayed values are read again every this many MFD refreshes, in between the last texts are drawn
+	int refreshDecimation = 1;
+
+	Oparse::OpModelDef GetModelDef();
+};
@@ -0,0 +1,16 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "DockPortConfig.h"
+
+using namespace Oparse;
+
+OpModelDef DockPortConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "positions", { _List(positions), { } } },
+		{ "directions", { _List(directions), { } } },
+		{ "rotations", { _List(rotations), { } } },
+		{ "range", { _Param(sensorRange), { _MIN(1.0) } } },
+		{ "masstolerance", { _Param(massTolerance), { _MIN(0.0) } } }
+	};
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <vector>
+#include "Oparse.h"
+
+/* Docking ports and the docking sensor.
+ */
+struct DockPortConfig {
+	/* Ports of the hauler: x, y, z of each port position in m, of its direction and of its rotation reference.
+	 * A single port at the front is used if there are none.
+	 */
+	std::vector<double> positions;
+	std::vector<double> directions;
+	std::vector<double> rotations;
+	//Distance in m up to which the docking sensor acquires ports of other vessels
+	double sensorRange = 1000.0;
+	//Relative change of a mass in the stack up to which its mass properties are kept
+	double massTolerance = 0.001;
+
+	Oparse::OpModelDef GetModelDef();
+};
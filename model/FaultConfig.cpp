@@ -0,0 +1,17 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "FaultConfig.h"
+
+using namespace Oparse;
+
+OpModelDef FaultConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "rcsthruster", { _Param(rcsThrusterMtbf), { _MIN(0.0) } } },
+		{ "throatvalve", { _Param(throatValveMtbf), { _MIN(0.0) } } },
+		{ "tankleak", { _Param(tankLeakMtbf), { _MIN(0.0) } } },
+		{ "leakrate", { _Param(leakRate), { _MIN(0.0) } } },
+		{ "seed", { _Param(seed), { _MIN(0) } } },
+		{ "script", { _List(script), { } } }
+	};
+}
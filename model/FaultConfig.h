@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include "Oparse.h"
+
+/* Random and scripted failures, see FaultInjector. Mean times between failures are per component in hours of sim
+ * time, 0.0 disables the failure mode.
+ */
+struct FaultConfig {
+	double rcsThrusterMtbf = 0.0;
+	double throatValveMtbf = 0.0;
+	double tankLeakMtbf = 0.0;
+	//Liquid a leaking tank loses in kg/s
+	double leakRate = 0.05;
+	//Seed of the failure times, 0 takes a seed from std::random_device
+	int seed = 0;
+	/* Faults for training, triples of sim time since the start of the session in s, failure mode and component.
+	 * Modes: 1 RCS thruster, 2 stuck throat valve (component 0), 3 tank leak. Failures are not saved with the scenario.
+	 */
+	std::vector<double> script;
+
+	Oparse::OpModelDef GetModelDef();
+};
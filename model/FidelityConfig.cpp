@@ -0,0 +1,15 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "FidelityConfig.h"
+
+using namespace Oparse;
+
+OpModelDef FidelityConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "budget", { _Param(budget), { _MIN(0.0) } } },
+		{ "warp", { _Param(warp), { _MIN(1.0) } } },
+		{ "headroom", { _Param(headroom), { _MIN(0.1), _MAX(0.95) } } },
+		{ "hold", { _Param(hold), { _MIN(1) } } }
+	};
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include "Oparse.h"
+
+/* Frame time budget of the vessel systems, see FidelityGovernor. The governor is off without a budget.
+ */
+struct FidelityConfig {
+	//Time all vessel systems may take per frame in ms, 0.0 disables the governor
+	double budget = 0.0;
+	//Above this time acceleration, no system steps at its most detailed level
+	double warp = 100.0;
+	//A system only steps more detailed again if the frame is expected to stay below this fraction of the budget
+	double headroom = 0.7;
+	//Frames between two switches, so the measured cost can settle
+	int hold = 50;
+
+	Oparse::OpModelDef GetModelDef();
+};
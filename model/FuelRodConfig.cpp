@@ -0,0 +1,18 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "FuelRodConfig.h"
+
+using namespace Oparse;
+
+OpModelDef FuelRodConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "radius", { _Param(fuelRadius), { _MIN(1.0E-4) } } },
+		{ "cladding", { _Param(claddingThickness), { _MIN(1.0E-5) } } },
+		{ "fuelconductivity", { _Param(fuelConductivity), { _MIN(0.1) } } },
+		{ "claddingconductivity", { _Param(claddingConductivity), { _MIN(0.1) } } },
+		{ "nodes", { _Param(fuelNodes), { _MIN(2) } } },
+		{ "rings", { _Param(rings), { _MIN(1) } } },
+		{ "zones", { _Param(zones), { _MIN(1) } } }
+	};
+}
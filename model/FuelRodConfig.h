@@ -0,0 +1,21 @@
+#pragma once
+#include "Oparse.h"
+
+/* Radial conduction in the fuel rods. The core is represented by channels of equal fuel volume,
+ * rings of equal area times axial zones, each with the power density of its position in the core.
+ */
+struct FuelRodConfig {
+	//Radius of the fuel and thickness of the cladding in m
+	double fuelRadius = 3.0E-3;
+	double claddingThickness = 0.5E-3;
+	//Thermal conductivity of the uranium carbide fuel and of the ZrC cladding in W/(m K)
+	double fuelConductivity = 20.0;
+	double claddingConductivity = 30.0;
+	//Finite volumes over the fuel radius, the cladding is one more
+	int fuelNodes = 8;
+	//Representative channels: rings of equal area times axial zones
+	int rings = 18;
+	int zones = 8;
+
+	Oparse::OpModelDef GetModelDef();
+};
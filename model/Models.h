@@ -1,6 +1,16 @@
 #pragma once
 
+#include "TurbomachineConfig.h"
+#include "NeutronicsConfig.h"
+#include "FuelRodConfig.h"
 #include "ThrusterConfig.h"
+#include "TelemetryConfig.h"
+#include "PropellantTankConfig.h"
+#include "AutopilotConfig.h"
+#include "DockPortConfig.h"
+#include "DisplayConfig.h"
+#include "FidelityConfig.h"
+#include "FaultConfig.h"
 
 
 #include "OrbitalHaulerConfig.h"
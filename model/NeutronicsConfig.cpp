@@ -0,0 +1,43 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "NeutronicsConfig.h"
+
+using namespace Oparse;
+
+OpModelDef CrossSectionConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "diffusion", { _List(diffusion), { _REQUIRED() } } },
+		{ "absorption", { _List(absorption), { _REQUIRED() } } },
+		{ "scattering", { _List(scattering), { _REQUIRED() } } },
+		{ "nufission", { _List(nuFission), { } } },
+		{ "chi", { _List(chi), { } } }
+	};
+}
+
+OpModelDef NeutronicsConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "detailed", { _Param(detailed), { } } },
+		{ "radius", { _Param(coreRadius), { _MIN(1.0) } } },
+		{ "height", { _Param(coreHeight), { _MIN(1.0) } } },
+		{ "reflector", { _Param(reflectorThickness), { _MIN(0.0) } } },
+		{ "radialcells", { _Param(radialCells), { _MIN(4) } } },
+		{ "axialcells", { _Param(axialCells), { _MIN(2) } } },
+		{ "core", { _Model<CrossSectionConfig>(core), { } } },
+		{ "reflectormaterial", { _Model<CrossSectionConfig>(reflector), { } } },
+		{ "drumabsorption", { _List(drumAbsorption), { } } },
+		{ "moderator", { _Param(moderatorShare), { _MIN(0.0), _MAX(1.0) } } },
+		{ "doppler", { _Param(doppler), { _MIN(0.0) } } },
+		{ "temperature", { _Param(referenceTemperature), { _MIN(1.0) } } },
+		{ "beta", { _Param(delayedFraction), { _MIN(1.0E-4) } } },
+		{ "omega", { _Param(omega), { _MIN(1.0), _MAX(1.95) } } },
+		{ "tolerance", { _Param(tolerance), { _MIN(1.0E-9) } } },
+		{ "iterations", { _Param(maxIterations), { _MIN(1) } } },
+		{ "threads", { _Param(threads), { _MIN(1) } } },
+		{ "background", { _Param(background), { } } },
+		{ "drumtolerance", { _Param(drumTolerance), { _MIN(0.0) } } },
+		{ "temperaturetolerance", { _Param(temperatureTolerance), { _MIN(0.0) } } },
+		{ "compositiontolerance", { _Param(compositionTolerance), { _MIN(0.0) } } },
+		{ "drumrate", { _Param(drumRate), { _MIN(0.1) } } }
+	};
+}
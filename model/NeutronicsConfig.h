@@ -0,0 +1,74 @@
+#pragma once
+#include <vector>
+#include "Oparse.h"
+
+/* Few-group macroscopic cross sections of one material, one entry per energy group, fastest group first.
+ * Neutrons only scatter down into the next group.
+ */
+struct CrossSectionConfig {
+	//Diffusion coefficient in cm
+	std::vector<double> diffusion;
+	//Absorption cross section in 1/cm
+	std::vector<double> absorption;
+	//Scattering into the next group in 1/cm, 0.0 for the last group
+	std::vector<double> scattering;
+	//Neutrons per fission times fission cross section in 1/cm, empty for materials without fuel
+	std::vector<double> nuFission;
+	//Fraction of the fission neutrons born in the group
+	std::vector<double> chi;
+
+	Oparse::OpModelDef GetModelDef();
+};
+
+/* Core neutronics for the detailed fidelity mode: multi-group diffusion in r-z geometry.
+ * A cylindrical core, surrounded by a radial reflector with the control drums. The drums are smeared over
+ * the reflector as additional absorption, fully effective with the absorber plates facing the core.
+ * The defaults describe a graphite matrix UC core with beryllium reflector in two groups.
+ */
+struct NeutronicsConfig {
+	//Solve the diffusion equation, instead of assuming flux proportional to power
+	bool detailed = false;
+
+	//Core radius, core height and radial reflector thickness in cm
+	double coreRadius = 45.0;
+	double coreHeight = 130.0;
+	double reflectorThickness = 15.0;
+	//Cells over core and reflector radius, must be even for the red-black ordering
+	int radialCells = 24;
+	int axialCells = 32;
+
+	CrossSectionConfig core = { { 1.4, 0.9 }, { 0.0012, 0.012 }, { 0.0075, 0.0 }, { 0.0008, 0.021 }, { 1.0, 0.0 } };
+	CrossSectionConfig reflector = { { 1.2, 0.6 }, { 0.0003, 0.0011 }, { 0.01, 0.0 }, { }, { } };
+	//Additional reflector absorption in 1/cm with the drum absorbers facing the core
+	std::vector<double> drumAbsorption = { 0.006, 0.08 };
+
+	//Share of the core down-scattering by hydrogen in the propellant channels at rated flow, the rest is the graphite matrix
+	double moderatorShare = 0.1;
+	//Relative increase of the fast absorption (resonance capture) per relative increase of sqrt(T) of the fuel
+	double doppler = 0.1;
+	//Fuel temperature of the cross sections in K
+	double referenceTemperature = 300.0;
+	//Delayed neutron fraction
+	double delayedFraction = 0.0065;
+
+	//Over-relaxation factor of the red-black SOR sweeps, 1.0 < omega < 2.0
+	double omega = 1.6;
+	//Convergence of the multiplication factor and fission source
+	double tolerance = 1.0E-5;
+	int maxIterations = 500;
+	//Threads sharing the rows of every sweep, 1 solves on the simulation thread
+	int threads = 1;
+	/* Solve on the job system of the vessel, the drum servo works with the last solution meanwhile.
+	 * Otherwise a solution is computed within the step that needs it.
+	 */
+	bool background = false;
+
+	//Changes of drum angle (deg), fuel temperature (K) and moderator density that require a new solution
+	double drumTolerance = 0.25;
+	double temperatureTolerance = 5.0;
+	double compositionTolerance = 0.01;
+	//Drum travel in deg/s
+	double drumRate = 5.0;
+
+	Oparse::OpModelDef GetModelDef();
+};
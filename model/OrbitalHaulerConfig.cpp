@@ -9,6 +9,13 @@ using namespace Oparse;
 OpModelDef OrbitalHaulerConfig::GetModelDef() {
 	return OpModelDef() = {
 		{"lantr", { _Model<LANTRConfig>(mainEngineConfig), { _REQUIRED() } } },
-		{"rcs_power", { _Model<ThrusterConfig>(rcsConfig), { _REQUIRED() } } }
+		{"rcs_power", { _Model<ThrusterConfig>(rcsConfig), { _REQUIRED() } } },
+		{"telemetry", { _Model<TelemetryConfig>(telemetryConfig), { } } },
+		{"tanks", { _Model<PropellantTankConfig>(tankConfig), { } } },
+		{"autopilot", { _Model<AutopilotConfig>(autopilotConfig), { } } },
+		{"docking", { _Model<DockPortConfig>(dockConfig), { } } },
+		{"display", { _Model<DisplayConfig>(displayConfig), { } } },
+		{"fidelity", { _Model<FidelityConfig>(fidelityConfig), { } } },
+		{"faults", { _Model<FaultConfig>(faultConfig), { } } }
 	};
 }
@@ -4,6 +4,13 @@ struct OrbitalHaulerConfig
 {
 	LANTRConfig mainEngineConfig;
 	ThrusterConfig rcsConfig;
+	TelemetryConfig telemetryConfig;
+	PropellantTankConfig tankConfig;
+	AutopilotConfig autopilotConfig;
+	DockPortConfig dockConfig;
+	DisplayConfig displayConfig;
+	FidelityConfig fidelityConfig;
+	FaultConfig faultConfig;
 
 	Oparse::OpModelDef GetModelDef();
 
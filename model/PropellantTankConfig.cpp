@@ -0,0 +1,24 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "PropellantTankConfig.h"
+
+using namespace Oparse;
+
+OpModelDef CryoTankConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "volume", { _Param(volume), { _MIN(0.1) } } },
+		{ "heatleak", { _Param(heatLeak), { _MIN(0.0) } } },
+		{ "relief", { _Param(reliefPressure), { _MIN(1000.0) } } },
+		{ "pressure", { _Param(initialPressure), { _MIN(1000.0) } } }
+	};
+}
+
+OpModelDef PropellantTankConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "lh2", { _Model<CryoTankConfig>(lh2), { } } },
+		{ "lo2", { _Model<CryoTankConfig>(lo2), { } } },
+		{ "synctolerance", { _Param(syncTolerance), { _MIN(0.0) } } },
+		{ "rcsrefill", { _Param(rcsRefillRate), { _MIN(0.0) } } }
+	};
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "Oparse.h"
+
+/* One kind of cryogenic propellant tank. The six LH2 tanks share one configuration.
+ */
+struct CryoTankConfig {
+	//Internal volume of one tank in m3
+	double volume;
+	//Heat leak through insulation, struts and feed lines into one tank in W
+	double heatLeak;
+	//Ullage pressure at which the vent valve opens in Pa
+	double reliefPressure;
+	//Ullage pressure at the start of the simulation in Pa
+	double initialPressure;
+
+	Oparse::OpModelDef GetModelDef();
+};
+
+/* Thermal state of the propellant tanks.
+ */
+struct PropellantTankConfig {
+	CryoTankConfig lh2 = { 74.0, 50.0, 250000.0, 120000.0 };
+	CryoTankConfig lo2 = { 27.6, 20.0, 250000.0, 120000.0 };
+	//Changes of the propellant mass in kg below this are not passed on to the propellant resources
+	double syncTolerance = 0.01;
+	//Flow from the sump into the RCS accumulator in kg/s
+	double rcsRefillRate = 2.0;
+
+	Oparse::OpModelDef GetModelDef();
+};
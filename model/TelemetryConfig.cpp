@@ -0,0 +1,16 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "TelemetryConfig.h"
+
+using namespace Oparse;
+
+OpModelDef TelemetryConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "file", { _Param(file), { } } },
+		{ "buffer", { _Param(bufferSamples), { _MIN(2) } } },
+		{ "chunk", { _Param(chunkSamples), { _MIN(1) } } },
+		{ "trace", { _Param(traceFile), { } } },
+		{ "tracespike", { _Param(traceSpike), { _MIN(0.0) } } }
+	};
+}
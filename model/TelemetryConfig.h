@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include "Oparse.h"
+
+/* Engine telemetry recording. Nothing is recorded unless a file is configured.
+ */
+struct TelemetryConfig {
+	//Output file, relative to the Orbiter root. Empty disables recording.
+	std::string file;
+	//Number of samples the ring buffers can hold before the writer thread falls behind
+	int bufferSamples = 8192;
+	//Number of samples written per chunk
+	int chunkSamples = 1024;
+	//Chrome trace of the hot paths, written when the vessel is destroyed. Empty disables, needs a build with OH_TRACING.
+	std::string traceFile;
+	//Frames slower than this in s write the trace right away, 0.0 only writes it at the end
+	double traceSpike = 0.0;
+
+	Oparse::OpModelDef GetModelDef();
+};
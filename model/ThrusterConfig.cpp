@@ -8,13 +8,27 @@ using namespace Oparse;
 OpModelDef ThrusterConfig::GetModelDef() {
 	return OpModelDef() = {
 		{ "isp", { _Param(isp), { _REQUIRED() } } },
-		{ "thrust", { _Param(thrust), { _REQUIRED() } } }
+		{ "thrust", { _Param(thrust), { _REQUIRED() } } },
+		{ "positions", { _List(positions), { } } },
+		{ "directions", { _List(directions), { } } },
+		{ "pulsed", { _Param(pulsed), { } } },
+		{ "minontime", { _Param(minimumOnTime), { _MIN(0.0) } } },
+		{ "latency", { _Param(valveLatency), { _MIN(0.0) } } }
 	};
 }
 
 OpModelDef LANTRConfig::GetModelDef() {
 	return OpModelDef() = {
 		{ "enrichment", { _Param(initialFuelEnrichment), { _REQUIRED() } } },
-		{ "absorption", { _Param(controlDrumAbsorptionEffect), { _REQUIRED() } } }
+		{ "absorption", { _Param(controlDrumAbsorptionEffect), { _REQUIRED() } } },
+		{ "h_cladding", { _Param(h_cladding), { _REQUIRED(), _MIN(0.0) } } },
+		{ "h_radiator", { _Param(h_radiator), { _REQUIRED(), _MIN(0.0) } } },
+		{ "tcga", { _Model<TurbomachineConfig>(tcga), { _REQUIRED() } } },
+		{ "h2tpa", { _Model<TurbomachineConfig>(h2tpa), { _REQUIRED() } } },
+		{ "o2tpa", { _Model<TurbomachineConfig>(o2tpa), { _REQUIRED() } } },
+		{ "neutronics", { _Model<NeutronicsConfig>(neutronics), { } } },
+		{ "fuelrods", { _Model<FuelRodConfig>(fuelRods), { } } },
+		{ "gimbal", { _Param(gimbalRange), { _MIN(0.0), _MAX(0.5) } } },
+		{ "anomalyseverity", { _Param(anomalySeverity), { } } }
 	};
 }
\ No newline at end of file
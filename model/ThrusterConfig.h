@@ -1,9 +1,25 @@
 #pragma once
+#include <string>
+#include <vector>
 #include "Oparse.h"
+#include "TurbomachineConfig.h"
+#include "NeutronicsConfig.h"
+#include "FuelRodConfig.h"
 
 struct ThrusterConfig {
 	double isp;
 	double thrust;
+	/* Layout of the thrusters: x, y, z of each thruster in m relative to the center of mass, and of its thrust direction.
+	 * A default layout is used if there are none.
+	 */
+	std::vector<double> positions;
+	std::vector<double> directions;
+	//Fire the thrusters in valve pulses instead of at continuous levels
+	bool pulsed = false;
+	//Shortest valve opening in s, the minimum impulse bit is this times the thrust
+	double minimumOnTime = 0.02;
+	//Delay in s between a valve command and the thrust
+	double valveLatency = 0.01;
 
 	Oparse::OpModelDef GetModelDef();
 };
@@ -33,5 +49,20 @@ struct LANTRConfig {
 	 */
 	double h_radiator;
 
+	//Turbo-compressor/generator assembly of the primary loop
+	TurbomachineConfig tcga;
+	//H2 turbopump assembly
+	TurbomachineConfig h2tpa;
+	//O2 turbopump assembly
+	TurbomachineConfig o2tpa;
+	//Core neutronics of the detailed fidelity mode
+	NeutronicsConfig neutronics;
+	//Radial conduction in the fuel rods
+	FuelRodConfig fuelRods;
+	//Largest angle in rad the nozzle gimbals off its axis to keep the thrust through the center of mass
+	double gimbalRange = 0.1;
+	//Least severe anomaly that is logged: I, W, E or X for info, warning, error or scram
+	std::string anomalySeverity = "I";
+
 	Oparse::OpModelDef GetModelDef();
 };
\ No newline at end of file
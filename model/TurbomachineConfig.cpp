@@ -0,0 +1,27 @@
+#include "OpStdLibs.h"
+#include "Oparse.h"
+
+#include "TurbomachineConfig.h"
+
+using namespace Oparse;
+
+OpModelDef PerformanceMapConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "speeds", { _List(speeds), { _REQUIRED() } } },
+		{ "flows", { _List(flows), { _REQUIRED() } } },
+		{ "pressureratio", { _List(pressureRatio), { _REQUIRED() } } },
+		{ "efficiency", { _List(efficiency), { _REQUIRED() } } }
+	};
+}
+
+OpModelDef TurbomachineConfig::GetModelDef() {
+	return OpModelDef() = {
+		{ "inertia", { _Param(inertia), { _REQUIRED(), _MIN(0.001) } } },
+		{ "rpm", { _Param(referenceSpeed), { _REQUIRED(), _MIN(1.0) } } },
+		{ "massflow", { _Param(referenceMassFlow), { _REQUIRED(), _MIN(0.001) } } },
+		{ "temperature", { _Param(referenceTemperature), { _REQUIRED(), _MIN(1.0) } } },
+		{ "pressure", { _Param(referencePressure), { _REQUIRED(), _MIN(1.0) } } },
+		{ "compressor", { _Model<PerformanceMapConfig>(compressor), { _REQUIRED() } } },
+		{ "turbine", { _Model<PerformanceMapConfig>(turbine), { _REQUIRED() } } }
+	};
+}
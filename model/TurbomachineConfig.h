@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include "Oparse.h"
+
+/* Performance map of a compressor, pump or turbine.
+ * Both axes are normalised to the reference conditions of the machine, so 1.0 is the design point.
+ * The tables are stored row-major, one row per corrected speed, one column per corrected mass flow.
+ */
+struct PerformanceMapConfig {
+	//Corrected shaft speed breakpoints, ascending
+	std::vector<double> speeds;
+	//Corrected mass flow breakpoints, ascending
+	std::vector<double> flows;
+	//Pressure ratio (compressor, pump) or expansion ratio (turbine)
+	std::vector<double> pressureRatio;
+	//Isentropic efficiency
+	std::vector<double> efficiency;
+
+	Oparse::OpModelDef GetModelDef();
+};
+
+/* A turbine driving a compressor or pump over a common shaft.
+ * TCGA: turbo-compressor/generator assembly in the primary loop.
+ * H2TPA, O2TPA: turbopump assemblies feeding the reactor in NTR and LANTR mode.
+ */
+struct TurbomachineConfig {
+	//Moment of inertia of the rotating assembly in kg m^2
+	double inertia;
+	//Reference shaft speed in rpm
+	double referenceSpeed;
+	//Reference mass flow in kg/s
+	double referenceMassFlow;
+	//Reference inlet temperature in K
+	double referenceTemperature;
+	//Reference inlet pressure in Pa
+	double referencePressure;
+
+	PerformanceMapConfig compressor;
+	PerformanceMapConfig turbine;
+
+	Oparse::OpModelDef GetModelDef();
+};
@@ -6,17 +6,55 @@ class OrbitalHauler;
 class VesselSystem : public EventSubscriber {
 
 public:
-	VesselSystem(OrbitalHauler* vessel) {
+	/* name labels the system in traces and profiles, a string literal.
+	 */
+	VesselSystem(OrbitalHauler* vessel, const char* name) {
 		this->vessel = vessel;
+		this->name = name;
+		this->fidelity = 0;
+		this->decimationPhase = 0;
 	};
-	~VesselSystem() {};
+	virtual ~VesselSystem() {};
 
 	virtual void init(EventBroker &eventBroker) = 0;
 	virtual void preStep(double simt, double simDt, double mjd) {};
 	virtual void postStep(double simt, double simDt, double mjd) {};
+	const char* getName() const {
+		return name;
+	};
+
+	/* Fidelity levels the system offers, 0 is the most detailed one and the default. The higher levels are cheaper to
+	 * step, see FidelityGovernor. A system keeps its state across a switch, it only changes how it steps.
+	 */
+	virtual int countFidelityLevels() const {
+		return 1;
+	};
+	virtual void setFidelity(int level) {
+		int levels = countFidelityLevels();
+		fidelity = level < 0 ? 0 : (level >= levels ? levels - 1 : level);
+	};
+	int getFidelity() const {
+		return fidelity;
+	};
+	/* Offsets the frames the decimated levels step on, so not all decimated systems land on the same frame.
+	 * The FidelityGovernor gives every system its own phase.
+	 */
+	void setDecimationPhase(unsigned int phase) {
+		decimationPhase = phase;
+	};
 
 protected:
 	OrbitalHauler *vessel;
+	const char* name;
+	int fidelity;
+	unsigned int decimationPhase;
+
+	/* Whether a level that steps every decimation frames steps in this one. frame counts every step of the system,
+	 * also those at the levels that are not decimated.
+	 */
+	bool isDecimationFrame(unsigned int frame, unsigned int decimation) const {
+		return (frame + decimationPhase) % decimation == 0;
+	};
 
 };
 
@@ -1,13 +1,33 @@
 #include "core/Common.h"
 #include "event/Events.h"
 #include "systems/VesselSystem.h"
+#include "model/DockPortConfig.h"
 
 #include "DockPort.h"
 #include "core/OrbitalHauler.h"
 
 
+/* Orthonormal frame of a port as columns: rotation reference, direction and their cross product.
+ */
+static void portFrame(const VECTOR3& dir, const VECTOR3& rot, double frame[9]) {
+	VECTOR3 z = unit(dir);
+	VECTOR3 x = unit(rot - z * dotp(rot, z));
+	VECTOR3 y = crossp(z, x);
+	for (int i = 0; i < 3; ++i) {
+		frame[3 * i] = x.data[i];
+		frame[3 * i + 1] = z.data[i];
+		frame[3 * i + 2] = y.data[i];
+	}
+}
+
+
+DockPort::DockPort(OrbitalHauler* vessel, DockPortConfig config) : VesselSystem(vessel, "DockPort"), config(config), sensor((VESSEL*)vessel, config.sensorRange) {
+	eventBroker = NULL;
+	haulerPMI = _V(0, 0, 0);
+	selected = 0;
+	acquired = false;
+}
 
-DockPort::DockPort(OrbitalHauler* vessel) : VesselSystem(vessel) {}
 DockPort::~DockPort() {}
 
 void DockPort::init(EventBroker& eventBroker) {
@@ -15,13 +35,150 @@ void DockPort::init(EventBroker& eventBroker) {
 	// create event subscriptions
 	
 	eventBroker.subscribe((EventSubscriber*)this, EVENTTOPIC::GENERAL);
+	this->eventBroker = &eventBroker;
+
+	std::vector<double> positions = config.positions;
+	std::vector<double> directions = config.directions;
+	std::vector<double> rotations = config.rotations;
+	if (positions.empty() || positions.size() % 3 != 0 || directions.size() != positions.size() || rotations.size() != positions.size()) {
+		if (!positions.empty()) {
+			Olog::warn("Dock positions, directions and rotations don't match, using a single port");
+		}
+		positions = { 0, 0, 5 };
+		directions = { 0, 0, 1 };
+		rotations = { 0, 1, 0 };
+	}
+
+	for (size_t i = 0; i + 2 < positions.size(); i += 3) {
+		VECTOR3 pos = _V(positions[i], positions[i + 1], positions[i + 2]);
+		VECTOR3 dir = _V(directions[i], directions[i + 1], directions[i + 2]);
+		VECTOR3 rot = _V(rotations[i], rotations[i + 1], rotations[i + 2]);
+		ports.push_back(Port{ vessel->CreateDock(pos, dir, rot), pos, dir, rot, NULL });
+	}
+	Olog::info("%d docking ports", (int)ports.size());
+}
+
+void DockPort::preStep(double simt, double simdt, double mjd) {
+	unsigned int revision = stack.countRevisions();
+
+	updateHauler();
+	for (unsigned int p = 0; p < ports.size(); ++p) {
+		OBJHANDLE mate = vessel->GetDockStatus(ports[p].handle);
+		if (mate != ports[p].mate) {
+			ports[p].mate = mate;
+			if (mate) {
+				Olog::info("%s docked at port %d", oapiGetVesselInterface(mate)->GetName(), (int)p);
+			}
+			updateMate(p);
+		}
+		else if (mate) {
+			// Payloads burn propellant too
+			double mass = oapiGetVesselInterface(mate)->GetMass();
+			if (fabs(mass - stack.getBodyMass(p + 1)) > config.massTolerance * mass) {
+				updateMate(p);
+			}
+		}
+	}
+
+	// Processed at the start of the next frame, once for however many changes
+	if (stack.countRevisions() != revision && eventBroker) {
+		eventBroker->publish(EVENTTOPIC::GENERAL, new StackChangedEvent(stack.getCenterOfMass()));
+	}
+
+	// Nothing to look for while docked
+	bool found = !ports.empty() && !ports[selected].mate && sensor.update(ports[selected].handle);
+	if (found && !acquired) {
+		const DockingTarget& target = sensor.getTarget();
+		Olog::info("Docking sensor acquired port %d of %s at %.0f m", (int)target.port, oapiGetVesselInterface(target.vessel)->GetName(), target.range);
+	}
+	acquired = found;
+}
+
+void DockPort::updateHauler() {
+	double mass = vessel->GetMass();
+	VECTOR3 pmi;
+	vessel->GetPMI(pmi);
+	if (stack.hasBody(0) && fabs(mass - stack.getBodyMass(0)) <= config.massTolerance * mass
+		&& pmi.x == haulerPMI.x && pmi.y == haulerPMI.y && pmi.z == haulerPMI.z) {
+		return;
+	}
+	haulerPMI = pmi;
+	MATRIX3 inertia = { pmi.x * mass, 0, 0, 0, pmi.y * mass, 0, 0, 0, pmi.z * mass };
+	stack.setBody(0, mass, _V(0, 0, 0), inertia);
+}
+
+void DockPort::updateMate(unsigned int port) {
+	OBJHANDLE mate = ports[port].mate;
+	VESSEL* other = mate ? oapiGetVesselInterface(mate) : NULL;
+	if (!other) {
+		stack.clearBody(port + 1);
+		return;
+	}
+
+	// The port of the mate that holds the hauler
+	VECTOR3 pos = _V(0, 0, 0), dir = _V(0, 0, 1), rot = _V(0, 1, 0);
+	for (UINT d = 0; d < other->DockCount(); ++d) {
+		DOCKHANDLE dock = other->GetDockHandle(d);
+		if (other->GetDockStatus(dock) == vessel->GetHandle()) {
+			other->GetDockParams(dock, pos, dir, rot);
+			break;
+		}
+	}
+
+	// Docked ports face each other with parallel rotation references: the mate frame turns into the hauler frame by
+	// R = A B^T, A the hauler port frame with the direction reversed and B the mate port frame
+	double a[9], b[9];
+	portFrame(-ports[port].dir, ports[port].rot, a);
+	portFrame(dir, rot, b);
+	MATRIX3 R;
+	for (int i = 0; i < 3; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			R.data[3 * i + k] = a[3 * i] * b[3 * k] + a[3 * i + 1] * b[3 * k + 1] + a[3 * i + 2] * b[3 * k + 2];
+		}
+	}
+
+	double mass = other->GetMass();
+	VECTOR3 pmi;
+	other->GetPMI(pmi);
+	// The mate origin is its center of mass
+	VECTOR3 centerOfMass = ports[port].pos - mul(R, pos);
+	MATRIX3 inertia;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			double sum = 0.0;
+			for (int k = 0; k < 3; ++k) {
+				sum += R.data[3 * i + k] * pmi.data[k] * mass * R.data[3 * j + k];
+			}
+			inertia.data[3 * i + j] = sum;
+		}
+	}
+	stack.setBody(port + 1, mass, centerOfMass, inertia);
+}
 
+unsigned int DockPort::countPorts() const {
+	return (unsigned int)ports.size();
+}
+
+OBJHANDLE DockPort::getMate(unsigned int port) const {
+	return port < ports.size() ? ports[port].mate : NULL;
+}
+
+const StackMassProperties& DockPort::getStack() const {
+	return stack;
+}
 
-	VECTOR3 pos = { 0, 0, 5 };
-	VECTOR3 rot = { 0, 1, 0 };
-	VECTOR3 dir = { 0, 0, 1 };
+void DockPort::selectPort(unsigned int port) {
+	if (port < ports.size()) {
+		selected = port;
+	}
+}
 
-	vessel->CreateDock(pos, dir, rot);
+unsigned int DockPort::getSelectedPort() const {
+	return selected;
+}
+
+const DockingTarget* DockPort::getTarget() const {
+	return acquired ? &sensor.getTarget() : NULL;
 }
 
 
@@ -31,4 +188,3 @@ void DockPort::receiveEvent(Event_Base* event, EVENTTOPIC topic) {
 		Olog::info("Dockport received sim started event!");
 	}
 }
-
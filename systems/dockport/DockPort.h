@@ -1,16 +1,58 @@
 #pragma once
 
+#include "DockingSensor.h"
+#include "StackMassProperties.h"
 
+/* Docking ports of the hauler, laid out by the configuration, and the mass properties of the docked stack.
+ * The hauler is slot 0 of the stack and the vessel docked at port n slot n + 1. The ports are polled every frame,
+ * but the stack only changes when a vessel docks or undocks or a mass moved beyond the tolerance, and then a
+ * STACKCHANGEDEVENT tells the systems that depend on the center of mass.
+ */
 class DockPort :
     public VesselSystem
 {
 public:
-    DockPort(OrbitalHauler* vessel);
+    DockPort(OrbitalHauler* vessel, DockPortConfig config);
     ~DockPort();
 
     void init(EventBroker& eventBroker);
+    void preStep(double simt, double simdt, double mjd);
+
+    unsigned int countPorts() const;
+    //Vessel docked at a port, NULL if it is free
+    OBJHANDLE getMate(unsigned int port) const;
+    const StackMassProperties& getStack() const;
+
+    /* The docking sensor searches from one port at a time.
+     */
+    void selectPort(unsigned int port);
+    unsigned int getSelectedPort() const;
+    /* Nearest free port of another vessel in sensor range of the selected port, NULL if there is none.
+     */
+    const DockingTarget* getTarget() const;
 
 protected:
     virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
-};
 
+private:
+    struct Port {
+        DOCKHANDLE handle;
+        VECTOR3 pos;
+        VECTOR3 dir;
+        VECTOR3 rot;
+        OBJHANDLE mate;
+    };
+
+    DockPortConfig config;
+    EventBroker* eventBroker;
+    std::vector<Port> ports;
+    StackMassProperties stack;
+    //Principal moments of inertia of the hauler the stack was computed with
+    VECTOR3 haulerPMI;
+    DockingSensor sensor;
+    unsigned int selected;
+    bool acquired;
+
+    void updateHauler();
+    void updateMate(unsigned int port);
+};
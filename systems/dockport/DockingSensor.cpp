@@ -0,0 +1,110 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include <algorithm>
+
+#include "DockingSensor.h"
+
+
+DockingSensor::DockingSensor(VESSEL* vessel, double range) : vessel(vessel), range(range) {
+	target = DockingTarget{ NULL, 0, 0.0, 0.0, 0.0 };
+	vessels = 0;
+	candidates = 0;
+	maxSize = 0.0;
+}
+
+void DockingSensor::rebuild() {
+	sweep.clear();
+	vessels = oapiGetVesselCount();
+	for (DWORD i = 0; i < vessels; ++i) {
+		OBJHANDLE handle = oapiGetVesselByIndex((int)i);
+		if (handle != vessel->GetHandle()) {
+			sweep.push_back(Entry{ handle, _V(0, 0, 0), 0.0 });
+		}
+	}
+}
+
+bool DockingSensor::refresh() {
+	maxSize = 0.0;
+	for (auto& it : sweep) {
+		VESSEL* other = oapiIsVessel(it.vessel) ? oapiGetVesselInterface(it.vessel) : NULL;
+		if (!other) {
+			return false;
+		}
+		oapiGetGlobalPos(it.vessel, &it.pos);
+		it.size = other->GetSize();
+		maxSize = max(maxSize, it.size);
+	}
+	// Insertion sort, close to linear on the order of the last frame
+	for (size_t i = 1; i < sweep.size(); ++i) {
+		Entry entry = sweep[i];
+		size_t j = i;
+		for (; j > 0 && sweep[j - 1].pos.x > entry.pos.x; --j) {
+			sweep[j] = sweep[j - 1];
+		}
+		sweep[j] = entry;
+	}
+	return true;
+}
+
+bool DockingSensor::update(DOCKHANDLE port) {
+	// Vessels were created or deleted
+	if (vessels != oapiGetVesselCount() || !refresh()) {
+		rebuild();
+		refresh();
+	}
+
+	VECTOR3 pos, dir, rot;
+	vessel->GetDockParams(port, pos, dir, rot);
+	VECTOR3 ownPos, ownDir, ownVel;
+	vessel->Local2Global(pos, ownPos);
+	vessel->GlobalRot(dir, ownDir);
+	vessel->GetGlobalVel(ownVel);
+
+	target.vessel = NULL;
+	candidates = 0;
+	// A dock in range may sit up to the size of its vessel off the vessel centre
+	double window = range + maxSize;
+	auto first = std::lower_bound(sweep.begin(), sweep.end(), ownPos.x - window,
+		[](const Entry& entry, double x) { return entry.pos.x < x; });
+	for (auto it = first; it != sweep.end() && it->pos.x <= ownPos.x + window; ++it) {
+		if (length(it->pos - ownPos) > range + it->size) {
+			continue;
+		}
+		VESSEL* other = oapiGetVesselInterface(it->vessel);
+		if (!other) {
+			continue;
+		}
+		candidates++;
+		for (UINT d = 0; d < other->DockCount(); ++d) {
+			DOCKHANDLE dock = other->GetDockHandle(d);
+			if (other->GetDockStatus(dock)) {
+				continue;
+			}
+			VECTOR3 portPos, portDir;
+			other->GetDockParams(dock, pos, dir, rot);
+			other->Local2Global(pos, portPos);
+			other->GlobalRot(dir, portDir);
+			VECTOR3 offset = portPos - ownPos;
+			double distance = length(offset);
+			if (distance > range || (target.vessel && distance >= target.range)) {
+				continue;
+			}
+			VECTOR3 otherVel;
+			other->GetGlobalVel(otherVel);
+			target.vessel = it->vessel;
+			target.port = d;
+			target.range = distance;
+			target.rangeRate = distance > 0.0 ? dotp(offset, otherVel - ownVel) / distance : 0.0;
+			target.alignment = acos(max(-1.0, min(1.0, -dotp(ownDir, portDir))));
+		}
+	}
+	return target.vessel != NULL;
+}
+
+const DockingTarget& DockingSensor::getTarget() const {
+	return target;
+}
+
+unsigned int DockingSensor::countCandidates() const {
+	return candidates;
+}
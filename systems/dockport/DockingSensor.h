@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+/* Port of another vessel the sensor acquired.
+ */
+struct DockingTarget {
+	OBJHANDLE vessel;
+	//Index of the port on the target vessel
+	UINT port;
+	//Distance between the ports in m and its rate of change in m/s, negative while closing
+	double range;
+	double rangeRate;
+	//Angle between the own port direction and the reverse of the target port direction in rad
+	double alignment;
+};
+
+/* Finds the nearest free port of another vessel in range of one of the own ports.
+ * All vessels are kept in an array sorted by their global x coordinate. The order hardly changes from one frame to
+ * the next, so an insertion sort restores it in about one pass, and the vessels within range of x follow from a
+ * binary search. Only their docks are looked at, so the cost grows with the vessels, not with all their docks.
+ * Positions are vessel centres while the docks sit up to the vessel size off them, so the search window is padded by
+ * the size of the largest vessel and the distance check by the size of the candidate.
+ */
+class DockingSensor {
+public:
+	DockingSensor(VESSEL* vessel, double range);
+
+	/* Searches again from the own port. Returns false if no free port is in range.
+	 */
+	bool update(DOCKHANDLE port);
+	const DockingTarget& getTarget() const;
+
+	//Vessels whose docks were looked at in the last update
+	unsigned int countCandidates() const;
+
+private:
+	struct Entry {
+		OBJHANDLE vessel;
+		VECTOR3 pos;
+		//Radius of the vessel in m
+		double size;
+	};
+
+	VESSEL* vessel;
+	double range;
+	//Vessels sorted by pos.x
+	std::vector<Entry> sweep;
+	//Largest size of the vessels in the array
+	double maxSize;
+	//Vessel count of the simulation when the array was built
+	DWORD vessels;
+	DockingTarget target;
+	unsigned int candidates;
+
+	void rebuild();
+	bool refresh();
+};
@@ -0,0 +1,87 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "StackMassProperties.h"
+
+
+/* Inertia of a point mass at r about the origin, m (|r|^2 E - r r^T).
+ */
+static MATRIX3 pointInertia(double mass, const VECTOR3& r) {
+	MATRIX3 result;
+	double square = dotp(r, r);
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			result.data[3 * i + j] = mass * ((i == j ? square : 0.0) - r.data[i] * r.data[j]);
+		}
+	}
+	return result;
+}
+
+
+StackMassProperties::StackMassProperties() {
+	mass = 0.0;
+	moment = _V(0, 0, 0);
+	for (int k = 0; k < 9; ++k) {
+		tensor.data[k] = 0.0;
+	}
+	revisions = 0;
+}
+
+void StackMassProperties::accumulate(const Body& body, double sign) {
+	mass += sign * body.mass;
+	moment += body.centerOfMass * (sign * body.mass);
+	MATRIX3 offset = pointInertia(body.mass, body.centerOfMass);
+	for (int k = 0; k < 9; ++k) {
+		tensor.data[k] += sign * (body.inertia.data[k] + offset.data[k]);
+	}
+}
+
+void StackMassProperties::setBody(unsigned int slot, double mass, const VECTOR3& centerOfMass, const MATRIX3& inertia) {
+	if (slot >= bodies.size()) {
+		bodies.resize(slot + 1, Body{ false, 0.0, _V(0, 0, 0), MATRIX3() });
+	}
+	if (bodies[slot].present) {
+		accumulate(bodies[slot], -1.0);
+	}
+	bodies[slot] = Body{ true, mass, centerOfMass, inertia };
+	accumulate(bodies[slot], 1.0);
+	revisions++;
+}
+
+void StackMassProperties::clearBody(unsigned int slot) {
+	if (slot < bodies.size() && bodies[slot].present) {
+		accumulate(bodies[slot], -1.0);
+		bodies[slot].present = false;
+		revisions++;
+	}
+}
+
+bool StackMassProperties::hasBody(unsigned int slot) const {
+	return slot < bodies.size() && bodies[slot].present;
+}
+
+double StackMassProperties::getBodyMass(unsigned int slot) const {
+	return hasBody(slot) ? bodies[slot].mass : 0.0;
+}
+
+double StackMassProperties::getMass() const {
+	return mass;
+}
+
+VECTOR3 StackMassProperties::getCenterOfMass() const {
+	return mass > 0.0 ? moment / mass : _V(0, 0, 0);
+}
+
+MATRIX3 StackMassProperties::getInertia() const {
+	// Parallel axis theorem back from the origin to the center of mass
+	MATRIX3 offset = pointInertia(mass, getCenterOfMass());
+	MATRIX3 result;
+	for (int k = 0; k < 9; ++k) {
+		result.data[k] = tensor.data[k] - offset.data[k];
+	}
+	return result;
+}
+
+unsigned int StackMassProperties::countRevisions() const {
+	return revisions;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * \brief Mass, center of mass and inertia tensor of the hauler and the vessels docked to it, in the hauler frame.
+ *
+ * Every body of the stack sits in a slot. The stack keeps the sums of the masses, of their first moments and of
+ * their inertia tensors about the hauler origin, so setting or clearing a slot only takes out its old contribution
+ * and adds the new one, however many bodies there are. The center of mass and the inertia about it follow from the
+ * sums.
+ */
+class StackMassProperties {
+public:
+	StackMassProperties();
+
+	/* mass in kg, center of mass in m in the hauler frame, inertia in kg m2 about the body's own center of mass, in
+	 * hauler axes.
+	 */
+	void setBody(unsigned int slot, double mass, const VECTOR3& centerOfMass, const MATRIX3& inertia);
+	void clearBody(unsigned int slot);
+	bool hasBody(unsigned int slot) const;
+	double getBodyMass(unsigned int slot) const;
+
+	double getMass() const;
+	VECTOR3 getCenterOfMass() const;
+	//Inertia tensor about the center of mass of the stack
+	MATRIX3 getInertia() const;
+
+	//Changes since construction
+	unsigned int countRevisions() const;
+
+private:
+	struct Body {
+		bool present;
+		double mass;
+		VECTOR3 centerOfMass;
+		MATRIX3 inertia;
+	};
+
+	std::vector<Body> bodies;
+	double mass;
+	VECTOR3 moment;
+	//About the hauler origin
+	MATRIX3 tensor;
+	unsigned int revisions;
+
+	void accumulate(const Body& body, double sign);
+};
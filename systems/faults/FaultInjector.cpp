@@ -0,0 +1,142 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+#include "event/Events.h"
+#include "systems/VesselSystem.h"
+#include "systems/mainengine/MainEngine.h"
+#include "systems/tanks/PropellantTanks.h"
+#include "systems/rcs/ReactionControlSystem.h"
+
+#include "core/OrbitalHauler.h"
+#include "FaultInjector.h"
+
+//Labels of the failure modes in the log and the anomaly causes, by mode - 1
+static const char* const FAULT_CAUSES[FAULTMODE_COUNT] = { "RCS_THRUSTER_FAILURE", "THROAT_VALVE_STUCK", "TANK_LEAK" };
+
+
+FaultInjector::FaultInjector(OrbitalHauler* vessel, const FaultConfig& config, MainEngine* engine, PropellantTanks* tanks, ReactionControlSystem* rcs) :
+	VesselSystem(vessel, "Faults"), config(config), engine(engine), tanks(tanks), rcs(rcs)
+{
+	random.seed(config.seed > 0 ? (unsigned int)config.seed : std::random_device()());
+	injected = 0;
+	time = 0.0;
+	armed = false;
+}
+
+void FaultInjector::init(EventBroker& eventBroker) {
+}
+
+void FaultInjector::receiveEvent(Event_Base* event, EVENTTOPIC topic) {}
+
+void FaultInjector::arm(double simt) {
+	for (unsigned int m = 0; m < FAULTMODE_COUNT; ++m) {
+		FAULTMODE mode = (FAULTMODE)(m + 1);
+		unsigned int components = countComponents(mode);
+		failed[m].assign(components, false);
+		double mtbf = getMtbf(mode);
+		if (mtbf <= 0.0) {
+			continue;
+		}
+		std::exponential_distribution<double> lifetime(1.0 / (mtbf * 3600.0));
+		for (unsigned int i = 0; i < components; ++i) {
+			pending.push(Fault{ simt + lifetime(random), mode, i });
+		}
+	}
+
+	for (size_t i = 0; i + 2 < config.script.size(); i += 3) {
+		int entry = (int)(i / 3);
+		int mode = (int)config.script[i + 1];
+		double component = config.script[i + 2];
+		if (mode < 1 || mode > (int)FAULTMODE_COUNT) {
+			Olog::warn("Ignoring scripted fault %d with unknown failure mode %d", entry, mode);
+			continue;
+		}
+		if (component < 0.0 || component >= countComponents((FAULTMODE)mode)) {
+			Olog::warn("Ignoring scripted fault %d, %s has no component %d", entry, FAULT_CAUSES[mode - 1], (int)component);
+			continue;
+		}
+		pending.push(Fault{ config.script[i], (FAULTMODE)mode, (unsigned int)component });
+	}
+	if (config.script.size() % 3 != 0) {
+		Olog::warn("Ignoring %d values at the end of the fault script, every fault takes three", (int)(config.script.size() % 3));
+	}
+	Olog::info("%d faults pending", (int)pending.size());
+	armed = true;
+}
+
+void FaultInjector::preStep(double simt, double simdt, double mjd) {
+	time = simt;
+	if (!armed) {
+		arm(simt);
+	}
+	while (!pending.empty() && pending.top().time <= simt) {
+		Fault fault = pending.top();
+		pending.pop();
+		inject(fault.mode, fault.component);
+	}
+}
+
+bool FaultInjector::inject(FAULTMODE mode, unsigned int component) {
+	unsigned int m = (unsigned int)mode - 1;
+	if (m >= FAULTMODE_COUNT || component >= failed[m].size() || failed[m][component]) {
+		return false;
+	}
+	switch (mode) {
+	case FAULTMODE::RCS_THRUSTER:
+		rcs->setThrusterFailed(component, true);
+		break;
+	case FAULTMODE::THROAT_VALVE:
+		engine->setThroatValveStuck(true);
+		break;
+	case FAULTMODE::TANK_LEAK:
+		tanks->setLeakRate(component, config.leakRate);
+		break;
+	}
+	failed[m][component] = true;
+	injected++;
+	Olog::warn("Fault %s of component %d at %.1f s", FAULT_CAUSES[m], (int)component, time);
+	engine->logAnomaly(ANOMALY_WARNING, FAULT_CAUSES[m]);
+	return true;
+}
+
+bool FaultInjector::isFailed(FAULTMODE mode, unsigned int component) const {
+	unsigned int m = (unsigned int)mode - 1;
+	return m < FAULTMODE_COUNT && component < failed[m].size() && failed[m][component];
+}
+
+unsigned int FaultInjector::countComponents(FAULTMODE mode) const {
+	switch (mode) {
+	case FAULTMODE::RCS_THRUSTER:
+		return rcs->countThrusters();
+	case FAULTMODE::THROAT_VALVE:
+		return 1;
+	case FAULTMODE::TANK_LEAK:
+		return PROPELLANT_TANKS;
+	}
+	return 0;
+}
+
+unsigned int FaultInjector::countInjected() const {
+	return injected;
+}
+
+unsigned int FaultInjector::countPending() const {
+	return (unsigned int)pending.size();
+}
+
+double FaultInjector::getNextFaultTime() const {
+	return pending.empty() ? -1.0 : pending.top().time;
+}
+
+double FaultInjector::getMtbf(FAULTMODE mode) const {
+	switch (mode) {
+	case FAULTMODE::RCS_THRUSTER:
+		return config.rcsThrusterMtbf;
+	case FAULTMODE::THROAT_VALVE:
+		return config.throatValveMtbf;
+	case FAULTMODE::TANK_LEAK:
+		return config.tankLeakMtbf;
+	}
+	return 0.0;
+}
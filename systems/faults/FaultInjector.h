@@ -0,0 +1,93 @@
+#pragma once
+
+#include <queue>
+#include <random>
+#include <vector>
+#include "systems/VesselSystem.h"
+#include "model/FaultConfig.h"
+
+class MainEngine;
+class PropellantTanks;
+class ReactionControlSystem;
+
+/* Failure modes the systems model. The values are the modes of FaultConfig::script.
+ */
+enum class FAULTMODE {
+	//A thruster of the RCS stays off, component is the thruster
+	RCS_THRUSTER = 1,
+	//The throat valve of the main engine holds its position
+	THROAT_VALVE = 2,
+	//A propellant tank loses liquid overboard, component is the tank
+	TANK_LEAK = 3
+};
+const unsigned int FAULTMODE_COUNT = 3;
+
+/**
+ * \brief Fails components of the vessel at random times drawn from their failure rates, and at scripted times.
+ *
+ * Failures of a component are taken as a Poisson process, so the time to its failure is drawn once from the
+ * exponential distribution of its mean time between failures, instead of rolling for a failure of every component
+ * every frame. All pending faults of the vessel wait in a queue ordered by their time, and a step only looks at the
+ * earliest one. Scripted faults for training go into the same queue.
+ *
+ * Failed components stay failed, there is no repair. Every fault is logged and raises an anomaly of the main engine,
+ * so the crew sees it on the MFD. Script entries that name no failure mode or component are logged and skipped.
+ *
+ * Failures are not saved with the scenario, like the rest of the state of the vessel systems. A loaded scenario
+ * starts with every component working, draws the random failures anew and runs the script from the start again.
+ */
+class FaultInjector :
+	public VesselSystem
+{
+public:
+	FaultInjector(OrbitalHauler* vessel, const FaultConfig& config, MainEngine* engine, PropellantTanks* tanks, ReactionControlSystem* rcs);
+
+	virtual void init(EventBroker& eventBroker);
+	virtual void preStep(double simt, double simdt, double mjd);
+
+	/* Fails a component right away. Returns false if there is no such component or it failed already.
+	 */
+	bool inject(FAULTMODE mode, unsigned int component);
+	bool isFailed(FAULTMODE mode, unsigned int component) const;
+	unsigned int countComponents(FAULTMODE mode) const;
+	//Faults injected since the start
+	unsigned int countInjected() const;
+	//Faults waiting in the queue, random and scripted
+	unsigned int countPending() const;
+	//Sim time of the next pending fault, negative if there is none
+	double getNextFaultTime() const;
+
+protected:
+	virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
+
+private:
+	struct Fault {
+		double time;
+		FAULTMODE mode;
+		unsigned int component;
+	};
+
+	struct Later {
+		bool operator()(const Fault& a, const Fault& b) const {
+			return a.time > b.time;
+		}
+	};
+
+	const FaultConfig& config;
+	MainEngine* engine;
+	PropellantTanks* tanks;
+	ReactionControlSystem* rcs;
+
+	std::priority_queue<Fault, std::vector<Fault>, Later> pending;
+	std::mt19937 random;
+	//Per failure mode, by component
+	std::vector<bool> failed[FAULTMODE_COUNT];
+	unsigned int injected;
+	//Sim time of the last step
+	double time;
+	//False until the faults were drawn in the first step, once the layout of the RCS is known
+	bool armed;
+
+	void arm(double simt);
+	double getMtbf(FAULTMODE mode) const;
+};
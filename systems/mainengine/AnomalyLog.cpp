@@ -0,0 +1,270 @@
+#include "core/Common.h"
+#include "AnomalyLog.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint32_t ANOMALY_LOG_MAGIC = 0x4C4E4D41;
+const uint32_t ANOMALY_LOG_VERSION = 1;
+const uint32_t ANOMALY_LOG_MASK = ANOMALY_LOG_CAPACITY - 1;
+//A torn read is retried this many times before giving up on the entry
+const int ANOMALY_LOG_READ_ATTEMPTS = 3;
+
+static_assert((ANOMALY_LOG_CAPACITY & ANOMALY_LOG_MASK) == 0, "ANOMALY_LOG_CAPACITY must be a power of two");
+
+
+int anomalySeverity(char type) {
+	switch (type) {
+	case ANOMALY_INFO:
+		return 0;
+	case ANOMALY_WARNING:
+		return 1;
+	case ANOMALY_SCRAM:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+AnomalyLog::AnomalyLog() {
+	file = NULL;
+	mapping = NULL;
+	mappingSize = 0;
+	minimumSeverity = 0;
+	confirmations = 0;
+	memory = new char[storageSize()];
+	memset(memory, 0, storageSize());
+	attach(memory);
+}
+
+AnomalyLog::~AnomalyLog() {
+	close();
+	delete[] memory;
+}
+
+/*
+* Header and slots share one block, so the whole log can be mapped from a file in one piece.
+*/
+size_t AnomalyLog::storageSize() {
+	return sizeof(Header) + ANOMALY_LOG_CAPACITY * sizeof(Slot);
+}
+
+/*
+* Points the log at a storage block. A block that doesn't carry a valid header is initialised as empty log.
+*/
+void AnomalyLog::attach(char* storage) {
+	header = (Header*)storage;
+	slots = (Slot*)(storage + sizeof(Header));
+
+	if (header->magic != ANOMALY_LOG_MAGIC || header->version != ANOMALY_LOG_VERSION ||
+		header->capacity != ANOMALY_LOG_CAPACITY || header->slotSize != sizeof(Slot)) {
+		memset(storage, 0, storageSize());
+		header->magic = ANOMALY_LOG_MAGIC;
+		header->version = ANOMALY_LOG_VERSION;
+		header->capacity = ANOMALY_LOG_CAPACITY;
+		header->slotSize = sizeof(Slot);
+		header->sequence.store(0);
+	}
+}
+
+bool AnomalyLog::open(const char* filename) {
+	close();
+
+	size_t size = storageSize();
+	char* view = NULL;
+
+#ifdef _WIN32
+	HANDLE hFile = CreateFileA(filename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) {
+		Olog::warn("Can't open anomaly log %s", filename);
+		return false;
+	}
+	//Grows the file to the full log size if necessary, new space is zeroed
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READWRITE, 0, (DWORD)size, NULL);
+	if (hMapping != NULL) {
+		view = (char*)MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+	}
+	if (view == NULL) {
+		Olog::warn("Can't map anomaly log %s", filename);
+		if (hMapping != NULL) CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+	file = hFile;
+	mapping = hMapping;
+#else
+	int fd = ::open(filename, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		Olog::warn("Can't open anomaly log %s", filename);
+		return false;
+	}
+	struct stat status;
+	if (fstat(fd, &status) == 0 && (size_t)status.st_size < size) {
+		if (ftruncate(fd, size) != 0) {
+			::close(fd);
+			return false;
+		}
+	}
+	void* mapped = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mapped == MAP_FAILED) {
+		Olog::warn("Can't map anomaly log %s", filename);
+		::close(fd);
+		return false;
+	}
+	view = (char*)mapped;
+	file = (void*)(intptr_t)fd;
+	mapping = mapped;
+#endif
+
+	mappingSize = size;
+
+	//Anything logged before the file was opened is appended to the restored log
+	Header* previousHeader = header;
+	Slot* previousSlots = slots;
+	uint32_t previousSequence = previousHeader->sequence.load();
+	uint32_t carried = min(previousSequence, ANOMALY_LOG_CAPACITY);
+
+	attach(view);
+
+	for (uint32_t seq = previousSequence - carried; seq != previousSequence; ++seq) {
+		const Slot& slot = previousSlots[seq & ANOMALY_LOG_MASK];
+		if (slot.stamp.load() == 2 * seq + 2) {
+			log(slot.entry.type, slot.entry.cause, slot.entry.mjd);
+		}
+	}
+	memset(memory, 0, size);
+	return true;
+}
+
+void AnomalyLog::close() {
+	if (mapping == NULL) {
+		return;
+	}
+
+	//Keep logging in memory with the current content
+	memcpy(memory, (char*)header, mappingSize);
+
+#ifdef _WIN32
+	FlushViewOfFile(header, mappingSize);
+	UnmapViewOfFile(header);
+	CloseHandle((HANDLE)mapping);
+	CloseHandle((HANDLE)file);
+#else
+	msync(header, mappingSize, MS_ASYNC);
+	munmap(header, mappingSize);
+	::close((int)(intptr_t)file);
+#endif
+
+	file = NULL;
+	mapping = NULL;
+	mappingSize = 0;
+	attach(memory);
+}
+
+void AnomalyLog::setMinimumSeverity(char type) {
+	minimumSeverity = anomalySeverity(type);
+}
+
+void AnomalyLog::log(char type, const char* cause, double mjd) {
+	if (anomalySeverity(type) < minimumSeverity) {
+		return;
+	}
+
+	uint32_t seq = header->sequence.fetch_add(1, std::memory_order_relaxed);
+	Slot& slot = slots[seq & ANOMALY_LOG_MASK];
+
+	slot.stamp.store(2 * seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	slot.entry.type = type;
+	slot.entry.confirmed = false;
+	slot.entry.mjd = mjd;
+	strncpy(slot.entry.cause, cause, sizeof(slot.entry.cause) - 1);
+	slot.entry.cause[sizeof(slot.entry.cause) - 1] = '\0';
+
+	slot.stamp.store(2 * seq + 2, std::memory_order_release);
+}
+
+/*
+* Copies an entry if it is published and wasn't overwritten while copying.
+*/
+bool AnomalyLog::readSlot(uint32_t sequence, REACTOR_ERROR_TYPE* entry) const {
+	const Slot& slot = slots[sequence & ANOMALY_LOG_MASK];
+	uint32_t expected = 2 * sequence + 2;
+
+	for (int attempt = 0; attempt < ANOMALY_LOG_READ_ATTEMPTS; ++attempt) {
+		if (slot.stamp.load(std::memory_order_acquire) != expected) {
+			return false;
+		}
+		*entry = slot.entry;
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.stamp.load(std::memory_order_relaxed) == expected) {
+			return true;
+		}
+	}
+	return false;
+}
+
+unsigned int AnomalyLog::count() const {
+	return min(header->sequence.load(std::memory_order_acquire), ANOMALY_LOG_CAPACITY);
+}
+
+bool AnomalyLog::get(unsigned int pos, REACTOR_ERROR_TYPE* entry) const {
+	uint32_t sequence = header->sequence.load(std::memory_order_acquire);
+	if (pos >= min(sequence, ANOMALY_LOG_CAPACITY)) {
+		return false;
+	}
+	return readSlot(sequence - 1 - pos, entry);
+}
+
+unsigned int AnomalyLog::countUnconfirmed() const {
+	unsigned int result = 0;
+	unsigned int entries = count();
+	for (unsigned int i = 0; i < entries; ++i) {
+		REACTOR_ERROR_TYPE entry;
+		if (get(i, &entry) && !entry.confirmed) {
+			result++;
+		}
+	}
+	return result;
+}
+
+bool AnomalyLog::confirm(unsigned int pos) {
+	uint32_t sequence = header->sequence.load(std::memory_order_acquire);
+	if (pos >= min(sequence, ANOMALY_LOG_CAPACITY)) {
+		return false;
+	}
+	uint32_t target = sequence - 1 - pos;
+	Slot& slot = slots[target & ANOMALY_LOG_MASK];
+	uint32_t published = 2 * target + 2;
+	//Writes the entry like log() does, odd stamp while changing it, so readers retry instead of copying it torn
+	uint32_t stamp = published;
+	if (!slot.stamp.compare_exchange_strong(stamp, published - 1, std::memory_order_acquire)) {
+		return false;
+	}
+	std::atomic_thread_fence(std::memory_order_release);
+	bool changed = !slot.entry.confirmed;
+	slot.entry.confirmed = true;
+	//Fails if the slot was overwritten in the meantime, the new entry then owns the stamp
+	stamp = published - 1;
+	slot.stamp.compare_exchange_strong(stamp, published, std::memory_order_release);
+	if (changed) {
+		confirmations.fetch_add(1, std::memory_order_relaxed);
+	}
+	return true;
+}
+
+void AnomalyLog::confirmAll() {
+	unsigned int entries = count();
+	for (unsigned int i = 0; i < entries; ++i) {
+		confirm(i);
+	}
+}
+
+unsigned int AnomalyLog::countChanges() const {
+	return header->sequence.load(std::memory_order_acquire) + confirmations.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+struct REACTOR_ERROR_TYPE {
+	char type;
+	bool confirmed;
+	double mjd;
+	char cause[40];
+};
+
+/* Anomaly types, in ascending severity
+ */
+const char ANOMALY_INFO = 'I';
+const char ANOMALY_WARNING = 'W';
+const char ANOMALY_ERROR = 'E';
+const char ANOMALY_SCRAM = 'X';
+
+/* Number of anomalies kept in the log. Must be a power of two.
+ */
+const unsigned int ANOMALY_LOG_CAPACITY = 256;
+
+/* Returns the severity rank of an anomaly type, higher is more severe. Unknown types rank as errors.
+ */
+int anomalySeverity(char type);
+
+/**
+ * \brief Bounded log of reactor anomalies, newest first.
+ *
+ * The log is a ring buffer of fixed capacity. When full, the oldest anomaly is overwritten,
+ * so a flapping sensor costs neither memory nor time.
+ * Writers reserve a slot with a single atomic increment and publish it with a sequence stamp,
+ * readers check the stamp before and after copying an entry, so logging is lock-free and safe from any thread.
+ *
+ * If a file is opened, the ring lives in a memory mapping of that file instead of the heap.
+ * Every logged anomaly is then in the page cache the moment it is written, and survives a crash of the simulator.
+ * Reopening the same file restores the log.
+ * The file is the ring itself, not an append-only journal: it keeps the newest ANOMALY_LOG_CAPACITY anomalies and
+ * older ones are overwritten. So the file has a fixed size, and logging never has to grow or remap it under readers.
+ */
+class AnomalyLog {
+public:
+	AnomalyLog();
+	~AnomalyLog();
+
+	/* Maps the log onto a file, restoring anomalies already in it.
+	 * Anomalies logged before are carried over into the file.
+	 * Returns false and keeps the log in memory if the file can't be mapped.
+	 */
+	bool open(const char* filename);
+	void close();
+
+	/* Anomalies below this severity are dropped when logged.
+	 */
+	void setMinimumSeverity(char type);
+
+	void log(char type, const char* cause, double mjd);
+
+	/* Copies the anomaly at pos into entry, 0 is the newest anomaly.
+	 * Returns false if there is no such anomaly.
+	 */
+	bool get(unsigned int pos, REACTOR_ERROR_TYPE* entry) const;
+	unsigned int count() const;
+	unsigned int countUnconfirmed() const;
+
+	/* Acknowledges the anomaly at pos, 0 is the newest.
+	 */
+	bool confirm(unsigned int pos);
+	void confirmAll();
+
+	/* Grows with every anomaly logged or acknowledged, so displays know when to read the log again.
+	 */
+	unsigned int countChanges() const;
+
+private:
+	struct Slot {
+		//Odd while the entry is written, 2 * (sequence + 1) once it is published
+		std::atomic<uint32_t> stamp;
+		REACTOR_ERROR_TYPE entry;
+	};
+
+	//Aligned like a slot, the slots follow the header directly
+	struct alignas(Slot) Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t capacity;
+		uint32_t slotSize;
+		std::atomic<uint32_t> sequence;
+	};
+
+	Header* header;
+	Slot* slots;
+	//Heap storage while no file is mapped
+	char* memory;
+
+	void* file;
+	void* mapping;
+	size_t mappingSize;
+
+	int minimumSeverity;
+	//Acknowledgements since construction, not kept in the file
+	std::atomic<uint32_t> confirmations;
+
+	static size_t storageSize();
+	void attach(char* storage);
+	bool readSlot(uint32_t sequence, REACTOR_ERROR_TYPE* entry) const;
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+/**
+ * \file ControllerStates.h
+ * Modes and states of the LANTR engine controller.
+ * Modes are the stable operating points the crew can command, states are the steps the controller passes through
+ * between them. Both share one id space, the controller always is in exactly one of them.
+ */
+
+const int LANTR_MODE_OFF		= 0;
+const int LANTR_MODE_ELECTRIC	= 100;
+const int LANTR_MODE_NTR		= 200;
+const int LANTR_MODE_LANTR		= 300;
+const int LANTR_MODE_SCRAM		= 1000;
+
+const int LANTR_STATE_ACTIVATE_CONTROLLER = 51;
+const int LANTR_STATE_CONTROLLER_BITE = 52;
+const int LANTR_STATE_NEUTRONDETECTOR_TEST = 53;
+const int LANTR_STATE_CIRCULATE_COOLANT = 60;
+const int LANTR_STATE_PREHEAT_CORE = 70;
+const int LANTR_STATE_ENTER_CRITICALITY = 90;
+const int LANTR_STATE_SHUTDOWN_REACTOR = 95;
+const int LANTR_STATE_START_NTR = 150;
+const int LANTR_STATE_STOP_NTR = 190;
+const int LANTR_STATE_START_LANTR = 250;
+const int LANTR_STATE_STOP_LANTR = 290;
+
+//All state ids must be below this limit
+const int LANTR_STATE_ID_LIMIT = LANTR_MODE_SCRAM + 1;
+
+struct ControllerStateName {
+	int id;
+	const char* label;
+};
+
+/* All controller states in dispatch order.
+ * The position of a state in this table is its index into the controller transition table of MainEngine.
+ */
+constexpr ControllerStateName CONTROLLER_STATES[] = {
+	{ LANTR_MODE_OFF, "STANDBY" },
+	{ LANTR_STATE_ACTIVATE_CONTROLLER, "ACTIVATE_CONTROLLER" },
+	{ LANTR_STATE_CONTROLLER_BITE, "CONTROLLER_BITE" },
+	{ LANTR_STATE_NEUTRONDETECTOR_TEST, "NEUTRON_DETECTOR_TEST" },
+	{ LANTR_STATE_CIRCULATE_COOLANT, "CIRCULATE_COOLANT" },
+	{ LANTR_STATE_PREHEAT_CORE, "PREHEAT_CORE" },
+	{ LANTR_STATE_ENTER_CRITICALITY, "ENTER_CRITICALITY" },
+	{ LANTR_STATE_SHUTDOWN_REACTOR, "SHUTDOWN_REACTOR" },
+	{ LANTR_MODE_ELECTRIC, "ELECTRIC" },
+	{ LANTR_STATE_START_NTR, "START_NTR" },
+	{ LANTR_STATE_STOP_NTR, "STOP_NTR" },
+	{ LANTR_MODE_NTR, "NTR" },
+	{ LANTR_STATE_START_LANTR, "START_LANTR" },
+	{ LANTR_STATE_STOP_LANTR, "STOP_LANTR" },
+	{ LANTR_MODE_LANTR, "LANTR" },
+	{ LANTR_MODE_SCRAM, "SCRAM" }
+};
+
+const unsigned int CONTROLLER_STATE_COUNT = sizeof(CONTROLLER_STATES) / sizeof(CONTROLLER_STATES[0]);
+const unsigned char CONTROLLER_STATE_INVALID = 0xFF;
+
+struct ControllerStateIndex {
+	unsigned char index[LANTR_STATE_ID_LIMIT];
+};
+
+constexpr ControllerStateIndex makeControllerStateIndex() {
+	ControllerStateIndex result = {};
+	for (int i = 0; i < LANTR_STATE_ID_LIMIT; ++i) {
+		result.index[i] = CONTROLLER_STATE_INVALID;
+	}
+	for (unsigned int i = 0; i < CONTROLLER_STATE_COUNT; ++i) {
+		result.index[CONTROLLER_STATES[i].id] = (unsigned char)i;
+	}
+	return result;
+}
+
+constexpr bool controllerStatesValid() {
+	for (unsigned int i = 0; i < CONTROLLER_STATE_COUNT; ++i) {
+		if (CONTROLLER_STATES[i].id < 0 || CONTROLLER_STATES[i].id >= LANTR_STATE_ID_LIMIT) return false;
+		for (unsigned int j = i + 1; j < CONTROLLER_STATE_COUNT; ++j) {
+			if (CONTROLLER_STATES[i].id == CONTROLLER_STATES[j].id) return false;
+		}
+	}
+	return CONTROLLER_STATE_COUNT < CONTROLLER_STATE_INVALID;
+}
+
+static_assert(controllerStatesValid(), "Controller state ids must be unique and below LANTR_STATE_ID_LIMIT");
+
+/* Maps a state id to its position in CONTROLLER_STATES, generated at compile time.
+ */
+constexpr ControllerStateIndex CONTROLLER_STATE_INDEX = makeControllerStateIndex();
+
+/* Returns the dispatch index of a state, or CONTROLLER_STATE_INVALID if there is no such state.
+ */
+constexpr unsigned int controllerStateIndex(int id) {
+	return (id >= 0 && id < LANTR_STATE_ID_LIMIT) ? CONTROLLER_STATE_INDEX.index[id] : CONTROLLER_STATE_INVALID;
+}
+
+/* Returns the display name of a state, or NULL if there is no such state.
+ */
+constexpr const char* controllerStateLabel(int id) {
+	return controllerStateIndex(id) != CONTROLLER_STATE_INVALID ? CONTROLLER_STATES[controllerStateIndex(id)].label : nullptr;
+}
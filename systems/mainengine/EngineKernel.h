@@ -0,0 +1,205 @@
+#pragma once
+
+/**
+ * \file EngineKernel.h
+ * Per step physics of the main engine: turbopumps, primary loop and core heat balance.
+ *
+ * Written once for any value type. MainEngine runs it with double, MainEngineBatch with Lanes<N> for N engines
+ * in lock-step. Branches of the scalar code are masks here, so every lane does the same work whatever mode its
+ * controller is in. Both paths execute the same operations in the same order and give the same results.
+ */
+
+#include "model/ThrusterConfig.h"
+#include "MainEngine.h"
+#include "EngineState.h"
+
+template <typename Real>
+void EngineHardware<Real>::bind(unsigned int i, const LANTRConfig* config, const Turbomachine* tcga, const Turbomachine* h2tpa, const Turbomachine* o2tpa) {
+	this->tcga.bind(i, tcga);
+	this->h2tpa.bind(i, h2tpa);
+	this->o2tpa.bind(i, o2tpa);
+	lane(coreConductance, i) = config ? config->h_cladding * CORE_HEAT_TRANSFER_AREA : 0.0;
+	lane(corePropellantConductance, i) = config ? config->h_cladding * CORE_PROPELLANT_HEAT_TRANSFER_AREA : 0.0;
+	lane(radiatorConductance, i) = config ? config->h_radiator * RADIATOR_HEAT_TRANSFER_AREA : 0.0;
+}
+
+/*
+* Cold engine with evacuated loop and filled accumulator.
+*/
+template <typename Real>
+void resetCoreState(EngineCoreState<Real>& state) {
+	state.tempReactor = PRIMARY_LOOP_INITIAL_TEMPERATURE;
+	state.accuMols = ACCUMULATOR_INITIAL_MOLS;
+	state.primaryLoopMols = PRIMARY_LOOP_INITIAL_MOLS;
+	state.shaftSpeed = 0.0;
+	state.h2tpaSpeed = 0.0;
+	state.o2tpaSpeed = 0.0;
+
+	BasicGasFlow<Real>* loop[] = {
+		&state.primaryLoop1, &state.primaryLoop2, &state.primaryLoop3a, &state.primaryLoop3b, &state.primaryLoop4a, &state.primaryLoop5,
+		&state.primaryLoop6a, &state.primaryLoop6b, &state.primaryLoop7, &state.primaryLoop8, &state.primaryLoop9, &state.primaryLoop10a,
+		&state.primaryLoop10b, &state.primaryLoop11
+	};
+	Real P = state.primaryLoopMols * UNIVERSAL_GAS_CONSTANT * PRIMARY_LOOP_INITIAL_TEMPERATURE / PRIMARY_LOOP_VOLUME;
+	for (BasicGasFlow<Real>* flow : loop) {
+		flow->heatcap = HEXE_HEATCAPACITY_PER_MASS;
+		flow->T = PRIMARY_LOOP_INITIAL_TEMPERATURE;
+		flow->P = P;
+		flow->massflow = 0.0;
+	}
+	state.propellantFlow = { H2_HEATCAPACITY_PER_MASS, LH2_TEMPERATURE, PROPELLANT_FEED_PRESSURE, 0.0 };
+}
+
+/*
+* Effective conductance between a wall and a flow in W/K, the heat capacity flow limits it for small flows.
+*/
+template <typename Real>
+Real wallConductance(const Real& hA, const BasicGasFlow<Real>& flow) {
+	Real c = flow.massflow * flow.heatcap;
+	return select(c > 0.0, (1.0 - exp(-hA / c)) * c, 0.0);
+}
+
+/*
+* Heat transfer between a wall at constant temperature and a flow, using the NTU method.
+* Returns the heat transferred into the flow in W, negative if the flow is cooled.
+*/
+template <typename Real>
+Real doWallHeatTransfer(const Real& hA, const Real& wallT, BasicGasFlow<Real>& flow) {
+	Real c = flow.massflow * flow.heatcap;
+	typename LaneTraits<Real>::Mask flowing = c > 0.0;
+	Real heat = select(flowing, wallConductance(hA, flow) * (wallT - flow.T), 0.0);
+	flow.T = select(flowing, flow.T + heat / c, flow.T);
+	return heat;
+}
+
+/*
+* Only steady state right now, no inertia by structural parts/walls
+*/
+template <typename Real>
+void doHeatTransfer(double eff, BasicGasFlow<Real>& flow1, BasicGasFlow<Real>& flow2) {
+	Real c1 = flow1.massflow * flow1.heatcap;
+	Real c2 = flow2.massflow * flow2.heatcap;
+	Real T1 = c1 * flow1.T;
+	Real T2 = c2 * flow2.T;
+
+	Real dT = T1 - T2;
+
+	T1 = T1 - 0.5 * dT * eff;
+	T2 = T2 + 0.5 * dT * eff;
+
+	flow1.T = T1 / c1;
+	flow2.T = T2 / c2;
+}
+
+/*
+* Adiabatic mixing of two flows. The result has the pressure of the lower pressure flow.
+*/
+template <typename Real>
+void mixFlows(const BasicGasFlow<Real>& flow1, const BasicGasFlow<Real>& flow2, BasicGasFlow<Real>& result) {
+	Real c1 = flow1.massflow * flow1.heatcap;
+	Real c2 = flow2.massflow * flow2.heatcap;
+	Real massflow = flow1.massflow + flow2.massflow;
+	typename LaneTraits<Real>::Mask flowing = massflow > 0.0;
+
+	result.P = minimum(flow1.P, flow2.P);
+	result.heatcap = select(flowing, (c1 + c2) / massflow, flow1.heatcap);
+	result.T = select(flowing, (c1 * flow1.T + c2 * flow2.T) / (c1 + c2), flow1.T);
+	result.massflow = massflow;
+}
+
+template <typename Real>
+void stepTurbopumps(EngineCoreState<Real>& state, const EngineActuators<Real>& actuators, EngineHardware<Real>& hardware, double simdt) {
+	Real h2Flow = actuators.throatValve * NTR_RATED_PROPELLANT_FLOW;
+	Real o2Flow = select(actuators.oxygenInjection, h2Flow * LANTR_MIXTURE_RATIO, 0.0);
+
+	BasicGasFlow<Real> h2PumpIn = { H2_HEATCAPACITY_PER_MASS, LH2_TEMPERATURE, PROPELLANT_FEED_PRESSURE, h2Flow };
+	BasicGasFlow<Real> h2PumpOut;
+	Real h2PumpPower = hardware.h2tpa.pump(state.h2tpaSpeed, h2PumpIn, h2PumpOut, LH2_DENSITY);
+
+	//Expander cycle: The pumped hydrogen cools the nozzle and reactor structure before driving both turbines.
+	Real chamberT = 3.0 + actuators.thermalPowerLevel * (RATED_PEAK_TEMPERATURE - 3.0);
+	BasicGasFlow<Real> driveGas = h2PumpOut;
+	driveGas.T = maximum(h2PumpOut.T, TPA_DRIVE_GAS_TEMPERATURE_FRACTION * chamberT);
+
+	BasicGasFlow<Real> h2TurbineIn = driveGas;
+	h2TurbineIn.massflow = h2Flow * (1.0 - actuators.h2tpaBypass);
+	BasicGasFlow<Real> h2TurbineOut;
+	Real h2TurbinePower = hardware.h2tpa.expand(state.h2tpaSpeed, h2TurbineIn, h2TurbineOut, H2_GAMMA, 0.5 * PROPELLANT_FEED_PRESSURE);
+	state.h2tpaSpeed = hardware.h2tpa.accelerate(state.h2tpaSpeed, h2TurbinePower - h2PumpPower, simdt);
+
+	BasicGasFlow<Real> o2PumpIn = { LO2_HEATCAPACITY_PER_MASS, LO2_TEMPERATURE, PROPELLANT_FEED_PRESSURE, o2Flow };
+	BasicGasFlow<Real> o2PumpOut;
+	Real o2PumpPower = hardware.o2tpa.pump(state.o2tpaSpeed, o2PumpIn, o2PumpOut, LO2_DENSITY);
+
+	BasicGasFlow<Real> o2TurbineIn = driveGas;
+	o2TurbineIn.massflow = select(o2Flow > 0.0, h2Flow * (1.0 - actuators.o2tpaBypass), 0.0);
+	BasicGasFlow<Real> o2TurbineOut;
+	Real o2TurbinePower = hardware.o2tpa.expand(state.o2tpaSpeed, o2TurbineIn, o2TurbineOut, H2_GAMMA, 0.5 * PROPELLANT_FEED_PRESSURE);
+	state.o2tpaSpeed = hardware.o2tpa.accelerate(state.o2tpaSpeed, o2TurbinePower - o2PumpPower, simdt);
+
+	//All hydrogen passes the reactor core on its way to the nozzle
+	state.propellantFlow = driveGas;
+	state.propellantFlow.massflow = h2Flow;
+}
+
+template <typename Real>
+void stepPrimaryLoop(EngineCoreState<Real>& state, const EngineActuators<Real>& actuators, EngineHardware<Real>& hardware, double simdt) {
+	//The loop inventory at the mean loop temperature defines the mean pressure,
+	//the compressor pressure ratio of the last step splits it into low and high pressure side.
+	Real meanT = 0.5 * (state.primaryLoop8.T + state.primaryLoop1.T);
+	Real meanP = state.primaryLoopMols * UNIVERSAL_GAS_CONSTANT * meanT / PRIMARY_LOOP_VOLUME;
+	Real lastPressureRatio = maximum(1.0, state.primaryLoop9.P / maximum(state.primaryLoop8.P, 1.0));
+	state.primaryLoop8.P = 2.0 * meanP / (1.0 + lastPressureRatio);
+
+	//Pressurization from the accumulator
+	Real pressurizationMols = minimum(state.accuMols, actuators.pressurizationValve * PRESSURIZATION_VALVE_FLOW * simdt);
+	state.accuMols -= pressurizationMols;
+	state.primaryLoopMols += pressurizationMols;
+	state.primaryLoop11.massflow = (simdt > 0.0) ? Real(pressurizationMols * HEXE_MOLAR_MASS / 1000.0 / simdt) : Real(0.0);
+
+	//Simplified operating line: corrected flow follows corrected speed.
+	TurbomachineLanes<Real>& tcga = hardware.tcga;
+	state.primaryLoop8.massflow = tcga.getReferenceMassFlow()
+		* tcga.correctedSpeed(state.shaftSpeed, state.primaryLoop8.T)
+		* (state.primaryLoop8.P / tcga.getReferencePressure())
+		/ sqrt(state.primaryLoop8.T / tcga.getReferenceTemperature());
+
+	Real compressorPower = tcga.compress(state.shaftSpeed, state.primaryLoop8, state.primaryLoop9, HEXE_GAMMA);
+
+	//Reactor core
+	state.primaryLoop1 = state.primaryLoop9;
+	//Implicit in the fuel temperature, so large time steps under time acceleration remain stable.
+	Real coolantConductance = wallConductance(hardware.coreConductance, state.primaryLoop1);
+	Real propellantConductance = wallConductance(hardware.corePropellantConductance, state.propellantFlow);
+	double k = simdt / CORE_HEAT_CAPACITY;
+	state.tempReactor = (state.tempReactor + k * (actuators.thermalPowerLevel * RATED_THERMAL_POWER
+		+ coolantConductance * state.primaryLoop1.T + propellantConductance * state.propellantFlow.T))
+		/ (1.0 + k * (coolantConductance + propellantConductance));
+	doWallHeatTransfer(hardware.coreConductance, state.tempReactor, state.primaryLoop1);
+	doWallHeatTransfer(hardware.corePropellantConductance, state.tempReactor, state.propellantFlow);
+
+	//NTR mode heat exchanger, not used yet
+	state.primaryLoop2 = state.primaryLoop1;
+
+	//Turbine bypass valve
+	state.primaryLoop3a = state.primaryLoop2;
+	state.primaryLoop3a.massflow = state.primaryLoop2.massflow * (1.0 - actuators.tcgaBypass);
+	state.primaryLoop3b = state.primaryLoop2;
+	state.primaryLoop3b.massflow = state.primaryLoop2.massflow * actuators.tcgaBypass;
+	Real turbinePower = tcga.expand(state.shaftSpeed, state.primaryLoop3a, state.primaryLoop4a, HEXE_GAMMA, state.primaryLoop8.P);
+	mixFlows(state.primaryLoop4a, state.primaryLoop3b, state.primaryLoop5);
+
+	//Radiator, no bypass yet
+	state.primaryLoop6a = state.primaryLoop5;
+	state.primaryLoop6b = state.primaryLoop5;
+	state.primaryLoop6b.massflow = 0.0;
+	state.primaryLoop7 = state.primaryLoop6a;
+	doWallHeatTransfer(hardware.radiatorConductance, Real(RADIATOR_SINK_TEMPERATURE), state.primaryLoop7);
+
+	//Inlet conditions for the next step
+	Real lowSideP = state.primaryLoop8.P;
+	mixFlows(state.primaryLoop7, state.primaryLoop6b, state.primaryLoop8);
+	state.primaryLoop8.P = lowSideP;
+
+	state.shaftSpeed = tcga.accelerate(state.shaftSpeed, turbinePower - compressorPower - actuators.tcgaElectricPower, simdt);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "core/Lanes.h"
+#include "GasFlow.h"
+#include "Turbomachine.h"
+
+struct LANTRConfig;
+
+/* State of the engine physics, everything the kernel in EngineKernel.h integrates.
+ * Real is double for a single engine and Lanes<N> for N engines stepped together by a MainEngineBatch.
+ */
+template <typename Real>
+struct EngineCoreState {
+	/* Temperature of the reactor fuel rods
+	 */
+	Real tempReactor;
+
+	//From reactor to NTR mode heat exchanger
+	BasicGasFlow<Real> primaryLoop1;
+	//From NTR mode heat exchanger to turbine bypass valve
+	BasicGasFlow<Real> primaryLoop2;
+	//From turbine bypass to turbine
+	BasicGasFlow<Real> primaryLoop3a;
+	//From turbine bypass to turbine mixer
+	BasicGasFlow<Real> primaryLoop3b;
+	//From turbine to turbine mixer
+	BasicGasFlow<Real> primaryLoop4a;
+	//From turbine mixer to radiator bypass valve
+	BasicGasFlow<Real> primaryLoop5;
+	//From radiator bypass to radiator
+	BasicGasFlow<Real> primaryLoop6a;
+	//From radiatior bypass to radiator mixer
+	BasicGasFlow<Real> primaryLoop6b;
+	//From radiator to radiator mixer
+	BasicGasFlow<Real> primaryLoop7;
+	//From radiator mixer to compressor
+	BasicGasFlow<Real> primaryLoop8;
+	//From compressor to junction
+	BasicGasFlow<Real> primaryLoop9;
+	//From junction to compressor
+	BasicGasFlow<Real> primaryLoop10a;
+	//From junction to accu charger checkvalve
+	BasicGasFlow<Real> primaryLoop10b;
+	//From pressurization globe valve to radiator mixer
+	BasicGasFlow<Real> primaryLoop11;
+	//From the turbopumps through the reactor core into the nozzle
+	BasicGasFlow<Real> propellantFlow;
+
+	//Content of the Accumulator in mols (40g / mol -  400 mol in accu at startup)
+	Real accuMols;
+	Real primaryLoopMols;
+
+	Real shaftSpeed; // (rad / s)
+	Real h2tpaSpeed; // (rad / s)
+	Real o2tpaSpeed; // (rad / s)
+};
+
+/* Calls f(a.x, b.x) for every value of two engine states, to move single engines in and out of lanes.
+ */
+template <typename FlowA, typename FlowB, typename Function>
+void forEachFlowValue(FlowA& a, FlowB& b, Function f) {
+	f(a.heatcap, b.heatcap);
+	f(a.T, b.T);
+	f(a.P, b.P);
+	f(a.massflow, b.massflow);
+}
+
+template <typename StateA, typename StateB, typename Function>
+void forEachCoreValue(StateA& a, StateB& b, Function f) {
+	f(a.tempReactor, b.tempReactor);
+	forEachFlowValue(a.primaryLoop1, b.primaryLoop1, f);
+	forEachFlowValue(a.primaryLoop2, b.primaryLoop2, f);
+	forEachFlowValue(a.primaryLoop3a, b.primaryLoop3a, f);
+	forEachFlowValue(a.primaryLoop3b, b.primaryLoop3b, f);
+	forEachFlowValue(a.primaryLoop4a, b.primaryLoop4a, f);
+	forEachFlowValue(a.primaryLoop5, b.primaryLoop5, f);
+	forEachFlowValue(a.primaryLoop6a, b.primaryLoop6a, f);
+	forEachFlowValue(a.primaryLoop6b, b.primaryLoop6b, f);
+	forEachFlowValue(a.primaryLoop7, b.primaryLoop7, f);
+	forEachFlowValue(a.primaryLoop8, b.primaryLoop8, f);
+	forEachFlowValue(a.primaryLoop9, b.primaryLoop9, f);
+	forEachFlowValue(a.primaryLoop10a, b.primaryLoop10a, f);
+	forEachFlowValue(a.primaryLoop10b, b.primaryLoop10b, f);
+	forEachFlowValue(a.primaryLoop11, b.primaryLoop11, f);
+	forEachFlowValue(a.propellantFlow, b.propellantFlow, f);
+	f(a.accuMols, b.accuMols);
+	f(a.primaryLoopMols, b.primaryLoopMols);
+	f(a.shaftSpeed, b.shaftSpeed);
+	f(a.h2tpaSpeed, b.h2tpaSpeed);
+	f(a.o2tpaSpeed, b.o2tpaSpeed);
+}
+
+/* Controller outputs the kernel acts on, set by the engine controller every step.
+ */
+template <typename Real>
+struct EngineActuators {
+	typedef typename LaneTraits<Real>::Mask Mask;
+
+	Real thermalPowerLevel;
+	Real throatValve;
+	Real tcgaBypass;
+	Real h2tpaBypass;
+	Real o2tpaBypass;
+	Real pressurizationValve;
+	Real tcgaElectricPower;
+	//Set in LANTR mode, the O2 turbopump feeds oxygen into the nozzle
+	Mask oxygenInjection;
+};
+
+/* Hardware of the engines in the lanes: turbomachine maps with their cursors and the heat transfer coefficients.
+ */
+template <typename Real>
+struct EngineHardware {
+	TurbomachineLanes<Real> tcga;
+	TurbomachineLanes<Real> h2tpa;
+	TurbomachineLanes<Real> o2tpa;
+
+	//Heat transfer coefficient times area in W/K
+	Real coreConductance;
+	Real corePropellantConductance;
+	Real radiatorConductance;
+
+	EngineHardware() : coreConductance(0.0), corePropellantConductance(0.0), radiatorConductance(0.0) {}
+
+	/* Uses the configuration and turbomachines of an engine for the lane, NULL frees the lane.
+	 * Defined in EngineKernel.h.
+	 */
+	void bind(unsigned int i, const LANTRConfig* config, const Turbomachine* tcga, const Turbomachine* h2tpa, const Turbomachine* o2tpa);
+};
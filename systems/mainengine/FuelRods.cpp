@@ -0,0 +1,174 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/FuelRodConfig.h"
+
+#include "FuelRods.h"
+
+
+FuelRodBank::FuelRodBank() {
+	channels = 0;
+	blocks = 0;
+	nodes = 0;
+	surfaceLink = 0.0;
+	rodLength = 0.0;
+	fuelVolume = 0.0;
+	peakTemperature = 0.0;
+	peakChannel = 0;
+}
+
+bool FuelRodBank::init(const FuelRodConfig& config, double heatCapacity, double surfaceArea, double initialTemperature) {
+	if (config.fuelRadius <= 0.0 || config.claddingThickness <= 0.0 || config.fuelConductivity <= 0.0 ||
+		config.claddingConductivity <= 0.0 || config.fuelNodes < 2 || config.rings < 1 || config.zones < 1 || surfaceArea <= 0.0) {
+		return false;
+	}
+
+	this->config = config;
+	channels = (unsigned int)(config.rings * config.zones);
+	blocks = (channels + FUEL_ROD_LANES - 1) / FUEL_ROD_LANES;
+	nodes = (unsigned int)config.fuelNodes + 1;
+
+	double a = config.fuelRadius;
+	double b = config.fuelRadius + config.claddingThickness;
+	rodLength = surfaceArea / (2.0 * PI * b);
+	fuelVolume = rodLength * PI * a * a;
+	//Same heat capacity as the lumped core, spread over fuel and cladding
+	double volumetricCapacity = heatCapacity / (rodLength * PI * b * b);
+
+	volume.assign(nodes, 0.0);
+	capacity.assign(nodes, 0.0);
+	link.assign(nodes, 0.0);
+	double dr = a / config.fuelNodes;
+	for (unsigned int i = 0; i < nodes - 1; ++i) {
+		double inner = i * dr;
+		double outer = (i + 1) * dr;
+		volume[i] = PI * (outer * outer - inner * inner);
+		//Node centers at the middle of the finite volumes, log mean for the cylindrical shell between them
+		double center = inner + 0.5 * dr;
+		double next = center + dr;
+		if (i + 1 < nodes - 1) {
+			link[i] = 2.0 * PI * config.fuelConductivity / log(next / center);
+		}
+	}
+	//Last fuel node to cladding node: half a fuel volume, then half the cladding in series
+	double fuelCenter = a - 0.5 * dr;
+	double claddingCenter = a + 0.5 * config.claddingThickness;
+	link[nodes - 2] = 1.0 / (log(a / fuelCenter) / (2.0 * PI * config.fuelConductivity) + log(claddingCenter / a) / (2.0 * PI * config.claddingConductivity));
+	surfaceLink = 2.0 * PI * config.claddingConductivity / log(b / claddingCenter);
+	volume[nodes - 1] = PI * (b * b - a * a);
+	for (unsigned int i = 0; i < nodes; ++i) {
+		capacity[i] = volumetricCapacity * volume[i];
+	}
+
+	temperature.assign(nodes * blocks, Real(initialTemperature));
+	powerShape.assign(blocks, Real(0.0));
+	std::vector<double> uniform(channels, 1.0);
+	setPowerShape(uniform);
+
+	lower.assign(nodes, 0.0);
+	upper.assign(nodes, 0.0);
+	inverse.assign(nodes, 0.0);
+	peakTemperature = initialTemperature;
+	peakChannel = 0;
+	return true;
+}
+
+void FuelRodBank::setPowerShape(const std::vector<double>& density) {
+	double sum = 0.0;
+	for (unsigned int c = 0; c < channels && c < density.size(); ++c) {
+		sum += max(0.0, density[c]);
+	}
+	double scale = sum > 0.0 ? channels / sum : 0.0;
+	for (unsigned int c = 0; c < blocks * FUEL_ROD_LANES; ++c) {
+		//Lanes past the last channel carry no power
+		double value = (c < channels && c < density.size()) ? max(0.0, density[c]) * scale : 0.0;
+		powerShape[c / FUEL_ROD_LANES][c % FUEL_ROD_LANES] = value;
+	}
+}
+
+void FuelRodBank::step(double power, double coolantTemperature, double conductance, double simdt) {
+	if (channels == 0 || simdt <= 0.0) {
+		return;
+	}
+
+	//Convection per meter of rod, in series with the outer half of the cladding
+	double convection = conductance / rodLength;
+	double cooling = convection > 0.0 ? 1.0 / (1.0 / convection + 1.0 / surfaceLink) : 0.0;
+	double powerDensity = power / fuelVolume;
+
+	//Factor the matrix once: (C / dt + sum of links) on the diagonal, -link to the neighbours
+	for (unsigned int i = 0; i < nodes; ++i) {
+		double west = i > 0 ? link[i - 1] : 0.0;
+		double east = i + 1 < nodes ? link[i] : 0.0;
+		double diagonal = capacity[i] / simdt + west + east + (i + 1 == nodes ? cooling : 0.0);
+		lower[i] = -west;
+		double pivot = diagonal - (i > 0 ? lower[i] * upper[i - 1] : 0.0);
+		inverse[i] = 1.0 / pivot;
+		upper[i] = -east * inverse[i];
+	}
+
+	//Forward substitution for all blocks, the right hand side replaces the temperatures
+	for (unsigned int i = 0; i < nodes; ++i) {
+		Real* t = &temperature[i * blocks];
+		const Real* previous = i > 0 ? &temperature[(i - 1) * blocks] : NULL;
+		double c = capacity[i] / simdt;
+		double heat = i + 1 < nodes ? powerDensity * volume[i] : 0.0;
+		double sink = i + 1 == nodes ? cooling * coolantTemperature : 0.0;
+		for (unsigned int b = 0; b < blocks; ++b) {
+			Real rhs = c * t[b] + heat * powerShape[b] + sink;
+			if (previous != NULL) {
+				rhs -= lower[i] * previous[b];
+			}
+			t[b] = rhs * inverse[i];
+		}
+	}
+
+	//Back substitution
+	for (unsigned int i = nodes - 1; i-- > 0;) {
+		Real* t = &temperature[i * blocks];
+		const Real* next = &temperature[(i + 1) * blocks];
+		for (unsigned int b = 0; b < blocks; ++b) {
+			t[b] -= upper[i] * next[b];
+		}
+	}
+
+	peakTemperature = 0.0;
+	for (unsigned int c = 0; c < channels; ++c) {
+		double centerline = temperature[c / FUEL_ROD_LANES][c % FUEL_ROD_LANES];
+		if (centerline > peakTemperature) {
+			peakTemperature = centerline;
+			peakChannel = c;
+		}
+	}
+}
+
+unsigned int FuelRodBank::countChannels() const {
+	return channels;
+}
+
+double FuelRodBank::getChannelRadius(unsigned int channel) const {
+	//Rings of equal area, center by area
+	unsigned int ring = channel / config.zones;
+	return sqrt((ring + 0.5) / config.rings);
+}
+
+double FuelRodBank::getChannelHeight(unsigned int channel) const {
+	unsigned int zone = channel % config.zones;
+	return (zone + 0.5) / config.zones;
+}
+
+double FuelRodBank::getCenterlineTemperature(unsigned int channel) const {
+	return channel < channels ? temperature[channel / FUEL_ROD_LANES][channel % FUEL_ROD_LANES] : 0.0;
+}
+
+double FuelRodBank::getSurfaceTemperature(unsigned int channel) const {
+	return channel < channels ? temperature[(nodes - 1) * blocks + channel / FUEL_ROD_LANES][channel % FUEL_ROD_LANES] : 0.0;
+}
+
+double FuelRodBank::getPeakCenterlineTemperature() const {
+	return peakTemperature;
+}
+
+unsigned int FuelRodBank::getPeakChannel() const {
+	return peakChannel;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+#include "core/Lanes.h"
+#include "model/FuelRodConfig.h"
+
+//Channels solved together in one block of lanes
+const unsigned int FUEL_ROD_LANES = 8;
+
+/**
+ * \brief Radial temperature profiles of the fuel rods in representative channels of the core.
+ *
+ * Every channel is one rod at a position of the core: a finite volume model over the fuel radius with one cladding
+ * node, cooled at the cladding surface. The channels only differ in their power density, so all of them share the
+ * same tridiagonal matrix. The backward Euler step factors it once and then runs the Thomas substitutions for
+ * FUEL_ROD_LANES channels at a time in SIMD lanes. The temperatures are stored node by node, so every block of
+ * lanes is a contiguous load.
+ *
+ * The rods together have the heat capacity and the wetted surface of the lumped core model.
+ */
+class FuelRodBank {
+public:
+	typedef Lanes<FUEL_ROD_LANES> Real;
+
+	FuelRodBank();
+
+	/* heatCapacity in J/K and surfaceArea in m2 of all rods together.
+	 * Returns false if the configuration is invalid.
+	 */
+	bool init(const FuelRodConfig& config, double heatCapacity, double surfaceArea, double initialTemperature);
+
+	/* Power density of every channel relative to the core mean, in the order of getChannelRadius().
+	 * Normalized, so the channels together produce the thermal power. Uniform after init.
+	 */
+	void setPowerShape(const std::vector<double>& density);
+
+	/* Advances all channels by one implicit step. power in W, film conductance between cladding and coolant
+	 * in W/K for all rods.
+	 */
+	void step(double power, double coolantTemperature, double conductance, double simdt);
+
+	unsigned int countChannels() const;
+	//Center of a channel as fractions of the core radius and height
+	double getChannelRadius(unsigned int channel) const;
+	double getChannelHeight(unsigned int channel) const;
+
+	double getCenterlineTemperature(unsigned int channel) const;
+	double getSurfaceTemperature(unsigned int channel) const;
+	//Hottest centerline over all channels in K
+	double getPeakCenterlineTemperature() const;
+	unsigned int getPeakChannel() const;
+
+private:
+	FuelRodConfig config;
+	unsigned int channels;
+	unsigned int blocks;
+	unsigned int nodes;
+
+	//Per meter of rod: volume and heat capacity of every node, conductance between node i and i + 1
+	std::vector<double> volume;
+	std::vector<double> capacity;
+	std::vector<double> link;
+	//Conduction from the cladding node to its surface per meter
+	double surfaceLink;
+	//Total length of all rods in m
+	double rodLength;
+	double fuelVolume;
+
+	//Node major: temperature of node i of block b at i * blocks + b
+	std::vector<Real> temperature;
+	std::vector<Real> powerShape;
+
+	//Thomas factorization of the current step, shared by all channels
+	std::vector<double> lower;
+	std::vector<double> upper;
+	std::vector<double> inverse;
+
+	double peakTemperature;
+	unsigned int peakChannel;
+};
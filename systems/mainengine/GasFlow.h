@@ -0,0 +1,18 @@
+#pragma once
+
+/* State of a flow between two components of a loop.
+ * Real is double for a single engine and Lanes<N> for N engines stepped together by a MainEngineBatch.
+ */
+template <typename Real>
+struct BasicGasFlow {
+	//specific heat capacity
+	Real heatcap;
+	//Temperature
+	Real T;
+	//Pressure
+	Real P;
+	//Mass flow (kg/s)
+	Real massflow;
+};
+
+typedef BasicGasFlow<double> GasFlow;
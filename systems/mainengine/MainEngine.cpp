@@ -5,21 +5,52 @@
 
 #include "systems/VesselSystem.h"
 #include "MainEngine.h"
+#include "EngineKernel.h"
 #include "core/OrbitalHauler.h"
+#include "core/Trace.h"
+#include "systems/telemetry/TelemetryRecorder.h"
+#include "systems/telemetry/TrendRecorder.h"
 #include <sstream>
 
 
 
-MainEngine::MainEngine(OrbitalHauler* vessel, const LANTRConfig &config, PROPELLANT_HANDLE phLH2, PROPELLANT_HANDLE phLO2) : VesselSystem(vessel), configuration(config) {
+MainEngine::MainEngine(OrbitalHauler* vessel, const LANTRConfig &config, PROPELLANT_HANDLE phLH2, PROPELLANT_HANDLE phLO2) : VesselSystem(vessel, "MainEngine"), configuration(config) {
 	targetMode = LANTR_MODE_OFF;
 	currentMode = LANTR_MODE_OFF;
 	this->phLH2 = phLH2;
 	this->phLO2 = phLO2;
 	thermalPowerLevel = 0.0;
-	shaftSpeed = 0.0;
-	accuMols = 400.0;
+	sensorNoise = 0.0;
+	tcgaElectricPower = 0.0;
+	neutronsAbsorbed = 0.0;
+	throatValve = 0.0f;
+	throatValveStuck = false;
+	TCGA_bypass = 0.0f;
+	H2TPA_bypass = 0.0f;
+	O2TPA_bypass = 0.0f;
+	HotLH2_valve = 0.0f;
+	nozzleLH2_valve = 0.0f;
+	electricPumpEnabled = false;
+	tempReactorHW = PRIMARY_LOOP_INITIAL_TEMPERATURE;
+	tempGammaShield = PRIMARY_LOOP_INITIAL_TEMPERATURE;
+	pressurizationValve = 0.0f;
+	thNTR = NULL;
+	thLANTR = NULL;
 	timer = 0.0;
+	watchdog = 0.0;
+	controllerTime = 0.0;
 	functionInit = false;
+	batched = false;
+	detailedNeutronics = false;
+	drumAngle = 0.0;
+	reactivity = 0.0;
+	fissionPowerFactor = 1.0;
+	peakFuelTemperature = PRIMARY_LOOP_INITIAL_TEMPERATURE;
+	fuelRodFrames = 0;
+	fuelRodTime = 0.0;
+	lumpedByFidelity = false;
+	jobs = NULL;
+	resetCoreState<double>(*this);
 }
 
 MainEngine::~MainEngine() {}
@@ -31,6 +62,26 @@ void MainEngine::init(EventBroker& eventBroker) {
 	// create event subscriptions
 	eventBroker.subscribe((EventSubscriber*)this, EVENTTOPIC::GENERAL);
 	
+	if (!tcga.init(configuration.tcga)) Olog::error("Invalid TCGA configuration");
+	if (!h2tpa.init(configuration.h2tpa)) Olog::error("Invalid H2TPA configuration");
+	if (!o2tpa.init(configuration.o2tpa)) Olog::error("Invalid O2TPA configuration");
+	hardware.bind(0, &configuration, &tcga, &h2tpa, &o2tpa);
+	const string& severity = configuration.anomalySeverity;
+	if (severity.size() == 1 && string("IWEX").find(severity[0]) != string::npos) {
+		anomalyLog.setMinimumSeverity(severity[0]);
+	}
+	else {
+		Olog::error("Invalid anomaly severity %s, logging all anomalies", severity.c_str());
+	}
+	if (!fuelRods.init(configuration.fuelRods, CORE_HEAT_CAPACITY, CORE_HEAT_TRANSFER_AREA + CORE_PROPELLANT_HEAT_TRANSFER_AREA, tempReactor)) {
+		Olog::error("Invalid fuel rod configuration");
+	}
+	if (configuration.neutronics.background) {
+		jobs = &vessel->Jobs();
+	}
+	if (configuration.neutronics.detailed) {
+		setDetailedNeutronics(true);
+	}
 
 	// Create the propellant tank.
 
@@ -39,7 +90,7 @@ void MainEngine::init(EventBroker& eventBroker) {
 	// TODO: Some of this should be configurable in the CFG.
 
 	VECTOR3 pos = { 0, 0, -5 };
-	VECTOR3 dir = { 0, 0, 1 };
+	VECTOR3 dir = MAIN_ENGINE_AXIS;
 	double thrust = 67000;
 	double isp = 9221;
 	
@@ -52,14 +103,34 @@ void MainEngine::init(EventBroker& eventBroker) {
 }
 
 void MainEngine::preStep(double simt, double simdt, double mjd) {
+	//The batch steps this engine together with the other lanes
+	if (batched) {
+		return;
+	}
 	doController(simt, simdt);
 	doAbsorptionReactions(simt, simdt);
 	doDecayReactions(simt, simdt);
+	calculateTurbopumps(simt, simdt);
 	//Use Newtons Law of cooling for calculating the heat transfers
 	calculatePrimaryLoop(simt, simdt);
+	calculateFuelRods(simdt);
+}
+
+EngineActuators<double> MainEngine::getActuators() const {
+	EngineActuators<double> actuators;
+	actuators.thermalPowerLevel = getFissionPowerLevel();
+	actuators.throatValve = throatValve;
+	actuators.tcgaBypass = TCGA_bypass;
+	actuators.h2tpaBypass = H2TPA_bypass;
+	actuators.o2tpaBypass = O2TPA_bypass;
+	actuators.pressurizationValve = pressurizationValve;
+	actuators.tcgaElectricPower = tcgaElectricPower;
+	actuators.oxygenInjection = currentMode == LANTR_MODE_LANTR;
+	return actuators;
 }
 
 void MainEngine::doAbsorptionReactions(double simt, double simdt) {
+	OH_TRACE_SCOPE("doAbsorptionReactions");
 	//Calculate what happens to neutrons absorbed inside the fuel rods.
 	//1. How many hit U235 atoms?
 	//2. How many hit Xenon? etc.
@@ -68,91 +139,564 @@ void MainEngine::doAbsorptionReactions(double simt, double simdt) {
 	//5. Absorption of neutrons increases the internal energy of the fuel.
 	//6. Also calculate the absorption of neutrons hitting the control drums. This only heats the control drums.
 	//7. The control drums slowly age over time and become less efficient and corroded.
+	double beta = configuration.neutronics.delayedFraction;
+	if (!detailedNeutronics) {
+		//The lumped core is critical, a core handed over while subcritical only gets there as the drums would turn
+		reactivity *= exp(-simdt / ENGINE_LUMPED_CRITICALITY_TIME);
+		fissionPowerFactor = reactivity < 0.0 ? beta / (beta - reactivity) : 1.0;
+		return;
+	}
+
+	NeutronicsConditions conditions = { drumAngle, tempReactor, propellantFlow.massflow / NTR_RATED_PROPELLANT_FLOW, 1.0 };
+	if (jobs != NULL) {
+		//Solutions come from a worker thread, meanwhile the servo works with the last one
+		if (neutronics.collect()) {
+			updatePowerShape();
+		}
+		if (!neutronics.isPending() && !neutronics.get().isCurrent(conditions)) {
+			neutronics.submit(*jobs, [conditions](NeutronDiffusion& solution, const std::atomic<bool>& cancelled) {
+				solution.solve(conditions, &cancelled);
+				return true;
+			});
+		}
+	}
+	else if (neutronics.get().update(conditions)) {
+		updatePowerShape();
+	}
+
+	//Drum servo: hold the core critical while the controller demands power, turn the absorbers in otherwise
+	double target = thermalPowerLevel > CONTROLLER_SHUTDOWN_POWER ? neutronics.get().getCriticalDrumAngle() : 0.0;
+	double step = configuration.neutronics.drumRate * simdt;
+	double next = (drumAngle < target) ? min(target, drumAngle + step) : max(target, drumAngle - step);
+	//The reactivity is only extrapolated near the last solution, so the drums wait for a pending solve rather than outrun it
+	double solved = neutronics.get().getConditions().drumAngle;
+	double reach = 2.0 * configuration.neutronics.drumTolerance;
+	if (jobs == NULL || fabs(next - solved) <= reach || fabs(next - solved) < fabs(drumAngle - solved)) {
+		drumAngle = next;
+	}
+	reactivity = neutronics.get().predictReactivity(drumAngle);
+
+	//Prompt jump: a subcritical core only sustains the fraction beta / (beta - rho) of the fission power
+	fissionPowerFactor = reactivity < 0.0 ? beta / (beta - reactivity) : 1.0;
+	if (reactivity >= beta) {
+		scram("PROMPT_CRITICAL");
+	}
+}
+
+void MainEngine::setDetailedNeutronics(bool detailed) {
+	if (detailed && !neutronics.get().isInitialized() && !neutronics.get().init(configuration.neutronics, configuration.controlDrumAbsorptionEffect)) {
+		Olog::error("Invalid neutronics configuration");
+		return;
+	}
+	//The back buffer is only ever solved on the job system, it needs the mesh as well
+	if (detailed && jobs != NULL && !neutronics.isPending() && !neutronics.getBack().isInitialized()) {
+		neutronics.getBack().init(configuration.neutronics, configuration.controlDrumAbsorptionEffect);
+	}
+	detailedNeutronics = detailed;
+	if (!detailed) {
+		//A solution still being computed is of no use anymore
+		neutronics.cancel();
+		//The reactivity and the fission power are kept, the lumped model eases them to critical
+	}
+	updatePowerShape();
+}
+
+/* Power density of the fuel rod channels at their position in the core, uniform without detailed neutronics.
+ */
+void MainEngine::updatePowerShape() {
+	std::vector<double> shape(fuelRods.countChannels(), 1.0);
+	if (detailedNeutronics) {
+		for (unsigned int c = 0; c < shape.size(); ++c) {
+			shape[c] = neutronics.get().getPowerDensity(fuelRods.getChannelRadius(c), fuelRods.getChannelHeight(c));
+		}
+	}
+	fuelRods.setPowerShape(shape);
+}
+
+/* Resolves the fuel temperature of the lumped core model into fuel rods.
+ * The lumped core is the wall both coolants see, so the rods are cooled by the coolant temperature that puts the
+ * cladding surface of a channel with mean power at the lumped temperature. Hotter channels get a hotter surface.
+ */
+void MainEngine::calculateFuelRods(double simdt) {
+	OH_TRACE_SCOPE("calculateFuelRods");
+	//The rods are implicit, so the decimated levels step them over the time they were skipped
+	fuelRodTime += simdt;
+	unsigned int frame = fuelRodFrames++;
+	if (fidelity >= ENGINE_FIDELITY_DECIMATED_RODS && !isDecimationFrame(frame, ENGINE_FUEL_ROD_DECIMATION)) {
+		return;
+	}
+	simdt = fuelRodTime;
+	fuelRodTime = 0.0;
+
+	double power = getThermalPower();
+	double conductance = hardware.coreConductance + hardware.corePropellantConductance;
+	double coolantT = conductance > 0.0 ? tempReactor - power / conductance : tempReactor;
+
+	fuelRods.step(power, coolantT, conductance, simdt);
+	peakFuelTemperature = fuelRods.getPeakCenterlineTemperature();
+	if (peakFuelTemperature >= FUEL_SCRAM_TEMPERATURE) {
+		scram("FUEL_TEMPERATURE");
+	}
+}
+
+int MainEngine::countFidelityLevels() const {
+	return detailedNeutronics || lumpedByFidelity ? ENGINE_FIDELITY_LUMPED_NEUTRONICS + 1 : ENGINE_FIDELITY_DECIMATED_RODS + 1;
+}
+
+void MainEngine::setFidelity(int level) {
+	VesselSystem::setFidelity(level);
+	if (fidelity >= ENGINE_FIDELITY_LUMPED_NEUTRONICS && detailedNeutronics) {
+		setDetailedNeutronics(false);
+		lumpedByFidelity = true;
+	}
+	else if (fidelity < ENGINE_FIDELITY_LUMPED_NEUTRONICS && lumpedByFidelity) {
+		lumpedByFidelity = false;
+		resumeDetailedNeutronics();
+	}
+}
+
+/* Back from the lumped model, the drums stood still meanwhile. They are set to where the servo would have turned them
+ * in the current core state, so the power doesn't jump with the reactivity of stale drums.
+ */
+void MainEngine::resumeDetailedNeutronics() {
+	setDetailedNeutronics(true);
+	if (!detailedNeutronics) {
+		return;
+	}
+	NeutronicsConditions conditions = { drumAngle, tempReactor, propellantFlow.massflow / NTR_RATED_PROPELLANT_FLOW, 1.0 };
+	if (neutronics.get().update(conditions)) {
+		updatePowerShape();
+	}
+	drumAngle = thermalPowerLevel > CONTROLLER_SHUTDOWN_POWER ? neutronics.get().getCriticalDrumAngle() : 0.0;
+	reactivity = neutronics.get().predictReactivity(drumAngle);
+}
+
+bool MainEngine::isDetailedNeutronics() const {
+	return detailedNeutronics;
+}
+
+bool MainEngine::isNeutronicsPending() const {
+	return neutronics.isPending();
+}
+
+const NeutronDiffusion& MainEngine::getNeutronics() const {
+	return neutronics.get();
+}
+
+double MainEngine::getControlDrumAngle() const {
+	return drumAngle;
+}
+
+double MainEngine::getReactivity() const {
+	return reactivity;
+}
+
+double MainEngine::getCriticality() const {
+	return 1.0 / (1.0 - reactivity);
+}
+
+double MainEngine::getPowerPeakingFactor() const {
+	return detailedNeutronics ? neutronics.get().getPeakingFactor() : 1.0;
+}
+
+/*
+* Controller transition table, one row per entry of CONTROLLER_STATES in the same order.
+* Columns: id, mode, advanceMode, next, downmode, dwell, timeout, timeoutMode, timeoutState, timeoutCause, entry, during, guard
+*/
+constexpr MainEngine::ControllerStateDef MainEngine::CONTROLLER_TABLE[] = {
+	//Controller is in standby, reduced power demand, only limited measurements
+	//If neutron detector senses higher than 5E5 flux, raise an alert
+	{ LANTR_MODE_OFF, LANTR_MODE_OFF, LANTR_MODE_ELECTRIC, LANTR_STATE_ACTIVATE_CONTROLLER, LANTR_MODE_OFF,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		&MainEngine::stopTurbomachinery, NULL, NULL },
+	//The startup procedure steps through the following states with their dwell, timeout and guard
+	{ LANTR_STATE_ACTIVATE_CONTROLLER, LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_STATE_CONTROLLER_BITE, LANTR_MODE_OFF,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		&MainEngine::beginStartup, NULL, NULL },
+	{ LANTR_STATE_CONTROLLER_BITE, LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_STATE_NEUTRONDETECTOR_TEST, LANTR_MODE_OFF,
+		5.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, NULL, NULL },
+	//Verify for 3 seconds, that the measured neutron flux never drops below minimum.
+	{ LANTR_STATE_NEUTRONDETECTOR_TEST, LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_STATE_CIRCULATE_COOLANT, LANTR_MODE_OFF,
+		3.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, NULL, NULL },
+	//If the coolant loop does not reach conditions for startup in 60 seconds abort the start
+	{ LANTR_STATE_CIRCULATE_COOLANT, LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_STATE_PREHEAT_CORE, LANTR_MODE_OFF,
+		0.0, 60.0, LANTR_MODE_OFF, LANTR_MODE_OFF, "PRILOOP_FAILURE",
+		NULL, &MainEngine::pressurizeLoop, &MainEngine::loopPressurized },
+	{ LANTR_STATE_PREHEAT_CORE, LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_STATE_ENTER_CRITICALITY, LANTR_STATE_SHUTDOWN_REACTOR,
+		0.0, 300.0, LANTR_MODE_OFF, LANTR_STATE_SHUTDOWN_REACTOR, "PREHEAT_FAILURE",
+		NULL, &MainEngine::preheatCore, &MainEngine::corePreheated },
+	{ LANTR_STATE_ENTER_CRITICALITY, LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_STATE_SHUTDOWN_REACTOR,
+		0.0, 120.0, LANTR_MODE_OFF, LANTR_STATE_SHUTDOWN_REACTOR, "CRITICALITY_FAILURE",
+		NULL, &MainEngine::enterCriticality, &MainEngine::electricPowerReached },
+	{ LANTR_STATE_SHUTDOWN_REACTOR, LANTR_MODE_OFF, LANTR_MODE_OFF, LANTR_MODE_OFF, LANTR_STATE_SHUTDOWN_REACTOR,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, &MainEngine::shutdownReactor, &MainEngine::reactorShutDown },
+	{ LANTR_MODE_ELECTRIC, LANTR_MODE_ELECTRIC, LANTR_MODE_NTR, LANTR_STATE_START_NTR, LANTR_STATE_SHUTDOWN_REACTOR,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, &MainEngine::runElectric, NULL },
+	{ LANTR_STATE_START_NTR, LANTR_MODE_NTR, LANTR_MODE_NTR, LANTR_MODE_NTR, LANTR_STATE_STOP_NTR,
+		0.0, 30.0, LANTR_MODE_ELECTRIC, LANTR_STATE_STOP_NTR, "NTR_START_FAILURE",
+		NULL, &MainEngine::openThroat, &MainEngine::throatOpen },
+	{ LANTR_STATE_STOP_NTR, LANTR_MODE_OFF, LANTR_MODE_OFF, LANTR_MODE_ELECTRIC, LANTR_STATE_STOP_NTR,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, &MainEngine::closeThroat, &MainEngine::throatClosed },
+	{ LANTR_MODE_NTR, LANTR_MODE_NTR, LANTR_MODE_LANTR, LANTR_STATE_START_LANTR, LANTR_STATE_STOP_NTR,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, &MainEngine::runNTR, NULL },
+	//Give the O2 turbopump time to spin up
+	{ LANTR_STATE_START_LANTR, LANTR_MODE_LANTR, LANTR_MODE_LANTR, LANTR_MODE_LANTR, LANTR_STATE_STOP_LANTR,
+		5.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, &MainEngine::runNTR, NULL },
+	{ LANTR_STATE_STOP_LANTR, LANTR_MODE_OFF, LANTR_MODE_OFF, LANTR_MODE_NTR, LANTR_STATE_STOP_LANTR,
+		2.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, &MainEngine::runNTR, NULL },
+	{ LANTR_MODE_LANTR, LANTR_MODE_LANTR, LANTR_MODE_LANTR, LANTR_MODE_LANTR, LANTR_STATE_STOP_LANTR,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		NULL, &MainEngine::runNTR, NULL },
+	//Latched until the crew commands a new target mode
+	{ LANTR_MODE_SCRAM, LANTR_MODE_OFF, LANTR_MODE_OFF, LANTR_MODE_OFF, LANTR_MODE_SCRAM,
+		0.0, 0.0, LANTR_MODE_OFF, LANTR_MODE_OFF, NULL,
+		&MainEngine::enterScram, &MainEngine::shutdownReactor, &MainEngine::throatClosed }
+};
+
+constexpr bool MainEngine::controllerTableValid() {
+	if (sizeof(CONTROLLER_TABLE) / sizeof(CONTROLLER_TABLE[0]) != CONTROLLER_STATE_COUNT) return false;
+	for (unsigned int i = 0; i < CONTROLLER_STATE_COUNT; ++i) {
+		if (CONTROLLER_TABLE[i].id != CONTROLLER_STATES[i].id) return false;
+		if (controllerStateIndex(CONTROLLER_TABLE[i].next) == CONTROLLER_STATE_INVALID) return false;
+		if (controllerStateIndex(CONTROLLER_TABLE[i].downmode) == CONTROLLER_STATE_INVALID) return false;
+		if (controllerStateIndex(CONTROLLER_TABLE[i].timeoutState) == CONTROLLER_STATE_INVALID) return false;
+	}
+	return true;
 }
 
 void MainEngine::doController(double simt, double simdt) {
-	if (timer > 0.0) {
+	static_assert(controllerTableValid(), "Controller table must list all states of CONTROLLER_STATES in the same order, with valid transitions");
+	OH_TRACE_SCOPE("doController");
+	controllerTime = simt;
+	procedures.step(simt);
+
+	unsigned int index = controllerStateIndex(currentMode);
+	if (index == CONTROLLER_STATE_INVALID) {
+		scram("ILLEGAL_FUNCTION");
+		return;
+	}
+	const ControllerStateDef& state = CONTROLLER_TABLE[index];
+
+	if (!functionInit) {
+		functionInit = true;
+		timer = state.dwell;
+		watchdog = state.timeout;
+		if (state.entry != NULL) (this->*state.entry)(simt, simdt);
+	}
+	else {
 		timer = max(0.0, timer - simdt);
+		watchdog = max(0.0, watchdog - simdt);
 	}
 
-	switch (currentMode) {
-	case LANTR_MODE_OFF:
-		//Controller is in standby, reduced power demand, only limited measurements
-		//If neutron detector senses higher than 5E5 flux, raise an alert
-		onTargetGoto(LANTR_MODE_ELECTRIC, LANTR_STATE_ACTIVATE_CONTROLLER);
-		break;
-	case LANTR_STATE_ACTIVATE_CONTROLLER:
-		onTargetGoto(LANTR_MODE_ELECTRIC, LANTR_STATE_CONTROLLER_BITE);
-		break;
-	case LANTR_STATE_CONTROLLER_BITE:
-		initTimer(5.0);
-		initEnd();
-		if(timerDone()) onTargetGoto(LANTR_MODE_ELECTRIC, LANTR_STATE_NEUTRONDETECTOR_TEST);
-		break;
-	case LANTR_STATE_NEUTRONDETECTOR_TEST:
-		//Verify for 3 seconds, that the measured neutron flux never drops below minimum.
-		initTimer(3.0);
-		initEnd();
-		if(timerDone()) onTargetGoto(LANTR_MODE_ELECTRIC, LANTR_STATE_CIRCULATE_COOLANT);
-		break;
-	case LANTR_STATE_CIRCULATE_COOLANT:
-		//Watchdog timer set to 60 seconds
-		initTimer(60.0);
-		initEnd();
-		//Modulate globe valve to raise pressure in loop
-		if (getPrimaryLoopInP() < 0.25E6) {
-			//Open valve to raise pressure (~ 50 kPa/s)
-		}
-		else {
-			//Close valve
+	if (state.during != NULL) (this->*state.during)(simt, simdt);
+
+	if (startup.isRunning()) {
+		if (targetMode < state.mode) {
+			enterState(state.downmode);
 		}
-		//Open ball valves
-		//Start compressor at low power for ventilation
-
-		//If the coolant loop does not reach conditions for startup in 60 seconds abort the start
-		//Downmode to OFF
-		if (timerDone()) downMode("PRILOOP_FAILURE", LANTR_MODE_OFF, LANTR_MODE_OFF);
-		if(getPrimaryLoopInP() > 0.2E6) 
-			onTargetGoto(LANTR_MODE_ELECTRIC, LANTR_STATE_PREHEAT_CORE);
-		//TODO Might leave some loose ends. Goto downmode entry point. 
-		onTargetGoto(LANTR_MODE_OFF, LANTR_MODE_OFF);
-		break;
-	case LANTR_MODE_SCRAM:
-		break;
-	default:
-		scram("ILLEGAL_FUNCTION");
 	}
+	else if (state.timeout > 0.0 && watchdog <= 0.0) {
+		downMode(state.timeoutCause, state.timeoutMode, state.timeoutState);
+	}
+	else if (targetMode < state.mode) {
+		enterState(state.downmode);
+	}
+	else if (modeRequested(state.advanceMode) && timer <= 0.0 && (state.guard == NULL || (this->*state.guard)())) {
+		enterState(state.next);
+	}
+}
+
+/*
+* A mode counts as requested if the target mode is at least that mode. Nothing is requested while the target is SCRAM.
+*/
+bool MainEngine::modeRequested(int mode) const {
+	return targetMode != LANTR_MODE_SCRAM && targetMode >= mode;
+}
+
+void MainEngine::enterState(int state) {
+	if (state == currentMode) {
+		return;
+	}
+	//Transitions of anyone but the startup procedure end it
+	if (!procedures.isResuming()) {
+		startup.cancel();
+	}
+	controllerTrace.push(ControllerTransition{ controllerTime, currentMode, state });
+	functionInit = false;
+	currentMode = state;
+}
+
+const MainEngine::ControllerStateDef& MainEngine::controllerState(int state) const {
+	return CONTROLLER_TABLE[controllerStateIndex(state)];
+}
+
+void MainEngine::beginStartup(double simt, double simdt) {
+	startup = startupProcedure();
+	procedures.start(startup);
+}
+
+Procedure MainEngine::startupProcedure() {
+	enterState(LANTR_STATE_CONTROLLER_BITE);
+	co_await procedures.seconds(controllerState(LANTR_STATE_CONTROLLER_BITE).dwell);
+
+	enterState(LANTR_STATE_NEUTRONDETECTOR_TEST);
+	co_await procedures.seconds(controllerState(LANTR_STATE_NEUTRONDETECTOR_TEST).dwell);
+
+	enterState(LANTR_STATE_CIRCULATE_COOLANT);
+	const ControllerStateDef& circulate = controllerState(LANTR_STATE_CIRCULATE_COOLANT);
+	if (!co_await procedures.until([this] { return loopPressurized(); }, circulate.timeout)) {
+		downMode(circulate.timeoutCause, circulate.timeoutMode, circulate.timeoutState);
+		co_return;
+	}
+
+	enterState(LANTR_STATE_PREHEAT_CORE);
+}
+
+void MainEngine::stopTurbomachinery(double simt, double simdt) {
+	thermalPowerLevel = 0.0;
+	if (!throatValveStuck) {
+		throatValve = 0.0f;
+	}
+	pressurizationValve = 0.0f;
+	tcgaElectricPower = 0.0;
+}
+
+void MainEngine::pressurizeLoop(double simt, double simdt) {
+	//Modulate globe valve to raise pressure in loop (~ 50 kPa/s)
+	pressurizationValve = (measure(getPrimaryLoopInP()) < CONTROLLER_LOOP_PRESSURE) ? 1.0f : 0.0f;
+	//Run the compressor on the generator for ventilation
+	governShaftSpeed(CONTROLLER_VENTILATION_SPEED * tcga.getReferenceSpeed(), simdt);
+}
+
+void MainEngine::preheatCore(double simt, double simdt) {
+	pressurizeLoop(simt, simdt);
+	rampPower(CONTROLLER_PREHEAT_POWER, simdt);
+}
+
+void MainEngine::enterCriticality(double simt, double simdt) {
+	pressurizeLoop(simt, simdt);
+	rampPower(CONTROLLER_ELECTRIC_POWER, simdt);
+}
+
+void MainEngine::runElectric(double simt, double simdt) {
+	pressurizationValve = (measure(getPrimaryLoopInP()) < CONTROLLER_LOOP_PRESSURE) ? 1.0f : 0.0f;
+	governShaftSpeed(tcga.getReferenceSpeed(), simdt);
+	rampPower(CONTROLLER_ELECTRIC_POWER, simdt);
+}
+
+void MainEngine::shutdownReactor(double simt, double simdt) {
+	//Keep the coolant circulating to remove decay heat
+	pressurizationValve = 0.0f;
+	governShaftSpeed(CONTROLLER_VENTILATION_SPEED * tcga.getReferenceSpeed(), simdt);
+	rampThroatValve(0.0f, simdt);
+	rampPower(0.0, simdt);
+}
+
+void MainEngine::openThroat(double simt, double simdt) {
+	rampThroatValve(1.0f, simdt);
+	runNTR(simt, simdt);
+}
+
+void MainEngine::closeThroat(double simt, double simdt) {
+	rampThroatValve(0.0f, simdt);
+	runElectric(simt, simdt);
+}
+
+void MainEngine::runNTR(double simt, double simdt) {
+	pressurizationValve = (measure(getPrimaryLoopInP()) < CONTROLLER_LOOP_PRESSURE) ? 1.0f : 0.0f;
+	governShaftSpeed(tcga.getReferenceSpeed(), simdt);
+	//Hold the chamber at rated temperature for the current propellant flow
+	double propellantPower = throatValve * NTR_RATED_PROPELLANT_FLOW * H2_HEATCAPACITY_PER_MASS * (RATED_PEAK_TEMPERATURE - LH2_TEMPERATURE);
+	rampPower(min(1.0, max(CONTROLLER_ELECTRIC_POWER, propellantPower / RATED_THERMAL_POWER)), simdt);
+}
+
+void MainEngine::enterScram(double simt, double simdt) {
+	//Control drums rotated in, prompt drop of the fission power
+	thermalPowerLevel = 0.0;
+	drumAngle = 0.0;
+}
+
+bool MainEngine::loopPressurized() const {
+	return measure(getPrimaryLoopInP()) > CONTROLLER_MIN_LOOP_PRESSURE;
+}
+
+bool MainEngine::corePreheated() const {
+	return measure(tempReactor) >= CONTROLLER_PREHEAT_TEMPERATURE;
+}
+
+bool MainEngine::electricPowerReached() const {
+	return measure(getFissionPowerLevel()) >= CONTROLLER_ELECTRIC_POWER;
+}
+
+bool MainEngine::reactorShutDown() const {
+	return measure(getFissionPowerLevel()) <= CONTROLLER_SHUTDOWN_POWER && throatValve <= 0.0f;
+}
+
+bool MainEngine::throatOpen() const {
+	return throatValve >= 1.0f;
+}
+
+bool MainEngine::throatClosed() const {
+	return throatValve <= 0.0f;
+}
+
+double MainEngine::measure(double value) const {
+	if (sensorNoise <= 0.0) {
+		return value;
+	}
+	return value * (1.0 + sensorNoise * sensorDistribution(sensorRandom));
+}
+
+void MainEngine::setSensorNoise(double sigma, unsigned int seed) {
+	sensorNoise = max(0.0, sigma);
+	sensorRandom.seed(seed);
+	sensorDistribution.reset();
+}
+
+void MainEngine::rampPower(double target, double simdt) {
+	double step = CONTROLLER_POWER_RAMP * simdt;
+	thermalPowerLevel = (thermalPowerLevel < target) ? min(target, thermalPowerLevel + step) : max(target, thermalPowerLevel - step);
+}
+
+void MainEngine::rampValve(float& valve, float target, double simdt) {
+	float step = (float)(CONTROLLER_VALVE_RAMP * simdt);
+	valve = (valve < target) ? min(target, valve + step) : max(target, valve - step);
+}
+
+void MainEngine::rampThroatValve(float target, double simdt) {
+	if (!throatValveStuck) {
+		rampValve(throatValve, target, simdt);
+	}
+}
+
+/*
+* Proportional shaft speed governor using the TCGA generator as load or motor.
+*/
+void MainEngine::governShaftSpeed(double setpoint, double simdt) {
+	double reference = tcga.getReferenceSpeed();
+	//Limit the gain, so the explicit shaft integration does not overshoot at large time steps
+	double stableGain = 0.5 * tcga.getInertia() * max(shaftSpeed, 0.01 * reference) * reference / max(simdt, 1.0E-6);
+	double gain = min(TCGA_GOVERNOR_GAIN, stableGain);
+	tcgaElectricPower = max(-TCGA_MOTOR_POWER, min(TCGA_RATED_ELECTRIC_POWER, gain * (shaftSpeed - setpoint) / reference));
+}
+
+double MainEngine::getFissionPowerLevel() const {
+	return thermalPowerLevel * fissionPowerFactor;
 }
 
 double MainEngine::getThermalPower() const {
-	return thermalPowerLevel * RATED_THERMAL_POWER;
+	return getFissionPowerLevel() * RATED_THERMAL_POWER;
 }
 
 double MainEngine::getChamberTemperature() const {
-	return 3.0 + thermalPowerLevel * (RATED_PEAK_TEMPERATURE - 3.0);
+	return 3.0 + getFissionPowerLevel() * (RATED_PEAK_TEMPERATURE - 3.0);
 }
 
 void MainEngine::doDecayReactions(double simt, double simdt) {
+	OH_TRACE_SCOPE("doDecayReactions");
 	//Decay elements in fuel pellets and control drums.
 	//(Maybe include other materials in the core later)
 
 }
 
+bool MainEngine::openAnomalyLog(const char* filename) {
+	return anomalyLog.open(filename);
+}
+
+void MainEngine::registerTelemetry(TelemetryRecorder& recorder) {
+	struct {
+		const char* name;
+		GasFlow* flow;
+	} flows[] = {
+		{ "primaryLoop1", &primaryLoop1 },
+		{ "primaryLoop2", &primaryLoop2 },
+		{ "primaryLoop3a", &primaryLoop3a },
+		{ "primaryLoop3b", &primaryLoop3b },
+		{ "primaryLoop4a", &primaryLoop4a },
+		{ "primaryLoop5", &primaryLoop5 },
+		{ "primaryLoop6a", &primaryLoop6a },
+		{ "primaryLoop6b", &primaryLoop6b },
+		{ "primaryLoop7", &primaryLoop7 },
+		{ "primaryLoop8", &primaryLoop8 },
+		{ "primaryLoop9", &primaryLoop9 },
+		{ "primaryLoop10a", &primaryLoop10a },
+		{ "primaryLoop10b", &primaryLoop10b },
+		{ "primaryLoop11", &primaryLoop11 },
+		{ "propellantFlow", &propellantFlow }
+	};
+
+	recorder.addChannel("currentMode", "", &currentMode);
+	recorder.addChannel("targetMode", "", &targetMode);
+	recorder.addChannel("thermalPowerLevel", "", &thermalPowerLevel);
+	recorder.addChannel("tempReactor", "K", &tempReactor);
+	recorder.addChannel("shaftSpeed", "rad/s", &shaftSpeed);
+	recorder.addChannel("h2tpaSpeed", "rad/s", &h2tpaSpeed);
+	recorder.addChannel("o2tpaSpeed", "rad/s", &o2tpaSpeed);
+	recorder.addChannel("tcgaElectricPower", "W", &tcgaElectricPower);
+	recorder.addChannel("primaryLoopMols", "mol", &primaryLoopMols);
+	recorder.addChannel("accuMols", "mol", &accuMols);
+	recorder.addChannel("throatValve", "", &throatValve);
+	recorder.addChannel("TCGA_bypass", "", &TCGA_bypass);
+	recorder.addChannel("H2TPA_bypass", "", &H2TPA_bypass);
+	recorder.addChannel("O2TPA_bypass", "", &O2TPA_bypass);
+	recorder.addChannel("HotLH2_valve", "", &HotLH2_valve);
+	recorder.addChannel("nozzleLH2_valve", "", &nozzleLH2_valve);
+	recorder.addChannel("pressurizationValve", "", &pressurizationValve);
+	recorder.addChannel("electricPumpEnabled", "", &electricPumpEnabled);
+	recorder.addChannel("drumAngle", "deg", &drumAngle);
+	recorder.addChannel("reactivity", "", &reactivity);
+	recorder.addChannel("fissionPowerFactor", "", &fissionPowerFactor);
+	recorder.addChannel("peakFuelTemperature", "K", &peakFuelTemperature);
+
+	for (const auto& it : flows) {
+		string name = it.name;
+		recorder.addChannel((name + ".T").c_str(), "K", &it.flow->T);
+		recorder.addChannel((name + ".P").c_str(), "Pa", &it.flow->P);
+		recorder.addChannel((name + ".massflow").c_str(), "kg/s", &it.flow->massflow);
+	}
+}
+
+void MainEngine::registerTrends(TrendRecorder& recorder) {
+	recorder.addTrend("THERMAL", "kW", [this]() { return getThermalPower() / 1000.0; });
+	recorder.addTrend("FLUX", "", [this]() { return getNeutronFlux(); });
+	recorder.addTrend("TEMP", "K", [this]() { return getChamberTemperature(); });
+	recorder.addTrend("IN P", "kPa", [this]() { return getPrimaryLoopInP() / 1000.0; });
+}
+
 void MainEngine::calculatePrimaryLoop(double simt, double simdt) {
-	//First step: Calculate flow resistance
-	//Assume it to be zero initially.
-	double loopDensity = HEXE_MOLAR_MASS * primaryLoopMols  / PRIMARY_LOOP_VOLUME;
-	//Simplified function: In reality more complicated
-	double totalMassFlow = loopDensity * shaftSpeed * PRIMARY_LOOP_COMP_DIAMETER / HEXE_REFERENCE_RPM;
-	primaryLoop5.massflow = totalMassFlow;
-	primaryLoop5.P = heXeCompressorPressureCoeff(shaftSpeed) * primaryLoop4a.P;
-	primaryLoop5.T = pow(heXeCompressorPressureCoeff(shaftSpeed), HEXE_GAMMA / (HEXE_GAMMA-1.0)) * primaryLoop4a.T;
+	OH_TRACE_SCOPE("calculatePrimaryLoop");
+	stepPrimaryLoop<double>(*this, getActuators(), hardware, simdt);
+}
+
+void MainEngine::calculateTurbopumps(double simt, double simdt) {
+	OH_TRACE_SCOPE("calculateTurbopumps");
+	stepTurbopumps<double>(*this, getActuators(), hardware, simdt);
 }
 
 double MainEngine::getChamberPressure() const {
 	//TODO Implement me
 	return 0.0;
 }
+double MainEngine::getFuelTemperature() const {
+	return tempReactor;
+}
+
+double MainEngine::getPeakFuelTemperature() const {
+	return peakFuelTemperature;
+}
+
+const FuelRodBank& MainEngine::getFuelRods() const {
+	return fuelRods;
+}
+
 double MainEngine::getPrimaryLoopInP() const {
 	return primaryLoop9.P;
 }
@@ -167,9 +711,14 @@ double MainEngine::getPrimaryLoopInletT() const {
 
 
 double MainEngine::getNeutronFlux() const {
-	//Must still get improved a lot
-	//Currently represents prompt neutrons from fuel and neutron source
-	return (2.3 * getThermalPower() / JOULE_PER_FISSION + NEUTRON_SOURCE_FLUX) * DETECTOR_CONSTANT;
+	if (detailedNeutronics) {
+		//Fission neutrons leaking out of core and reflector, and the source neutrons multiplied by the subcritical core
+		double leakage = NEUTRONS_PER_FISSION * getThermalPower() / JOULE_PER_FISSION * neutronics.get().getLeakageFraction();
+		double sourceMultiplication = 1.0 / max(-reactivity, configuration.neutronics.delayedFraction);
+		return (leakage + NEUTRON_SOURCE_FLUX * sourceMultiplication) * DETECTOR_CONSTANT;
+	}
+	//Represents prompt neutrons from fuel and neutron source
+	return (NEUTRONS_PER_FISSION * getThermalPower() / JOULE_PER_FISSION + NEUTRON_SOURCE_FLUX) * DETECTOR_CONSTANT;
 }
 
 void MainEngine::receiveEvent(Event_Base* event, EVENTTOPIC topic) {
@@ -177,6 +726,30 @@ void MainEngine::receiveEvent(Event_Base* event, EVENTTOPIC topic) {
 	if (*event == EVENTTYPE::SIMULATIONSTARTEDEVENT) {
 		Olog::info("Main engine received sim started event!");
 	}
+	else if (*event == EVENTTYPE::STACKCHANGEDEVENT) {
+		// Gimbal the nozzle so the thrust passes through the center of mass of the stack, as far as the gimbal goes
+		VECTOR3 centerOfMass = ((StackChangedEvent*)event)->getCenterOfMass();
+		THRUSTER_HANDLE thrusters[] = { thNTR, thLANTR };
+		for (auto it : thrusters) {
+			VECTOR3 pos;
+			vessel->GetThrusterRef(it, pos);
+			VECTOR3 dir = centerOfMass - pos;
+			if (length(dir) < 1e-6) {
+				continue;
+			}
+			dir = unit(dir);
+			double along = dotp(dir, MAIN_ENGINE_AXIS);
+			if (acos(max(-1.0, min(1.0, along))) > configuration.gimbalRange) {
+				// Tilt the axis toward the center of mass by the full range, straight behind it there is no direction to tilt to
+				VECTOR3 across = dir - MAIN_ENGINE_AXIS * along;
+				if (length(across) < 1e-6) {
+					continue;
+				}
+				dir = MAIN_ENGINE_AXIS * cos(configuration.gimbalRange) + unit(across) * sin(configuration.gimbalRange);
+			}
+			vessel->SetThrusterDir(it, dir);
+		}
+	}
 }
 
 const string MODE_OFF_TEXT = "OFF";
@@ -204,82 +777,92 @@ const string& MainEngine::getModeAsText() const {
 }
 
 
+int MainEngine::getTargetMode() const {
+	return targetMode;
+}
+
 int MainEngine::getCurrentMode() const {
 	return currentMode;
 }
 
+bool MainEngine::getTransition(unsigned int pos, ControllerTransition* entry) const {
+	if (pos < controllerTrace.size()) {
+		*entry = controllerTrace.newest(pos);
+		return true;
+	}
+	return false;
+}
+
+int MainEngine::countTransitions() const {
+	return controllerTrace.size();
+}
+
+double MainEngine::getStateTimeout(int state) {
+	unsigned int index = controllerStateIndex(state);
+	return index != CONTROLLER_STATE_INVALID ? CONTROLLER_TABLE[index].timeout : 0.0;
+}
+
 void MainEngine::setTargetMode(int mode) {
 	//Check that this is a valid mode change
 	//LANTR_MODE_SCRAM is possible anytime
-	functionInit = false;
+	if (mode == LANTR_MODE_SCRAM) {
+		scram();
+		return;
+	}
+	if (mode != LANTR_MODE_OFF && mode != LANTR_MODE_ELECTRIC && mode != LANTR_MODE_NTR && mode != LANTR_MODE_LANTR) {
+		return;
+	}
+	//The controller table takes care of getting there
 	targetMode = mode;
 }
 
-void MainEngine::scram(char* cause) {
+void MainEngine::setThroatValveStuck(bool stuck) {
+	throatValveStuck = stuck;
+}
+
+bool MainEngine::isThroatValveStuck() const {
+	return throatValveStuck;
+}
+
+void MainEngine::scram(const char* cause) {
 	if (targetMode != LANTR_MODE_SCRAM) {
-		functionInit = false;
 		targetMode = LANTR_MODE_SCRAM;
-		currentMode = LANTR_MODE_SCRAM;
-		logAnomaly('X', cause);
+		enterState(LANTR_MODE_SCRAM);
+		logAnomaly(ANOMALY_SCRAM, cause);
 	}
 }
 
-void MainEngine::downMode(char* cause, int newMode, int entryPoint) {
-	functionInit = false;
+void MainEngine::downMode(const char* cause, int newMode, int entryPoint) {
+	if (!procedures.isResuming()) {
+		startup.cancel();
+	}
 	targetMode = newMode;
+	controllerTrace.push(ControllerTransition{ controllerTime, currentMode, entryPoint });
+	functionInit = false;
 	currentMode = entryPoint;
-	logAnomaly('E', cause);
+	logAnomaly(ANOMALY_ERROR, cause);
 }
 
-void MainEngine::onTargetGoto(int targetMode, int nextFunction) {
-	if (targetMode == this->targetMode) {
-		functionInit = false;
-		currentMode = nextFunction;
-	}
-}
-
-void MainEngine::logAnomaly(char type, char* cause) {
-	REACTOR_ERROR_TYPE newAnomaly;
-	newAnomaly.type = type;
-	newAnomaly.mjd = oapiGetSimMJD();
-	newAnomaly.confirmed = false;
-	strncpy(newAnomaly.cause, cause, 39);
-	errorLog.insert(errorLog.begin(), newAnomaly);
+void MainEngine::logAnomaly(char type, const char* cause) {
+	anomalyLog.log(type, cause, oapiGetSimMJD());
 }
 
 bool MainEngine::getError(unsigned int pos, REACTOR_ERROR_TYPE* entry) const {
-	if (pos < errorLog.size()) {
-		*entry = errorLog.at(pos);
-		return true;
-	}
-	else {
-		return false;
-	}
+	return anomalyLog.get(pos, entry);
 }
 
 int MainEngine::countErrors() const {
-	return errorLog.size();
+	return anomalyLog.count();
 }
 
-double MainEngine::heXeCompressorPressureCoeff(double shaftSpeed) const {
-	return 2.9 * shaftSpeed / HEXE_REFERENCE_RPM;
+int MainEngine::countUnconfirmedErrors() const {
+	return anomalyLog.countUnconfirmed();
 }
 
-/*
-* Only steady state right now, no inertia by structural parts/walls
-*/
-void MainEngine::doHeatTransfer(double eff, GasFlow& flow1, GasFlow& flow2, double simdt) {
-	double c1 = flow1.massflow * flow1.heatcap;
-	double c2 = flow2.massflow * flow2.heatcap;
-	double T1 = c1 * flow1.T;
-	double T2 = c2 * flow2.T;
-
-	double dT = T1 - T2;
-
-	T1 = T1 - 0.5 * dT * eff;
-	T2 = T2 + 0.5 * dT * eff;
-
-	flow1.T = T1 / c1;
-	flow2.T = T2 / c2;
+unsigned int MainEngine::countErrorChanges() const {
+	return anomalyLog.countChanges();
+}
 
-}
\ No newline at end of file
+void MainEngine::confirmErrors() {
+	anomalyLog.confirmAll();
+}
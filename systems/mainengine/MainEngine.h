@@ -3,28 +3,32 @@
 using namespace std;
 
 #include <cmath>
+#include <random>
 #include "model/ThrusterConfig.h"
 #include "systems/VesselSystem.h"
 #include "event/Events.h"
+#include "core/FixedRingBuffer.h"
+#include "core/JobSystem.h"
+#include "core/Procedure.h"
+#include "GasFlow.h"
+#include "Turbomachine.h"
+#include "EngineState.h"
+#include "NeutronDiffusion.h"
+#include "FuelRods.h"
+#include "ControllerStates.h"
+#include "AnomalyLog.h"
 
 const double RPM = 2.0 * PI / 60.0;
 
-const int LANTR_MODE_OFF		= 0;
-const int LANTR_MODE_ELECTRIC	= 100;
-const int LANTR_MODE_NTR		= 200;
-const int LANTR_MODE_LANTR		= 300;
-const int LANTR_MODE_SCRAM		= 1000;
-
-const int LANTR_STATE_ACTIVATE_CONTROLLER = 51;
-const int LANTR_STATE_CONTROLLER_BITE = 52;
-const int LANTR_STATE_NEUTRONDETECTOR_TEST = 53;
-const int LANTR_STATE_CIRCULATE_COOLANT = 60;
-const int LANTR_STATE_PREHEAT_CORE = 70;
-const int LANTR_STATE_ENTER_CRITICALITY = 90;
-
 const double RATED_THERMAL_POWER = 555.0E6;
 const double RATED_PEAK_TEMPERATURE = 2700.0;
 
+//U2C3 fuel decomposes into UC and UC2 above 1800C and melts at 2500C
+const double FUEL_DECOMPOSITION_TEMPERATURE = 2073.0;
+const double FUEL_MELTING_TEMPERATURE = 2773.0;
+//Fuel centerline temperature that trips a scram, with margin to melting
+const double FUEL_SCRAM_TEMPERATURE = FUEL_MELTING_TEMPERATURE - 100.0;
+
 const double HEXE_MOLAR_MASS = 40.0;
 //Assumption: Monoatomic gas
 const double HEXE_GAMMA = 5.0 / 3.0;
@@ -35,6 +39,28 @@ const double HEXE_HEATCAPACITY_PER_MASS = 14304.0;
 
 const double HEXE_REFERENCE_RPM = 53000.0 * RPM;
 
+const double UNIVERSAL_GAS_CONSTANT = 8.314;
+
+//Properties of the propellants at the turbopump inlets
+const double H2_GAMMA = 1.4;
+const double H2_HEATCAPACITY_PER_MASS = 14304.0;
+const double LH2_DENSITY = 70.85;
+const double LH2_TEMPERATURE = 20.3;
+const double LO2_DENSITY = 1141.0;
+const double LO2_HEATCAPACITY_PER_MASS = 1700.0;
+const double LO2_TEMPERATURE = 90.2;
+const double PROPELLANT_FEED_PRESSURE = 0.2E6;
+
+//Hydrogen flow through the reactor at full thrust in kg/s
+const double NTR_RATED_PROPELLANT_FLOW = 67000.0 / 9221.0;
+const double LANTR_MIXTURE_RATIO = 3.0;
+//Thrust direction of the nozzle at rest, the gimbal turns it by up to LANTRConfig::gimbalRange
+const VECTOR3 MAIN_ENGINE_AXIS = { 0, 0, 1 };
+/* Expander cycle: Fraction of the chamber temperature the turbopump drive gas reaches
+ * after cooling the nozzle and reactor structure.
+ */
+const double TPA_DRIVE_GAS_TEMPERATURE_FRACTION = 0.2;
+
 /* Maximum pressure at which the Brayton cycle hardware operates. 
  * At higher chamber pressure, the valves are closed and the Brayton cycle powered only 
  * by the heated LH2 from the gamma shield recuperator. 
@@ -45,6 +71,8 @@ const double LANTR_BRAYTON_CYCLE_MAX_PRESSURE = 1.0E6;
  * Can be used for calculating the neutron flux based on a set power level
  */
 const double JOULE_PER_FISSION = 3.2E-11;
+//Prompt neutrons released per fission event
+const double NEUTRONS_PER_FISSION = 2.3;
 const double DETECTOR_SIZE = pow(0.01, 2);
 //Distance from Reactor core center to detector
 const double DETECTOR_DISTANCE = 2.5;
@@ -56,25 +84,67 @@ const double NEUTRON_SOURCE_FLUX = 5.0E9;
 const double PRIMARY_LOOP_VOLUME = 2.0;
 //Primary loop compressor diameter - 13 cm in reference model.
 const double PRIMARY_LOOP_COMP_DIAMETER = 0.13;
+//Coolant inventory of the evacuated loop before startup
+const double PRIMARY_LOOP_INITIAL_MOLS = 50.0;
+const double PRIMARY_LOOP_INITIAL_TEMPERATURE = 250.0;
+//Coolant inventory of the accumulator before startup
+const double ACCUMULATOR_INITIAL_MOLS = 400.0;
+//Heat capacity of the fuel elements in J/K
+const double CORE_HEAT_CAPACITY = 6.0E5;
+//Wetted surface of the fuel elements in the primary loop channels
+const double CORE_HEAT_TRANSFER_AREA = 50.0;
+const double RADIATOR_HEAT_TRANSFER_AREA = 200.0;
+const double RADIATOR_SINK_TEMPERATURE = 250.0;
+//Wetted surface of the fuel elements in the propellant channels
+const double CORE_PROPELLANT_HEAT_TRANSFER_AREA = 400.0;
+//Maximum flow through the pressurization globe valve in mol/s, about 50 kPa/s in the cold loop
+const double PRESSURIZATION_VALVE_FLOW = 48.0;
+
+//Loop pressure the controller holds while circulating coolant
+const double CONTROLLER_LOOP_PRESSURE = 0.25E6;
+//Minimum loop pressure for starting the reactor
+const double CONTROLLER_MIN_LOOP_PRESSURE = 0.2E6;
+//TCGA speed while ventilating the loop on the motor, fraction of reference speed
+const double CONTROLLER_VENTILATION_SPEED = 0.3;
+//Thermal power level while heating the core with source neutrons
+const double CONTROLLER_PREHEAT_POWER = 0.01;
+const double CONTROLLER_PREHEAT_TEMPERATURE = 400.0;
+//Thermal power level in electric mode
+const double CONTROLLER_ELECTRIC_POWER = 0.02;
+//Thermal power below which the reactor counts as shut down
+const double CONTROLLER_SHUTDOWN_POWER = 1.0E-4;
+//Power ramp rate in fractions of rated power per second
+const double CONTROLLER_POWER_RAMP = 0.02;
+//Valve travel per second
+const double CONTROLLER_VALVE_RAMP = 0.2;
+
+/* Maximum power the TCGA generator can drive the shaft with as motor in W.
+ */
+const double TCGA_MOTOR_POWER = 2.0E5;
+const double TCGA_RATED_ELECTRIC_POWER = 2.0E6;
+//Generator load per unit of relative shaft speed error in W
+const double TCGA_GOVERNOR_GAIN = 5.0E7;
+
+//Number of controller state transitions kept for diagnostics
+const unsigned int CONTROLLER_TRACE_SIZE = 32;
+
+//Fidelity levels: fuel rods stepped every ENGINE_FUEL_ROD_DECIMATION steps, then lumped neutronics as well
+const int ENGINE_FIDELITY_FULL = 0;
+const int ENGINE_FIDELITY_DECIMATED_RODS = 1;
+const int ENGINE_FIDELITY_LUMPED_NEUTRONICS = 2;
+const int ENGINE_FUEL_ROD_DECIMATION = 4;
+//Time constant in s in which a subcritical core taken over by the lumped model eases to critical, about the pace of the drum servo
+const double ENGINE_LUMPED_CRITICALITY_TIME = 5.0;
 
 class OrbitalHauler;
-
-struct REACTOR_ERROR_TYPE {
-	char type;
-	bool confirmed;
-	double mjd;
-	char cause[40];
-};
-
-struct GasFlow {
-	//specific heat capacity
-	double heatcap;
-	//Temperature
-	double T;
-	//Pressure
-	double P;		
-	//Mass flow (kg/s)
-	double massflow;
+class TelemetryRecorder;
+class TrendRecorder;
+template <unsigned int LANES> class MainEngineBatch;
+
+struct ControllerTransition {
+	double simt;
+	int from;
+	int to;
 };
 
 /* Implementation of a LANTR type main engine
@@ -112,10 +182,15 @@ struct GasFlow {
  * Simplification: We control Reactor power directly (assuming a fast computer controls the power based on neutron flux), burnup is linear to reactor power.
  * In this case, we could ignore most of the neutronics (neutron flux is proportional to power level), the changing composition of the fuel could be derived from the burn up, 
  * Iodide and Xenon could be estimated from the power level. Xenon level would then just scale the speed how fast power can ramp up.
+ *
+ * The flows, temperatures and shaft speeds are in EngineCoreState and integrated by the kernel in EngineKernel.h,
+ * which a MainEngineBatch also runs for several engines at once.
  */
 class MainEngine :
-    public VesselSystem
+    public VesselSystem, protected EngineCoreState<double>
 {
+	template <unsigned int LANES> friend class MainEngineBatch;
+
 	/* Operation mode for the engine controller, commanded by crew or ship AI
 	 * LANTR_MODE_OFF		Engine cold, fully shut down (nuclear refueling)
 	 * LANTR_MODE_ELECTRIC	Reactor providing electrical power only. Constant TCGA shaft speed.
@@ -138,6 +213,8 @@ class MainEngine :
 	 * 1.0 fully opened, full thrust as by chamber pressure/nozzle function
 	 */
 	float throatValve;
+	//Failed valve, holds its position whatever the controller commands
+	bool throatValveStuck;
 	/* Bypass valve position for the turbo-compressor/generator assembly. Controlled by engine controller.
 	 * 0.0f = fully closed
 	 * 1.0f = fully opened
@@ -172,47 +249,55 @@ class MainEngine :
 	/* Temperature of the reactor hardware (control drum drives, valves)
 	 */
 	double tempReactorHW;
-	/* Temperature of the reactor fuel rods
-	 */
-	double tempReactor;
 	/* Temperature of the gamma shield. Heated by engine radiation (IR, neutron flux)
 	 */
 	double tempGammaShield;
 
-	//From reactor to NTR mode heat exchanger
-	GasFlow primaryLoop1;
-	//From NTR mode heat exchanger to turbine bypass valve
-	GasFlow primaryLoop2; 
-	//From turbine bypass to turbine
-	GasFlow primaryLoop3a;
-	//From turbine bypass to turbine mixer
-	GasFlow primaryLoop3b;
-	//From turbine to turbine mixer
-	GasFlow primaryLoop4a;
-	//From turbine mixer to radiator bypass valve
-	GasFlow primaryLoop5;
-	//From radiator bypass to radiator
-	GasFlow primaryLoop6a;
-	//From radiatior bypass to radiator mixer
-	GasFlow primaryLoop6b;
-	//From radiator to radiator mixer
-	GasFlow primaryLoop7;
-	//From radiator mixer to compressor
-	GasFlow primaryLoop8;
-	//From compressor to junction
-	GasFlow primaryLoop9;
-	//From junction to compressor
-	GasFlow primaryLoop10a;
-	//From junction to accu charger checkvalve
-	GasFlow primaryLoop10b;
-	//From pressurization globe valve to radiator mixer
-	GasFlow primaryLoop11;
-	//Content of the Accumulator in mols (40g / mol -  400 mol in accu at startup)
-	double accuMols;
-
-	double primaryLoopMols;
-
-	double shaftSpeed; // (rad / s)
+	/* Globe valve between accumulator and primary loop. Controlled by engine controller.
+	 * 0.0f = fully closed
+	 * 1.0f = fully opened
+	 */
+	float pressurizationValve;
+	/* Electrical power taken from the TCGA shaft by the generator in W.
+	 * Negative while the generator is used as motor for starting the compressor.
+	 */
+	double tcgaElectricPower;
+
+	Turbomachine tcga;
+	Turbomachine h2tpa;
+	Turbomachine o2tpa;
+	//The turbomachines and heat transfer coefficients as the kernel uses them
+	EngineHardware<double> hardware;
+	//Set while a MainEngineBatch steps the physics of this engine
+	bool batched;
+
+	/* Multi-group diffusion solution of the core, only used with detailed neutronics.
+	 */
+	BackgroundResult<NeutronDiffusion> neutronics;
+	//Job system the diffusion is solved on, NULL to solve within the step
+	JobSystem* jobs;
+	bool detailedNeutronics;
+	/* Control drum rotation in deg, turned by the drum servo with detailed neutronics.
+	 * 0.0 absorbers facing the core, 180.0 reflectors facing the core
+	 */
+	double drumAngle;
+	//Reactivity of the core at the current drum angle
+	double reactivity;
+	/* Fission power relative to the power level the controller demands.
+	 * 1.0 while the drums hold the core critical, lower while the core is subcritical.
+	 */
+	double fissionPowerFactor;
+
+	/* Radial temperature profiles of representative fuel rods, with the power shape of the neutronics.
+	 */
+	FuelRodBank fuelRods;
+	//Hottest fuel centerline temperature of the last step in K
+	double peakFuelTemperature;
+	//Steps of the engine, and time the fuel rods were not stepped for at the decimated fidelity levels
+	unsigned int fuelRodFrames;
+	double fuelRodTime;
+	//Set while the governor replaced the configured detailed neutronics by the lumped model
+	bool lumpedByFidelity;
 
 	/* Number of absorbed neutrons in this timestep
 	 */
@@ -229,48 +314,158 @@ class MainEngine :
 
 	const LANTRConfig &configuration;
 
-	vector<REACTOR_ERROR_TYPE> errorLog;
+	AnomalyLog anomalyLog;
 
-	bool functionInit;
+	/* Relative standard deviation of the measurements the controller acts on, 0.0 for ideal sensors.
+	 */
+	double sensorNoise;
+	mutable std::mt19937 sensorRandom;
+	mutable std::normal_distribution<double> sensorDistribution;
+
+	typedef void (MainEngine::*ControllerAction)(double simt, double simdt);
+	typedef bool (MainEngine::*ControllerGuard)() const;
+
+	/* One row of the controller transition table.
+	 * Every step, the controller runs the during action of the current state. Once the dwell time has passed
+	 * and the guard holds, it advances to next, as long as the target mode is at least advanceMode.
+	 * If the target mode drops below mode, the controller goes to downmode instead.
+	 * If the watchdog expires first, the controller downmodes to timeoutMode / timeoutState and logs timeoutCause.
+	 */
+	struct ControllerStateDef {
+		int id;
+		int mode;
+		int advanceMode;
+		int next;
+		int downmode;
+		//Minimum time in the state in seconds
+		double dwell;
+		//Watchdog in seconds, 0.0 for none
+		double timeout;
+		int timeoutMode;
+		int timeoutState;
+		const char* timeoutCause;
+		ControllerAction entry;
+		ControllerAction during;
+		ControllerGuard guard;
+	};
+
+	/* Transition table of the controller, in the order of CONTROLLER_STATES.
+	 */
+	static const ControllerStateDef CONTROLLER_TABLE[];
+	static constexpr bool controllerTableValid();
 
+	//False until the entry action of the current state has run
+	bool functionInit;
+	//Remaining dwell time of the current state
 	double timer;
-
-	inline void initTimer(double delay) {
-		if (delay <= 0.0)
-			return;
-
-		if (!functionInit) {
-			timer = delay;
-		}
-	}
-
-	inline bool timerDone() {
-		return (timer == 0.0);
-	}
-	
-	inline void initEnd() {
-		if(!functionInit)
-			functionInit = true;
-	}
-
-	void onTargetGoto(int targetMode, int nextFunction);
-
-	double heXeCompressorPressureCoeff(double shaftSpeed) const;
-
-
-	void doHeatTransfer(double eff, GasFlow& side1, GasFlow& side2, double simdt);
+	//Remaining watchdog time of the current state
+	double watchdog;
+	//Sim time of the last controller step
+	double controllerTime;
+	//Resumed at the beginning of every controller step
+	ProcedureScheduler procedures;
+	/* Sequences the startup from the controller BITE to the core preheat, while it runs the table only downmodes.
+	 */
+	Procedure startup;
+
+	FixedRingBuffer<ControllerTransition, CONTROLLER_TRACE_SIZE> controllerTrace;
+
+	bool modeRequested(int mode) const;
+	void enterState(int state);
+
+	//Controller entry and during actions
+	void stopTurbomachinery(double simt, double simdt);
+	void pressurizeLoop(double simt, double simdt);
+	void preheatCore(double simt, double simdt);
+	void enterCriticality(double simt, double simdt);
+	void runElectric(double simt, double simdt);
+	void shutdownReactor(double simt, double simdt);
+	void openThroat(double simt, double simdt);
+	void closeThroat(double simt, double simdt);
+	void runNTR(double simt, double simdt);
+	void enterScram(double simt, double simdt);
+	void beginStartup(double simt, double simdt);
+
+	Procedure startupProcedure();
+	const ControllerStateDef& controllerState(int state) const;
+
+	//Controller guards
+	bool loopPressurized() const;
+	bool corePreheated() const;
+	bool electricPowerReached() const;
+	bool reactorShutDown() const;
+	bool throatOpen() const;
+	bool throatClosed() const;
+
+	//Reading of a sensor the controller acts on
+	double measure(double value) const;
+
+	void rampPower(double target, double simdt);
+	void rampValve(float& valve, float target, double simdt);
+	void rampThroatValve(float target, double simdt);
+	void governShaftSpeed(double setpoint, double simdt);
+
+	//Fission power in fractions of rated power
+	double getFissionPowerLevel() const;
+	EngineActuators<double> getActuators() const;
+	void updatePowerShape();
+	void calculateFuelRods(double simdt);
+	void resumeDetailedNeutronics();
 public:
 	MainEngine(OrbitalHauler *vessel, const LANTRConfig &config, PROPELLANT_HANDLE phLH2, PROPELLANT_HANDLE phLO2);
 	~MainEngine();
 
 	void init(EventBroker& eventBroker);
 
+	/* Adds the flows, shaft speeds, valve positions and controller modes of the engine as telemetry channels.
+	 */
+	void registerTelemetry(TelemetryRecorder& recorder);
+	/* Adds thermal power, neutron flux, chamber temperature and loop pressure as trends for the MFD plots.
+	 */
+	void registerTrends(TrendRecorder& recorder);
+
+	/* Keeps the anomaly log in a file, so it survives crashes and is restored on the next session.
+	 */
+	bool openAnomalyLog(const char* filename);
+
+	/* Adds gaussian noise with the given relative standard deviation to every measurement the controller acts on.
+	 * Used to check the robustness of the controller, 0.0 restores ideal sensors.
+	 */
+	void setSensorNoise(double sigma, unsigned int seed);
+
+	/* Solves the core neutronics with multi-group diffusion, see NeutronDiffusion. The control drums then follow
+	 * the critical drum angle and the fission power drops below the demand while the core is subcritical.
+	 * Without, the core is critical and the neutron flux proportional to the power, a core that was subcritical eases to critical.
+	 */
+	void setDetailedNeutronics(bool detailed);
+	bool isDetailedNeutronics() const;
+	//Whether a solution of the neutronics is being computed on the job system
+	bool isNeutronicsPending() const;
+	const NeutronDiffusion& getNeutronics() const;
+	/* Control drum rotation in deg.
+	 * 0.0 absorbers facing the core
+	 * 180.0 reflectors facing the core
+	 */
+	double getControlDrumAngle() const;
+	/* Reactivity (k - 1) / k of the core. Without detailed neutronics it eases to 0.0 from the last detailed value.
+	 */
+	double getReactivity() const;
+	/* Peak to average power density in the fuel, 1.0 without detailed neutronics.
+	 */
+	double getPowerPeakingFactor() const;
+
 	/*
 	 * calculations based on reactor state
 	 * @sa VesselSystem::preStep 
 	 */
 	virtual void preStep(double simt, double simdt, double mjd);
 
+	/* Full, fuel rods decimated, and lumped neutronics if detailed neutronics are on.
+	 * @sa VesselSystem::setFidelity
+	 */
+	virtual int countFidelityLevels() const;
+	virtual void setFidelity(int level);
+
 	/**
 	* Get the thermal power of the reactor in Watt. 
 	* 
@@ -307,21 +502,48 @@ public:
 	double getPrimaryLoopInP() const;
 	double getPrimaryLoopOutletT() const;
 	double getPrimaryLoopInletT() const;
+	/* Temperature of the reactor fuel rods in K.
+	 */
+	double getFuelTemperature() const;
+	/* Hottest fuel centerline temperature of all fuel rod channels in K.
+	 * Compare with FUEL_DECOMPOSITION_TEMPERATURE and FUEL_MELTING_TEMPERATURE.
+	 */
+	double getPeakFuelTemperature() const;
+	const FuelRodBank& getFuelRods() const;
 
 	const string& getModeAsText() const;
 
+	int getTargetMode() const;
 	int getCurrentMode() const;
 
+	/* Read the controller transition trace. Position 0 is the most recent transition.
+	 */
+	bool getTransition(unsigned int pos, ControllerTransition* entry) const;
+	int countTransitions() const;
+	/* Watchdog of a controller state in seconds, 0.0 if the state has none.
+	 */
+	static double getStateTimeout(int state);
+
 	void setTargetMode(int mode);
+	/* Fault injection: a stuck throat valve stays where it is until it is freed again.
+	 */
+	void setThroatValveStuck(bool stuck);
+	bool isThroatValveStuck() const;
 
-	void scram(char* cause = "USER");
-	void downMode(char* cause, int newmode, int entryPoint);
+	void scram(const char* cause = "USER");
+	void downMode(const char* cause, int newmode, int entryPoint);
 
-	void logAnomaly(char type, char* cause);
+	void logAnomaly(char type, const char* cause);
 
 	bool getError(unsigned int pos, REACTOR_ERROR_TYPE* entry) const;
 
 	int countErrors() const;
+	int countUnconfirmedErrors() const;
+	//Changes of the anomaly log, see AnomalyLog::countChanges
+	unsigned int countErrorChanges() const;
+	/* Acknowledges all anomalies in the log.
+	 */
+	void confirmErrors();
 protected:
 	virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
 	void createDefaultPropellantLoad();
@@ -330,6 +552,7 @@ protected:
 	void doDecayReactions(double simt, double simdt);
 	void doController(double simt, double simdt);
 	void calculatePrimaryLoop(double simt, double simdt);
+	void calculateTurbopumps(double simt, double simdt);
 	
 };
 
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "EngineKernel.h"
+
+/**
+ * \brief Steps the physics of up to LANES main engines in lock-step, one engine per SIMD lane.
+ *
+ * For fleets of tugs and ensemble runs, where many engines advance by the same time step. The state of the
+ * attached engines lives here as structure of arrays, so the kernel in EngineKernel.h runs once for all lanes
+ * instead of once per engine. 4 lanes fill an AVX2 register, 8 an AVX-512 register, 16 give the core more
+ * independent work to overlap the latency of exp and pow.
+ *
+ * The controllers stay scalar: every engine runs its own controller first, and its outputs are gathered into the
+ * actuator lanes. Engines in different modes only differ in those values and in masks, so the kernel does not
+ * branch per lane. After the step, the state of every lane is copied back into its engine, so getters, telemetry
+ * and the controller see the same values as if the engine had stepped itself.
+ *
+ * Every lane may have its own configuration. Free lanes are stepped with a cold engine and no hardware.
+ */
+template <unsigned int LANES>
+class MainEngineBatch {
+public:
+	typedef Lanes<LANES> Real;
+
+	MainEngineBatch() : count(0) {
+		resetCoreState(cold);
+		for (unsigned int i = 0; i < LANES; ++i) {
+			engines[i] = NULL;
+			freeLane(i);
+		}
+	}
+
+	~MainEngineBatch() {
+		for (unsigned int i = 0; i < LANES; ++i) {
+			if (engines[i] != NULL) {
+				detach(engines[i]);
+			}
+		}
+	}
+
+	/* Moves an initialized engine into a free lane. From now on, preStep() of the engine does nothing
+	 * and the batch steps it. Returns false if all lanes are taken.
+	 */
+	bool attach(MainEngine* engine) {
+		for (unsigned int i = 0; i < LANES; ++i) {
+			if (engines[i] == NULL) {
+				engines[i] = engine;
+				engine->batched = true;
+				load(i, *engine);
+				hardware.bind(i, &engine->configuration, &engine->tcga, &engine->h2tpa, &engine->o2tpa);
+				count++;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* The engine steps itself again, with the state it had after the last step of the batch.
+	 */
+	void detach(MainEngine* engine) {
+		for (unsigned int i = 0; i < LANES; ++i) {
+			if (engines[i] == engine) {
+				engine->batched = false;
+				engines[i] = NULL;
+				freeLane(i);
+				count--;
+				return;
+			}
+		}
+	}
+
+	unsigned int size() const {
+		return count;
+	}
+
+	unsigned int capacity() const {
+		return LANES;
+	}
+
+	/* Runs the controllers of all engines, then the kernel for all lanes at once.
+	 * Same order as MainEngine::preStep.
+	 */
+	void preStep(double simt, double simdt, double mjd) {
+		for (unsigned int i = 0; i < LANES; ++i) {
+			MainEngine* engine = engines[i];
+			if (engine == NULL) {
+				continue;
+			}
+			engine->doController(simt, simdt);
+			engine->doAbsorptionReactions(simt, simdt);
+			engine->doDecayReactions(simt, simdt);
+			setActuators(i, engine->getActuators());
+		}
+
+		stepTurbopumps(state, actuators, hardware, simdt);
+		stepPrimaryLoop(state, actuators, hardware, simdt);
+
+		for (unsigned int i = 0; i < LANES; ++i) {
+			MainEngine* engine = engines[i];
+			if (engine == NULL) {
+				continue;
+			}
+			store(i, *engine);
+			engine->calculateFuelRods(simdt);
+		}
+	}
+
+private:
+	MainEngine* engines[LANES];
+	unsigned int count;
+
+	EngineCoreState<Real> state;
+	EngineActuators<Real> actuators;
+	EngineHardware<Real> hardware;
+	//State of a free lane
+	EngineCoreState<double> cold;
+
+	void load(unsigned int i, const EngineCoreState<double>& engine) {
+		forEachCoreValue(state, engine, [i](Real& lanes, const double& value) { lanes[i] = value; });
+	}
+
+	void store(unsigned int i, EngineCoreState<double>& engine) const {
+		forEachCoreValue(state, engine, [i](const Real& lanes, double& value) { value = lanes[i]; });
+	}
+
+	void setActuators(unsigned int i, const EngineActuators<double>& engine) {
+		actuators.thermalPowerLevel[i] = engine.thermalPowerLevel;
+		actuators.throatValve[i] = engine.throatValve;
+		actuators.tcgaBypass[i] = engine.tcgaBypass;
+		actuators.h2tpaBypass[i] = engine.h2tpaBypass;
+		actuators.o2tpaBypass[i] = engine.o2tpaBypass;
+		actuators.pressurizationValve[i] = engine.pressurizationValve;
+		actuators.tcgaElectricPower[i] = engine.tcgaElectricPower;
+		actuators.oxygenInjection[i] = engine.oxygenInjection;
+	}
+
+	void freeLane(unsigned int i) {
+		load(i, cold);
+		hardware.bind(i, NULL, NULL, NULL, NULL);
+		setActuators(i, EngineActuators<double>{ 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, false });
+	}
+};
@@ -0,0 +1,554 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/NeutronicsConfig.h"
+#include "core/Trace.h"
+
+#include "NeutronDiffusion.h"
+
+//Linear extrapolation distance of the flux beyond a vacuum boundary, in units of the diffusion coefficient
+const double DIFFUSION_EXTRAPOLATION_DISTANCE = 2.13;
+//SOR sweeps per group and outer iteration
+const int DIFFUSION_INNER_SWEEPS = 3;
+//Moderator density for calibrating the drum worth, rated propellant flow
+const double DIFFUSION_CALIBRATION_MODERATOR = 1.0;
+
+
+NeutronDiffusion::NeutronDiffusion() {
+	absorptionEffect = 1.0;
+	initialized = false;
+	groups = 0;
+	nr = 0;
+	nz = 0;
+	fuelCells = 0;
+	half = 0;
+	stride = 0;
+	dr = 1.0;
+	dz = 1.0;
+	conditions = NeutronicsConditions{ 0.0, 0.0, 0.0, 0.0 };
+	multiplication = 1.0;
+	drumWorth = 0.0;
+	peakingFactor = 1.0;
+	leakageFraction = 0.0;
+	iterations = 0;
+	converged = false;
+	sweepGeneration = 0;
+	sweepGroup = 0;
+	sweepColor = 0;
+	sweepPending = 0;
+	stopping = false;
+}
+
+NeutronDiffusion::~NeutronDiffusion() {
+	stopWorkers();
+}
+
+static bool validCrossSections(const CrossSectionConfig& material, size_t groups, bool fissile) {
+	if (material.diffusion.size() != groups || material.absorption.size() != groups || material.scattering.size() != groups) {
+		return false;
+	}
+	if (fissile && (material.nuFission.size() != groups || material.chi.size() != groups)) {
+		return false;
+	}
+	for (size_t g = 0; g < groups; ++g) {
+		if (material.diffusion[g] <= 0.0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool NeutronDiffusion::init(const NeutronicsConfig& config, double absorption) {
+	stopWorkers();
+	initialized = false;
+
+	size_t count = config.core.diffusion.size();
+	if (count == 0 || !validCrossSections(config.core, count, true) || !validCrossSections(config.reflector, count, false) ||
+		config.drumAbsorption.size() != count) {
+		Olog::error("Neutronics: cross sections need one value per group for every material");
+		return false;
+	}
+	if (config.radialCells < 4 || config.radialCells % 2 != 0 || config.axialCells < 2) {
+		Olog::error("Neutronics: radial cells must be even and at least 4, axial cells at least 2");
+		return false;
+	}
+
+	this->config = config;
+	absorptionEffect = absorption;
+	groups = (int)count;
+	buildMesh();
+
+	stopping = false;
+	for (int i = 1; i < config.threads; ++i) {
+		workers.push_back(std::thread(&NeutronDiffusion::runWorker, this, i, sweepGeneration));
+	}
+
+	//Drum worth with fresh fuel at the cross section temperature
+	NeutronicsConditions reference = { 0.0, config.referenceTemperature, DIFFUSION_CALIBRATION_MODERATOR, 1.0 };
+	solve(reference);
+	double drumsIn = getReactivity();
+	reference.drumAngle = 180.0;
+	solve(reference);
+	drumWorth = getReactivity() - drumsIn;
+	initialized = true;
+
+	Olog::info("Neutronics: %dx%d cells, %d groups, drum worth %.4f, k drums out %.4f",
+		nr, nz, groups, drumWorth, multiplication);
+	return true;
+}
+
+bool NeutronDiffusion::isInitialized() const {
+	return initialized;
+}
+
+int NeutronDiffusion::index(int j, int k) const {
+	return (j + 1) * stride + k + 1;
+}
+
+void NeutronDiffusion::buildMesh() {
+	nr = config.radialCells;
+	nz = config.axialCells;
+	half = nr / 2;
+	stride = half + 2;
+	dr = (config.coreRadius + config.reflectorThickness) / nr;
+	dz = config.coreHeight / nz;
+	fuelCells = max(1, min(nr, (int)(config.coreRadius / dr + 0.5)));
+
+	size_t size = (size_t)(nz + 2) * stride;
+	auto allocate = [this, size](std::vector<Field>& fields) {
+		fields.assign(groups, Field());
+		for (auto& field : fields) {
+			field.values[0].assign(size, 0.0);
+			field.values[1].assign(size, 0.0);
+		}
+	};
+	allocate(west);
+	allocate(east);
+	allocate(south);
+	allocate(north);
+	allocate(inverseDiagonal);
+	allocate(boundary);
+	allocate(nuFission);
+	allocate(scattering);
+	allocate(flux);
+	for (Field* field : { &volume, &source, &fission, &previousFission }) {
+		field->values[0].assign(size, 0.0);
+		field->values[1].assign(size, 0.0);
+	}
+
+	for (int c = 0; c < 2; ++c) {
+		ring[c].assign(size, 0);
+		for (int j = 0; j < nz; ++j) {
+			int p = (j + c) & 1;
+			for (int k = 0; k < half; ++k) {
+				int i = 2 * k + p;
+				int n = index(j, k);
+				ring[c][n] = i;
+				volume.values[c][n] = 0.5 * ((i + 1) * (i + 1) - i * i) * dr * dr * dz;
+				for (int g = 0; g < groups; ++g) {
+					flux[g].values[c][n] = 1.0;
+				}
+			}
+		}
+	}
+
+	ringPower.assign(fuelCells, 0.0);
+	powerDensity.assign((size_t)fuelCells * nz, 1.0);
+	multiplication = 1.0;
+}
+
+/* Finite volume coefficients per radian of the cylinder. Neighbours couple with the harmonic mean
+ * of their diffusion coefficients, boundary cells leak into vacuum through the extrapolation distance.
+ */
+void NeutronDiffusion::setCrossSections(const NeutronicsConditions& conditions) {
+	const CrossSectionConfig& core = config.core;
+	const CrossSectionConfig& reflector = config.reflector;
+	//Absorbers facing the core at 0 deg, reflectors at 180 deg
+	double drumWeight = absorptionEffect * 0.5 * (1.0 + cos(conditions.drumAngle * RAD));
+	double doppler = 1.0 + config.doppler * (sqrt(max(conditions.fuelTemperature, 1.0) / config.referenceTemperature) - 1.0);
+	double moderation = 1.0 - config.moderatorShare + config.moderatorShare * max(0.0, conditions.moderatorDensity);
+
+	for (int g = 0; g < groups; ++g) {
+		double coreAbsorption = core.absorption[g] * (g == 0 ? doppler : 1.0);
+		double coreScattering = core.scattering[g] * moderation;
+		double reflectorAbsorption = reflector.absorption[g] + drumWeight * config.drumAbsorption[g];
+		double coreNuFission = core.nuFission[g] * max(0.0, conditions.fissileContent);
+
+		auto diffusion = [&](int i) { return i < fuelCells ? core.diffusion[g] : reflector.diffusion[g]; };
+		auto coupling = [&](int a, int b) {
+			double da = diffusion(a), db = diffusion(b);
+			return 2.0 * da * db / (da + db);
+		};
+
+		for (int c = 0; c < 2; ++c) {
+			for (int j = 0; j < nz; ++j) {
+				for (int k = 0; k < half; ++k) {
+					int n = index(j, k);
+					int i = ring[c][n];
+					bool isFuel = i < fuelCells;
+					double d = diffusion(i);
+					double inner = i * dr;
+					double outer = (i + 1) * dr;
+					double face = 0.5 * (outer * outer - inner * inner);
+					double v = volume.values[c][n];
+
+					double aW = i > 0 ? inner * dz * coupling(i - 1, i) / dr : 0.0;
+					double aE = i < nr - 1 ? outer * dz * coupling(i, i + 1) / dr : 0.0;
+					double aS = j > 0 ? face * d / dz : 0.0;
+					double aN = j < nz - 1 ? face * d / dz : 0.0;
+					double leak = 0.0;
+					if (i == nr - 1) leak += outer * dz * d / (0.5 * dr + DIFFUSION_EXTRAPOLATION_DISTANCE * d);
+					if (j == 0) leak += face * d / (0.5 * dz + DIFFUSION_EXTRAPOLATION_DISTANCE * d);
+					if (j == nz - 1) leak += face * d / (0.5 * dz + DIFFUSION_EXTRAPOLATION_DISTANCE * d);
+
+					double absorption = isFuel ? coreAbsorption : reflectorAbsorption;
+					double scatter = isFuel ? coreScattering : reflector.scattering[g];
+					west[g].values[c][n] = aW;
+					east[g].values[c][n] = aE;
+					south[g].values[c][n] = aS;
+					north[g].values[c][n] = aN;
+					boundary[g].values[c][n] = leak;
+					inverseDiagonal[g].values[c][n] = 1.0 / (aW + aE + aS + aN + leak + (absorption + scatter) * v);
+					nuFission[g].values[c][n] = isFuel ? coreNuFission * v : 0.0;
+					scattering[g].values[c][n] = scatter * v;
+				}
+			}
+		}
+	}
+}
+
+/* One SOR sweep over the cells of one color. The cell i = 2k + p of a row has its west neighbour at k - 1 + p
+ * and its east neighbour at k + p in the same row of the other color, and its south and north neighbours at k
+ * in the rows below and above. The reflective axis and the vacuum boundaries have zero coefficients.
+ */
+void NeutronDiffusion::sweep(int group, int color, int firstRow, int endRow) {
+	const int other = 1 - color;
+	const double omega = config.omega;
+	for (int j = firstRow; j < endRow; ++j) {
+		const int p = (j + color) & 1;
+		const int base = index(j, 0);
+		double* phi = flux[group].values[color].data() + base;
+		const double* neighbour = flux[group].values[other].data() + base;
+		const double* aW = west[group].values[color].data() + base;
+		const double* aE = east[group].values[color].data() + base;
+		const double* aS = south[group].values[color].data() + base;
+		const double* aN = north[group].values[color].data() + base;
+		const double* inverse = inverseDiagonal[group].values[color].data() + base;
+		const double* q = source.values[color].data() + base;
+		const double* neighbourWest = neighbour - 1 + p;
+		const double* neighbourEast = neighbour + p;
+		const double* neighbourSouth = neighbour - stride;
+		const double* neighbourNorth = neighbour + stride;
+
+		for (int k = 0; k < half; ++k) {
+			double balance = q[k] + aW[k] * neighbourWest[k] + aE[k] * neighbourEast[k] + aS[k] * neighbourSouth[k] + aN[k] * neighbourNorth[k];
+			phi[k] += omega * (balance * inverse[k] - phi[k]);
+		}
+	}
+}
+
+void NeutronDiffusion::sweepAll(int group, int color) {
+	OH_TRACE_SCOPE("sweepAll");
+	if (workers.empty()) {
+		sweep(group, color, 0, nz);
+		return;
+	}
+
+	int parts = (int)workers.size() + 1;
+	{
+		std::lock_guard<std::mutex> lock(sweepMutex);
+		sweepGroup = group;
+		sweepColor = color;
+		sweepPending = (int)workers.size();
+		sweepGeneration++;
+	}
+	sweepStart.notify_all();
+	sweep(group, color, 0, nz / parts);
+
+	std::unique_lock<std::mutex> lock(sweepMutex);
+	sweepDone.wait(lock, [this] { return sweepPending == 0; });
+}
+
+void NeutronDiffusion::runWorker(int worker, unsigned long long generation) {
+	int parts = config.threads;
+	while (true) {
+		int group, color;
+		{
+			std::unique_lock<std::mutex> lock(sweepMutex);
+			sweepStart.wait(lock, [this, generation] { return stopping || sweepGeneration != generation; });
+			if (stopping) {
+				return;
+			}
+			generation = sweepGeneration;
+			group = sweepGroup;
+			color = sweepColor;
+		}
+
+		{
+			OH_TRACE_SCOPE("sweep");
+			sweep(group, color, nz * worker / parts, nz * (worker + 1) / parts);
+		}
+
+		std::lock_guard<std::mutex> lock(sweepMutex);
+		if (--sweepPending == 0) {
+			sweepDone.notify_one();
+		}
+	}
+}
+
+void NeutronDiffusion::stopWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(sweepMutex);
+		stopping = true;
+	}
+	sweepStart.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+	workers.clear();
+}
+
+/* Fission neutrons of every cell from the current flux, returns their sum.
+ */
+double NeutronDiffusion::updateFission() {
+	double total = 0.0;
+	for (int c = 0; c < 2; ++c) {
+		double* f = fission.values[c].data();
+		size_t size = fission.values[c].size();
+		for (size_t n = 0; n < size; ++n) {
+			double sum = 0.0;
+			for (int g = 0; g < groups; ++g) {
+				sum += nuFission[g].values[c][n] * flux[g].values[c][n];
+			}
+			f[n] = sum;
+			total += sum;
+		}
+	}
+	return total;
+}
+
+/* Power iteration, starting from the flux and multiplication factor of the last solution.
+ * The flux is normalized to one fission neutron per iteration.
+ */
+void NeutronDiffusion::solve(const NeutronicsConditions& conditions, const std::atomic<bool>* cancelled) {
+	OH_TRACE_SCOPE("NeutronDiffusion::solve");
+	this->conditions = conditions;
+	setCrossSections(conditions);
+
+	const std::vector<double>& chi = config.core.chi;
+	double total = updateFission();
+	if (total <= 0.0) {
+		//No fuel left, nothing to iterate on
+		multiplication = 0.0;
+		converged = true;
+		iterations = 0;
+		return;
+	}
+
+	if (multiplication <= 0.0) {
+		multiplication = 1.0;
+	}
+	converged = false;
+	for (iterations = 1; iterations <= config.maxIterations; ++iterations) {
+		if (cancelled != NULL && cancelled->load(std::memory_order_relaxed)) {
+			return;
+		}
+		for (int c = 0; c < 2; ++c) {
+			for (auto& f : fission.values[c]) f /= total;
+			for (int g = 0; g < groups; ++g) {
+				for (auto& phi : flux[g].values[c]) phi /= total;
+			}
+			previousFission.values[c] = fission.values[c];
+		}
+
+		for (int g = 0; g < groups; ++g) {
+			for (int c = 0; c < 2; ++c) {
+				double* q = source.values[c].data();
+				const double* f = fission.values[c].data();
+				size_t size = source.values[c].size();
+				double chiFactor = chi[g] / multiplication;
+				for (size_t n = 0; n < size; ++n) {
+					q[n] = chiFactor * f[n];
+				}
+				if (g > 0) {
+					const double* s = scattering[g - 1].values[c].data();
+					const double* phi = flux[g - 1].values[c].data();
+					for (size_t n = 0; n < size; ++n) {
+						q[n] += s[n] * phi[n];
+					}
+				}
+			}
+			for (int sweeps = 0; sweeps < DIFFUSION_INNER_SWEEPS; ++sweeps) {
+				sweepAll(g, 0);
+				sweepAll(g, 1);
+			}
+		}
+
+		total = updateFission();
+		double previous = multiplication;
+		multiplication *= total;
+		OH_TRACE_COUNTER("multiplication", multiplication);
+
+		double peak = 0.0;
+		double change = 0.0;
+		for (int c = 0; c < 2; ++c) {
+			for (size_t n = 0; n < fission.values[c].size(); ++n) {
+				double f = fission.values[c][n] / total;
+				peak = max(peak, f);
+				change = max(change, fabs(f - previousFission.values[c][n]));
+			}
+		}
+		if (fabs(multiplication - previous) < config.tolerance * multiplication && change < config.tolerance * peak) {
+			converged = true;
+			break;
+		}
+	}
+	iterations = min(iterations, config.maxIterations);
+	evaluate();
+}
+
+/* Power shape and leakage of the converged flux.
+ */
+void NeutronDiffusion::evaluate() {
+	double total = 0.0;
+	double fuelVolume = 0.0;
+	double peakDensity = 0.0;
+	double leakage = 0.0;
+	std::fill(ringPower.begin(), ringPower.end(), 0.0);
+
+	for (int c = 0; c < 2; ++c) {
+		for (int j = 0; j < nz; ++j) {
+			for (int k = 0; k < half; ++k) {
+				int n = index(j, k);
+				int i = ring[c][n];
+				double f = fission.values[c][n];
+				for (int g = 0; g < groups; ++g) {
+					leakage += boundary[g].values[c][n] * flux[g].values[c][n];
+				}
+				if (i >= fuelCells) {
+					continue;
+				}
+				total += f;
+				fuelVolume += volume.values[c][n];
+				peakDensity = max(peakDensity, f / volume.values[c][n]);
+				ringPower[i] += f;
+			}
+		}
+	}
+
+	if (total <= 0.0) {
+		peakingFactor = 1.0;
+		leakageFraction = 0.0;
+		return;
+	}
+	for (auto& power : ringPower) {
+		power /= total;
+	}
+	for (int c = 0; c < 2; ++c) {
+		for (int j = 0; j < nz; ++j) {
+			for (int k = 0; k < half; ++k) {
+				int n = index(j, k);
+				int i = ring[c][n];
+				if (i < fuelCells) {
+					powerDensity[(size_t)j * fuelCells + i] = fission.values[c][n] / volume.values[c][n] * fuelVolume / total;
+				}
+			}
+		}
+	}
+	peakingFactor = peakDensity * fuelVolume / total;
+	//In balance, the neutrons of one generation are the fission neutrons divided by k
+	leakageFraction = leakage * multiplication / total;
+}
+
+bool NeutronDiffusion::update(const NeutronicsConditions& conditions) {
+	if (isCurrent(conditions)) {
+		return false;
+	}
+	solve(conditions);
+	return true;
+}
+
+bool NeutronDiffusion::isCurrent(const NeutronicsConditions& conditions) const {
+	return !initialized ||
+		(fabs(conditions.drumAngle - this->conditions.drumAngle) <= config.drumTolerance &&
+		fabs(conditions.fuelTemperature - this->conditions.fuelTemperature) <= config.temperatureTolerance &&
+		fabs(conditions.moderatorDensity - this->conditions.moderatorDensity) <= config.compositionTolerance &&
+		fabs(conditions.fissileContent - this->conditions.fissileContent) <= config.compositionTolerance);
+}
+
+const NeutronicsConditions& NeutronDiffusion::getConditions() const {
+	return conditions;
+}
+
+double NeutronDiffusion::getMultiplication() const {
+	return multiplication;
+}
+
+double NeutronDiffusion::getReactivity() const {
+	return multiplication > 0.0 ? (multiplication - 1.0) / multiplication : -1.0;
+}
+
+double NeutronDiffusion::getDrumWorth() const {
+	return drumWorth;
+}
+
+static double drumAbsorberWeight(double drumAngle) {
+	return 0.5 * (1.0 + cos(drumAngle * RAD));
+}
+
+double NeutronDiffusion::predictReactivity(double drumAngle) const {
+	return getReactivity() + drumWorth * (drumAbsorberWeight(conditions.drumAngle) - drumAbsorberWeight(drumAngle));
+}
+
+double NeutronDiffusion::getCriticalDrumAngle() const {
+	if (drumWorth <= 0.0) {
+		return 180.0;
+	}
+	//Reactivity with the absorbers turned away, then the absorber weight that takes it back to zero
+	double drumsOut = getReactivity() + drumWorth * drumAbsorberWeight(conditions.drumAngle);
+	double weight = drumsOut / drumWorth;
+	if (weight <= 0.0) {
+		return 180.0;
+	}
+	if (weight >= 1.0) {
+		return 0.0;
+	}
+	return acos(2.0 * weight - 1.0) * DEG;
+}
+
+double NeutronDiffusion::getPeakingFactor() const {
+	return peakingFactor;
+}
+
+double NeutronDiffusion::getLeakageFraction() const {
+	return leakageFraction;
+}
+
+unsigned int NeutronDiffusion::countFuelRings() const {
+	return (unsigned int)ringPower.size();
+}
+
+double NeutronDiffusion::getRingPowerFraction(unsigned int ring) const {
+	return ring < ringPower.size() ? ringPower[ring] : 0.0;
+}
+
+double NeutronDiffusion::getRingRadius(unsigned int ring) const {
+	return (ring + 1) * dr;
+}
+
+double NeutronDiffusion::getPowerDensity(double radius, double height) const {
+	if (powerDensity.empty()) {
+		return 1.0;
+	}
+	int i = max(0, min(fuelCells - 1, (int)(radius * fuelCells)));
+	int j = max(0, min(nz - 1, (int)(height * nz)));
+	return powerDensity[(size_t)j * fuelCells + i];
+}
+
+int NeutronDiffusion::getIterations() const {
+	return iterations;
+}
+
+bool NeutronDiffusion::hasConverged() const {
+	return converged;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "model/NeutronicsConfig.h"
+
+/* Conditions of the core the cross sections depend on.
+ */
+struct NeutronicsConditions {
+	//Control drum rotation in deg, 0.0 absorbers facing the core, 180.0 reflectors facing the core
+	double drumAngle;
+	//Mean fuel temperature in K
+	double fuelTemperature;
+	//Hydrogen in the propellant channels relative to rated flow
+	double moderatorDensity;
+	//Fissile content of the fuel relative to fresh fuel
+	double fissileContent;
+};
+
+/**
+ * \brief Multi-group neutron diffusion in r-z geometry for the detailed fidelity mode.
+ *
+ * The core is a cylinder of fuel with a radial reflector around it, which carries the control drums.
+ * The drums are not resolved: their absorbers are smeared over the reflector and weighted by the drum angle.
+ * The finite volume discretization has vacuum boundaries at the outer radius and top and bottom,
+ * and the multiplication factor is found by power iteration with red-black SOR as inner solver.
+ *
+ * The cells are stored by color: every row of a color holds every other cell of the row, so a sweep over one color
+ * reads the neighbours from the other color as contiguous rows. The inner loops have no dependencies and no branches,
+ * which lets the compiler vectorize them, and the rows of one color can be split over threads.
+ *
+ * Solving takes milliseconds, so update() only solves again once the conditions changed beyond the tolerances
+ * of the configuration, and starts from the flux of the last solution.
+ */
+class NeutronDiffusion {
+public:
+	NeutronDiffusion();
+	~NeutronDiffusion();
+
+	/* Builds the mesh and calibrates the worth of the control drums. absorption scales the drum absorbers,
+	 * to account for their aging. Returns false if the configuration is invalid.
+	 */
+	bool init(const NeutronicsConfig& config, double absorption);
+	bool isInitialized() const;
+
+	/* Solves for the conditions if they differ from the last solution beyond the tolerances.
+	 * Returns true if it solved.
+	 */
+	bool update(const NeutronicsConditions& conditions);
+	//Whether the last solution is within the tolerances of the conditions
+	bool isCurrent(const NeutronicsConditions& conditions) const;
+	/* Solves for the conditions. Returns early, with an unfinished solution, once cancelled is set.
+	 */
+	void solve(const NeutronicsConditions& conditions, const std::atomic<bool>* cancelled = NULL);
+
+	//Conditions of the last solution
+	const NeutronicsConditions& getConditions() const;
+	double getMultiplication() const;
+	//(k - 1) / k of the last solution
+	double getReactivity() const;
+	//Reactivity difference between drums fully out and fully in
+	double getDrumWorth() const;
+	/* Reactivity at another drum angle, by scaling the drum worth with the drum absorber weight.
+	 * Exact at the angle of the last solution, close enough for the drum servo in between.
+	 */
+	double predictReactivity(double drumAngle) const;
+	/* Drum angle at which the core would be critical under the conditions of the last solution.
+	 * 0.0 or 180.0 if the drums can't reach criticality.
+	 */
+	double getCriticalDrumAngle() const;
+
+	//Peak to average power density in the fuel
+	double getPeakingFactor() const;
+	//Fraction of the fission neutrons leaking out of core and reflector
+	double getLeakageFraction() const;
+	//Radial power shape: fraction of the fission power in each ring of fuel cells, the innermost ring first
+	unsigned int countFuelRings() const;
+	double getRingPowerFraction(unsigned int ring) const;
+	//Outer radius of a ring of fuel cells in cm
+	double getRingRadius(unsigned int ring) const;
+	/* Power density relative to the fuel mean at a position in the core, given as fractions of core radius and height.
+	 */
+	double getPowerDensity(double radius, double height) const;
+
+	//Outer iterations of the last solution
+	int getIterations() const;
+	bool hasConverged() const;
+
+private:
+	NeutronicsConfig config;
+	double absorptionEffect;
+	bool initialized;
+
+	int groups;
+	int nr;
+	int nz;
+	int fuelCells;
+	//Cells per row of one color, and the padded row length with a ghost cell on each side
+	int half;
+	int stride;
+	double dr;
+	double dz;
+
+	/* Arrays of one group and color, (nz + 2) rows of stride values.
+	 * The ghost cells around the mesh stay 0.0.
+	 */
+	struct Field {
+		std::vector<double> values[2];
+	};
+
+	Field volume;
+	//Radial index of each cell, cells below fuelCells are fuel, the others reflector
+	std::vector<int> ring[2];
+	//Per group: coupling coefficients to the neighbours and the inverse of the diagonal
+	std::vector<Field> west;
+	std::vector<Field> east;
+	std::vector<Field> south;
+	std::vector<Field> north;
+	std::vector<Field> inverseDiagonal;
+	//Per group: leakage coefficients of the boundary cells, already part of the diagonal
+	std::vector<Field> boundary;
+	//Per group: nu-fission and scattering into the next group times the cell volume
+	std::vector<Field> nuFission;
+	std::vector<Field> scattering;
+	std::vector<Field> flux;
+	//Source of the group the sweeps currently solve for
+	Field source;
+	//Fission neutrons per cell of the current and the previous iteration
+	Field fission;
+	Field previousFission;
+
+	NeutronicsConditions conditions;
+	double multiplication;
+	double drumWorth;
+	double peakingFactor;
+	double leakageFraction;
+	std::vector<double> ringPower;
+	//Relative power density of the fuel cells, row by row
+	std::vector<double> powerDensity;
+	int iterations;
+	bool converged;
+
+	//Workers sharing the rows of every sweep, empty for single threaded solving
+	std::vector<std::thread> workers;
+	std::mutex sweepMutex;
+	std::condition_variable sweepStart;
+	std::condition_variable sweepDone;
+	unsigned long long sweepGeneration;
+	int sweepGroup;
+	int sweepColor;
+	int sweepPending;
+	bool stopping;
+
+	int index(int j, int k) const;
+	void buildMesh();
+	void setCrossSections(const NeutronicsConditions& conditions);
+	void sweep(int group, int color, int firstRow, int endRow);
+	void sweepAll(int group, int color);
+	void runWorker(int worker, unsigned long long generation);
+	void stopWorkers();
+	double updateFission();
+	void evaluate();
+};
@@ -0,0 +1,96 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/TurbomachineConfig.h"
+
+#include "PerformanceMap.h"
+
+
+PerformanceMap::PerformanceMap() {}
+PerformanceMap::~PerformanceMap() {}
+
+bool PerformanceMap::load(const PerformanceMapConfig& config) {
+	speeds.clear();
+	flows.clear();
+	points.clear();
+
+	size_t cells = config.speeds.size() * config.flows.size();
+	if (config.speeds.size() < 2 || config.flows.size() < 2 ||
+		config.pressureRatio.size() != cells || config.efficiency.size() != cells) {
+		Olog::error("Performance map dimensions do not match its breakpoints");
+		return false;
+	}
+
+	for (size_t i = 1; i < config.speeds.size(); ++i) {
+		if (config.speeds[i] <= config.speeds[i - 1]) {
+			Olog::error("Performance map speed breakpoints must be ascending");
+			return false;
+		}
+	}
+	for (size_t i = 1; i < config.flows.size(); ++i) {
+		if (config.flows[i] <= config.flows[i - 1]) {
+			Olog::error("Performance map flow breakpoints must be ascending");
+			return false;
+		}
+	}
+
+	speeds = config.speeds;
+	flows = config.flows;
+	points.resize(cells);
+	for (size_t i = 0; i < cells; ++i) {
+		points[i].pressureRatio = config.pressureRatio[i];
+		points[i].efficiency = config.efficiency[i];
+	}
+	return true;
+}
+
+bool PerformanceMap::isLoaded() const {
+	return !points.empty();
+}
+
+/*
+* Returns the index of the lower breakpoint of the cell containing value, starting the search at hint.
+* The returned cell is always valid, values outside of the table end up in the first or last cell.
+*/
+unsigned int PerformanceMap::findCell(const vector<double>& breakpoints, double value, unsigned int hint) {
+	unsigned int lastCell = (unsigned int)breakpoints.size() - 2;
+	unsigned int cell = min(hint, lastCell);
+
+	while (cell > 0 && value < breakpoints[cell]) {
+		cell--;
+	}
+	while (cell < lastCell && value > breakpoints[cell + 1]) {
+		cell++;
+	}
+	return cell;
+}
+
+PerformancePoint PerformanceMap::lookup(double correctedSpeed, double correctedFlow, PerformanceMapCursor& cursor) const {
+	if (points.empty()) {
+		return PerformancePoint{ 1.0, 1.0 };
+	}
+
+	unsigned int i = cursor.speedCell = findCell(speeds, correctedSpeed, cursor.speedCell);
+	unsigned int j = cursor.flowCell = findCell(flows, correctedFlow, cursor.flowCell);
+
+	double u = (correctedSpeed - speeds[i]) / (speeds[i + 1] - speeds[i]);
+	double v = (correctedFlow - flows[j]) / (flows[j + 1] - flows[j]);
+	u = max(0.0, min(1.0, u));
+	v = max(0.0, min(1.0, v));
+
+	size_t stride = flows.size();
+	const PerformancePoint& p00 = points[i * stride + j];
+	const PerformancePoint& p01 = points[i * stride + j + 1];
+	const PerformancePoint& p10 = points[(i + 1) * stride + j];
+	const PerformancePoint& p11 = points[(i + 1) * stride + j + 1];
+
+	double w00 = (1.0 - u) * (1.0 - v);
+	double w01 = (1.0 - u) * v;
+	double w10 = u * (1.0 - v);
+	double w11 = u * v;
+
+	PerformancePoint result;
+	result.pressureRatio = w00 * p00.pressureRatio + w01 * p01.pressureRatio + w10 * p10.pressureRatio + w11 * p11.pressureRatio;
+	result.efficiency = w00 * p00.efficiency + w01 * p01.efficiency + w10 * p10.efficiency + w11 * p11.efficiency;
+	return result;
+}
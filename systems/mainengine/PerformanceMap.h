@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+
+struct PerformanceMapConfig;
+
+/* Remembers the map cell used by the previous lookup.
+ * Operating points move slowly between steps, so the next lookup almost always hits the same
+ * or a neighbouring cell and does not need to search the breakpoints again.
+ * Every caller keeps its own cursor, so a map can be shared between several machines.
+ */
+struct PerformanceMapCursor {
+	unsigned int speedCell = 0;
+	unsigned int flowCell = 0;
+};
+
+/* Result of a map lookup.
+ */
+struct PerformancePoint {
+	double pressureRatio;
+	double efficiency;
+};
+
+/* Bilinear interpolation table over corrected speed and corrected mass flow.
+ * All memory is allocated by load(), lookups do not allocate and only walk the breakpoints
+ * when the operating point left the cached cell. Outside of the tabulated range, the values are clamped
+ * to the border of the map.
+ */
+class PerformanceMap {
+public:
+	PerformanceMap();
+	~PerformanceMap();
+
+	/* Copies the tables from the configuration. Returns false and leaves the map empty if the
+	 * table dimensions do not match the number of breakpoints or the breakpoints are not ascending.
+	 */
+	bool load(const PerformanceMapConfig& config);
+
+	bool isLoaded() const;
+
+	PerformancePoint lookup(double correctedSpeed, double correctedFlow, PerformanceMapCursor& cursor) const;
+
+private:
+	std::vector<double> speeds;
+	std::vector<double> flows;
+	//Pressure ratio and efficiency are interleaved so a cell is read from adjacent memory.
+	std::vector<PerformancePoint> points;
+
+	static unsigned int findCell(const std::vector<double>& breakpoints, double value, unsigned int hint);
+};
@@ -0,0 +1,59 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/TurbomachineConfig.h"
+
+#include "Turbomachine.h"
+
+const double TURBOMACHINE_RPM = 2.0 * PI / 60.0;
+
+
+Turbomachine::Turbomachine() {
+	inertia = 1.0;
+	referenceSpeed = 1.0;
+	referenceMassFlow = 1.0;
+	referenceTemperature = 1.0;
+	referencePressure = 1.0;
+}
+
+Turbomachine::~Turbomachine() {}
+
+bool Turbomachine::init(const TurbomachineConfig& config) {
+	inertia = config.inertia;
+	referenceSpeed = config.referenceSpeed * TURBOMACHINE_RPM;
+	referenceMassFlow = config.referenceMassFlow;
+	referenceTemperature = config.referenceTemperature;
+	referencePressure = config.referencePressure;
+
+	bool compressorLoaded = compressorMap.load(config.compressor);
+	bool turbineLoaded = turbineMap.load(config.turbine);
+	return compressorLoaded && turbineLoaded;
+}
+
+double Turbomachine::getReferenceSpeed() const {
+	return referenceSpeed;
+}
+
+double Turbomachine::getInertia() const {
+	return inertia;
+}
+
+double Turbomachine::getReferenceMassFlow() const {
+	return referenceMassFlow;
+}
+
+double Turbomachine::getReferenceTemperature() const {
+	return referenceTemperature;
+}
+
+double Turbomachine::getReferencePressure() const {
+	return referencePressure;
+}
+
+PerformancePoint Turbomachine::lookupCompressor(double correctedSpeed, double correctedFlow, PerformanceMapCursor& cursor) const {
+	return compressorMap.lookup(correctedSpeed, correctedFlow, cursor);
+}
+
+PerformancePoint Turbomachine::lookupTurbine(double correctedSpeed, double correctedFlow, PerformanceMapCursor& cursor) const {
+	return turbineMap.lookup(correctedSpeed, correctedFlow, cursor);
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "core/Lanes.h"
+#include "PerformanceMap.h"
+#include "GasFlow.h"
+
+struct TurbomachineConfig;
+
+/* Below this fraction of the reference speed, shaft power is converted into torque as if the shaft 
+ * was turning at this speed. Otherwise a resting shaft could never be started.
+ */
+const double TURBOMACHINE_MIN_TORQUE_SPEED = 0.01;
+
+/* A turbine and a compressor or pump on a common shaft.
+ * Holds the configuration and the performance maps. The thermodynamics are done by TurbomachineLanes,
+ * which steps one machine per lane, so the same code serves a single engine and a batch of engines.
+ */
+class Turbomachine {
+public:
+	Turbomachine();
+	~Turbomachine();
+
+	bool init(const TurbomachineConfig& config);
+
+	/* Reference shaft speed in rad/s
+	 */
+	double getReferenceSpeed() const;
+	/* Moment of inertia of the rotating assembly in kg m^2
+	 */
+	double getInertia() const;
+	double getReferenceMassFlow() const;
+	double getReferenceTemperature() const;
+	double getReferencePressure() const;
+
+	PerformancePoint lookupCompressor(double correctedSpeed, double correctedFlow, PerformanceMapCursor& cursor) const;
+	PerformancePoint lookupTurbine(double correctedSpeed, double correctedFlow, PerformanceMapCursor& cursor) const;
+
+private:
+	PerformanceMap compressorMap;
+	PerformanceMap turbineMap;
+
+	double inertia;
+	double referenceSpeed;
+	double referenceMassFlow;
+	double referenceTemperature;
+	double referencePressure;
+};
+
+/* Turbomachines of one kind, one per lane. Real is double for a single machine.
+ * The machines do not own their shaft speeds, the engine passes them in and integrates them with accelerate(),
+ * so the speeds remain part of the engine state.
+ * Performance is read from the compressor and turbine maps of every lane at corrected speed and corrected mass flow,
+ * everything else is computed for all lanes at once. Lanes without machine read a pressure ratio and efficiency of 1.
+ */
+template <typename Real>
+class TurbomachineLanes {
+public:
+	static const unsigned int COUNT = LaneTraits<Real>::COUNT;
+
+	TurbomachineLanes() {
+		for (unsigned int i = 0; i < COUNT; ++i) {
+			bind(i, NULL);
+		}
+	}
+
+	/* Uses the configuration and maps of the machine for the lane, NULL frees the lane. 
+	 * The machine must outlive the binding.
+	 */
+	void bind(unsigned int i, const Turbomachine* machine) {
+		machines[i] = machine;
+		compressorCursors[i] = PerformanceMapCursor();
+		turbineCursors[i] = PerformanceMapCursor();
+		lane(inertia, i) = machine ? machine->getInertia() : 1.0;
+		lane(referenceSpeed, i) = machine ? machine->getReferenceSpeed() : 1.0;
+		lane(referenceMassFlow, i) = machine ? machine->getReferenceMassFlow() : 1.0;
+		lane(referenceTemperature, i) = machine ? machine->getReferenceTemperature() : 1.0;
+		lane(referencePressure, i) = machine ? machine->getReferencePressure() : 1.0;
+	}
+
+	const Real& getReferenceSpeed() const { return referenceSpeed; }
+	const Real& getReferenceMassFlow() const { return referenceMassFlow; }
+	const Real& getReferenceTemperature() const { return referenceTemperature; }
+	const Real& getReferencePressure() const { return referencePressure; }
+
+	/* Shaft speed relative to the reference speed, corrected for the inlet temperature.
+	 */
+	Real correctedSpeed(const Real& shaftSpeed, const Real& T) const {
+		return shaftSpeed / (referenceSpeed * sqrt(maximum(T, 1.0) / referenceTemperature));
+	}
+
+	/* Mass flow relative to the reference mass flow, corrected for inlet temperature and pressure.
+	 */
+	Real correctedFlow(const Real& massflow, const Real& T, const Real& P) const {
+		return massflow * sqrt(maximum(T, 1.0) / referenceTemperature) / (referenceMassFlow * maximum(P, 1.0) / referencePressure);
+	}
+
+	/* Compresses the inlet gas into the outlet, using the inlet mass flow. 
+	 * Returns the power absorbed from the shaft in W.
+	 */
+	Real compress(const Real& shaftSpeed, const BasicGasFlow<Real>& inlet, BasicGasFlow<Real>& outlet, double gamma) {
+		Real pressureRatio, efficiency;
+		lookup(false, shaftSpeed, inlet, pressureRatio, efficiency);
+
+		efficiency = maximum(efficiency, 0.01);
+		Real isentropicRise = pow(pressureRatio, (gamma - 1.0) / gamma) - 1.0;
+
+		outlet.heatcap = inlet.heatcap;
+		outlet.massflow = inlet.massflow;
+		outlet.P = inlet.P * pressureRatio;
+		outlet.T = inlet.T * (1.0 + isentropicRise / efficiency);
+		return outlet.massflow * outlet.heatcap * (outlet.T - inlet.T);
+	}
+
+	/* Expands the inlet gas through the turbine into the outlet, using the inlet mass flow.
+	 * The outlet pressure will not drop below minOutletP.
+	 * Returns the power delivered to the shaft in W.
+	 */
+	Real expand(const Real& shaftSpeed, const BasicGasFlow<Real>& inlet, BasicGasFlow<Real>& outlet, double gamma, const Real& minOutletP) {
+		Real pressureRatio, efficiency;
+		lookup(true, shaftSpeed, inlet, pressureRatio, efficiency);
+
+		Real expansionRatio = maximum(1.0, minimum(pressureRatio, inlet.P / maximum(minOutletP, 1.0)));
+		Real isentropicDrop = 1.0 - pow(expansionRatio, -(gamma - 1.0) / gamma);
+
+		outlet.heatcap = inlet.heatcap;
+		outlet.massflow = inlet.massflow;
+		outlet.P = inlet.P / expansionRatio;
+		outlet.T = inlet.T * (1.0 - efficiency * isentropicDrop);
+		return outlet.massflow * outlet.heatcap * (inlet.T - outlet.T);
+	}
+
+	/* Pumps an incompressible liquid of the passed density (kg/m^3).
+	 * Returns the power absorbed from the shaft in W.
+	 */
+	Real pump(const Real& shaftSpeed, const BasicGasFlow<Real>& inlet, BasicGasFlow<Real>& outlet, double density) {
+		Real pressureRatio, efficiency;
+		lookup(false, shaftSpeed, inlet, pressureRatio, efficiency);
+
+		efficiency = maximum(efficiency, 0.01);
+		Real pressureRise = inlet.P * (pressureRatio - 1.0);
+
+		outlet.heatcap = inlet.heatcap;
+		outlet.massflow = inlet.massflow;
+		outlet.P = inlet.P + pressureRise;
+		//Pump losses end up in the liquid
+		outlet.T = inlet.T + pressureRise / density * (1.0 - efficiency) / efficiency / maximum(inlet.heatcap, 1.0);
+		return inlet.massflow * pressureRise / (density * efficiency);
+	}
+
+	/* Integrates the shaft speed over a time step for the passed net power (turbine - loads).
+	 * Returns the new shaft speed.
+	 */
+	Real accelerate(const Real& shaftSpeed, const Real& netPower, double simdt) const {
+		Real torque = netPower / maximum(shaftSpeed, TURBOMACHINE_MIN_TORQUE_SPEED * referenceSpeed);
+		return maximum(0.0, shaftSpeed + torque / inertia * simdt);
+	}
+
+private:
+	const Turbomachine* machines[COUNT];
+	PerformanceMapCursor compressorCursors[COUNT];
+	PerformanceMapCursor turbineCursors[COUNT];
+
+	Real inertia;
+	Real referenceSpeed;
+	Real referenceMassFlow;
+	Real referenceTemperature;
+	Real referencePressure;
+
+	/* The only part done lane by lane: every lane sits in a different cell of its own map.
+	 */
+	void lookup(bool turbine, const Real& shaftSpeed, const BasicGasFlow<Real>& inlet, Real& pressureRatio, Real& efficiency) {
+		Real speed = correctedSpeed(shaftSpeed, inlet.T);
+		Real flow = correctedFlow(inlet.massflow, inlet.T, inlet.P);
+		for (unsigned int i = 0; i < COUNT; ++i) {
+			PerformancePoint point = { 1.0, 1.0 };
+			if (machines[i] != NULL) {
+				point = turbine 
+					? machines[i]->lookupTurbine(lane(speed, i), lane(flow, i), turbineCursors[i])
+					: machines[i]->lookupCompressor(lane(speed, i), lane(flow, i), compressorCursors[i]);
+			}
+			lane(pressureRatio, i) = point.pressureRatio;
+			lane(efficiency, i) = point.efficiency;
+		}
+	}
+};
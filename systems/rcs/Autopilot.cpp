@@ -0,0 +1,204 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "OpForwardDeclare.h"
+#include "event/Events.h"
+
+#include "systems/VesselSystem.h"
+#include "model/ThrusterConfig.h"
+#include "model/AutopilotConfig.h"
+#include "model/DockPortConfig.h"
+#include "systems/rcs/ReactionControlSystem.h"
+#include "systems/rcs/Autopilot.h"
+#include "systems/dockport/DockPort.h"
+
+#include "core/OrbitalHauler.h"
+
+//Time constant in s in which a rate error is taken out, well below the response time of the attitude
+const double AUTOPILOT_RATE_TIME = 0.5;
+
+
+/* Rotation vector in the vessel frame that turns the vessel frame R into the target frame T, from the relative
+ * rotation Q = R^T T.
+ */
+static VECTOR3 attitudeError(const MATRIX3& R, const MATRIX3& T) {
+	double q[3][3];
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			q[i][j] = R.data[i] * T.data[j] + R.data[3 + i] * T.data[3 + j] + R.data[6 + i] * T.data[6 + j];
+		}
+	}
+	VECTOR3 skew = _V(q[2][1] - q[1][2], q[0][2] - q[2][0], q[1][0] - q[0][1]);
+	double cosine = max(-1.0, min(1.0, (q[0][0] + q[1][1] + q[2][2] - 1.0) * 0.5));
+	double angle = acos(cosine);
+	double sine = sin(angle);
+	if (sine > 1.0E-6) {
+		return skew * (angle / (2.0 * sine));
+	}
+	if (cosine > 0.0) {
+		return skew * 0.5;
+	}
+	//Half a turn: the axis follows from the diagonal, its sign from the largest component
+	int k = q[0][0] >= q[1][1] && q[0][0] >= q[2][2] ? 0 : (q[1][1] >= q[2][2] ? 1 : 2);
+	VECTOR3 axis;
+	double pivot = sqrt(max(0.0, (q[k][k] + 1.0) * 0.5));
+	for (int i = 0; i < 3; ++i) {
+		axis.data[i] = i == k ? pivot : (q[i][k] + q[k][i]) / (4.0 * pivot);
+	}
+	return axis * angle;
+}
+
+
+Autopilot::Autopilot(OrbitalHauler* vessel, AutopilotConfig config, ReactionControlSystem* rcs) : VesselSystem(vessel, "Autopilot"), config(config), rcs(rcs) {
+	mode = AUTOPILOTMODE::OFF;
+	target = NULL;
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		command[a] = 0.0;
+		authority[a] = 0.0;
+	}
+	for (int k = 0; k < 9; ++k) {
+		targetAttitude.data[k] = k % 4 == 0 ? 1.0 : 0.0;
+	}
+	cachedStack = 0;
+	cachedLayout = 0;
+	stale = true;
+	refreshes = 0;
+}
+
+Autopilot::~Autopilot() {}
+
+void Autopilot::init(EventBroker& eventBroker) {
+	Olog::trace("Autopilot init");
+
+	// create event subscriptions
+	eventBroker.subscribe((EventSubscriber*)this, EVENTTOPIC::GENERAL);
+}
+
+void Autopilot::preStep(double simt, double simdt, double mjd) {
+	if (mode == AUTOPILOTMODE::OFF) {
+		return;
+	}
+	if (mode == AUTOPILOTMODE::APPROACH && !oapiIsVessel(target)) {
+		Olog::warn("Autopilot approach target is gone, holding attitude");
+		mode = AUTOPILOTMODE::HOLD;
+	}
+
+	// The caches hold until the stack or the RCS layout change
+	if (stale || vessel->Docking()->getStack().countRevisions() != cachedStack || rcs->getAllocator().countRebuilds() != cachedLayout) {
+		refresh();
+	}
+
+	VECTOR3 rate;
+	vessel->GetAngularVel(rate);
+	VECTOR3 desired = _V(0, 0, 0);
+	if (mode != AUTOPILOTMODE::KILLROT) {
+		MATRIX3 R;
+		vessel->GetRotationMatrix(R);
+		VECTOR3 error = attitudeError(R, targetAttitude);
+		double responseTime = max(config.responseTime, simdt);
+		for (int i = 0; i < 3; ++i) {
+			// Slow enough to brake to a stop at half the angular acceleration
+			double limit = min(config.maxRate * RAD, sqrt(authority[3 + i] * fabs(error.data[i])));
+			desired.data[i] = max(-limit, min(limit, error.data[i] / responseTime));
+		}
+
+		for (int i = 0; i < 3; ++i) {
+			command[i] = 0.0;
+		}
+		if (mode == AUTOPILOTMODE::APPROACH) {
+			VECTOR3 position, velocity;
+			vessel->GetRelativePos(target, position);
+			vessel->GetRelativeVel(target, velocity);
+			// Offset of the target from the vessel and the velocity towards it, both in the vessel frame
+			VECTOR3 offset = -tmul(R, position);
+			velocity = tmul(R, velocity);
+			// The lateral offset is taken out like an attitude error, no faster than the closing speed
+			VECTOR3 closing = _V(0, 0, config.approachSpeed);
+			for (int i = 0; i < 2; ++i) {
+				double limit = min(config.approachSpeed, sqrt(authority[i] * fabs(offset.data[i])));
+				closing.data[i] = max(-limit, min(limit, offset.data[i] / responseTime));
+			}
+			for (int i = 0; i < 3; ++i) {
+				command[i] = rateCommand(i, closing.data[i], velocity.data[i], simdt);
+			}
+		}
+	}
+	for (int i = 0; i < 3; ++i) {
+		command[3 + i] = rateCommand(3 + i, desired.data[i], rate.data[i], simdt);
+	}
+	rcs->setAutopilotCommand(command);
+}
+
+double Autopilot::rateCommand(int axis, double desired, double rate, double simdt) const {
+	if (authority[axis] <= 0.0) {
+		return 0.0;
+	}
+	return max(-1.0, min(1.0, (desired - rate) / (authority[axis] * max(AUTOPILOT_RATE_TIME, simdt))));
+}
+
+void Autopilot::refresh() {
+	const StackMassProperties& stack = vessel->Docking()->getStack();
+	const ThrusterAllocator& allocator = rcs->getAllocator();
+	cachedStack = stack.countRevisions();
+	cachedLayout = allocator.countRebuilds();
+	stale = false;
+	double mass = stack.getMass();
+	MATRIX3 inertia = stack.getInertia();
+	for (int a = 0; a < 3; ++a) {
+		authority[a] = mass > 0.0 ? allocator.getWrenchLimit(a) / mass : 0.0;
+		// Every axis on its own, the products of inertia are left out
+		double moment = inertia.data[4 * a];
+		authority[3 + a] = moment > 0.0 ? allocator.getWrenchLimit(3 + a) / moment : 0.0;
+	}
+	refreshes++;
+}
+
+void Autopilot::setMode(AUTOPILOTMODE mode) {
+	this->mode = mode;
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		command[a] = 0.0;
+	}
+	rcs->setAutopilotCommand(command);
+	// The stack may have changed any time while off
+	stale = true;
+}
+
+void Autopilot::off() {
+	setMode(AUTOPILOTMODE::OFF);
+}
+
+void Autopilot::killRotation() {
+	setMode(AUTOPILOTMODE::KILLROT);
+}
+
+void Autopilot::holdAttitude() {
+	MATRIX3 R;
+	vessel->GetRotationMatrix(R);
+	holdAttitude(R);
+}
+
+void Autopilot::holdAttitude(const MATRIX3& target) {
+	targetAttitude = target;
+	setMode(AUTOPILOTMODE::HOLD);
+}
+
+void Autopilot::approach(OBJHANDLE target) {
+	this->target = target;
+	vessel->GetRotationMatrix(targetAttitude);
+	setMode(AUTOPILOTMODE::APPROACH);
+}
+
+AUTOPILOTMODE Autopilot::getMode() const {
+	return mode;
+}
+
+unsigned int Autopilot::countRefreshes() const {
+	return refreshes;
+}
+
+
+void Autopilot::receiveEvent(Event_Base* event, EVENTTOPIC topic) {
+
+	if (*event == EVENTTYPE::SIMULATIONSTARTEDEVENT) {
+		Olog::info("Autopilot received sim started event!");
+	}
+}
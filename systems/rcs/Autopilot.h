@@ -0,0 +1,71 @@
+#pragma once
+
+class ReactionControlSystem;
+
+enum class AUTOPILOTMODE {
+    OFF,
+    //Null the rotation rates
+    KILLROT,
+    //Rotate into a target attitude and hold it
+    HOLD,
+    //Hold the attitude, the target vessel on the docking axis and a closing speed towards it
+    APPROACH
+};
+
+/* Attitude and translation autopilot, commanding the RCS alongside the manual input.
+ * Every axis is controlled on its own: the attitude error gives a rate that takes it out in the response time,
+ * limited by the maximum rate and by the rate that can still be braked to zero at the angular acceleration of that
+ * axis, and the rate error gives the command. The angular accelerations follow from the inertia of the docked stack
+ * and the torque limits of the RCS and the linear ones from the stack mass and the force limits; they are cached and
+ * only computed again when the stack changes or the RCS is laid out again, so a step costs a few dozen
+ * multiplications. The autopilot has to step before the RCS, so its command is allocated in the same frame.
+ */
+class Autopilot :
+    public VesselSystem
+{
+public:
+    Autopilot(OrbitalHauler* vessel, AutopilotConfig config, ReactionControlSystem* rcs);
+    ~Autopilot();
+
+    void init(EventBroker& eventBroker);
+    void preStep(double simt, double simdt, double mjd);
+
+    void off();
+    void killRotation();
+    //Holds the current attitude
+    void holdAttitude();
+    //Rotates into an attitude, the rotation matrix of the vessel frame in the global frame
+    void holdAttitude(const MATRIX3& target);
+    //Holds the current attitude, centers a target vessel on the +z axis and closes in on it at the configured speed
+    void approach(OBJHANDLE target);
+    AUTOPILOTMODE getMode() const;
+
+    //Times the cached inertia and authority have been computed
+    unsigned int countRefreshes() const;
+
+protected:
+    virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
+
+private:
+    AutopilotConfig config;
+    ReactionControlSystem* rcs;
+
+    AUTOPILOTMODE mode;
+    MATRIX3 targetAttitude;
+    OBJHANDLE target;
+    double command[WRENCH_AXES];
+
+    //Revisions of the stack and the RCS layout the caches are valid for
+    unsigned int cachedStack;
+    unsigned int cachedLayout;
+    bool stale;
+    //Largest acceleration the RCS gives on every axis, in m/s2 for the forces and rad/s2 for the torques
+    double authority[WRENCH_AXES];
+    unsigned int refreshes;
+
+    void refresh();
+    void setMode(AUTOPILOTMODE mode);
+    /* Command on one axis bringing a rate to the desired one, relative to the authority of the axis.
+     */
+    double rateCommand(int axis, double desired, double rate, double simdt) const;
+};
@@ -0,0 +1,71 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "PulseModulator.h"
+
+
+PulseModulator::PulseModulator() {
+	thrusters = 0;
+	minimumOnTime = 0.0;
+	latency = 0.0;
+	pulses = 0;
+}
+
+void PulseModulator::setThrusters(unsigned int thrusters, double minimumOnTime, double latency) {
+	this->thrusters = thrusters;
+	this->minimumOnTime = minimumOnTime;
+	this->latency = latency;
+	demand.assign(thrusters, 0.0);
+	pulseStart.assign(thrusters, 0.0);
+	committed.assign(thrusters, 0.0);
+}
+
+bool PulseModulator::step(double simt, double simdt, const double* requests, double* levels) {
+	bool active = false;
+	double end = simt + simdt;
+	for (unsigned int i = 0; i < thrusters; ++i) {
+		levels[i] = 0.0;
+		double request = max(0.0, min(1.0, requests[i]));
+		if (request <= 0.0 && committed[i] <= 0.0) {
+			// A fraction of a bit left over when the requests stop would fire long after it was asked for
+			demand[i] = 0.0;
+			continue;
+		}
+		demand[i] += request * simdt;
+
+		if (committed[i] > 0.0) {
+			// An open valve stays open for whatever is asked meanwhile
+			committed[i] += demand[i];
+			demand[i] = 0.0;
+		}
+		else if (demand[i] >= minimumOnTime) {
+			// The valve is commanded as soon as the demand reaches the minimum on-time within this frame
+			double reached = end - (demand[i] - minimumOnTime) / request;
+			pulseStart[i] = max(simt, reached) + latency;
+			committed[i] = demand[i];
+			demand[i] = 0.0;
+			pulses++;
+		}
+
+		if (committed[i] > 0.0) {
+			double open = max(simt, pulseStart[i]);
+			double delivered = max(0.0, min(end, open + committed[i]) - open);
+			levels[i] = simdt > 0.0 ? delivered / simdt : 0.0;
+			committed[i] -= delivered;
+			if (committed[i] <= 1.0E-12) {
+				committed[i] = 0.0;
+			}
+			else if (delivered > 0.0) {
+				// The rest of the pulse continues at the start of the next frame
+				pulseStart[i] = end;
+			}
+			active = true;
+		}
+		active |= demand[i] > 0.0;
+	}
+	return active;
+}
+
+unsigned int PulseModulator::countPulses() const {
+	return pulses;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * \brief Turns continuous thruster levels into valve pulses, and the pulses back into levels per frame.
+ *
+ * Orbiter holds a thruster level for a whole frame. The modulator accumulates the requested on-time of every thruster
+ * (level times frame length) and opens the valve once the accumulated time reaches the minimum on-time, for exactly
+ * that time. Requests arriving while the valve is open extend the pulse. A pulse starts the valve latency after the
+ * command, which may be anywhere within a frame, and may end in a later frame; the level of a frame is the part of the
+ * frame the valve is open. Over time every thruster delivers the requested impulse, but never less than the
+ * minimum impulse bit at once.
+ *
+ * Opening and closing are taken to be equally late, so the latency shifts a pulse but does not change its length.
+ */
+class PulseModulator {
+public:
+	PulseModulator();
+
+	/* minimumOnTime and latency in s.
+	 */
+	void setThrusters(unsigned int thrusters, double minimumOnTime, double latency);
+
+	/* Levels for the frame from simt to simt + simdt, for requested levels in [0, 1] over the same frame.
+	 * Returns false if no valve is open and nothing is accumulated, so every level is 0.
+	 */
+	bool step(double simt, double simdt, const double* requests, double* levels);
+
+	//Pulses started since construction
+	unsigned int countPulses() const;
+
+private:
+	unsigned int thrusters;
+	double minimumOnTime;
+	double latency;
+
+	//On-time requested but not committed to a pulse yet, in s
+	std::vector<double> demand;
+	//Start of the current pulse and the on-time it still has to deliver, in s
+	std::vector<double> pulseStart;
+	std::vector<double> committed;
+	unsigned int pulses;
+};
@@ -10,7 +10,54 @@
 #include "core/OrbitalHauler.h"
 
 
-ReactionControlSystem::ReactionControlSystem(ThrusterConfig config, OrbitalHauler *vessel) : VesselSystem(vessel), config(config) {}
+/* Layout of the RCS if the configuration has none: four quads of two up and down thrusters at the corners,
+ * four lateral thrusters and one axial thruster at each end.
+ */
+static const double RCS_DEFAULT_POSITIONS[] = {
+	1, 0, 5,	1, 0, 5,	-1, 0, 5,	-1, 0, 5,
+	1, 0, -5,	1, 0, -5,	-1, 0, -5,	-1, 0, -5,
+	1, 0, 5,	-1, 0, 5,	1, 0, -5,	-1, 0, -5,
+	0, 0, -5,	0, 0, 5
+};
+static const double RCS_DEFAULT_DIRECTIONS[] = {
+	0, 1, 0,	0, -1, 0,	0, 1, 0,	0, -1, 0,
+	0, 1, 0,	0, -1, 0,	0, 1, 0,	0, -1, 0,
+	-1, 0, 0,	1, 0, 0,	-1, 0, 0,	1, 0, 0,
+	0, 0, 1,	0, 0, -1
+};
+
+/* Axis and sense of the force (0 to 2) or torque (3 to 5) each attitude group commands.
+ */
+static const struct {
+	THGROUP_TYPE group;
+	int axis;
+	double sign;
+} RCS_COMMANDS[RCS_COMMAND_GROUPS] = {
+	{ THGROUP_ATT_RIGHT, 0, 1.0 },
+	{ THGROUP_ATT_LEFT, 0, -1.0 },
+	{ THGROUP_ATT_UP, 1, 1.0 },
+	{ THGROUP_ATT_DOWN, 1, -1.0 },
+	{ THGROUP_ATT_FORWARD, 2, 1.0 },
+	{ THGROUP_ATT_BACK, 2, -1.0 },
+	{ THGROUP_ATT_PITCHDOWN, 3, 1.0 },
+	{ THGROUP_ATT_PITCHUP, 3, -1.0 },
+	{ THGROUP_ATT_YAWRIGHT, 4, 1.0 },
+	{ THGROUP_ATT_YAWLEFT, 4, -1.0 },
+	{ THGROUP_ATT_BANKLEFT, 5, 1.0 },
+	{ THGROUP_ATT_BANKRIGHT, 5, -1.0 }
+};
+
+
+ReactionControlSystem::ReactionControlSystem(ThrusterConfig config, OrbitalHauler *vessel, PROPELLANT_HANDLE propHandle) : VesselSystem(vessel, "ReactionControlSystem"), config(config), propHandle(propHandle) {
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		command[a] = 0.0;
+		autopilotCommand[a] = 0.0;
+	}
+	reallocate = true;
+	pulsing = false;
+	centerOfMass = _V(0, 0, 0);
+}
+
 ReactionControlSystem::~ReactionControlSystem() {}
 
 void ReactionControlSystem::init(EventBroker& eventBroker) {
@@ -19,87 +66,123 @@ void ReactionControlSystem::init(EventBroker& eventBroker) {
 	// create event subscriptions
 	eventBroker.subscribe((EventSubscriber*)this, EVENTTOPIC::GENERAL);
 
+	positions = config.positions;
+	directions = config.directions;
+	if (positions.empty() || positions.size() != directions.size() || positions.size() % 3 != 0) {
+		if (!positions.empty()) {
+			Olog::warn("RCS positions and directions don't match, using the default layout");
+		}
+		positions.assign(RCS_DEFAULT_POSITIONS, RCS_DEFAULT_POSITIONS + sizeof(RCS_DEFAULT_POSITIONS) / sizeof(double));
+		directions.assign(RCS_DEFAULT_DIRECTIONS, RCS_DEFAULT_DIRECTIONS + sizeof(RCS_DEFAULT_DIRECTIONS) / sizeof(double));
+	}
 
-	// Create the propellant tank.
-	double propMass = 500;
-	PROPELLANT_HANDLE propHandle = vessel->CreatePropellantResource(propMass);
-
-	// Create the RCS thrusters. 
-	// TODO: Arrange RCS thrusters into some smarter data structure so their creation can be written a bit more readable.
-	// This messy stuff is copied and modified from ShuttlePB because I'm lazy and they're not going to stay anyways. 
-	THRUSTER_HANDLE th_rcs[14], th_group[4];
-	double thrust = config.thrust;
-	double isp = config.isp;
-
-	th_rcs[0] = vessel->CreateThruster(_V(1, 0, 5), _V(0, 1, 0), thrust, propHandle, isp);
-	th_rcs[1] = vessel->CreateThruster(_V(1, 0, 5), _V(0, -1, 0), thrust, propHandle, isp);
-	th_rcs[2] = vessel->CreateThruster(_V(-1, 0, 5), _V(0, 1, 0), thrust, propHandle, isp);
-	th_rcs[3] = vessel->CreateThruster(_V(-1, 0, 5), _V(0, -1, 0), thrust, propHandle, isp);
-	th_rcs[4] = vessel->CreateThruster(_V(1, 0, -5), _V(0, 1, 0), thrust, propHandle, isp);
-	th_rcs[5] = vessel->CreateThruster(_V(1, 0, -5), _V(0, -1, 0), thrust, propHandle, isp);
-	th_rcs[6] = vessel->CreateThruster(_V(-1, 0, -5), _V(0, 1, 0), thrust, propHandle, isp);
-	th_rcs[7] = vessel->CreateThruster(_V(-1, 0, -5), _V(0, -1, 0), thrust, propHandle, isp);
-	th_rcs[8] = vessel->CreateThruster(_V(1, 0, 5), _V(-1, 0, 0), thrust, propHandle, isp);
-	th_rcs[9] = vessel->CreateThruster(_V(-1, 0, 5), _V(1, 0, 0), thrust, propHandle, isp);
-	th_rcs[10] = vessel->CreateThruster(_V(1, 0, -5), _V(-1, 0, 0), thrust, propHandle, isp);
-	th_rcs[11] = vessel->CreateThruster(_V(-1, 0, -5), _V(1, 0, 0), thrust, propHandle, isp);
-	th_rcs[12] = vessel->CreateThruster(_V(0, 0, -5), _V(0, 0, 1), thrust, propHandle, isp);
-	th_rcs[13] = vessel->CreateThruster(_V(0, 0, 5), _V(0, 0, -1), thrust, propHandle, isp);
-
-	th_group[0] = th_rcs[0];
-	th_group[1] = th_rcs[2];
-	th_group[2] = th_rcs[5];
-	th_group[3] = th_rcs[7];
-	vessel->CreateThrusterGroup(th_group, 4, THGROUP_ATT_PITCHUP);
-
-	th_group[0] = th_rcs[1];
-	th_group[1] = th_rcs[3];
-	th_group[2] = th_rcs[4];
-	th_group[3] = th_rcs[6];
-	vessel->CreateThrusterGroup(th_group, 4, THGROUP_ATT_PITCHDOWN);
-
-	th_group[0] = th_rcs[0];
-	th_group[1] = th_rcs[4];
-	th_group[2] = th_rcs[3];
-	th_group[3] = th_rcs[7];
-	vessel->CreateThrusterGroup(th_group, 4, THGROUP_ATT_BANKLEFT);
-
-	th_group[0] = th_rcs[1];
-	th_group[1] = th_rcs[5];
-	th_group[2] = th_rcs[2];
-	th_group[3] = th_rcs[6];
-	vessel->CreateThrusterGroup(th_group, 4, THGROUP_ATT_BANKRIGHT);
-
-	th_group[0] = th_rcs[0];
-	th_group[1] = th_rcs[4];
-	th_group[2] = th_rcs[2];
-	th_group[3] = th_rcs[6];
-	vessel->CreateThrusterGroup(th_group, 4, THGROUP_ATT_UP);
-
-	th_group[0] = th_rcs[1];
-	th_group[1] = th_rcs[5];
-	th_group[2] = th_rcs[3];
-	th_group[3] = th_rcs[7];
-	vessel->CreateThrusterGroup(th_group, 4, THGROUP_ATT_DOWN);
-
-	th_group[0] = th_rcs[8];
-	th_group[1] = th_rcs[11];
-	vessel->CreateThrusterGroup(th_group, 2, THGROUP_ATT_YAWLEFT);
-
-	th_group[0] = th_rcs[9];
-	th_group[1] = th_rcs[10];
-	vessel->CreateThrusterGroup(th_group, 2, THGROUP_ATT_YAWRIGHT);
-
-	th_group[0] = th_rcs[8];
-	th_group[1] = th_rcs[10];
-	vessel->CreateThrusterGroup(th_group, 2, THGROUP_ATT_LEFT);
-
-	th_group[0] = th_rcs[9];
-	th_group[1] = th_rcs[11];
-	vessel->CreateThrusterGroup(th_group, 2, THGROUP_ATT_RIGHT);
-
-	vessel->CreateThrusterGroup(th_rcs + 12, 1, THGROUP_ATT_FORWARD);
-	vessel->CreateThrusterGroup(th_rcs + 13, 1, THGROUP_ATT_BACK);
+	for (size_t i = 0; i + 2 < positions.size(); i += 3) {
+		thrusters.push_back(vessel->CreateThruster(_V(positions[i], positions[i + 1], positions[i + 2]),
+			_V(directions[i], directions[i + 1], directions[i + 2]), config.thrust, propHandle, config.isp));
+	}
+	levels.assign(thrusters.size(), 0.0);
+	applied.assign(thrusters.size(), 0.0);
+	layout();
+	Olog::info("RCS with %d thrusters", (int)thrusters.size());
+	if (config.pulsed) {
+		pulseLevels.assign(thrusters.size(), 0.0);
+		modulator.setThrusters((unsigned int)thrusters.size(), config.minimumOnTime, config.valveLatency);
+		Olog::info("RCS pulsed, minimum impulse bit %.1f Ns", config.minimumOnTime * config.thrust);
+	}
+
+	// One thruster without thrust per attitude group, only to capture its level
+	for (int g = 0; g < RCS_COMMAND_GROUPS; ++g) {
+		THRUSTER_HANDLE proxy = vessel->CreateThruster(_V(0, 0, 0), _V(0, 0, 1), 0.0, propHandle, config.isp);
+		vessel->CreateThrusterGroup(&proxy, 1, RCS_COMMANDS[g].group);
+	}
+}
+
+void ReactionControlSystem::preStep(double simt, double simdt, double mjd) {
+	double current[WRENCH_AXES];
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		current[a] = autopilotCommand[a];
+	}
+	for (int g = 0; g < RCS_COMMAND_GROUPS; ++g) {
+		current[RCS_COMMANDS[g].axis] += RCS_COMMANDS[g].sign * vessel->GetThrusterGroupLevel(RCS_COMMANDS[g].group);
+	}
+
+	// Most frames repeat the command of the last one
+	bool changed = reallocate;
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		current[a] = max(-1.0, min(1.0, current[a]));
+		changed |= current[a] != command[a];
+		command[a] = current[a];
+	}
+	if (changed) {
+		allocator.allocate(command, levels.data());
+		reallocate = false;
+	}
+
+	if (config.pulsed) {
+		// The pulses run on while the command holds, until nothing is left to fire
+		if (changed || pulsing) {
+			pulsing = modulator.step(simt, simdt, levels.data(), pulseLevels.data());
+			applyLevels(pulseLevels);
+		}
+	}
+	else if (changed) {
+		applyLevels(levels);
+	}
+}
+
+void ReactionControlSystem::layout() {
+	std::vector<double> relative = positions;
+	for (size_t i = 0; i < relative.size(); ++i) {
+		relative[i] -= centerOfMass.data[i % 3];
+	}
+	// The allocator forgets the failures with a new layout, they are carried over to it
+	std::vector<bool> failed(thrusters.size());
+	for (unsigned int i = 0; i < thrusters.size(); ++i) {
+		failed[i] = i < allocator.countThrusters() && allocator.isFailed(i);
+	}
+	allocator.setLayout(relative, directions, config.thrust);
+	for (unsigned int i = 0; i < thrusters.size(); ++i) {
+		allocator.setFailed(i, failed[i]);
+	}
+	reallocate = true;
+}
+
+void ReactionControlSystem::applyLevels(const std::vector<double>& target) {
+	for (size_t i = 0; i < thrusters.size(); ++i) {
+		if (target[i] != applied[i]) {
+			vessel->SetThrusterLevel(thrusters[i], target[i]);
+			applied[i] = target[i];
+		}
+	}
+}
+
+void ReactionControlSystem::setThrusterFailed(unsigned int thruster, bool failed) {
+	if (thruster < thrusters.size() && allocator.isFailed(thruster) != failed) {
+		allocator.setFailed(thruster, failed);
+		reallocate = true;
+	}
+}
+
+bool ReactionControlSystem::isThrusterFailed(unsigned int thruster) const {
+	return allocator.isFailed(thruster);
+}
+
+unsigned int ReactionControlSystem::countThrusters() const {
+	return (unsigned int)thrusters.size();
+}
+
+const ThrusterAllocator& ReactionControlSystem::getAllocator() const {
+	return allocator;
+}
+
+const PulseModulator& ReactionControlSystem::getModulator() const {
+	return modulator;
+}
+
+void ReactionControlSystem::setAutopilotCommand(const double command[WRENCH_AXES]) {
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		autopilotCommand[a] = command[a];
+	}
 }
 
 
@@ -108,4 +191,11 @@ void ReactionControlSystem::receiveEvent(Event_Base* event, EVENTTOPIC topic) {
 	if (*event == EVENTTYPE::SIMULATIONSTARTEDEVENT) {
 		Olog::info("RCS received sim started event!");
 	}
+	else if (*event == EVENTTYPE::STACKCHANGEDEVENT) {
+		VECTOR3 shifted = ((StackChangedEvent*)event)->getCenterOfMass();
+		if (length(shifted - centerOfMass) > RCS_CENTER_OF_MASS_TOLERANCE) {
+			centerOfMass = shifted;
+			layout();
+		}
+	}
 }
@@ -1,19 +1,71 @@
 #pragma once
 
+#include <vector>
+#include "ThrusterAllocator.h"
+#include "PulseModulator.h"
+
+//Orbiter attitude thruster groups the RCS takes its command from
+const int RCS_COMMAND_GROUPS = 12;
+//Shift of the center of mass in m below which the RCS keeps its layout
+const double RCS_CENTER_OF_MASS_TOLERANCE = 0.01;
+
+/* The RCS thrusters are laid out by the configuration and fired by a ThrusterAllocator.
+ * Orbiter's attitude groups only hold thrusters without thrust: manual input and navigation modes set their levels,
+ * which the RCS reads back as a force and torque command and allocates over the real thrusters.
+ * In pulsed mode a PulseModulator turns the allocated levels into valve pulses.
+ * The allocation works about the center of mass of the docked stack and is laid out again when it moves.
+ */
 class ReactionControlSystem :
     public VesselSystem
 {
 public:
-    ReactionControlSystem(ThrusterConfig config, OrbitalHauler* vessel);
+    ReactionControlSystem(ThrusterConfig config, OrbitalHauler* vessel, PROPELLANT_HANDLE propHandle);
     ~ReactionControlSystem();
 
     void init(EventBroker& eventBroker);
+    void preStep(double simt, double simdt, double mjd);
+
+    /* Failed thrusters stay off, the allocation works around them.
+     */
+    void setThrusterFailed(unsigned int thruster, bool failed);
+    bool isThrusterFailed(unsigned int thruster) const;
+    unsigned int countThrusters() const;
+    const ThrusterAllocator& getAllocator() const;
+    const PulseModulator& getModulator() const;
+
+    /* Command of the autopilot relative to the wrench limits, added to the manual one until it is set again.
+     */
+    void setAutopilotCommand(const double command[WRENCH_AXES]);
 
 protected:
     virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
 
 private:
     ThrusterConfig config;
+    //RCS accumulator, refilled by the propellant tanks
+    PROPELLANT_HANDLE propHandle;
 
-};
+    ThrusterAllocator allocator;
+    std::vector<THRUSTER_HANDLE> thrusters;
+    //Layout relative to the vessel origin, and the center of mass the allocator works about
+    std::vector<double> positions;
+    std::vector<double> directions;
+    VECTOR3 centerOfMass;
+    std::vector<double> levels;
+    //Command of the last allocation, relative to the wrench limits
+    double command[WRENCH_AXES];
+    double autopilotCommand[WRENCH_AXES];
+    //Set when the layout changed and the levels have to be allocated again
+    bool reallocate;
+
+    PulseModulator modulator;
+    std::vector<double> pulseLevels;
+    //Set while the modulator has pulses to fire or on-time accumulated
+    bool pulsing;
+    //Levels last set on the thrusters, only changes are passed to Orbiter
+    std::vector<double> applied;
 
+    void applyLevels(const std::vector<double>& target);
+    void layout();
+
+};
@@ -0,0 +1,255 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "core/Trace.h"
+
+#include "ThrusterAllocator.h"
+
+//Regularization of the normal equations relative to their mean diagonal, keeps rank deficient layouts solvable
+const double ALLOCATOR_REGULARIZATION = 1.0E-9;
+//Relative residual up to which a command counts as produced
+const double ALLOCATOR_TOLERANCE = 1.0E-6;
+
+
+/* Solves m x = b in place for a symmetric positive definite 6x6 matrix.
+ */
+static void choleskySolve(double m[WRENCH_AXES * WRENCH_AXES], double b[WRENCH_AXES]) {
+	const int n = WRENCH_AXES;
+	for (int j = 0; j < n; ++j) {
+		double diagonal = m[j * n + j];
+		for (int k = 0; k < j; ++k) {
+			diagonal -= m[j * n + k] * m[j * n + k];
+		}
+		diagonal = sqrt(max(diagonal, 1.0E-300));
+		m[j * n + j] = diagonal;
+		for (int i = j + 1; i < n; ++i) {
+			double value = m[i * n + j];
+			for (int k = 0; k < j; ++k) {
+				value -= m[i * n + k] * m[j * n + k];
+			}
+			m[i * n + j] = value / diagonal;
+		}
+	}
+	for (int i = 0; i < n; ++i) {
+		for (int k = 0; k < i; ++k) {
+			b[i] -= m[i * n + k] * b[k];
+		}
+		b[i] /= m[i * n + i];
+	}
+	for (int i = n - 1; i >= 0; --i) {
+		for (int k = i + 1; k < n; ++k) {
+			b[i] -= m[k * n + i] * b[k];
+		}
+		b[i] /= m[i * n + i];
+	}
+}
+
+
+ThrusterAllocator::ThrusterAllocator() {
+	thrusters = 0;
+	rebuilds = 0;
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		wrenchLimit[a] = 0.0;
+	}
+}
+
+void ThrusterAllocator::setLayout(const std::vector<double>& positions, const std::vector<double>& directions, double thrust) {
+	thrusters = (unsigned int)(min(positions.size(), directions.size()) / 3);
+	effectiveness.assign(WRENCH_AXES * thrusters, 0.0);
+	for (unsigned int i = 0; i < thrusters; ++i) {
+		const double* r = &positions[3 * i];
+		double d[3] = { directions[3 * i], directions[3 * i + 1], directions[3 * i + 2] };
+		double length = sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+		for (int k = 0; k < 3; ++k) {
+			d[k] = length > 0.0 ? d[k] / length * thrust : 0.0;
+		}
+		//Force, then the torque r x F
+		double column[WRENCH_AXES] = { d[0], d[1], d[2], r[1] * d[2] - r[2] * d[1], r[2] * d[0] - r[0] * d[2], r[0] * d[1] - r[1] * d[0] };
+		for (int a = 0; a < WRENCH_AXES; ++a) {
+			effectiveness[a * thrusters + i] = column[a];
+		}
+	}
+	failed.assign(thrusters, false);
+	free.assign(thrusters, false);
+	solution.assign(thrusters, 0.0);
+	rebuild();
+}
+
+void ThrusterAllocator::setFailed(unsigned int thruster, bool failed) {
+	if (thruster < thrusters && this->failed[thruster] != failed) {
+		this->failed[thruster] = failed;
+		rebuild();
+	}
+}
+
+bool ThrusterAllocator::isFailed(unsigned int thruster) const {
+	return thruster < thrusters ? failed[thruster] : true;
+}
+
+unsigned int ThrusterAllocator::countThrusters() const {
+	return thrusters;
+}
+
+double ThrusterAllocator::getWrenchLimit(int axis) const {
+	return axis >= 0 && axis < WRENCH_AXES ? wrenchLimit[axis] : 0.0;
+}
+
+unsigned int ThrusterAllocator::countRebuilds() const {
+	return rebuilds;
+}
+
+void ThrusterAllocator::rebuild() {
+	OH_TRACE_SCOPE("ThrusterAllocator::rebuild");
+	//Pseudo-inverse B^T (B B^T)^-1 over the working thrusters
+	double normal[WRENCH_AXES * WRENCH_AXES] = { 0.0 };
+	for (unsigned int i = 0; i < thrusters; ++i) {
+		if (failed[i]) continue;
+		for (int a = 0; a < WRENCH_AXES; ++a) {
+			for (int b = 0; b < WRENCH_AXES; ++b) {
+				normal[a * WRENCH_AXES + b] += effectiveness[a * thrusters + i] * effectiveness[b * thrusters + i];
+			}
+		}
+	}
+	double trace = 0.0;
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		trace += normal[a * WRENCH_AXES + a];
+	}
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		normal[a * WRENCH_AXES + a] += ALLOCATOR_REGULARIZATION * max(trace / WRENCH_AXES, 1.0);
+	}
+
+	pseudoInverse.assign(thrusters * WRENCH_AXES, 0.0);
+	for (unsigned int i = 0; i < thrusters; ++i) {
+		if (failed[i]) continue;
+		double factor[WRENCH_AXES * WRENCH_AXES];
+		double row[WRENCH_AXES];
+		for (int k = 0; k < WRENCH_AXES * WRENCH_AXES; ++k) factor[k] = normal[k];
+		for (int a = 0; a < WRENCH_AXES; ++a) row[a] = effectiveness[a * thrusters + i];
+		choleskySolve(factor, row);
+		for (int a = 0; a < WRENCH_AXES; ++a) pseudoInverse[i * WRENCH_AXES + a] = row[a];
+	}
+
+	//A unit wrench is far from the upper limits, so the levels scale linearly up to the first saturated thruster
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		double limit = 0.0;
+		for (int sign = -1; sign <= 1; sign += 2) {
+			double wrench[WRENCH_AXES] = { 0.0 };
+			wrench[a] = sign;
+			bool exact = solve(wrench, &solution[0]);
+			double peak = 0.0;
+			for (unsigned int i = 0; i < thrusters; ++i) {
+				peak = max(peak, solution[i]);
+			}
+			double reach = exact && peak > 0.0 ? 1.0 / peak : 0.0;
+			limit = sign < 0 ? reach : min(limit, reach);
+		}
+		wrenchLimit[a] = limit;
+	}
+	rebuilds++;
+}
+
+bool ThrusterAllocator::allocate(const double command[WRENCH_AXES], double* levels) {
+	double wrench[WRENCH_AXES];
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		wrench[a] = max(-1.0, min(1.0, command[a])) * wrenchLimit[a];
+	}
+	return solve(wrench, levels);
+}
+
+bool ThrusterAllocator::solveFree(const double wrench[WRENCH_AXES], double* levels) {
+	double normal[WRENCH_AXES * WRENCH_AXES] = { 0.0 };
+	double trace = 0.0;
+	bool any = false;
+	for (unsigned int i = 0; i < thrusters; ++i) {
+		if (!free[i]) continue;
+		any = true;
+		for (int a = 0; a < WRENCH_AXES; ++a) {
+			for (int b = 0; b <= a; ++b) {
+				normal[a * WRENCH_AXES + b] += effectiveness[a * thrusters + i] * effectiveness[b * thrusters + i];
+			}
+		}
+	}
+	if (!any) {
+		return false;
+	}
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		for (int b = a + 1; b < WRENCH_AXES; ++b) {
+			normal[a * WRENCH_AXES + b] = normal[b * WRENCH_AXES + a];
+		}
+		trace += normal[a * WRENCH_AXES + a];
+	}
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		normal[a * WRENCH_AXES + a] += ALLOCATOR_REGULARIZATION * max(trace / WRENCH_AXES, 1.0);
+	}
+
+	double multiplier[WRENCH_AXES];
+	for (int a = 0; a < WRENCH_AXES; ++a) multiplier[a] = wrench[a];
+	choleskySolve(normal, multiplier);
+	for (unsigned int i = 0; i < thrusters; ++i) {
+		if (!free[i]) continue;
+		double level = 0.0;
+		for (int a = 0; a < WRENCH_AXES; ++a) {
+			level += effectiveness[a * thrusters + i] * multiplier[a];
+		}
+		levels[i] = level;
+	}
+	return true;
+}
+
+bool ThrusterAllocator::solve(const double wrench[WRENCH_AXES], double* levels) {
+	//Unconstrained solution from the cached pseudo-inverse
+	for (unsigned int i = 0; i < thrusters; ++i) {
+		free[i] = !failed[i];
+		double level = 0.0;
+		if (free[i]) {
+			for (int a = 0; a < WRENCH_AXES; ++a) {
+				level += pseudoInverse[i * WRENCH_AXES + a] * wrench[a];
+			}
+		}
+		levels[i] = level;
+	}
+
+	//Fix the thrusters beyond their limits and solve for the rest of the command over the others
+	for (unsigned int iteration = 0; iteration < thrusters; ++iteration) {
+		bool clamped = false;
+		for (unsigned int i = 0; i < thrusters; ++i) {
+			if (free[i] && (levels[i] < 0.0 || levels[i] > 1.0)) {
+				levels[i] = max(0.0, min(1.0, levels[i]));
+				free[i] = false;
+				clamped = true;
+			}
+		}
+		if (!clamped) {
+			break;
+		}
+
+		double residual[WRENCH_AXES];
+		for (int a = 0; a < WRENCH_AXES; ++a) {
+			residual[a] = wrench[a];
+			for (unsigned int i = 0; i < thrusters; ++i) {
+				if (!free[i] && !failed[i]) {
+					residual[a] -= effectiveness[a * thrusters + i] * levels[i];
+				}
+			}
+		}
+		if (!solveFree(residual, levels)) {
+			break;
+		}
+	}
+
+	double error = 0.0;
+	double scale = 0.0;
+	for (int a = 0; a < WRENCH_AXES; ++a) {
+		double produced = 0.0;
+		for (unsigned int i = 0; i < thrusters; ++i) {
+			if (failed[i]) {
+				levels[i] = 0.0;
+			}
+			levels[i] = max(0.0, min(1.0, levels[i]));
+			produced += effectiveness[a * thrusters + i] * levels[i];
+		}
+		error += (produced - wrench[a]) * (produced - wrench[a]);
+		scale += wrench[a] * wrench[a];
+	}
+	return error <= ALLOCATOR_TOLERANCE * ALLOCATOR_TOLERANCE * max(scale, 1.0);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+
+//Force x, y, z and torque x, y, z
+const int WRENCH_AXES = 6;
+
+/**
+ * \brief Maps a force and torque command onto the levels of an arbitrary layout of thrusters.
+ *
+ * Every thruster contributes its thrust and the torque of its thrust about the center of mass, the columns of the
+ * effectiveness matrix. The levels are the smallest ones (in the least squares sense) that produce the command, and
+ * each level is limited to [0, 1]: the cached pseudo-inverse of the matrix gives the unconstrained solution, then
+ * thrusters beyond their limits are fixed there and the rest of the command is solved again over the remaining ones,
+ * until all levels are in range. The remaining solves only factor a 6x6 matrix.
+ *
+ * The pseudo-inverse and the largest wrench the layout can produce on every axis are only computed again when the
+ * layout changes, e.g. after a thruster failed.
+ */
+class ThrusterAllocator {
+public:
+	ThrusterAllocator();
+
+	/* positions and directions are x, y, z per thruster, relative to the center of mass. thrust in N.
+	 */
+	void setLayout(const std::vector<double>& positions, const std::vector<double>& directions, double thrust);
+	//Failed thrusters stay at level 0
+	void setFailed(unsigned int thruster, bool failed);
+	bool isFailed(unsigned int thruster) const;
+	unsigned int countThrusters() const;
+
+	/* Levels for a command relative to the largest wrench on every axis, each in [-1, 1].
+	 * levels needs room for countThrusters() values. Returns false if the command can't be produced exactly.
+	 */
+	bool allocate(const double command[WRENCH_AXES], double* levels);
+	//Largest force in N or torque in Nm the layout can produce along an axis in both directions
+	double getWrenchLimit(int axis) const;
+	//Layout changes since construction, the wrench limits of users are stale when this moved
+	unsigned int countRebuilds() const;
+
+private:
+	unsigned int thrusters;
+	//6 x thrusters, row major
+	std::vector<double> effectiveness;
+	//thrusters x 6, row major, of the thrusters that have not failed
+	std::vector<double> pseudoInverse;
+	std::vector<bool> failed;
+	double wrenchLimit[WRENCH_AXES];
+	unsigned int rebuilds;
+
+	//Scratch space of the constrained solve
+	std::vector<bool> free;
+	std::vector<double> solution;
+
+	void rebuild();
+	bool solveFree(const double wrench[WRENCH_AXES], double* levels);
+	bool solve(const double wrench[WRENCH_AXES], double* levels);
+};
@@ -0,0 +1,187 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "core/Trace.h"
+
+#include "FeedNetwork.h"
+
+
+FeedNetwork::FeedNetwork() {
+	dirty = true;
+	solves = 0;
+}
+
+int FeedNetwork::addTank(unsigned int tank) {
+	if (tank >= tankAvailable.size()) {
+		tankAvailable.resize(tank + 1, false);
+	}
+	tankAvailable[tank] = true;
+	for (auto& it : fractions) {
+		it.resize(tankAvailable.size(), 0.0);
+	}
+	nodes.push_back(Node{ NodeType::TANK, tank });
+	dirty = true;
+	return (int)nodes.size() - 1;
+}
+
+int FeedNetwork::addJunction() {
+	nodes.push_back(Node{ NodeType::JUNCTION, 0 });
+	return (int)nodes.size() - 1;
+}
+
+int FeedNetwork::addConsumer() {
+	nodes.push_back(Node{ NodeType::CONSUMER, (unsigned int)fractions.size() });
+	fractions.push_back(std::vector<double>(tankAvailable.size(), 0.0));
+	dirty = true;
+	return (int)nodes.size() - 1;
+}
+
+int FeedNetwork::addLine(int from, int to, double conductance, bool open) {
+	lines.push_back(Line{ from, to, conductance, open });
+	dirty = true;
+	return (int)lines.size() - 1;
+}
+
+void FeedNetwork::setLineOpen(int line, bool open) {
+	if (line >= 0 && line < (int)lines.size() && lines[line].open != open) {
+		lines[line].open = open;
+		dirty = true;
+	}
+}
+
+bool FeedNetwork::isLineOpen(int line) const {
+	return line >= 0 && line < (int)lines.size() && lines[line].open;
+}
+
+void FeedNetwork::setTankAvailable(unsigned int tank, bool available) {
+	if (tank < tankAvailable.size() && tankAvailable[tank] != available) {
+		tankAvailable[tank] = available;
+		dirty = true;
+	}
+}
+
+const std::vector<double>& FeedNetwork::getFractions(int consumer) {
+	if (dirty) {
+		solve();
+	}
+	return fractions[nodes[consumer].index];
+}
+
+bool FeedNetwork::feeds(int consumer, unsigned int tank) {
+	const std::vector<double>& split = getFractions(consumer);
+	return tank < split.size() && split[tank] > 0.0;
+}
+
+unsigned int FeedNetwork::countSolves() const {
+	return solves;
+}
+
+void FeedNetwork::solve() {
+	OH_TRACE_SCOPE("FeedNetwork::solve");
+	for (int i = 0; i < (int)nodes.size(); ++i) {
+		if (nodes[i].type == NodeType::CONSUMER) {
+			solveConsumer(i);
+		}
+	}
+	dirty = false;
+	solves++;
+}
+
+void FeedNetwork::solveConsumer(int consumer) {
+	std::vector<double>& split = fractions[nodes[consumer].index];
+	split.assign(tankAvailable.size(), 0.0);
+
+	//Nodes the consumer reaches over open lines
+	std::vector<bool> connected(nodes.size(), false);
+	std::vector<int> pending(1, consumer);
+	connected[consumer] = true;
+	while (!pending.empty()) {
+		int node = pending.back();
+		pending.pop_back();
+		for (const auto& line : lines) {
+			int other = line.from == node ? line.to : (line.to == node ? line.from : -1);
+			if (line.open && other >= 0 && !connected[other]) {
+				connected[other] = true;
+				pending.push_back(other);
+			}
+		}
+	}
+
+	//Tanks with liquid have head 1, the consumer 0, every other connected node is unknown
+	auto source = [&](int node) {
+		return nodes[node].type == NodeType::TANK && tankAvailable[nodes[node].index];
+	};
+	unknown.assign(nodes.size(), -1);
+	int n = 0;
+	for (int i = 0; i < (int)nodes.size(); ++i) {
+		if (connected[i] && i != consumer && !source(i)) {
+			unknown[i] = n++;
+		}
+	}
+
+	//Kirchhoff at every unknown node: conductance matrix and the inflow from the fixed heads
+	matrix.assign(n * n, 0.0);
+	head.assign(n, 0.0);
+	for (const auto& line : lines) {
+		if (!line.open || !connected[line.from]) {
+			continue;
+		}
+		int ends[2] = { line.from, line.to };
+		for (int e = 0; e < 2; ++e) {
+			int row = unknown[ends[e]];
+			int column = unknown[ends[1 - e]];
+			if (row < 0) {
+				continue;
+			}
+			matrix[row * n + row] += line.conductance;
+			if (column >= 0) {
+				matrix[row * n + column] -= line.conductance;
+			}
+			else if (source(ends[1 - e])) {
+				head[row] += line.conductance;
+			}
+		}
+	}
+
+	//Every unknown node connects to the consumer, so the matrix is positive definite and needs no pivoting
+	for (int k = 0; k < n; ++k) {
+		for (int i = k + 1; i < n; ++i) {
+			double factor = matrix[i * n + k] / matrix[k * n + k];
+			if (factor == 0.0) {
+				continue;
+			}
+			for (int j = k; j < n; ++j) {
+				matrix[i * n + j] -= factor * matrix[k * n + j];
+			}
+			head[i] -= factor * head[k];
+		}
+	}
+	for (int k = n - 1; k >= 0; --k) {
+		for (int j = k + 1; j < n; ++j) {
+			head[k] -= matrix[k * n + j] * head[j];
+		}
+		head[k] /= matrix[k * n + k];
+	}
+
+	//Flow out of every tank with liquid
+	double total = 0.0;
+	for (const auto& line : lines) {
+		if (!line.open || !connected[line.from]) {
+			continue;
+		}
+		int ends[2] = { line.from, line.to };
+		for (int e = 0; e < 2; ++e) {
+			if (!source(ends[e])) {
+				continue;
+			}
+			int other = ends[1 - e];
+			double otherHead = source(other) ? 1.0 : (unknown[other] >= 0 ? head[unknown[other]] : 0.0);
+			double flow = line.conductance * (1.0 - otherHead);
+			split[nodes[ends[e]].index] += flow;
+			total += flow;
+		}
+	}
+	for (auto& it : split) {
+		it = total > 0.0 ? it / total : 0.0;
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * \brief Plumbing between propellant tanks and their consumers, and how a consumer's flow splits over the tanks.
+ *
+ * Nodes are tanks, junctions (manifolds, sumps) and consumers, connected by lines of a given hydraulic conductance,
+ * each of which can be closed by a valve. For the split, all tanks with liquid are taken at the same head and the
+ * consumer as the only sink: the node heads then follow from the linear network of conductances, and the flow out of
+ * every tank from the heads of its neighbours.
+ *
+ * The split only changes when a valve moves or a tank runs dry, so it is solved for all consumers once after such a
+ * change and cached. Reading the fractions in between costs nothing.
+ */
+class FeedNetwork {
+public:
+	FeedNetwork();
+
+	/* Add nodes, returning their node id. tank is the index of the tank in the tank arrays of the owner.
+	 */
+	int addTank(unsigned int tank);
+	int addJunction();
+	int addConsumer();
+	/* Adds a line between two nodes and returns its id. conductance is relative to the other lines.
+	 */
+	int addLine(int from, int to, double conductance, bool open = true);
+
+	void setLineOpen(int line, bool open);
+	bool isLineOpen(int line) const;
+	/* Tanks without liquid take no part in the split.
+	 */
+	void setTankAvailable(unsigned int tank, bool available);
+
+	/* Fractions of the flow of a consumer node drawn from each tank, indexed by tank.
+	 * All zero if no tank with liquid is connected. Solves the network first if it changed since the last call.
+	 */
+	const std::vector<double>& getFractions(int consumer);
+	//Whether a consumer node draws from a tank under the current valve positions
+	bool feeds(int consumer, unsigned int tank);
+
+	//Network solutions since construction
+	unsigned int countSolves() const;
+
+private:
+	enum class NodeType { TANK, JUNCTION, CONSUMER };
+
+	struct Node {
+		NodeType type;
+		//Tank index for tanks, slot in fractions for consumers
+		unsigned int index;
+	};
+
+	struct Line {
+		int from;
+		int to;
+		double conductance;
+		bool open;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<Line> lines;
+	std::vector<bool> tankAvailable;
+	//Per consumer slot, fractions by tank
+	std::vector<std::vector<double>> fractions;
+	bool dirty;
+	unsigned int solves;
+
+	//Scratch space of the solver
+	std::vector<int> unknown;
+	std::vector<double> matrix;
+	std::vector<double> head;
+
+	void solve();
+	void solveConsumer(int consumer);
+};
@@ -0,0 +1,352 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+#include "event/Events.h"
+#include "systems/VesselSystem.h"
+#include "systems/telemetry/TelemetryRecorder.h"
+
+#include "core/OrbitalHauler.h"
+#include "PropellantTanks.h"
+
+
+PropellantTanks::PropellantTanks(OrbitalHauler* vessel, const PropellantTankConfig& config, PROPELLANT_HANDLE phLH2, PROPELLANT_HANDLE phLO2, PROPELLANT_HANDLE phRCS) :
+	VesselSystem(vessel, "PropellantTanks"), config(config), phLH2(phLH2), phLO2(phLO2), phRCS(phRCS)
+{
+	syncedLH2 = 0.0;
+	syncedLO2 = 0.0;
+	syncedOffline = 0.0;
+	seenLH2 = 0.0;
+	seenLO2 = 0.0;
+	rcsRefill = 0.0;
+	dryMass = 0.0;
+	synced = false;
+	frames = 0;
+	skippedTime = 0.0;
+
+	for (unsigned int i = 0; i < PROPELLANT_TANK_LANES; ++i) {
+		//The unused lane gets the properties of an LH2 tank, but no volume to fill and no heat leak
+		bool lo2 = i == LO2_TANK;
+		bool unused = i >= PROPELLANT_TANKS;
+		const CryoFluid& fluid = lo2 ? LO2_FLUID : LH2_FLUID;
+		const CryoTankConfig& tank = lo2 ? config.lo2 : config.lh2;
+
+		volume[i] = unused ? 1.0 : tank.volume;
+		heatLeak[i] = unused ? 0.0 : tank.heatLeak;
+		liquidDensity[i] = fluid.liquidDensity;
+		liquidHeat[i] = fluid.liquidHeat;
+		latentHeat[i] = fluid.latentHeat;
+		gasConstant[i] = fluid.gasConstant;
+		vaporHeat[i] = fluid.vaporHeat;
+		saturationSlope[i] = fluid.latentHeat / fluid.gasConstant;
+		saturationReference[i] = 1.0 / fluid.boilingPoint;
+		minimumTemperature[i] = fluid.triplePoint;
+		capacity[i] = unused ? 0.0 : (lo2 ? TUG_LO2TANK_MAXIMUM_MASS : TUG_LH2TANK_MAXIMUM_MASS / TUG_NUMBER_LH2_TANKS);
+
+		//Inverse of the saturation curve
+		double relief = 1.0 / (saturationReference[i] - log(tank.reliefPressure / NORMAL_PRESSURE) / saturationSlope[i]);
+		double initial = 1.0 / (saturationReference[i] - log(tank.initialPressure / NORMAL_PRESSURE) / saturationSlope[i]);
+		reliefTemperature[i] = relief;
+		reliefPressure[i] = tank.reliefPressure;
+		temperature[i] = max(min(initial, relief), fluid.triplePoint);
+
+		liquidMass[i] = 0.0;
+		vaporMass[i] = 0.0;
+		ventedMass[i] = 0.0;
+		pressurizationPower[i] = 0.0;
+		leakRate[i] = 0.0;
+		leakedMass[i] = 0.0;
+	}
+	pressure = vaporDensity(temperature) * gasConstant * temperature;
+
+	//Tanks 1 to 3 and 4 to 6 share a manifold each, both manifolds meet in the sump
+	int port = feed.addJunction();
+	int starboard = feed.addJunction();
+	int sump = feed.addJunction();
+	for (unsigned int i = 0; i < TUG_NUMBER_LH2_TANKS; ++i) {
+		tankValves[i] = feed.addLine(feed.addTank(i), i < TUG_NUMBER_LH2_TANKS / 2 ? port : starboard, FEED_TANK_CONDUCTANCE);
+	}
+	valves[(int)FEEDVALVE::PORT_MANIFOLD] = feed.addLine(port, sump, FEED_MANIFOLD_CONDUCTANCE);
+	valves[(int)FEEDVALVE::STARBOARD_MANIFOLD] = feed.addLine(starboard, sump, FEED_MANIFOLD_CONDUCTANCE);
+
+	int lo2Outlet = feed.addJunction();
+	tankValves[LO2_TANK] = feed.addLine(feed.addTank(LO2_TANK), lo2Outlet, FEED_TANK_CONDUCTANCE);
+
+	engineLH2 = feed.addConsumer();
+	engineLO2 = feed.addConsumer();
+	rcsAccumulator = feed.addConsumer();
+	valves[(int)FEEDVALVE::ENGINE_LH2] = feed.addLine(sump, engineLH2, FEED_LINE_CONDUCTANCE);
+	valves[(int)FEEDVALVE::ENGINE_LO2] = feed.addLine(lo2Outlet, engineLO2, FEED_LINE_CONDUCTANCE);
+	valves[(int)FEEDVALVE::RCS] = feed.addLine(sump, rcsAccumulator, FEED_LINE_CONDUCTANCE);
+}
+
+PropellantTanks::~PropellantTanks() {}
+
+void PropellantTanks::init(EventBroker& eventBroker) {
+	Olog::trace("Propellant tanks init");
+}
+
+void PropellantTanks::receiveEvent(Event_Base* event, EVENTTOPIC topic) {}
+
+void PropellantTanks::registerTelemetry(TelemetryRecorder& recorder) {
+	static const char* pressureNames[PROPELLANT_TANKS] = {
+		"lh2Tank1Pressure", "lh2Tank2Pressure", "lh2Tank3Pressure", "lh2Tank4Pressure", "lh2Tank5Pressure", "lh2Tank6Pressure", "lo2TankPressure"
+	};
+	static const char* massNames[PROPELLANT_TANKS] = {
+		"lh2Tank1Mass", "lh2Tank2Mass", "lh2Tank3Mass", "lh2Tank4Mass", "lh2Tank5Mass", "lh2Tank6Mass", "lo2TankMass"
+	};
+
+	for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+		recorder.addChannel(pressureNames[i], "Pa", &pressure[i]);
+		recorder.addChannel(massNames[i], "kg", &liquidMass[i]);
+	}
+}
+
+void PropellantTanks::preStep(double simt, double simdt, double mjd) {
+	if (!synced) {
+		loadFromResources();
+	}
+	//The draw since the last update is the difference to the resources as last seen, so it adds up by itself
+	skippedTime += simdt;
+	unsigned int frame = frames++;
+	if (fidelity > 0 && !isDecimationFrame(frame, TANK_FIDELITY_DECIMATION)) {
+		return;
+	}
+	step(takeDraw(skippedTime), skippedTime);
+	syncResources();
+	skippedTime = 0.0;
+}
+
+int PropellantTanks::countFidelityLevels() const {
+	return 2;
+}
+
+PropellantTanks::Real PropellantTanks::vaporDensity(const Real& t) const {
+	return NORMAL_PRESSURE * exp(saturationSlope * (saturationReference - 1.0 / t)) / (gasConstant * t);
+}
+
+void PropellantTanks::step(const Real& draw, double dt) {
+	if (dt <= 0.0) {
+		return;
+	}
+
+	//Autogenous pressurization fills the volume the feed drew with vapor of the current state
+	Mask feeding = draw > 0.0;
+	Real pressurant = select(feeding, minimum(draw, liquidMass) / liquidDensity * vaporDensity(temperature), 0.0);
+
+	Real heat = heatLeak * dt;
+	//A leak takes liquid overboard on top of the draw, without pressurization to replace it
+	Real leaked = minimum(leakRate * dt, maximum(liquidMass - draw - pressurant, 0.0));
+	Real liquid = maximum(liquidMass - draw - pressurant - leaked, 0.0);
+	Real heatCapacity = liquid * liquidHeat;
+	Real ullage = maximum(volume - liquid / liquidDensity, volume * TANK_MINIMUM_ULLAGE);
+	Real previousVapor = vaporMass + pressurant;
+	Real previousTemperature = temperature;
+
+	/* Energy balance at saturation temperature t: heat left after warming the liquid to t and evaporating enough
+	 * of it to fill the ullage at the saturation pressure of t. It rises with t and is convex, so Newton started
+	 * from the relief temperature approaches the root from above without overshooting.
+	 */
+	Real relief = heatCapacity * (reliefTemperature - previousTemperature) + latentHeat * (ullage * vaporDensity(reliefTemperature) - previousVapor) - heat;
+
+	Real t = reliefTemperature;
+	for (int i = 0; i < TANK_NEWTON_ITERATIONS; ++i) {
+		Real density = vaporDensity(t);
+		Real balance = heatCapacity * (t - previousTemperature) + latentHeat * (ullage * density - previousVapor) - heat;
+		Real slope = heatCapacity + latentHeat * ullage * density * (saturationSlope / (t * t) - 1.0 / t);
+		t = t - balance / slope;
+	}
+	t = maximum(minimum(t, reliefTemperature), minimumTemperature);
+
+	//Enough heat to reach the relief pressure: the vent holds it and boils off the rest
+	Mask venting = relief <= 0.0;
+	t = select(venting, reliefTemperature, t);
+
+	Real density = vaporDensity(t);
+	Real vapor = ullage * density;
+	//Liquid evaporated by the heat, the surplus at relief pressure on top of what fills the ullage
+	Real evaporated = select(venting, vapor - relief / latentHeat, vapor) - previousVapor;
+	Real remaining = maximum(liquid - evaporated, 0.0);
+	//While venting, the ullage of the new level is held at relief pressure and the rest of the vapor leaves
+	Real ventedUllage = maximum(volume - remaining / liquidDensity, volume * TANK_MINIMUM_ULLAGE);
+	vapor = select(venting, ventedUllage * density, vapor);
+	Real vented = select(venting, maximum(previousVapor + minimum(evaporated, liquid) - vapor, 0.0), 0.0);
+	Real p = density * gasConstant * t;
+
+	/* Not enough liquid left to saturate the ullage: all of it evaporates, and the heat left over warms the vapor,
+	 * an ideal gas in the whole volume. Above the relief pressure the vent lets out what the volume can't hold.
+	 */
+	Mask dry = evaporated >= liquid;
+	Real dryVapor = previousVapor + liquid;
+	Real superheat = maximum(heat - latentHeat * liquid, 0.0);
+	Real dryTemperature = select(dryVapor > 0.0, previousTemperature + superheat / (dryVapor * vaporHeat), previousTemperature);
+	dryTemperature = minimum(dryTemperature, maximum(previousTemperature, TANK_STRUCTURE_TEMPERATURE));
+	Real dryVented = maximum(dryVapor - reliefPressure * volume / (gasConstant * dryTemperature), 0.0);
+	dryVapor -= dryVented;
+
+	liquidMass = select(dry, 0.0, remaining);
+	vaporMass = select(dry, dryVapor, vapor);
+	temperature = select(dry, dryTemperature, t);
+	pressure = select(dry, dryVapor * gasConstant * dryTemperature / volume, p);
+	vented = select(dry, dryVented, vented);
+	ventedMass += vented;
+	leakedMass += leaked;
+	pressurizationPower = pressurant * latentHeat / dt;
+}
+
+void PropellantTanks::loadFromResources() {
+	//Take over the propellant load of the scenario, spread over the tanks by their capacity
+	double lh2 = vessel->GetPropellantMass(phLH2);
+	double lo2 = vessel->GetPropellantMass(phLO2);
+	for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+		double load = i == LO2_TANK ? lo2 / TUG_LO2TANK_MAXIMUM_MASS : lh2 / TUG_LH2TANK_MAXIMUM_MASS;
+		liquidMass[i] = min(max(load, 0.0), 1.0) * capacity[i];
+	}
+	Real ullage = maximum(volume - liquidMass / liquidDensity, volume * TANK_MINIMUM_ULLAGE);
+	vaporMass = select(capacity > 0.0, ullage * vaporDensity(temperature), 0.0);
+
+	syncedLH2 = lh2;
+	syncedLO2 = lo2;
+	seenLH2 = lh2;
+	seenLO2 = lo2;
+	dryMass = vessel->GetEmptyMass();
+	syncedOffline = 0.0;
+	synced = true;
+}
+
+PropellantTanks::Real PropellantTanks::takeDraw(double simdt) {
+	//Tanks that ran dry drop out of the split, a refill brings them back
+	double resourceLH2 = vessel->GetPropellantMass(phLH2);
+	double resourceLO2 = vessel->GetPropellantMass(phLO2);
+	double lh2 = seenLH2 - resourceLH2;
+	double lo2 = seenLO2 - resourceLO2;
+	seenLH2 = resourceLH2;
+	seenLO2 = resourceLO2;
+	for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+		feed.setTankAvailable(i, liquidMass[i] > 0.0 || (i == LO2_TANK ? lo2 : lh2) < 0.0);
+	}
+
+	//The accumulator tops up from the sump while the RCS valve is open
+	double sump = 0.0;
+	const std::vector<double>& rcsSplit = feed.getFractions(rcsAccumulator);
+	for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+		sump += rcsSplit[i] > 0.0 ? liquidMass[i] : 0.0;
+	}
+	double missing = vessel->GetPropellantMaxMass(phRCS) - vessel->GetPropellantMass(phRCS);
+	rcsRefill = missing > config.syncTolerance ? min(min(missing, config.rcsRefillRate * simdt), sump) : 0.0;
+
+	Real draw(0.0);
+	addDraw(draw, engineLH2, lh2);
+	addDraw(draw, engineLO2, lo2);
+	addDraw(draw, rcsAccumulator, rcsRefill);
+	return draw;
+}
+
+void PropellantTanks::addDraw(Real& draw, int consumer, double mass) {
+	if (mass == 0.0) {
+		return;
+	}
+	const std::vector<double>& split = feed.getFractions(consumer);
+	for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+		draw[i] += mass * split[i];
+	}
+}
+
+void PropellantTanks::syncResources() {
+	double lh2 = 0.0;
+	double lo2 = 0.0;
+	double offline = 0.0;
+	for (unsigned int i = 0; i < PROPELLANT_TANKS; ++i) {
+		offline += vaporMass[i];
+		if (feed.feeds(engineLH2, i)) {
+			lh2 += liquidMass[i];
+		}
+		else if (feed.feeds(engineLO2, i)) {
+			lo2 += liquidMass[i];
+		}
+		else {
+			offline += liquidMass[i];
+		}
+	}
+
+	if (fabs(lh2 - syncedLH2) > config.syncTolerance) {
+		vessel->SetPropellantMass(phLH2, lh2);
+		syncedLH2 = lh2;
+		seenLH2 = lh2;
+	}
+	if (fabs(lo2 - syncedLO2) > config.syncTolerance) {
+		vessel->SetPropellantMass(phLO2, lo2);
+		syncedLO2 = lo2;
+		seenLO2 = lo2;
+	}
+	if (rcsRefill > 0.0) {
+		vessel->SetPropellantMass(phRCS, vessel->GetPropellantMass(phRCS) + rcsRefill);
+	}
+	if (fabs(offline - syncedOffline) > config.syncTolerance) {
+		vessel->SetEmptyMass(dryMass + offline);
+		syncedOffline = offline;
+	}
+}
+
+void PropellantTanks::setIsolated(unsigned int tank, bool isolated) {
+	if (tank < PROPELLANT_TANKS) {
+		feed.setLineOpen(tankValves[tank], !isolated);
+	}
+}
+
+bool PropellantTanks::isIsolated(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? !feed.isLineOpen(tankValves[tank]) : true;
+}
+
+void PropellantTanks::setValve(FEEDVALVE valve, bool open) {
+	feed.setLineOpen(valves[(int)valve], open);
+}
+
+bool PropellantTanks::isValveOpen(FEEDVALVE valve) const {
+	return feed.isLineOpen(valves[(int)valve]);
+}
+
+double PropellantTanks::getFeedFraction(unsigned int tank) {
+	if (tank >= PROPELLANT_TANKS) {
+		return 0.0;
+	}
+	return feed.getFractions(tank == LO2_TANK ? engineLO2 : engineLH2)[tank];
+}
+
+void PropellantTanks::setLeakRate(unsigned int tank, double rate) {
+	if (tank < PROPELLANT_TANKS) {
+		leakRate[tank] = max(rate, 0.0);
+	}
+}
+
+double PropellantTanks::getLeakRate(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? leakRate[tank] : 0.0;
+}
+
+double PropellantTanks::getLiquidMass(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? liquidMass[tank] : 0.0;
+}
+
+double PropellantTanks::getVaporMass(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? vaporMass[tank] : 0.0;
+}
+
+double PropellantTanks::getPressure(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? pressure[tank] : 0.0;
+}
+
+double PropellantTanks::getTemperature(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? temperature[tank] : 0.0;
+}
+
+double PropellantTanks::getVentedMass(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? ventedMass[tank] : 0.0;
+}
+
+double PropellantTanks::getPressurizationPower(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? pressurizationPower[tank] : 0.0;
+}
+
+double PropellantTanks::getLeakedMass(unsigned int tank) const {
+	return tank < PROPELLANT_TANKS ? leakedMass[tank] : 0.0;
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include "core/Lanes.h"
+#include "core/OrbitalHauler.h"
+#include "model/PropellantTankConfig.h"
+#include "FeedNetwork.h"
+
+class TelemetryRecorder;
+
+/* Six LH2 tanks and the LO2 tank
+ */
+const unsigned int PROPELLANT_TANKS = TUG_NUMBER_LH2_TANKS + 1;
+const unsigned int LO2_TANK = TUG_NUMBER_LH2_TANKS;
+//All tanks are stepped together in one block of lanes, the last lane is unused
+const unsigned int PROPELLANT_TANK_LANES = 8;
+//The ullage never gets smaller than this fraction of the tank volume
+const double TANK_MINIMUM_ULLAGE = 0.01;
+const double NORMAL_PRESSURE = 101325.0;
+//Temperature of the tank structure in K, the heat leak warms the vapor of a dry tank no further
+const double TANK_STRUCTURE_TEMPERATURE = 250.0;
+//Newton iterations for the saturation temperature of a closed tank
+const int TANK_NEWTON_ITERATIONS = 5;
+//Steps per tank update at the reduced fidelity level
+const int TANK_FIDELITY_DECIMATION = 8;
+//Relative hydraulic conductance of the tank outlets, the manifolds and the feed lines
+const double FEED_TANK_CONDUCTANCE = 1.0;
+const double FEED_MANIFOLD_CONDUCTANCE = 3.0;
+const double FEED_LINE_CONDUCTANCE = 6.0;
+
+/* Valves of the feed system, besides the outlet valves of the tanks.
+ */
+enum class FEEDVALVE {
+	//Manifolds of LH2 tanks 1 to 3 and 4 to 6 to the sump
+	PORT_MANIFOLD,
+	STARBOARD_MANIFOLD,
+	//Sump to the engine
+	ENGINE_LH2,
+	//LO2 tank to the engine
+	ENGINE_LO2,
+	//Sump to the RCS accumulator
+	RCS
+};
+const unsigned int FEEDVALVE_COUNT = 5;
+
+/* Properties of a cryogenic propellant, taken as constant over the narrow range of saturation states in the tanks.
+ * The saturation curve follows Clausius-Clapeyron through the normal boiling point.
+ */
+struct CryoFluid {
+	//Density of the liquid in kg/m3
+	double liquidDensity;
+	//Specific heat of the liquid in J/(kg K)
+	double liquidHeat;
+	//Heat of vaporization in J/kg
+	double latentHeat;
+	//Specific gas constant of the vapor in J/(kg K)
+	double gasConstant;
+	//Saturation temperature at normal pressure in K
+	double boilingPoint;
+	//Triple point in K, the liquid never gets colder
+	double triplePoint;
+	//Specific heat of the vapor at constant volume in J/(kg K), warms it once the liquid is gone
+	double vaporHeat;
+};
+
+const CryoFluid LH2_FLUID = { 70.8, 9700.0, 446000.0, 4124.0, 20.27, 13.8, 6190.0 };
+const CryoFluid LO2_FLUID = { 1141.0, 1700.0, 213000.0, 259.8, 90.19, 54.4, 650.0 };
+
+/**
+ * \brief Liquid and vapor state of the cryogenic propellant tanks.
+ *
+ * Every tank holds saturated liquid under its own vapor. The heat leak warms the liquid and evaporates as much of it as
+ * the ullage takes at the new saturation pressure, until the vent valve holds the relief pressure and every further
+ * joule boils off overboard. A tank that ran dry keeps its vapor, which the heat leak warms above saturation up to the
+ * relief pressure, and the vent holds it there. While a tank feeds, autogenous pressurization taps liquid from the feed line, evaporates it
+ * with engine heat and returns it to the ullage, so the ullage pressure holds while the level drops.
+ *
+ * The tanks feed their consumers through a FeedNetwork: the LH2 tanks over two manifolds into the sump, and from there
+ * the engine and the RCS accumulator, the LO2 tank directly into the engine. How a draw splits over the tanks follows
+ * from the valve positions and is only solved again when a valve moves or a tank runs dry.
+ *
+ * The state of a tank only depends on the energy that went into it, so a step solves the energy balance over its whole
+ * length instead of integrating rates: with constant heat leak one step of a month gives the same boil-off as a million
+ * small ones, which keeps time acceleration cheap. All tanks are stored as arrays of lanes and solved in one pass.
+ *
+ * Orbiter only knows the aggregate propellant resources. phLH2 and phLO2 hold the liquid of the tanks that feed the
+ * engine, phRCS the RCS accumulator, which the sump refills. Vapor and the liquid of tanks cut off from the engine are
+ * added to the empty mass of the vessel instead. Whatever the thrusters took from the resources since the last step is
+ * drawn from the tanks, and the resources are only written again once the tanks differ by more than the sync tolerance.
+ */
+class PropellantTanks :
+	public VesselSystem
+{
+public:
+	typedef Lanes<PROPELLANT_TANK_LANES> Real;
+	typedef LaneMask<PROPELLANT_TANK_LANES> Mask;
+
+	PropellantTanks(OrbitalHauler* vessel, const PropellantTankConfig& config, PROPELLANT_HANDLE phLH2, PROPELLANT_HANDLE phLO2, PROPELLANT_HANDLE phRCS);
+	~PropellantTanks();
+
+	virtual void init(EventBroker& eventBroker);
+	virtual void preStep(double simt, double simdt, double mjd);
+	/* Full, and the tanks only updated every TANK_FIDELITY_DECIMATION steps over the time since the last update.
+	 * @sa VesselSystem::setFidelity
+	 */
+	virtual int countFidelityLevels() const;
+	void registerTelemetry(TelemetryRecorder& recorder);
+
+	/* Advances all tanks by dt, after drawing the given mass of liquid from each.
+	 */
+	void step(const Real& draw, double dt);
+
+	/* Isolated tanks neither feed nor get refilled.
+	 */
+	void setIsolated(unsigned int tank, bool isolated);
+	bool isIsolated(unsigned int tank) const;
+	void setValve(FEEDVALVE valve, bool open);
+	bool isValveOpen(FEEDVALVE valve) const;
+	//Fraction of the engine feed drawn from a tank
+	double getFeedFraction(unsigned int tank);
+	/* Fault injection: liquid lost overboard through a leak in kg/s, 0.0 for a sound tank.
+	 */
+	void setLeakRate(unsigned int tank, double rate);
+	double getLeakRate(unsigned int tank) const;
+
+	double getLiquidMass(unsigned int tank) const;
+	double getVaporMass(unsigned int tank) const;
+	//Ullage pressure in Pa
+	double getPressure(unsigned int tank) const;
+	//Saturation temperature in K, temperature of the vapor once the tank ran dry
+	double getTemperature(unsigned int tank) const;
+	//Boil-off vented overboard since the start in kg
+	double getVentedMass(unsigned int tank) const;
+	//Engine heat used for autogenous pressurization over the last step in W
+	double getPressurizationPower(unsigned int tank) const;
+	//Liquid lost through leaks since the start in kg
+	double getLeakedMass(unsigned int tank) const;
+
+protected:
+	virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
+
+private:
+	PropellantTankConfig config;
+	PROPELLANT_HANDLE phLH2;
+	PROPELLANT_HANDLE phLO2;
+	PROPELLANT_HANDLE phRCS;
+
+	FeedNetwork feed;
+	//Lines of the tank outlet valves and of the other valves
+	int tankValves[PROPELLANT_TANKS];
+	int valves[FEEDVALVE_COUNT];
+	//Consumer nodes
+	int engineLH2;
+	int engineLO2;
+	int rcsAccumulator;
+
+	//Per tank: fluid properties and configuration
+	Real volume;
+	Real heatLeak;
+	Real liquidDensity;
+	Real liquidHeat;
+	Real latentHeat;
+	Real gasConstant;
+	Real vaporHeat;
+	//Slope latentHeat / gasConstant and reference 1 / boilingPoint of the saturation curve
+	Real saturationSlope;
+	Real saturationReference;
+	//Saturation temperature at the relief pressure
+	Real reliefTemperature;
+	Real reliefPressure;
+	Real minimumTemperature;
+	//Liquid mass a full tank holds in kg
+	Real capacity;
+	Real leakRate;
+
+	//Per tank: state
+	Real liquidMass;
+	Real vaporMass;
+	Real temperature;
+	Real pressure;
+	Real ventedMass;
+	Real pressurizationPower;
+	Real leakedMass;
+
+	//What was last written to the propellant resources and the empty mass
+	double syncedLH2;
+	double syncedLO2;
+	double syncedOffline;
+	//Propellant resources as of the last draw, what the thrusters took since is the next draw
+	double seenLH2;
+	double seenLO2;
+	//Mass the RCS accumulator takes from the sump in this step
+	double rcsRefill;
+	double dryMass;
+	//False until the tanks took over the propellant load of the scenario
+	bool synced;
+	//Steps of the tanks, and time since the last update at the reduced fidelity level
+	unsigned int frames;
+	double skippedTime;
+
+	Real vaporDensity(const Real& t) const;
+	void loadFromResources();
+	Real takeDraw(double simdt);
+	void addDraw(Real& draw, int consumer, double mass);
+	void syncResources();
+};
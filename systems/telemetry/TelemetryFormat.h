@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * \file TelemetryFormat.h
+ * Layout of the telemetry files written by TelemetryRecorder.
+ *
+ * A file starts with a TelemetryFileHeader, followed by one TelemetryChannelInfo per channel and any number of chunks.
+ * Every chunk is a TelemetryChunkHeader followed by sampleCount doubles of sim time and then sampleCount doubles
+ * for each channel in the order of the channel table. Columns are contiguous, so a single channel can be read without
+ * touching the others.
+ * All records are multiples of 8 bytes and written in native (little endian) byte order, so a mapped file can be read in place.
+ * A chunk holds up to chunkSamples samples. It ends early where samples were dropped, so a chunk never spans a drop, and
+ * at the end of the recording. If samples were dropped after the last sample written, an empty chunk counts them.
+ */
+
+const char TELEMETRY_FILE_MAGIC[8] = { 'O', 'H', 'T', 'E', 'L', 'E', 'M', '\0' };
+const uint32_t TELEMETRY_FILE_VERSION = 1;
+const uint32_t TELEMETRY_CHUNK_MAGIC = 0x4B4E4843; // "CHNK"
+
+const unsigned int TELEMETRY_NAME_LENGTH = 48;
+const unsigned int TELEMETRY_UNIT_LENGTH = 16;
+
+struct TelemetryFileHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t channelCount;
+	//Number of samples in a full chunk
+	uint32_t chunkSamples;
+	uint32_t reserved;
+};
+
+struct TelemetryChannelInfo {
+	char name[TELEMETRY_NAME_LENGTH];
+	char unit[TELEMETRY_UNIT_LENGTH];
+};
+
+struct TelemetryChunkHeader {
+	uint32_t magic;
+	//At most chunkSamples, 0 for a last chunk that only counts the samples dropped after the others
+	uint32_t sampleCount;
+	//Index of the first sample of this chunk since the recording started
+	uint64_t firstSample;
+	//Samples lost between the previous chunk and this one because the writer fell behind
+	uint64_t droppedSamples;
+};
+
+static_assert(sizeof(TelemetryFileHeader) % 8 == 0, "Telemetry records must be 8 byte aligned");
+static_assert(sizeof(TelemetryChannelInfo) % 8 == 0, "Telemetry records must be 8 byte aligned");
+static_assert(sizeof(TelemetryChunkHeader) % 8 == 0, "Telemetry records must be 8 byte aligned");
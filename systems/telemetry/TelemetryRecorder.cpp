@@ -0,0 +1,229 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "Oparse.h"
+#include "model/Models.h"
+#include "event/Events.h"
+#include "systems/VesselSystem.h"
+#include "core/Trace.h"
+
+#include "TelemetryFormat.h"
+#include "TelemetryRecorder.h"
+
+#include <chrono>
+
+//The writer thread checks for a full chunk at least this often
+const int TELEMETRY_WRITER_PERIOD_MS = 250;
+
+
+TelemetryRecorder::TelemetryRecorder(OrbitalHauler* vessel, const TelemetryConfig& config) : VesselSystem(vessel, "Telemetry"),
+	filename(config.file), traceFile(config.traceFile), traceSpike(config.traceSpike), head(0), tail(0), dropped(0), droppedWritten(0), file(NULL), stopping(false)
+{
+	capacity = (unsigned int)max(2, config.bufferSamples);
+	chunkSamples = (unsigned int)max(1, min(config.chunkSamples, (int)capacity));
+}
+
+TelemetryRecorder::~TelemetryRecorder() {
+	stop();
+	if (!traceFile.empty() && Trace::isEnabled()) {
+		Trace::stop();
+		if (!Trace::write(traceFile.c_str())) {
+			Olog::error("Can't write trace file %s", traceFile.c_str());
+		}
+	}
+}
+
+void TelemetryRecorder::addChannel(const char* name, const char* unit, const double* source) {
+	channels.push_back(Channel{ name, unit, SourceType::DOUBLE, source });
+}
+
+void TelemetryRecorder::addChannel(const char* name, const char* unit, const float* source) {
+	channels.push_back(Channel{ name, unit, SourceType::FLOAT, source });
+}
+
+void TelemetryRecorder::addChannel(const char* name, const char* unit, const int* source) {
+	channels.push_back(Channel{ name, unit, SourceType::INT, source });
+}
+
+void TelemetryRecorder::addChannel(const char* name, const char* unit, const bool* source) {
+	channels.push_back(Channel{ name, unit, SourceType::BOOL, source });
+}
+
+void TelemetryRecorder::init(EventBroker& eventBroker) {
+	startTrace();
+	if (filename.empty()) {
+		return;
+	}
+
+	file = fopen(filename.c_str(), "wb");
+	if (file == NULL) {
+		Olog::error("Can't open telemetry file %s", filename.c_str());
+		return;
+	}
+
+	rings.assign((channels.size() + 1) * capacity, 0.0);
+	droppedBefore.assign(capacity, 0);
+	chunk.assign((channels.size() + 1) * chunkSamples, 0.0);
+	writeHeader();
+
+	Olog::info("Recording %d telemetry channels to %s", (int)channels.size(), filename.c_str());
+	writer = std::thread(&TelemetryRecorder::runWriter, this);
+}
+
+void TelemetryRecorder::startTrace() {
+	if (traceFile.empty()) {
+		return;
+	}
+	if (!Trace::isCompiled()) {
+		Olog::warn("Trace file %s configured, but this build has no tracing", traceFile.c_str());
+		return;
+	}
+	Trace::setSpikeThreshold(traceSpike, traceFile.c_str());
+	Trace::start();
+	Olog::info("Tracing to %s", traceFile.c_str());
+}
+
+void TelemetryRecorder::receiveEvent(Event_Base* event, EVENTTOPIC topic) {}
+
+bool TelemetryRecorder::isRecording() const {
+	return file != NULL;
+}
+
+unsigned int TelemetryRecorder::countChannels() const {
+	return (unsigned int)channels.size();
+}
+
+unsigned long long TelemetryRecorder::countDroppedSamples() const {
+	return dropped.load(std::memory_order_relaxed);
+}
+
+double TelemetryRecorder::sample(const Channel& channel) const {
+	switch (channel.type) {
+	case SourceType::FLOAT:
+		return *(const float*)channel.source;
+	case SourceType::INT:
+		return *(const int*)channel.source;
+	case SourceType::BOOL:
+		return *(const bool*)channel.source ? 1.0 : 0.0;
+	default:
+		return *(const double*)channel.source;
+	}
+}
+
+void TelemetryRecorder::preStep(double simt, double simdt, double mjd) {
+	if (file == NULL) {
+		return;
+	}
+
+	unsigned long long sampleIndex = head.load(std::memory_order_relaxed);
+	if (sampleIndex - tail.load(std::memory_order_acquire) >= capacity) {
+		dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	unsigned int slot = (unsigned int)(sampleIndex % capacity);
+	rings[slot] = simt;
+	for (size_t i = 0; i < channels.size(); ++i) {
+		rings[(i + 1) * capacity + slot] = sample(channels[i]);
+	}
+	droppedBefore[slot] = dropped.load(std::memory_order_relaxed);
+	head.store(sampleIndex + 1, std::memory_order_release);
+
+	if ((sampleIndex + 1) % chunkSamples == 0) {
+		wake.notify_one();
+	}
+}
+
+void TelemetryRecorder::writeHeader() {
+	TelemetryFileHeader header = {};
+	memcpy(header.magic, TELEMETRY_FILE_MAGIC, sizeof(header.magic));
+	header.version = TELEMETRY_FILE_VERSION;
+	header.channelCount = (uint32_t)channels.size();
+	header.chunkSamples = chunkSamples;
+	fwrite(&header, sizeof(header), 1, file);
+
+	for (const auto& channel : channels) {
+		TelemetryChannelInfo info = {};
+		strncpy(info.name, channel.name.c_str(), TELEMETRY_NAME_LENGTH - 1);
+		strncpy(info.unit, channel.unit.c_str(), TELEMETRY_UNIT_LENGTH - 1);
+		fwrite(&info, sizeof(info), 1, file);
+	}
+	fflush(file);
+}
+
+/*
+* Copies count samples starting at first out of every ring into one contiguous column each, and appends them as chunk.
+*/
+void TelemetryRecorder::writeChunk(unsigned long long first, unsigned int count) {
+	unsigned int start = (unsigned int)(first % capacity);
+	unsigned int beforeWrap = min(count, capacity - start);
+	size_t columns = channels.size() + 1;
+
+	for (size_t column = 0; column < columns; ++column) {
+		const double* ring = &rings[column * capacity];
+		double* target = &chunk[column * count];
+		memcpy(target, ring + start, beforeWrap * sizeof(double));
+		memcpy(target + beforeWrap, ring, (count - beforeWrap) * sizeof(double));
+	}
+
+	//The writer never puts a drop in between the samples of a chunk, so the drops before its first sample describe it.
+	//An empty chunk at the end carries the drops after the last sample.
+	unsigned long long droppedFirst = count > 0 ? droppedBefore[start] : dropped.load(std::memory_order_relaxed);
+	TelemetryChunkHeader header = {};
+	header.magic = TELEMETRY_CHUNK_MAGIC;
+	header.sampleCount = count;
+	header.firstSample = first + droppedFirst;
+	header.droppedSamples = droppedFirst - droppedWritten;
+	droppedWritten = droppedFirst;
+
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(chunk.data(), sizeof(double), columns * count, file);
+	fflush(file);
+}
+
+void TelemetryRecorder::runWriter() {
+	while (true) {
+		bool finish = stopping.load(std::memory_order_acquire);
+		unsigned long long first = tail.load(std::memory_order_relaxed);
+		unsigned long long available = head.load(std::memory_order_acquire) - first;
+
+		if (available >= chunkSamples || (finish && available > 0)) {
+			unsigned int count = (unsigned int)min(available, (unsigned long long)chunkSamples);
+			//Samples taken after a drop start the next chunk
+			unsigned long long drops = droppedBefore[first % capacity];
+			for (unsigned int i = 1; i < count; ++i) {
+				if (droppedBefore[(first + i) % capacity] != drops) {
+					count = i;
+					break;
+				}
+			}
+			writeChunk(first, count);
+			tail.store(first + count, std::memory_order_release);
+			continue;
+		}
+		if (finish) {
+			if (dropped.load(std::memory_order_relaxed) > droppedWritten) {
+				writeChunk(first, 0);
+			}
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(wakeMutex);
+		wake.wait_for(lock, std::chrono::milliseconds(TELEMETRY_WRITER_PERIOD_MS));
+	}
+}
+
+/*
+* Writes out everything still in the rings and closes the file.
+*/
+void TelemetryRecorder::stop() {
+	if (file == NULL) {
+		return;
+	}
+	stopping.store(true, std::memory_order_release);
+	wake.notify_one();
+	if (writer.joinable()) {
+		writer.join();
+	}
+	fclose(file);
+	file = NULL;
+}
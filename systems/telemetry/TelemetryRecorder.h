@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "systems/VesselSystem.h"
+
+struct TelemetryConfig;
+
+/**
+ * \brief Records selected simulation variables every step into a columnar binary file.
+ *
+ * Systems register the variables they want to have recorded as channels before init().
+ * Every step, the recorder copies the current value of each channel into a preallocated ring buffer per channel.
+ * That is all the simulation thread does: no allocation, no formatting, no I/O.
+ * A background thread drains the rings in chunks and appends them to the file, see TelemetryFormat.h for the layout.
+ *
+ * The rings are single producer, single consumer: the simulation thread only moves the head, the writer thread only the tail.
+ * If the writer falls behind and the rings run full, new samples are dropped and counted instead of blocking the simulation.
+ *
+ * The recorder should be the last vessel system, so it samples the state every other system computed in the same step.
+ * Use tools/telemetry2csv to convert a recording for analysis.
+ *
+ * The recorder also starts the trace of the hot paths if a trace file is configured, see core/Trace.h.
+ */
+class TelemetryRecorder :
+	public VesselSystem
+{
+public:
+	TelemetryRecorder(OrbitalHauler* vessel, const TelemetryConfig& config);
+	~TelemetryRecorder();
+
+	/* Channels can only be added before init. The source must outlive the recorder.
+	 */
+	void addChannel(const char* name, const char* unit, const double* source);
+	void addChannel(const char* name, const char* unit, const float* source);
+	void addChannel(const char* name, const char* unit, const int* source);
+	void addChannel(const char* name, const char* unit, const bool* source);
+
+	virtual void init(EventBroker& eventBroker);
+	virtual void preStep(double simt, double simdt, double mjd);
+
+	bool isRecording() const;
+	unsigned int countChannels() const;
+	//Number of samples lost because the writer thread fell behind
+	unsigned long long countDroppedSamples() const;
+
+protected:
+	virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
+
+private:
+	enum class SourceType { DOUBLE, FLOAT, INT, BOOL };
+
+	struct Channel {
+		std::string name;
+		std::string unit;
+		SourceType type;
+		const void* source;
+	};
+
+	std::string filename;
+	std::string traceFile;
+	double traceSpike;
+	unsigned int capacity;
+	unsigned int chunkSamples;
+
+	std::vector<Channel> channels;
+	/* One ring of capacity samples per column, stored back to back. Column 0 is the sim time,
+	 * column i + 1 is channel i.
+	 */
+	std::vector<double> rings;
+	//Per ring slot, samples dropped since the start before the sample in the slot was taken
+	std::vector<unsigned long long> droppedBefore;
+	//Staging buffer of the writer thread for one chunk
+	std::vector<double> chunk;
+
+	//Samples taken since the start, only written by the simulation thread
+	std::atomic<unsigned long long> head;
+	//Samples written to the file, only written by the writer thread
+	std::atomic<unsigned long long> tail;
+	std::atomic<unsigned long long> dropped;
+	unsigned long long droppedWritten;
+
+	FILE* file;
+	std::thread writer;
+	std::mutex wakeMutex;
+	std::condition_variable wake;
+	std::atomic<bool> stopping;
+
+	double sample(const Channel& channel) const;
+	void writeHeader();
+	void writeChunk(unsigned long long first, unsigned int count);
+	void runWriter();
+	void stop();
+	void startTrace();
+};
@@ -0,0 +1,99 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+
+#include "TrendHistory.h"
+
+
+TrendHistory::TrendHistory() {
+	double width = TREND_BASE_INTERVAL;
+	for (auto& it : levels) {
+		it.width = width;
+		width *= TREND_LEVEL_FACTOR;
+	}
+	clear();
+}
+
+void TrendHistory::add(double simt, double value) {
+	if (started && simt < latest) {
+		clear();
+	}
+	for (auto& it : levels) {
+		long long index = (long long)floor(simt / it.width);
+		if (!started) {
+			it.open = TrendBucket{ index, value, value };
+		}
+		else if (index != it.open.index) {
+			it.closed.push(it.open);
+			it.open = TrendBucket{ index, value, value };
+		}
+		else {
+			it.open.minimum = min(it.open.minimum, value);
+			it.open.maximum = max(it.open.maximum, value);
+		}
+	}
+	latest = simt;
+	started = true;
+}
+
+void TrendHistory::clear() {
+	for (auto& it : levels) {
+		it.closed.clear();
+	}
+	latest = 0.0;
+	started = false;
+}
+
+bool TrendHistory::empty() const {
+	return !started;
+}
+
+double TrendHistory::getLatest() const {
+	return latest;
+}
+
+double TrendHistory::getSpan() {
+	return TREND_BUCKETS * TREND_BASE_INTERVAL * pow((double)TREND_LEVEL_FACTOR, (double)(TREND_LEVELS - 1));
+}
+
+bool TrendHistory::plot(double window, unsigned int columns, double* minimum, double* maximum) const {
+	if (!started || columns == 0 || window <= 0.0) {
+		return false;
+	}
+	for (unsigned int c = 0; c < columns; ++c) {
+		minimum[c] = HUGE_VAL;
+		maximum[c] = -HUGE_VAL;
+	}
+
+	//Finest level that still reaches back over the whole window
+	const Level* level = &levels[TREND_LEVELS - 1];
+	for (const auto& it : levels) {
+		if (TREND_BUCKETS * it.width >= window) {
+			level = &it;
+			break;
+		}
+	}
+
+	double start = latest - window;
+	double columnWidth = window / columns;
+	//A bucket wider than a column fills all columns it overlaps
+	auto merge = [&](const TrendBucket& bucket) {
+		double from = bucket.index * level->width;
+		double to = min(from + level->width, latest);
+		int first = (int)floor((from - start) / columnWidth);
+		int last = (int)floor((to - start) / columnWidth);
+		for (int c = max(first, 0); c <= min(last, (int)columns - 1); ++c) {
+			minimum[c] = min(minimum[c], bucket.minimum);
+			maximum[c] = max(maximum[c], bucket.maximum);
+		}
+	};
+
+	merge(level->open);
+	for (unsigned int age = 0; age < level->closed.size(); ++age) {
+		const TrendBucket& bucket = level->closed.newest(age);
+		if ((bucket.index + 1) * level->width <= start) {
+			break;
+		}
+		merge(bucket);
+	}
+	return true;
+}
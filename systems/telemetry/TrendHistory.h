@@ -0,0 +1,61 @@
+#pragma once
+
+#include "core/FixedRingBuffer.h"
+
+//Buckets kept per level, about the width of an MFD in pixels
+const unsigned int TREND_BUCKETS = 256;
+const unsigned int TREND_LEVELS = 6;
+//Width of the buckets of a level relative to the level below
+const unsigned int TREND_LEVEL_FACTOR = 4;
+//Width of the finest buckets in s
+const double TREND_BASE_INTERVAL = 0.25;
+
+struct TrendBucket {
+	//Start of the bucket in bucket widths of its level since sim time 0
+	long long index;
+	double minimum;
+	double maximum;
+};
+
+/**
+ * \brief History of a value at several resolutions, for plotting it over windows from seconds to hours.
+ *
+ * Every level keeps the minimum and maximum of the value per bucket, in a ring of the last TREND_BUCKETS buckets.
+ * The finest level has buckets of TREND_BASE_INTERVAL and covers about a minute, every further level has
+ * TREND_LEVEL_FACTOR times wider buckets, up to about 18 hours for the coarsest level. Every sample goes into the
+ * open bucket of each level, so adding a sample is constant time and the memory is fixed, however long the mission.
+ *
+ * A plot takes the finest level that covers the window and merges its buckets into the columns, so it costs at most
+ * TREND_BUCKETS plus the number of columns, whatever the number of samples in the window. As the buckets keep the
+ * extremes, spikes shorter than a column are not averaged away.
+ */
+class TrendHistory {
+public:
+	TrendHistory();
+
+	/* Sim time going backwards, e.g. after loading a scenario, starts a new history.
+	 */
+	void add(double simt, double value);
+	void clear();
+	bool empty() const;
+	//Sim time of the last sample
+	double getLatest() const;
+	//Longest window that can be plotted in s
+	static double getSpan();
+
+	/* Minimum and maximum of the value per column, for columns equal columns of the window ending at the last sample.
+	 * Columns without samples get a minimum above the maximum. Returns false if there are no samples yet.
+	 */
+	bool plot(double window, unsigned int columns, double* minimum, double* maximum) const;
+
+private:
+	struct Level {
+		double width;
+		FixedRingBuffer<TrendBucket, TREND_BUCKETS> closed;
+		TrendBucket open;
+	};
+
+	Level levels[TREND_LEVELS];
+	double latest;
+	bool started;
+};
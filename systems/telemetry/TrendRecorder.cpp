@@ -0,0 +1,41 @@
+#include "core/Common.h"
+#include "OpStdLibs.h"
+#include "event/Events.h"
+#include "systems/VesselSystem.h"
+
+#include "TrendRecorder.h"
+
+
+TrendRecorder::TrendRecorder(OrbitalHauler* vessel) : VesselSystem(vessel, "Trends") {}
+
+void TrendRecorder::addTrend(const char* name, const char* unit, Value value) {
+	trends.push_back(Trend{ name, unit, value, TrendHistory() });
+}
+
+void TrendRecorder::init(EventBroker& eventBroker) {
+	Olog::info("Recording %d trends", (int)trends.size());
+}
+
+void TrendRecorder::receiveEvent(Event_Base* event, EVENTTOPIC topic) {}
+
+void TrendRecorder::preStep(double simt, double simdt, double mjd) {
+	for (auto& it : trends) {
+		it.history.add(simt, it.value());
+	}
+}
+
+unsigned int TrendRecorder::countTrends() const {
+	return (unsigned int)trends.size();
+}
+
+const char* TrendRecorder::getName(unsigned int trend) const {
+	return trends[trend].name.c_str();
+}
+
+const char* TrendRecorder::getUnit(unsigned int trend) const {
+	return trends[trend].unit.c_str();
+}
+
+const TrendHistory& TrendRecorder::getHistory(unsigned int trend) const {
+	return trends[trend].history;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "systems/VesselSystem.h"
+#include "TrendHistory.h"
+
+/**
+ * \brief Keeps the trend history of a few key values for the MFD plots, see TrendHistory.
+ *
+ * Unlike TelemetryRecorder, which writes every step to a file for later analysis, the trends stay in memory of
+ * fixed size for the crew, and are recorded whether or not an MFD shows them.
+ * Systems add their trends before init(). The recorder steps after them, so it samples the state of the same step.
+ */
+class TrendRecorder :
+	public VesselSystem
+{
+public:
+	typedef std::function<double()> Value;
+
+	TrendRecorder(OrbitalHauler* vessel);
+
+	/* Trends can only be added before init. Values are recorded in the given unit.
+	 */
+	void addTrend(const char* name, const char* unit, Value value);
+
+	virtual void init(EventBroker& eventBroker);
+	virtual void preStep(double simt, double simdt, double mjd);
+
+	unsigned int countTrends() const;
+	const char* getName(unsigned int trend) const;
+	const char* getUnit(unsigned int trend) const;
+	const TrendHistory& getHistory(unsigned int trend) const;
+
+protected:
+	virtual void receiveEvent(Event_Base* event, EVENTTOPIC topic);
+
+private:
+	struct Trend {
+		std::string name;
+		std::string unit;
+		Value value;
+		TrendHistory history;
+	};
+
+	std::vector<Trend> trends;
+};
@@ -0,0 +1,147 @@
+/**
+ * \file telemetry2csv.cpp
+ * Converts a telemetry recording of the OrbitalHauler into CSV.
+ *
+ * Usage: telemetry2csv <recording> [output.csv] [channel ...]
+ * Without output file, the CSV goes to stdout. If channels are given, only those are exported.
+ * A chunk truncated by a crash of the simulator is skipped.
+ *
+ * Standalone, builds with any C++11 compiler:
+ *   cl /EHsc /O2 /I..\.. telemetry2csv.cpp
+ *   g++ -O2 -I../.. telemetry2csv.cpp -o telemetry2csv
+ */
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "systems/telemetry/TelemetryFormat.h"
+
+using namespace std;
+
+static bool readFile(const char* filename, vector<char>& content) {
+	FILE* in = fopen(filename, "rb");
+	if (in == NULL) {
+		return false;
+	}
+	char buffer[65536];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+		content.insert(content.end(), buffer, buffer + read);
+	}
+	fclose(in);
+	return true;
+}
+
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		fprintf(stderr, "Usage: telemetry2csv <recording> [output.csv] [channel ...]\n");
+		return 1;
+	}
+
+	vector<char> content;
+	if (!readFile(argv[1], content)) {
+		fprintf(stderr, "Can't read %s\n", argv[1]);
+		return 1;
+	}
+
+	TelemetryFileHeader header;
+	if (content.size() < sizeof(header)) {
+		fprintf(stderr, "%s is not a telemetry recording\n", argv[1]);
+		return 1;
+	}
+	memcpy(&header, content.data(), sizeof(header));
+	if (memcmp(header.magic, TELEMETRY_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != TELEMETRY_FILE_VERSION) {
+		fprintf(stderr, "%s is not a telemetry recording of version %u\n", argv[1], TELEMETRY_FILE_VERSION);
+		return 1;
+	}
+
+	size_t offset = sizeof(header);
+	if (content.size() < offset + header.channelCount * sizeof(TelemetryChannelInfo)) {
+		fprintf(stderr, "%s: channel table is truncated\n", argv[1]);
+		return 1;
+	}
+	vector<TelemetryChannelInfo> channels(header.channelCount);
+	if (header.channelCount > 0) {
+		memcpy(channels.data(), content.data() + offset, header.channelCount * sizeof(TelemetryChannelInfo));
+	}
+	offset += header.channelCount * sizeof(TelemetryChannelInfo);
+
+	//Columns to export, column 0 is always the sim time
+	vector<unsigned int> selected;
+	for (unsigned int i = 0; i < header.channelCount; ++i) {
+		bool wanted = argc <= 3;
+		for (int arg = 3; arg < argc && !wanted; ++arg) {
+			wanted = strcmp(channels[i].name, argv[arg]) == 0;
+		}
+		if (wanted) {
+			selected.push_back(i + 1);
+		}
+	}
+
+	FILE* out = stdout;
+	if (argc > 2) {
+		out = fopen(argv[2], "w");
+		if (out == NULL) {
+			fprintf(stderr, "Can't write %s\n", argv[2]);
+			return 1;
+		}
+	}
+
+	fprintf(out, "simt [s]");
+	for (unsigned int column : selected) {
+		const TelemetryChannelInfo& info = channels[column - 1];
+		if (info.unit[0] != '\0') {
+			fprintf(out, ",%s [%s]", info.name, info.unit);
+		}
+		else {
+			fprintf(out, ",%s", info.name);
+		}
+	}
+	fprintf(out, "\n");
+
+	size_t columns = header.channelCount + 1;
+	unsigned long long samples = 0;
+	unsigned long long dropped = 0;
+	vector<double> values;
+
+	while (offset + sizeof(TelemetryChunkHeader) <= content.size()) {
+		TelemetryChunkHeader chunk;
+		memcpy(&chunk, content.data() + offset, sizeof(chunk));
+		offset += sizeof(chunk);
+		if (chunk.magic != TELEMETRY_CHUNK_MAGIC) {
+			fprintf(stderr, "%s: corrupt chunk at offset %zu\n", argv[1], offset - sizeof(chunk));
+			break;
+		}
+
+		size_t count = chunk.sampleCount;
+		if (content.size() - offset < columns * count * sizeof(double)) {
+			//Columns are written one after another, so a truncated chunk has no complete sample
+			fprintf(stderr, "%s: last chunk is truncated\n", argv[1]);
+			break;
+		}
+		values.resize(columns * count);
+		memcpy(values.data(), content.data() + offset, columns * count * sizeof(double));
+
+		for (size_t i = 0; i < count; ++i) {
+			fprintf(out, "%.6f", values[i]);
+			for (unsigned int column : selected) {
+				fprintf(out, ",%.9g", values[column * count + i]);
+			}
+			fprintf(out, "\n");
+		}
+
+		samples += count;
+		dropped += chunk.droppedSamples;
+		offset += columns * count * sizeof(double);
+	}
+
+	if (out != stdout) {
+		fclose(out);
+	}
+	fprintf(stderr, "%llu samples, %zu of %u channels exported, %llu samples dropped while recording\n",
+		samples, selected.size(), header.channelCount, dropped);
+	return 0;
+}